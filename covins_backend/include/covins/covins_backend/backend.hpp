@@ -53,8 +53,12 @@
 namespace covins {
 
 class AgentHandler;
+class KeyframePager;
 class Map;
+class MapJournal;
 class MapManager;
+class MapSaver;
+class TrajectoryWriter;
 class Visualizer;
 
 class AgentPackage : public std::enable_shared_from_this<AgentPackage> {
@@ -79,6 +83,10 @@ public:
     using VisPtr                        = TypeDefs::VisPtr;
     using ThreadPtr                     = TypeDefs::ThreadPtr;
     using VocabularyPtr                 = CovinsVocabulary::VocabularyPtr;
+    using SaverPtr                      = std::shared_ptr<MapSaver>;
+    using JournalPtr                    = std::shared_ptr<MapJournal>;
+    using PagerPtr                      = std::shared_ptr<KeyframePager>;
+    using WriterPtr                     = std::shared_ptr<TrajectoryWriter>;
 
 public:
     CovinsBackend();
@@ -113,8 +121,15 @@ protected:
     ManagerPtr                  mapmanager_;
     VisPtr                      vis_;
     VocabularyPtr               voc_;
+    SaverPtr                    saver_;
+    JournalPtr                  journal_;
+    PagerPtr                    pager_;
+    WriterPtr                   writer_;
 
     ThreadPtr                   thread_mapmanager_;
+    ThreadPtr                   thread_saver_;
+    ThreadPtr                   thread_journal_;
+    ThreadPtr                   thread_writer_;
     ThreadPtr                   thread_vis_;
 
     int                         agent_next_id_                                          = 0;
@@ -26,6 +26,7 @@
 // C++
 #include <memory>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <eigen3/Eigen/Core>
 
@@ -36,6 +37,7 @@
 
 namespace covins {
 
+class KeyframePager;
 class Map;
 
 class Keyframe : public KeyframeBase, public std::enable_shared_from_this<Keyframe> {
@@ -43,6 +45,7 @@ public:
     using MapPtr                        = TypeDefs::MapPtr;
     using VocabularyPtr                 = CovinsVocabulary::VocabularyPtr;
     using KeyframeIntMap                = TypeDefs::KeyframeIntMap;
+    using PagerPtr                      = std::shared_ptr<KeyframePager>;
 
     struct kf_less{
         auto operator() (const KeyframePtr a, const KeyframePtr b) const                ->bool;
@@ -53,11 +56,14 @@ public:
     static auto CompStamp(KeyframePtr kf1, KeyframePtr kf2)                             ->bool;     //greater - newest stamp at beginning of container
 
 public:
-    Keyframe(MsgKeyframe msg, MapPtr map, VocabularyPtr voc);
+    Keyframe(MsgKeyframe msg, MapPtr map, VocabularyPtr voc);                                    //voc==nullptr: BoW is not computed
+    ~Keyframe();
+
+    auto ComputeBoW(VocabularyPtr voc)                                                  ->void;
 
     auto EstablishConnections(MsgKeyframe msg, MapPtr map)                              ->void;    //Establishes connections to KFs/Landmarks - cannot call shared_from_this() from constructor!
 
-    auto EstablishNeighbors(MsgKeyframe msg, MapPtr map)                                ->void;    //Establishes extra neighbor connections for placerecognition (COVINS-G)
+    auto EstablishNeighbors(MapPtr map)                                                 ->void;    //Establishes extra neighbor connections for placerecognition (COVINS-G)
     // Interfaces
     virtual auto RemapLandmark(LandmarkPtr lm,
                                const size_t feat_id_now,
@@ -80,6 +86,8 @@ public:
     virtual auto ConvertToMsg(MsgKeyframe &msg,
                              KeyframePtr kf_ref, bool is_update)                        ->void;
     virtual auto ConvertToMsgFileExport(MsgKeyframe &msg)                               ->void;
+    virtual auto ConvertToMsgFileExportState(MsgKeyframe &msg)                          ->void;     // pose, IMU and associations only - cheap, for map snapshots
+    virtual auto ConvertToMsgFileExportFeatures(MsgKeyframe &msg)                       ->void;     // immutable data (calibration, keypoints, descriptors, image)
     virtual auto UpdatePoseFromMsg(MsgKeyframe &msg, MapPtr map)                        ->void;
 
     // BoW
@@ -95,9 +103,6 @@ public:
     // Image handling
     cv::Mat                     img_;
 
-    // Map Save/Load
-    MsgKeyframe                 msg_;
-
     // Redundancy detection
     double latest_red_val_ = 0.0;
 
@@ -114,6 +119,11 @@ public:
     auto GetDescriptorAddCV(size_t ind) -> cv::Mat;
     const unsigned char *GetDescriptorAdd(size_t ind);
 
+    // Paging - the matching payload (descriptors, undistorted & additional keypoints, bearings, grid, image) of KFs from prior maps can be evicted, see KeyframePager
+    auto PinPayload()                                                                   ->void;     // faults the payload in if it was evicted - use KeyframePayloadGuard
+    auto UnpinPayload()                                                                 ->void;
+    auto IsPaged()                                                                      ->bool;
+
 protected:
 
     // Interfaces
@@ -122,11 +132,47 @@ protected:
 
     // Covisibility Graph Functions
     virtual auto UpdateCovisibilityConnections()                                        ->void;     // This function should only be called by the map
+
+    // Paging
+    friend class KeyframePager;
+    auto SerializePayload()                                                             ->std::string;
+    auto LoadPayload(const char *data, size_t size)                                     ->void;
+    auto TryReleasePayload()                                                            ->bool;     // fails if the payload is pinned
     
     // Infrastructure
     bool                        pose_optimized_                                         = false;    // Indicates that this LM was part of an optimization process (important for landmark culling)
     bool                        vel_bias_optimized_                                     = false;
     bool                        not_erase_                                              = false;
+
+    // Paging
+    PagerPtr                    pager_;                                                             // nullptr: payload is always resident
+    int                         payload_pins_                                           = 0;
+    bool                        payload_resident_                                       = true;
+    std::mutex                  mtx_payload_;
+};
+
+// Keeps the payload of paged KFs in memory for the lifetime of the guard - no-op for KFs that are not paged
+class KeyframePayloadGuard {
+public:
+    using KeyframePtr                   = TypeDefs::KeyframePtr;
+    using KeyframeVector                = TypeDefs::KeyframeVector;
+
+    KeyframePayloadGuard(KeyframePtr kf)
+        : keyframes_{kf} {
+        if(kf) kf->PinPayload();
+    }
+    KeyframePayloadGuard(const KeyframeVector &keyframes)
+        : keyframes_(keyframes) {
+        for(const auto& kf : keyframes_) if(kf) kf->PinPayload();
+    }
+    ~KeyframePayloadGuard() {
+        for(const auto& kf : keyframes_) if(kf) kf->UnpinPayload();
+    }
+    KeyframePayloadGuard(const KeyframePayloadGuard&) = delete;
+    KeyframePayloadGuard& operator=(const KeyframePayloadGuard&) = delete;
+
+private:
+    KeyframeVector              keyframes_;
 };
 
 inline std::ostream& operator<<(std::ostream& out, const Keyframe::KeyframePtr kf) {
@@ -0,0 +1,102 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+
+namespace covins {
+
+// Out-of-core storage for the matching payload of KFs from prior maps
+//
+// The payload (descriptors, undistorted and additional keypoints, bearing vectors, keypoint grid, image) is only
+// needed by the matchers. It is written to a memory-mapped backing file and evicted from the KFs. A KF faults its
+// payload back in when it is pinned (see KeyframePayloadGuard); unpinned payloads are evicted in LRU order as soon as
+// the resident payloads exceed the budget. Poses, covisibility graph, landmark associations and BoW stay resident.
+class KeyframePager : public std::enable_shared_from_this<KeyframePager> {
+public:
+    using KeyframeVector                = TypeDefs::KeyframeVector;
+
+    struct Stats {
+        size_t                  num_pages                                               = 0;
+        size_t                  num_resident                                            = 0;
+        size_t                  resident_bytes                                          = 0;
+        size_t                  file_bytes                                              = 0;
+        size_t                  num_faults                                              = 0;
+        size_t                  num_evictions                                           = 0;
+    };
+
+public:
+    KeyframePager(std::string const &path_name, size_t budget_bytes);                                   // removes stale backing files in path_name
+    ~KeyframePager();
+
+    // Interfaces
+    auto AddKeyframes(const KeyframeVector &keyframes)                                  ->bool;     // writes the payloads to a new backing file and evicts them
+    auto GetStats()                                                                     ->Stats;
+
+protected:
+    friend class Keyframe;
+    auto GetPage(const Keyframe *kf, const char *&data, size_t &size)                   ->bool;     // location of the payload in the backing file
+    auto Touch(Keyframe *kf)                                                            ->void;     // payload is resident and was used - may evict other payloads
+    auto Remove(Keyframe *kf)                                                           ->void;
+
+    auto EvictOverBudget()                                                              ->void;
+
+    struct Segment {
+        std::string             filename;
+        char                    *data                                                   = nullptr;
+        size_t                  size                                                    = 0;
+    };
+
+    struct Page {
+        size_t                  segment;
+        size_t                  offset;
+        size_t                  size;
+        bool                    resident;
+        std::list<Keyframe*>::iterator lru;                                                         // only valid if resident
+    };
+
+    // Infrastructure
+    std::string                 path_name_;
+    size_t                      budget_bytes_;
+
+    // Data
+    std::vector<Segment>        segments_;
+    std::map<const Keyframe*,Page> pages_;
+    std::list<Keyframe*>        lru_;                                                               // resident payloads, most recently used first
+    Stats                       stats_;
+
+    // Sync
+    std::mutex                  mtx_pager_;
+};
+
+} //end ns
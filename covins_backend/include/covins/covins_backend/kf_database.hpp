@@ -58,6 +58,7 @@ public:
 
     // Interfacing
     virtual auto AddKeyframe(KeyframePtr kf)                                            ->void override;
+    virtual auto AddKeyframes(const KeyframeVector &kfs)                                ->void override;     // bulk insertion, e.g. of a loaded map
     virtual auto EraseKeyframe(KeyframePtr kf)                                          ->void override;
 
     // Loop Detection
@@ -62,9 +62,6 @@ public:
     // Ceres Variable Access
     precision_t                 ceres_pos_[robopt::defs::pose::kPositionBlockSize];
 
-    // Map Save/Load
-    MsgLandmark                 msg_;
-
     // debug
     bool                        tofuse_lm_                                              = false;
 
@@ -0,0 +1,119 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <eigen3/Eigen/Core>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+
+namespace covins {
+
+// Voxel-downsampled landmark cloud for visualization
+//
+// Each occupied voxel is represented by the centroid of its LMs. Voxels are grouped into cubic chunks of
+// chunk_voxels^3 voxels, which are the unit of publishing: every insertion/removal marks its chunk as changed, and
+// changed chunks are handed out oldest first. LM positions are not observed - Refresh() re-checks a bounded number of
+// LMs per call, round-robin, and moves them between voxels if they were corrected.
+class LandmarkLod {
+public:
+    using precision_t                   = TypeDefs::precision_t;
+    using idpair                        = TypeDefs::idpair;
+    using Vector3Type                   = TypeDefs::Vector3Type;
+    using Vector3Vector                 = TypeDefs::Vector3Vector;
+    using LandmarkPtr                   = TypeDefs::LandmarkPtr;
+
+    struct Chunk {
+        int                     id;                                                                 // stable while the chunk is occupied
+        bool                    erased;                                                             // last voxel was removed
+        Vector3Vector           points;                                                             // voxel centroids
+        std::vector<size_t>     client_ids;                                                         // same order as points - agent of the first LM in the voxel
+    };
+
+public:
+    LandmarkLod(precision_t voxel_size, int chunk_voxels = 16);
+
+    // Interfaces
+    auto Clear()                                                                        ->void;
+    auto Insert(LandmarkPtr lm)                                                         ->void;
+    auto Remove(idpair id)                                                              ->void;
+    auto Refresh(size_t max_num)                                                        ->void;     // re-checks the positions of up to max_num LMs
+
+    auto HasChanges()                                                                   ->bool;
+    auto PopChangedChunk(Chunk &chunk, size_t max_points)                               ->bool;     // false if there is no change or the oldest changed chunk has more than max_points voxels
+    auto GetNumVoxels()                                                                 ->size_t;
+
+protected:
+    using VoxelKey                      = int64_t;
+    using ChunkKey                      = int64_t;
+
+    struct Voxel {
+        Vector3Type             sum                                             = Vector3Type::Zero();
+        size_t                  count                                           = 0;
+        size_t                  client_id                                       = 0;
+    };
+    using VoxelMap                      = std::unordered_map<VoxelKey,Voxel>;
+
+    struct ChunkData {
+        int                     id;
+        VoxelMap                voxels;
+    };
+
+    struct Entry {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        LandmarkPtr             lm;
+        Vector3Type             pos;                                                                // position contained in the voxel sum
+        VoxelKey                voxel;
+        ChunkKey                chunk;
+    };
+    using EntryMap                      = std::map<idpair,Entry,std::less<idpair>,Eigen::aligned_allocator<std::pair<const idpair,Entry>>>;
+
+    auto GetVoxelKey(const Vector3Type &pos, ChunkKey &chunk)                           ->VoxelKey;
+    auto AddToVoxel(VoxelKey voxel, ChunkKey chunk, const Vector3Type &pos,
+                    size_t client_id)                                                   ->void;
+    auto RemoveFromVoxel(VoxelKey voxel, ChunkKey chunk, const Vector3Type &pos)        ->void;
+    auto MarkChanged(ChunkKey chunk)                                                    ->void;
+
+    // Parameters
+    const precision_t           voxel_size_;
+    const int                   chunk_voxels_;
+
+    // Data
+    EntryMap                    entries_;
+    std::unordered_map<ChunkKey,ChunkData> chunks_;
+    std::deque<ChunkKey>        changed_;                                                           // oldest first
+    std::unordered_set<ChunkKey> changed_set_;
+    std::unordered_map<ChunkKey,int> erased_chunks_;                                                // emptied chunks whose removal is not published yet
+    idpair                      refresh_pos_                                    = defpair;
+    int                         next_chunk_id_                                  = 0;
+};
+
+} //end ns
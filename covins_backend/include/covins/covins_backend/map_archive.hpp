@@ -0,0 +1,230 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+#include <covins/covins_base/msgs/msg_keyframe.hpp>
+#include "covins_base/vocabulary.h"
+
+namespace covins {
+
+// Single-file map archive
+//
+// Layout:  [Header][SectionEntry x num_sections][Section 0]...[Section N-1]
+// Sections are 64-byte aligned. Readers ignore sections they do not know. Sections holding variable-size objects store one record per object,
+// each prefixed by its byte length (uint64_t) and serialized with cereal. Sections can be zlib-compressed
+// individually. All integers are stored in host byte order.
+
+namespace MapArchive {
+
+    enum eSection : uint32_t {
+        KEYFRAMES       = 0,        // MsgKeyframe (file export) without descriptors, one record per KF
+        LANDMARKS       = 1,        // MsgLandmark (file export) without observations, one record per LM
+        OBSERVATIONS    = 2,        // flat array of ObservationRecord
+        DESCRIPTORS     = 3,        // descriptors/descriptors_add of the KFs, one record per KF (same order as KEYFRAMES)
+        MAPDATA         = 4,        // MsgMap
+        BOW             = 5,        // optional: vocabulary fingerprint (uint64_t), then one BowRecord per KF (same order as KEYFRAMES)
+        NUM_SECTIONS    = 6
+    };
+
+    enum eSectionFlags : uint32_t {
+        FLAG_NONE       = 0,
+        FLAG_ZLIB       = 1
+    };
+
+    const char                  magic[8]                                                = {'C','O','V','I','N','S','M','A'};
+    const uint32_t              version                                                 = 1;
+    const std::string           filename                                                = "map.cvma";
+
+    struct Header {
+        char                    magic[8];
+        uint32_t                version;
+        uint32_t                num_sections;
+    };
+
+    struct SectionEntry {
+        uint32_t                type;
+        uint32_t                flags;
+        uint64_t                count;                                                  // number of records/elements
+        uint64_t                offset;                                                 // from beginning of file
+        uint64_t                size;                                                   // stored size
+        uint64_t                raw_size;                                               // size after decompression
+    };
+
+    struct ObservationRecord {
+        uint32_t                lm_idx;                                                 // index into LANDMARKS section
+        uint32_t                kf_id;
+        uint32_t                client_id;
+        uint32_t                feat_id;
+    };
+
+    struct DescriptorRecord {
+        cv::Mat                 descriptors;
+        cv::Mat                 descriptors_add;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(descriptors,descriptors_add);
+        }
+    };
+
+    // BoW and feature vector of a KF, flattened for fast serialization
+    struct BowRecord {
+        std::vector<uint32_t>   words;
+        std::vector<double>     values;
+        std::vector<uint32_t>   nodes;
+        std::vector<uint32_t>   node_offsets;                                           // features of nodes[i]: features[node_offsets[i]...node_offsets[i+1]-1]
+        std::vector<uint32_t>   features;
+
+        auto FromBow(const DBoW2::BowVector &bow_vec, const DBoW2::FeatureVector &feat_vec)  ->void;
+        auto ToBow(DBoW2::BowVector &bow_vec, DBoW2::FeatureVector &feat_vec) const     ->void;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(words,values,nodes,node_offsets,features);
+        }
+    };
+
+    // Hash over the vocabulary structure and all words - BoW data stored with a different vocabulary cannot be reused
+    auto VocabularyFingerprint(CovinsVocabulary::VocabularyPtr voc)                     ->uint64_t;
+
+    static_assert(sizeof(Header) == 16,"unexpected padding in MapArchive::Header");
+    static_assert(sizeof(SectionEntry) == 40,"unexpected padding in MapArchive::SectionEntry");
+    static_assert(sizeof(ObservationRecord) == 16,"unexpected padding in MapArchive::ObservationRecord");
+
+    // Read-only std::streambuf over an existing memory region (e.g. mmap'ed file) - avoids copying records
+    class MemoryBuffer : public std::streambuf {
+    public:
+        MemoryBuffer(const char *data, size_t size) {
+            char *p = const_cast<char*>(data);
+            this->setg(p,p,p+size);
+        }
+    };
+
+    struct RecordSpan {
+        const char              *data                                                   = nullptr;
+        size_t                  size                                                    = 0;
+    };
+
+    template<typename T> auto Deserialize(const RecordSpan &record, T &obj)             ->void {
+        MemoryBuffer buf(record.data,record.size);
+        std::istream is(&buf);
+        cereal::BinaryInputArchive iarchive(is);
+        iarchive(obj);
+    }
+
+    inline auto Exists(std::string const &path_name)                                    ->bool {
+        std::ifstream fs(path_name + "/" + filename);
+        return fs.good();
+    }
+
+} //end ns MapArchive
+
+class MapArchiveWriter {
+public:
+    using eSection                      = MapArchive::eSection;
+
+public:
+    MapArchiveWriter(bool compress);
+
+    auto Open(std::string const &filename)                                              ->bool;
+    auto Close()                                                                        ->bool;
+
+    // Sections are written one after another: BeginSection -> Add... -> EndSection
+    auto BeginSection(eSection section)                                                 ->void;
+    auto EndSection()                                                                   ->void;
+
+    template<typename T> auto AddRecord(const T &obj)                                   ->void {
+        std::stringstream ss;
+        {
+            cereal::BinaryOutputArchive oarchive(ss);
+            oarchive(obj);
+        }
+        const std::string data = ss.str();
+        const uint64_t len = data.size();
+        this->Append(reinterpret_cast<const char*>(&len),sizeof(len));
+        this->Append(data.data(),data.size());
+        ++count_;
+    }
+
+    auto AddRaw(const void *data, size_t size, size_t count)                            ->void;
+
+    auto GetBytesWritten()                                                              ->size_t { return bytes_written_; }
+
+protected:
+    auto Append(const char *data, size_t size)                                          ->void;
+    auto Pad()                                                                          ->void;
+
+    // Infrastructure
+    const bool                  compress_;
+    std::ofstream               fs_;
+    std::vector<MapArchive::SectionEntry> table_;
+
+    // Current section
+    bool                        in_section_                                             = false;
+    bool                        buffered_                                               = false;
+    std::string                 buffer_;
+    MapArchive::SectionEntry    current_;
+    uint64_t                    count_                                                  = 0;
+    size_t                      bytes_written_                                          = 0;
+};
+
+class MapArchiveReader {
+public:
+    using eSection                      = MapArchive::eSection;
+    using RecordSpan                    = MapArchive::RecordSpan;
+    using RecordVector                  = std::vector<RecordSpan>;
+
+public:
+    MapArchiveReader()                                                                  = default;
+    MapArchiveReader(const MapArchiveReader&)                                           = delete;
+    MapArchiveReader& operator=(const MapArchiveReader&)                                = delete;
+    ~MapArchiveReader();
+
+    auto Open(std::string const &filename)                                              ->bool;     // memory-maps the file
+    auto Close()                                                                        ->void;
+
+    auto HasSection(eSection section)                                                   ->bool;
+    auto GetCount(eSection section)                                                     ->size_t;
+    auto GetSection(eSection section, const char *&data, size_t &size)                  ->bool;     // decompresses if necessary
+    auto GetRecords(eSection section, RecordVector &records)                            ->bool;
+
+protected:
+    auto FindSection(eSection section)                                                  ->const MapArchive::SectionEntry*;
+
+    // Data
+    int                         fd_                                                     = -1;
+    const char                  *mapped_                                                = nullptr;
+    size_t                      mapped_size_                                            = 0;
+    std::vector<MapArchive::SectionEntry> table_;
+    std::vector<std::string>    inflated_;                                              // decompressed sections, indexed by section type
+};
+
+} //end ns
@@ -23,11 +23,19 @@
 
 #pragma once
 
+// C++
+#include <functional>
+#include <set>
+
 // COVINS
+#include <covins/covins_base/msgs/msg_keyframe.hpp>
+#include <covins/covins_base/msgs/msg_landmark.hpp>
 #include "covins_base/map_base.hpp"
 #include "covins_base/vocabulary.h"
 #include "covins_base/kf_database_base.hpp"
 #include "covins_base/placerec_base.hpp"
+#include "covins_backend/map_archive.hpp"
+#include "covins_backend/trajectory_writer.hpp"
 
 namespace covins {
 
@@ -69,6 +77,7 @@ public:
     using TransformType                 = TypeDefs::TransformType;
 
     using KeyframePtr                   = TypeDefs::KeyframePtr;
+    using KeyframeVector                = TypeDefs::KeyframeVector;
     using MapPtr                        = TypeDefs::MapPtr;
     using MapInstancePtr                = std::shared_ptr<MapInstance>;
 
@@ -96,11 +105,14 @@ public:
 
     auto RegisterMerge(MergeInformation merge_data)                                     ->void;
 
+    auto GetMapIds()                                                                    ->std::vector<int>;
+
     auto GetVoc()                                                                       ->VocabularyPtr {   // will never change - no need to be guarded by mutex
         return voc_;
     }
 
     auto AddToDatabase(KeyframePtr kf)                                                  ->void;
+    auto AddToDatabase(const KeyframeVector &kfs)                                       ->void;
     auto GetDatabase()                                                                  ->DatabasePtr;
     auto EraseFromDatabase(KeyframePtr kf)                                              ->void;
 
@@ -135,6 +147,44 @@ struct MsgMap {
     }
 };
 
+struct MapSnapshot {                                                                                // consistent copy of the mutable map state - see Map::CreateSnapshot()
+    using KeyframeVector                = TypeDefs::KeyframeVector;
+    using KeyframeMsgVector             = std::vector<MsgKeyframe,Eigen::aligned_allocator<MsgKeyframe>>;
+    using ObservationVector             = std::vector<MapArchive::ObservationRecord>;
+
+    struct LandmarkState {                                                                          // fields of Landmark::ConvertToMsgFileExport()
+        TypeDefs::idpair        id;
+        TypeDefs::idpair        id_reference;
+        TypeDefs::Vector3Type   pos_w;
+        size_t                  obs_begin;                                                          // observations are lm_observations[obs_begin,obs_begin of the next LM)
+    };
+    using LandmarkStateVector           = std::vector<LandmarkState>;
+
+    // LMs are kept flat - no msg with an observation map per LM
+    auto AddLandmark(const MsgLandmark &msg)                                            ->void;
+    auto GetLandmark(size_t idx, MsgLandmark &msg) const                                ->void;     // complete msg, as exported by the LM
+    auto GetNumObservations(size_t idx) const                                           ->size_t;
+
+    KeyframeVector              keyframes;                                                              // immutable data (features, BoW) is read from the KFs when writing
+    KeyframeMsgVector           kf_states;                                                              // same order as keyframes - complete msgs if keyframes is empty
+    LandmarkStateVector         lm_states;
+    ObservationVector           lm_observations;                                                        // grouped by LM, lm_idx refers to lm_states
+    MsgMap                      msg_map;
+};
+
+struct MapVisChanges {                                                                              // changes of the map containers since the last pull - see Map::PullVisChanges()
+    using KeyframeMap                   = TypeDefs::KeyframeMap;
+    using LandmarkMap                   = TypeDefs::LandmarkMap;
+
+    bool                        full                                            = false;    // containers hold the complete map, not a delta
+    KeyframeMap                 keyframes_added;
+    KeyframeMap                 keyframes_erased;
+    LandmarkMap                 landmarks_added;
+    std::set<TypeDefs::idpair>  landmarks_erased;
+    bool                        loops_changed                                   = false;
+    TypeDefs::LoopVector        loops;                                                      // set if loops_changed
+};
+
 class Map : public MapBase, public std::enable_shared_from_this<Map> {
 public:
     using idpair                        = TypeDefs::idpair;
@@ -164,6 +214,7 @@ public:
     virtual auto EraseLandmark(LandmarkPtr lm, bool mtx_lock = true)                    ->bool override;
 
     virtual auto Clean()                                                                ->void;
+    virtual auto Clear()                                                                ->void override;
 
     virtual auto RemoveRedundantData(ManagerPtr mapmanager, double th_red,
                                      size_t max_kfs
@@ -181,29 +232,68 @@ public:
     virtual auto GetLoopConstraints()                                                   ->LoopVector;
 
     // Save/Load Data
-    virtual auto SaveToFile(std::string const &path_name)                               ->void;
+    virtual auto SaveToFile(std::string const &path_name,
+                            VocabularyPtr voc = nullptr)                                ->void;     // with voc, BoW vectors are stored and can be reused on load
     virtual auto LoadFromFile(std::string const &path_name,
                               VocabularyPtr voc)                                        ->void;
     virtual auto ConvertToMsgFileExport(MsgMap &msg)                                    ->void;
+    virtual auto CreateSnapshot(MapSnapshot &snapshot)                                  ->void;     // map should be checked out exclusively
+    static auto WriteSnapshot(const MapSnapshot &snapshot, std::string const &path_name,
+                              VocabularyPtr voc, bool overwrite,
+                              std::function<void(size_t,size_t)> progress = nullptr)    ->bool;     // does not access the map - can run on any thread
 
-    // Write-Out
-    auto WriteKFsToFile(std::string suffix = std::string())                             ->void;
+    // Visualization
+    virtual auto PullVisChanges(MapVisChanges &changes, bool full = false)              ->void;     // single consumer - the first pull (or full) returns the complete map and starts tracking
 
-    auto WriteKFsToFileAllAg(std::string prefix = std::string())                        ->void;
+    // Write-Out - snapshots the KF states, files are written by the TrajectoryWriter
+    auto WriteKFsToFile(std::string suffix = std::string(),
+                        bool incremental = false)                                       ->void;
+    auto WriteKFsToFileAllAg(std::string prefix = std::string(),
+                             bool incremental = false)                                  ->void;
 
 protected:
     // Outlier Removal
     virtual auto RemoveLandmarkOutliers()                                               ->int;
 
+    // Save/Load Data
+    struct KeyframeLinks {                                                                          // ids required to link a loaded KF
+        idpair                          id_predecessor                                  = defpair;
+        idpair                          id_successor                                    = defpair;
+        TypeDefs::LandmarksMinimalType  landmarks;
+    };
+    struct LandmarkLinks {                                                                          // ids required to link a loaded LM
+        TypeDefs::ObservationsMinimalType observations;
+        idpair                          id_reference                                    = defpair;
+    };
+    struct LoadData {                                                                               // transient - released after linking
+        KeyframeVector                  keyframes;
+        std::vector<KeyframeLinks>      kf_links;                                                   // same order as keyframes
+        LandmarkVector                  landmarks;
+        std::vector<LandmarkLinks>      lm_links;                                                   // same order as landmarks
+        MsgMap                          msg_map;
+        size_t                          msg_bytes                                       = 0;        // payload of the loaded msgs, not retained after construction
+    };
+
+    virtual auto GetNumLoadThreads()                                                    ->size_t;
+    virtual auto ParallelFor(size_t num, std::function<void(size_t)> func)              ->void;     // runs func(0)...func(num-1) on a worker pool, blocks until all are done
+    virtual auto LoadFromArchive(std::string const &path_name, VocabularyPtr voc,
+                                 LoadData &data)                                        ->bool;
+    virtual auto LoadFromDirectory(std::string const &path_name, VocabularyPtr voc,
+                                   LoadData &data)                                      ->bool;     // legacy format: one file per KF/LM
+    static auto GetMsgBytes(const MsgKeyframe &msg)                                     ->size_t;
+    static auto GetMsgBytes(const MsgLandmark &msg)                                     ->size_t;
+
     // Write-Out
-    auto WriteStateToCsv(const std::string& filename,
-                         const size_t client_id, const bool truncate = true)            ->void;
-    auto WriteStateToCsvTUM(const std::string& filename,
-                         const size_t client_id, const bool truncate = true)            ->void;
+    auto GetTrajectoryStates(const size_t client_id,
+                             TrajectoryWriter::StateVector &states)                     ->void;     // sorted by timestamp, newest first
 
     // Loop Correction
     LoopVector                  loop_constraints_;
 
+    // Visualization
+    MapVisChanges               vis_changes_;                                                       // pending, guarded by mtx_map_
+    bool                        vis_tracking_                                   = false;
+
     // Sync
     std::mutex                  mtx_update_connections_;
 };
@@ -0,0 +1,246 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+#include "covins_backend/map_be.hpp"
+
+namespace covins {
+
+// Append-only journal of map mutations
+//
+// The journal directory holds numbered segments (journal_<n>.cvmj) and one base archive per map (map_<id>/map.cvma).
+// Records are queued by the mapping threads and written by a background thread in batches (group commit). Each
+// record is protected by a CRC, so a torn write at the end of a segment is detected and ignored. Compaction folds
+// all closed segments into the base archives; recovery does the same for all segments before the maps are loaded.
+//
+// Segment layout:  [SegmentHeader][RecordHeader][payload]...[RecordHeader][payload]
+
+class MapJournal {
+public:
+    using idpair                        = TypeDefs::idpair;
+    using TransformType                 = TypeDefs::TransformType;
+    using Vector3Type                   = TypeDefs::Vector3Type;
+    using Matrix6Type                   = TypeDefs::Matrix6Type;
+
+    using KeyframePtr                   = TypeDefs::KeyframePtr;
+    using LandmarkPtr                   = TypeDefs::LandmarkPtr;
+    using MapPtr                        = TypeDefs::MapPtr;
+    using JournalPtr                    = std::shared_ptr<MapJournal>;
+    using SnapshotPtr                   = std::shared_ptr<MapSnapshot>;
+
+    using KeyframeMsgMap                = std::map<idpair,MsgKeyframe,std::less<idpair>,Eigen::aligned_allocator<std::pair<const idpair,MsgKeyframe>>>;
+    using LandmarkMsgMap                = std::map<idpair,MsgLandmark,std::less<idpair>,Eigen::aligned_allocator<std::pair<const idpair,MsgLandmark>>>;
+
+    enum eRecord : uint32_t {
+        KF_INSERT       = 0,        // MsgKeyframe (file export)
+        LM_INSERT       = 1,        // MsgLandmark (file export) - also used for LM updates
+        KF_POSE         = 2,        // KeyframePoseRecord
+        LM_POS          = 3,        // LandmarkPosRecord
+        KF_ERASE        = 4,        // idpair
+        LM_ERASE        = 5,        // idpair
+        LOOP            = 6,        // LoopRecord
+        MERGE           = 7,        // MergeRecord - record map ID is the target map
+        STATE           = 8,        // #KFs, KF states (MsgKeyframe without features), #LMs, MsgLandmark, MsgMap
+        MAP_LOAD        = 9         // MapLoadRecord
+    };
+
+    struct SegmentHeader {
+        char                    magic[8];
+        uint32_t                version;
+        uint32_t                reserved;
+    };
+
+    struct RecordHeader {
+        uint32_t                type;
+        uint32_t                map_id;
+        uint64_t                size;                                                               // payload size in bytes
+        uint32_t                crc;                                                                // crc32 of the payload
+        uint32_t                reserved;
+    };
+
+    struct KeyframePoseRecord {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        idpair                  id;
+        TransformType           T_w_s;
+        TransformType           T_w_s_vio;
+        Vector3Type             velocity;
+        Vector3Type             bias_accel;
+        Vector3Type             bias_gyro;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(id,T_w_s,T_w_s_vio,velocity,bias_accel,bias_gyro);
+        }
+    };
+
+    struct LandmarkPosRecord {
+        idpair                  id;
+        Vector3Type             pos_w;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(id,pos_w);
+        }
+    };
+
+    struct LoopRecord {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        idpair                  kf1;
+        idpair                  kf2;
+        TransformType           T_s1_s2;
+        Matrix6Type             cov;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(kf1,kf2,T_s1_s2,cov);
+        }
+    };
+
+    struct MergeRecord {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        uint32_t                map_id_tofuse;
+        TransformType           T_wtarget_wtofuse;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(map_id_tofuse,T_wtarget_wtofuse);
+        }
+    };
+
+    enum eMapFormat : uint32_t {
+        FORMAT_ARCHIVE      = 0,    // map.cvma
+        FORMAT_DIRECTORY    = 1     // legacy format: one file per KF/LM
+    };
+
+    struct MapLoadRecord {
+        std::string             path_name;
+        uint32_t                format;
+
+        template<class Archive> auto serialize( Archive & archive )                     ->void {
+            archive(path_name,format);
+        }
+    };
+
+    struct MapTable {                                                                               // map state rebuilt from base archive + journal
+        KeyframeMsgMap          keyframes;
+        LandmarkMsgMap          landmarks;
+        MsgMap                  msg_map;
+        bool                    failed                                                  = false;    // a loaded map could not be read - the table is incomplete
+    };
+    using MapTables                     = std::map<uint32_t,MapTable>;
+
+    static constexpr const char*    magic                                               = "COVINSMJ";
+    static constexpr uint32_t       version                                             = 2;
+
+public:
+    MapJournal(std::string const &path_name);
+    ~MapJournal();
+
+    // Main
+    auto Run()                                                                          ->void;     // writer thread
+
+    // Global instance - nullptr if journaling is not active
+    static auto GetInstance()                                                           ->JournalPtr;
+    static auto SetInstance(JournalPtr journal)                                         ->void;
+
+    // Recording - only copies the data, serialization and I/O happen on the writer thread
+    auto AddKeyframe(size_t map_id, KeyframePtr kf)                                     ->void;
+    auto AddLandmark(size_t map_id, LandmarkPtr lm)                                     ->void;
+    auto UpdateKeyframePose(size_t map_id, KeyframePtr kf)                              ->void;
+    auto UpdateLandmarkPos(size_t map_id, LandmarkPtr lm)                               ->void;
+    auto EraseKeyframe(size_t map_id, idpair id)                                        ->void;
+    auto EraseLandmark(size_t map_id, idpair id)                                        ->void;
+    auto AddLoopConstraint(size_t map_id, const LoopConstraint &lc)                     ->void;
+    auto MergeMaps(size_t map_id_target, size_t map_id_tofuse,
+                   TransformType T_wtarget_wtofuse)                                     ->void;
+    auto UpdateMapState(MapPtr map)                                                     ->void;     // full state, e.g. after optimization - map should be checked out exclusively
+    auto LoadMap(size_t map_id, std::string const &path_name)                           ->void;
+
+    // Recovery
+    auto Recover(std::map<uint32_t,std::string> &map_paths)                             ->bool;     // folds all closed segments, returns the base archive of every map
+
+protected:
+    struct Entry {
+        eRecord                 type;
+        uint32_t                map_id;
+        std::string             payload;                                                            // serialized record - empty for KF_INSERT/STATE
+        KeyframePtr             kf;                                                                 // KF_INSERT: features are added on the writer thread
+        std::shared_ptr<MsgKeyframe> kf_state;
+        SnapshotPtr             snapshot;                                                           // STATE
+    };
+    using EntryList                     = std::list<Entry>;
+
+    template<typename T> static auto Serialize(const T &data)                           ->std::string;
+
+    auto Push(Entry &&entry)                                                            ->void;
+    auto WriteBatch(EntryList &entries)                                                 ->bool;
+    auto OpenSegment(uint32_t number)                                                   ->bool;
+    auto GetSegments()                                                                  ->std::vector<uint32_t>;
+    auto GetSegmentPath(uint32_t number)                                                ->std::string;
+    auto GetBasePath(uint32_t map_id)                                                   ->std::string;
+    auto Compact()                                                                      ->void;
+    auto FoldSegments(std::vector<uint32_t> const &segments)                            ->bool;
+
+    // Replay
+    static auto ReadArchive(std::string const &path_name, MapTable &table)              ->bool;
+    static auto ReadDirectory(std::string const &path_name, MapTable &table)            ->bool;     // legacy format
+    static auto WriteArchive(uint32_t map_id, MapTable &table,
+                             std::string const &path_name)                              ->bool;     // consumes the table
+    static auto ReplaySegment(std::string const &filename, MapTables &tables)           ->size_t;
+    static auto ApplyRecord(eRecord type, uint32_t map_id, const char *data,
+                            size_t size, MapTables &tables)                             ->void;
+
+    // Infrastructure
+    std::string                 path_name_;
+    int                         fd_                                                     = -1;
+    uint32_t                    segment_                                                = 0;        // number of the active segment
+    size_t                      segment_bytes_                                          = 0;
+    static JournalPtr           instance_;
+
+    // Data
+    EntryList                   queue_;
+    size_t                      num_batches_                                            = 0;
+    size_t                      num_records_                                            = 0;
+
+    // Compaction
+    std::unique_ptr<std::thread> thread_compaction_;
+    std::atomic<bool>           compaction_running_;
+
+    // Sync
+    std::mutex                  mtx_queue_;
+    std::condition_variable     cv_queue_;
+    std::mutex                  mtx_fold_;
+    static std::mutex           mtx_instance_;
+};
+
+} //end ns
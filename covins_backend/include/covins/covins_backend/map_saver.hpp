@@ -0,0 +1,87 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+#include "covins_base/vocabulary.h"
+
+namespace covins {
+
+struct MapSnapshot;
+
+// Saves maps on a background thread: a snapshot of the mutable map state is taken while the map is checked out
+// (short), the archive is written afterwards without accessing the map. Only one snapshot is held at a time.
+class MapSaver {
+public:
+    using ManagerPtr                    = TypeDefs::ManagerPtr;
+    using VocabularyPtr                 = CovinsVocabulary::VocabularyPtr;
+    using SnapshotPtr                   = std::shared_ptr<MapSnapshot>;
+
+public:
+    MapSaver(ManagerPtr manager, VocabularyPtr voc);
+
+    // Main
+    auto Run()                                                                          ->void;
+
+    // Interfaces
+    auto SaveAsync(int map_id, std::string const &path_name,
+                   bool overwrite, bool clean)                                          ->bool;     // returns false if a save is already in progress
+    auto IsBusy()                                                                       ->bool;
+    auto GetProgress()                                                                  ->double;   // [0,1] of the current save
+
+protected:
+    auto WriteJob()                                                                     ->void;
+    auto Checkpoint()                                                                   ->void;
+
+    struct SaveJob {
+        int                     map_id;
+        std::string             path_name;
+        bool                    overwrite;
+        SnapshotPtr             snapshot;
+    };
+
+    // Infrastructure
+    ManagerPtr                  mapmanager_;
+    VocabularyPtr               voc_;
+
+    // Data
+    std::shared_ptr<SaveJob>    job_;
+    std::atomic<bool>           busy_;                                                              // a snapshot is queued or being written
+    std::atomic<size_t>         num_done_, num_total_;                                              // progress
+    std::chrono::steady_clock::time_point last_checkpoint_;
+    size_t                      next_checkpoint_map_                                    = 0;
+
+    // Sync
+    std::mutex                  mtx_job_;
+};
+
+} //end ns
@@ -0,0 +1,107 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Core>
+
+// COVINS
+#include <covins/covins_base/typedefs_base.hpp>
+
+namespace covins {
+
+// Writes KF trajectories (EUROC or TUM format) on a background thread
+//
+// The map only collects a snapshot of the KF states and submits it as a job, so no file I/O happens while a map is
+// checked out. Queued full rewrites of the same file are coalesced. Incremental jobs only append states that are newer
+// than the last state written to the file for the respective agent - appended rows are not re-sorted and poses of
+// already written KFs are not updated until the next full rewrite.
+class TrajectoryWriter {
+public:
+    using TransformType                 = TypeDefs::TransformType;
+    using Vector3Type                   = TypeDefs::Vector3Type;
+    using WriterPtr                     = std::shared_ptr<TrajectoryWriter>;
+
+    enum eFormat {
+        EUROC           = 0,
+        TUM             = 1
+    };
+
+    struct State {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        size_t                  client_id;
+        double                  stamp;
+        TransformType           T_w_s;
+        Vector3Type             velocity;
+        Vector3Type             bias_accel;
+        Vector3Type             bias_gyro;
+    };
+    using StateVector                   = std::vector<State,Eigen::aligned_allocator<State>>;
+
+    struct Job {
+        std::string             filename;
+        eFormat                 format;
+        bool                    incremental;
+        StateVector             states;                                                             // in output order - increasing stamps per agent
+    };
+
+public:
+    TrajectoryWriter();
+
+    // Main
+    auto Run()                                                                          ->void;
+
+    // Global instance - nullptr: trajectories are written synchronously by the caller
+    static auto GetInstance()                                                           ->WriterPtr;
+    static auto SetInstance(WriterPtr writer)                                           ->void;
+
+    // Interfaces
+    static auto GetFormat()                                                             ->eFormat;  // from sys.trajectory_format
+    static auto Submit(Job &&job)                                                       ->void;     // asynchronous if an instance is active
+
+protected:
+    using StampMap                      = std::map<size_t,double>;                                  // client ID -> stamp of the newest state in the file
+
+    auto Push(Job &&job)                                                                ->void;
+    static auto Write(const Job &job, StampMap &last_stamps)                            ->bool;
+
+    // Data
+    std::list<Job>              queue_;
+    std::map<std::string,StampMap> last_stamps_;                                                    // per file
+    static WriterPtr            instance_;
+
+    // Sync
+    std::mutex                  mtx_queue_;
+    std::condition_variable     cv_queue_;
+    static std::mutex           mtx_instance_;
+};
+
+} //end ns
@@ -23,6 +23,11 @@
 
 #pragma once
 
+// C++
+#include <chrono>
+#include <map>
+#include <memory>
+
 // COVINS
 #include "covins_base/visualization_base.hpp"
 #include "covins_backend/keyframe_be.hpp"
@@ -32,9 +37,20 @@
 
 namespace covins {
 
+class LandmarkLod;
+
 class Visualizer : public VisualizerBase, public std::enable_shared_from_this<Visualizer> {
 public:
     using KeyframeSetById               = std::set<KeyframePtr,Keyframe::kf_less,Eigen::aligned_allocator<KeyframePtr>>;
+    using MapWeakPtr                    = std::weak_ptr<Map>;
+    using LodPtr                        = std::shared_ptr<LandmarkLod>;
+    using TimePoint                     = std::chrono::steady_clock::time_point;
+
+    struct MapCache {                                                                               // bundle kept up-to-date with the changes pulled from the map
+        MapWeakPtr              map;
+        VisBundle               bundle;
+        LodPtr                  lod;                                                                // only with vis.landmark_lod
+    };
 
 public:
     Visualizer(std::string topic_prefix = std::string());
@@ -43,18 +59,34 @@ public:
     virtual auto Run()                                                                  ->void override;
 
     // Interfaces
-    virtual auto DrawMap(MapPtr map)                                                    ->void;
+    virtual auto DrawMap(MapPtr map)                                                    ->void;     // only registers the map - changes are pulled by Run()
 
     // Draw Loaded Map
     auto DrawMapBitByBit(MapPtr map, std::string frame)                                 ->void;
 
 protected:
+    virtual auto CheckVisData()                                                         ->bool override;
+    virtual auto ResetIfRequested()                                                     ->void override;
+    virtual auto UpdateCache(MapPtr map, MapCache &cache)                               ->void;
+
     // Draw Map
     virtual auto PubCovGraph()                                                          ->void;
     virtual auto PubKeyframesAsFrusta()                                                 ->void;
     virtual auto PubLandmarksAsCloud()                                                  ->void;
+    virtual auto PubLandmarkLod()                                                       ->void;     // changed chunks of curr_lod_, within the byte budget
+    virtual auto PubLandmarkLodDelete(MapCache &cache)                                  ->void;     // removes all chunks of the cached map
     virtual auto PubLoopEdges()                                                         ->void;
     virtual auto PubTrajectories()                                                      ->void;
+
+    // Data
+    std::map<size_t,MapPtr>     draw_requests_;                                                     // guarded by mtx_draw_
+    std::map<size_t,MapCache>   map_cache_;                                                         // only accessed by Run()
+    LodPtr                      curr_lod_;
+
+    // Landmark LOD budget
+    bool                        lod_cycle_                                      = false;    // LOD is refreshed and published in this cycle
+    TimePoint                   last_lod_cycle_;
+    double                      lod_bytes_available_                            = 0.0;
 };
 
 } //end ns
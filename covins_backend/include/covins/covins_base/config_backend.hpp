@@ -109,6 +109,15 @@ namespace sys {
     //--------------------------
     const std::string output_dir                        = outpath;
     const std::string trajectory_format                 = estd2::GetStringFromYaml(conf,"sys.trajectory_format");
+    const bool trajectory_incremental                   = estd2::GetValFromYaml<bool>(conf,"sys.trajectory_incremental");    // periodic trajectory write-out only appends new KFs
+    const bool map_archive_compression                  = estd2::GetValFromYaml<bool>(conf,"sys.map_archive_compression");
+    const int threads_map_load                          = estd2::GetValFromYaml<int>(conf,"sys.threads_map_load");          // <= 0: use all cores
+    const double map_checkpoint_interval                = estd2::GetValFromYaml<double>(conf,"sys.map_checkpoint_interval"); // [s] periodic background save of all maps, <= 0: off
+    const bool map_journal                              = estd2::GetValFromYaml<bool>(conf,"sys.map_journal");               // append-only log of map changes in output_dir/map_journal/ - maps are recovered on startup
+    const bool map_journal_sync                         = estd2::GetValFromYaml<bool>(conf,"sys.map_journal_sync");          // fdatasync after each batch of records
+    const int map_journal_compaction_mb                 = estd2::GetValFromYaml<int>(conf,"sys.map_journal_compaction_mb");  // fold the journal into the base archives after this many MB, <= 0: never
+    const bool map_paging                               = estd2::GetValFromYaml<bool>(conf,"sys.map_paging");                // evict the matching payload of loaded KFs to a backing file in output_dir/kf_paging/
+    const int map_paging_budget_mb                      = estd2::GetValFromYaml<int>(conf,"sys.map_paging_budget_mb");       // payloads kept in memory (LRU)
 }
 
 namespace features {
@@ -214,6 +223,12 @@ namespace vis {
     const bool showkeyframes                            = estd2::GetValFromYaml<bool>(conf,"vis.showkeyframes"); //-1=no KFs;0=frusta;1=spheres
     const int covgraph_minweight                        = estd2::GetValFromYaml<int>(conf,"vis.covgraph_minweight");
     const bool covgraph_shared_edges_only               = estd2::GetValFromYaml<bool>(conf,"vis.covgraph_shared_edges_only"); // show only cov edges between trajectories from different agents
+    const precision_t publish_rate                      = estd2::GetValFromYaml<precision_t>(conf,"vis.publish_rate");      // [Hz] changes are pulled from the maps at this rate; <= 0: 200 Hz
+    const bool landmark_lod                             = estd2::GetValFromYaml<bool>(conf,"vis.landmark_lod");               // publish LMs as voxel-downsampled chunks, only changed chunks are sent
+    const precision_t lod_voxel_size                    = estd2::GetValFromYaml<precision_t>(conf,"vis.lod_voxel_size");     // [m]
+    const precision_t lod_rate                          = estd2::GetValFromYaml<precision_t>(conf,"vis.lod_rate");           // [Hz] max. publish frequency of LOD updates
+    const int lod_kbytes_per_sec                        = estd2::GetValFromYaml<int>(conf,"vis.lod_kbytes_per_sec");         // <= 0: unlimited
+    const int lod_refresh_num                           = estd2::GetValFromYaml<int>(conf,"vis.lod_refresh_num");            // LM positions re-checked per LOD update
 
     const precision_t scalefactor                       = estd2::GetValFromYaml<precision_t>(conf,"vis.scalefactor");
     const precision_t trajmarkersize                    = estd2::GetValFromYaml<precision_t>(conf,"vis.trajmarkersize");
@@ -26,6 +26,9 @@ public:
 public:
     virtual ~KeyframeDatabaseBase(){}
     virtual auto AddKeyframe(KeyframePtr kf)                                    ->void                      = 0;
+    virtual auto AddKeyframes(const KeyframeVector &kfs)                        ->void {
+        for(const auto& kf : kfs) this->AddKeyframe(kf);
+    }
     virtual auto EraseKeyframe(KeyframePtr kf)                                  ->void                      = 0;
     virtual auto DetectCandidates(KeyframePtr kf, precision_t min_score)        ->KeyframeVector            = 0;
 
@@ -79,6 +79,16 @@ bool RelNonCentralPosSolver::computeNonCentralRelPose(
   std::vector<std::vector<std::vector<int>>> inliers_vect(n_qkfs);
   std::vector<int> inliers_size;
 
+  // Keep the payload (descriptors, bearings) of all involved KFs in memory
+  KeyframeVector involved_kfs;
+  for (KeyframePtr kf = QKF; kf && involved_kfs.size() < n_qkfs; kf = kf->GetPredecessor()) {
+    involved_kfs.push_back(kf);
+  }
+  for (KeyframePtr kf = CKF; kf && involved_kfs.size() < n_qkfs + n_ckfs; kf = kf->GetPredecessor()) {
+    involved_kfs.push_back(kf);
+  }
+  KeyframePayloadGuard guard(involved_kfs);
+
   for (size_t i = 0; i < n_qkfs; ++i) {
 
     KeyframePtr curr_QKF = QKF;
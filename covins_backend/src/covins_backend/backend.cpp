@@ -26,8 +26,13 @@
 // COVINS
 #include <covins/covins_backend/communicator_be.hpp>
 #include "covins_backend/handler_be.hpp"
+#include "covins_backend/keyframe_pager.hpp"
+#include "covins_backend/map_archive.hpp"
 #include "covins_backend/map_be.hpp"
+#include "covins_backend/map_journal.hpp"
+#include "covins_backend/map_saver.hpp"
 #include "covins_backend/optimization_be.hpp"
+#include "covins_backend/trajectory_writer.hpp"
 #include "covins_backend/visualization_be.hpp"
 #include "covins_backend/placerec_be.hpp"
 #include "covins_backend/placerec_gen_be.hpp"
@@ -56,6 +61,46 @@ CovinsBackend::CovinsBackend() {
     thread_mapmanager_.reset(new std::thread(&MapManager::Run,mapmanager_));
     thread_mapmanager_->detach(); // Thread will be cleaned up when exiting main()
 
+    //+++++ Create KF Pager +++++
+    if(covins_params::sys::map_paging) {
+        pager_.reset(new KeyframePager(covins_params::sys::output_dir + "kf_paging/",static_cast<size_t>(std::max(covins_params::sys::map_paging_budget_mb,0))*1024*1024));
+    }
+
+    //+++++ Recover Maps & Start Journal +++++
+    if(covins_params::sys::map_journal) {
+        journal_.reset(new MapJournal(covins_params::sys::output_dir + "map_journal/"));
+        std::map<uint32_t,std::string> map_paths;
+        if(!journal_->Recover(map_paths)) {
+            std::cout << COUTFATAL << "map journal recovery failed" << std::endl;
+            exit(-1);
+        }
+        for(const auto& mit : map_paths) {
+            std::cout << "--> Recover map " << mit.first << " from " << mit.second << std::endl;
+            AgentPackage::MapPtr map(new Map(mit.first));
+            map->LoadFromFile(mit.second,voc_);
+            for(auto client_id : map->associated_clients_) {
+                agent_next_id_ = std::max(agent_next_id_,static_cast<int>(client_id)+1);
+            }
+            agent_next_id_ = std::max(agent_next_id_,static_cast<int>(mit.first)+1);
+            if(pager_) pager_->AddKeyframes(map->GetKeyframesVec());
+            mapmanager_->RegisterMap(map,true);
+        }
+        MapJournal::SetInstance(journal_);
+        thread_journal_.reset(new std::thread(&MapJournal::Run,journal_));
+        thread_journal_->detach(); // Thread will be cleaned up when exiting main()
+    }
+
+    //+++++ Create TrajectoryWriter +++++
+    writer_.reset(new TrajectoryWriter());
+    TrajectoryWriter::SetInstance(writer_);
+    thread_writer_.reset(new std::thread(&TrajectoryWriter::Run,writer_));
+    thread_writer_->detach(); // Thread will be cleaned up when exiting main()
+
+    //+++++ Create MapSaver +++++
+    saver_.reset(new MapSaver(mapmanager_,voc_));
+    thread_saver_.reset(new std::thread(&MapSaver::Run,saver_));
+    thread_saver_->detach(); // Thread will be cleaned up when exiting main()
+
     service_gba_ = nh_.advertiseService("covins_gba",&CovinsBackend::CallbackGBA, this);
     service_savemap_ = nh_.advertiseService("covins_savemap",&CovinsBackend::CallbackSaveMap, this);
     service_loadmap_ = nh_.advertiseService("covins_loadmap",&CovinsBackend::CallbackLoadMap, this);
@@ -234,8 +279,10 @@ auto CovinsBackend::CallbackLoadMap(covins_backend::ServiceLoadMap::Request &req
     AgentPackage::MapPtr map(new Map(agent_next_id_));
     map->LoadFromFile(filepath.str(),voc_);
     agent_next_id_ += map->associated_clients_.size();
+    if(pager_) pager_->AddKeyframes(map->GetKeyframesVec());
     std::cout << "--> Register to Map Manager" << std::endl;
     mapmanager_->RegisterMap(map,!perform_placerec);
+    if(journal_) journal_->LoadMap(map->id_map_,filepath.str());
     std::cout << "----> Done" << std::endl;
 
     if(covins_params::vis::active) {
@@ -323,6 +370,7 @@ auto CovinsBackend::CallbackPruneMap(covins_backend::ServicePruneMap::Request &r
     }
     std::cout << "----> Done" << std::endl;
     std::cout << "KFs in map: " << map->GetKeyframes().size() << std::endl;
+    if(journal_) journal_->UpdateMapState(map);
     if(covins_params::vis::active) {
         usleep(100000);
         std::cout << "--> Display Map" << std::endl;
@@ -341,19 +389,12 @@ auto CovinsBackend::CallbackSaveMap(covins_backend::ServiceSaveMap::Request &req
     std::stringstream filepath;
     filepath << covins_params::sys::output_dir << "map_data/";
     std::cout << "----> saving map to: " << filepath.str() << std::endl;
-    std::cout << "--> Get map" << std::endl;
-    int check_num_map;
-    MapManager::MapPtr map = mapmanager_->CheckoutMapExclusiveOrWait(map_id,check_num_map);
-    std::cout << "----> Done" << std::endl;
-    if(!map) {
-        std::cout << COUTERROR << "No map found with ID " << map_id << std::endl;
+    if(MapArchive::Exists(filepath.str())) {
+        std::cout << COUTERROR << "Write directory is not empty: '" << MapArchive::filename << "' found." << std::endl;
         return false;
     }
-    map->SaveToFile(filepath.str());
-    std::cout << "--> Return map" << std::endl;
-    mapmanager_->ReturnMap(map_id,check_num_map);
-    std::cout << "----> Done" << std::endl;
-    return true;
+    // the map is only blocked while the snapshot is taken - writing happens in the background
+    return saver_->SaveAsync(map_id,filepath.str(),false,true);
 }
 
 auto CovinsBackend::ConnectSocket()->void {
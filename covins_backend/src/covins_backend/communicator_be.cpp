@@ -27,6 +27,7 @@
 #include "covins_backend/keyframe_be.hpp"
 #include "covins_backend/landmark_be.hpp"
 #include "covins_backend/map_be.hpp"
+#include "covins_backend/map_journal.hpp"
 #include "covins_backend/placerec_be.hpp"
 #include "covins_backend/visualization_be.hpp"
 
@@ -107,6 +108,7 @@ auto Communicator::ProcessAdditional()->void {
 auto Communicator::ProcessKeyframeMessages()->void {
     std::unique_lock<std::mutex> lock(mtx_in_);
     auto voc = mapmanager_->GetVoc();
+    auto journal = MapJournal::GetInstance();
     size_t cnt = 0;
     while(!buffer_keyframes_in_.empty() && cnt < 1) {
         MsgKeyframe msg = buffer_keyframes_in_.front();
@@ -117,6 +119,7 @@ auto Communicator::ProcessKeyframeMessages()->void {
                 auto kf = map_->GetKeyframe(msg.id,false);
                 if(kf && kf->id_.first == 0) continue;
                 if(kf) kf->UpdatePoseFromMsg(msg,map_);
+                if(kf && journal) journal->UpdateKeyframePose(map_->id_map_,kf);
             }
         } else {
             KeyframePtr kf;
@@ -134,8 +137,9 @@ auto Communicator::ProcessKeyframeMessages()->void {
                 }
                 kf.reset(new Keyframe(msg,map_,voc));
                 kf->EstablishConnections(msg, map_);
-                kf->EstablishNeighbors(msg,map_);
+                kf->EstablishNeighbors(map_);
                 map_->AddKeyframe(kf);                      // Add it to the map already here, because otherwise the next KF in 'buffer_keyframes_in_' (which is most likely the successor) will not find this KF
+                if(journal) journal->AddKeyframe(map_->id_map_,kf);
                 keyframes_new_.push_back(kf);
                 recent_keyframes_.push_back(kf);
                 last_processed_kf_msg_ = kf->id_;
@@ -143,6 +147,7 @@ auto Communicator::ProcessKeyframeMessages()->void {
             } else {
                 std::cout << COUTWARN << "Received full msgs for existing KF " << kf << std::endl;
                 kf->UpdatePoseFromMsg(msg,map_);
+                if(journal) journal->UpdateKeyframePose(map_->id_map_,kf);
             }
         }
     }
@@ -150,6 +155,7 @@ auto Communicator::ProcessKeyframeMessages()->void {
 
 auto Communicator::ProcessLandmarkMessages()->void {
     std::unique_lock<std::mutex> lock(mtx_in_);
+    auto journal = MapJournal::GetInstance();
     while(!buffer_landmarks_in_.empty()) {
         MsgLandmark msg = buffer_landmarks_in_.front();
         if(msg.id_reference.first > last_processed_kf_msg_.first) break;
@@ -159,6 +165,7 @@ auto Communicator::ProcessLandmarkMessages()->void {
             else {
                 auto lm = map_->GetLandmark(msg.id);
                 if(lm) lm->UpdatePosFromMsg(msg,map_);
+                if(lm && journal) journal->UpdateLandmarkPos(map_->id_map_,lm);
             }
             continue;
         } else {
@@ -168,11 +175,13 @@ auto Communicator::ProcessLandmarkMessages()->void {
                 lm.reset(new Landmark(msg,map_));
                 lm->EstablishConnections(msg,map_);
                 map_->AddLandmark(lm);
+                if(journal) journal->AddLandmark(map_->id_map_,lm);
                 landmarks_new_.push_back(lm);
                 recent_landmarks_.push_back(lm);
             } else {
                 lm->EstablishConnections(msg,map_);
                 lm->UpdatePosFromMsg(msg,map_);
+                if(journal) journal->AddLandmark(map_->id_map_,lm);      // observations might have changed
             }
         }
     }
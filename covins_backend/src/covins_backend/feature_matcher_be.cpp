@@ -64,6 +64,8 @@ auto FeatureMatcher::DescriptorDistanceHamming(const cv::Mat &a, const cv::Mat &
 }
 
 auto FeatureMatcher::Fuse(KeyframePtr pKF, Eigen::Matrix4d Tcw, const LandmarkVector &vpPoints, precision_t th, LandmarkVector &vpReplacePoint)->int {
+    KeyframePayloadGuard guard(pKF);
+
     // Get Calibration Parameters for later projection
     // Decompose Scw
     Eigen::Matrix4d Twc = Tcw.inverse();
@@ -166,6 +168,8 @@ auto FeatureMatcher::Fuse(KeyframePtr pKF, Eigen::Matrix4d Tcw, const LandmarkVe
 }
 
 auto FeatureMatcher::SearchByProjection(KeyframePtr pKF, Eigen::Matrix4d Tcw, const LandmarkVector &vpPoints, LandmarkVector &vpMatched, precision_t th)->int {
+    KeyframePayloadGuard guard(pKF);
+
     // Decompose Tcw
     Eigen::Matrix3d Rcw = Tcw.block<3,3>(0,0);
     Eigen::Vector3d tcw = Tcw.block<3,1>(0,3);
@@ -291,6 +295,9 @@ auto FeatureMatcher::SearchByProjection(KeyframePtr pKF, Eigen::Matrix4d Tcw, co
 }
 
 auto FeatureMatcher::SearchBySE3(KeyframePtr pKF1, KeyframePtr pKF2, LandmarkVector &matches12, const Eigen::Matrix4d T12, const precision_t th)->int {
+    KeyframePayloadGuard guard1(pKF1);
+    KeyframePayloadGuard guard2(pKF2);
+
     // Obtain the descriptor size (for descriptor matching)
 
     // Camera Parameters
@@ -25,13 +25,16 @@
 
 // C++
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <eigen3/Eigen/Core>
 #include <opencv2/opencv.hpp>
 
 // COVINS
 #include <covins/covins_base/utils_base.hpp>
+#include "covins_backend/keyframe_pager.hpp"
 #include "covins_backend/landmark_be.hpp"
+#include "covins_backend/map_archive.hpp"
 #include "covins_backend/map_be.hpp"
 
 // Thirdparty
@@ -151,36 +154,12 @@ Keyframe::Keyframe(MsgKeyframe msg, MapPtr map, VocabularyPtr voc)
     if(msg.save_to_file) {
         this->SetPoseTws(msg.T_w_s);
         this->SetPoseTws_vio(msg.T_w_s_vio);
-        msg_ = msg;
     } else {
         this->UpdatePoseFromMsg(msg,map);
     }
 
-    // BoW
-    {
-        if(!bow_vec_.empty() || !feat_vec_.empty()){
-            cout << COUTERROR << " !mBowVec.empty() || !mFeatVec.empty()" << endl;
-            exit(-1);
-        }
-
-        // Unless we are using SIFT descriptors, we will use the additional
-        // features for both Place Recognition and Image Matching.
-        // For SIFT features, we will use additional features (descriptors_add_)
-        // (SIFT) for Image matching and the regular features (descriptors_)
-        // (ORB) for Place Recognition
-
-        vector<cv::Mat> current_desc;
-        
-        if (covins_params::features::type == "SIFT") {
-          current_desc = Utils::ToDescriptorVector(descriptors_);
-        } else {
-          current_desc = Utils::ToDescriptorVector(descriptors_add_);
-        }
-
-        // Feature vector associate features with nodes in the 4th level (from leaves up)
-        // We assume the vocabulary tree has 6 levels, change the 4 otherwise
-        voc->transform(current_desc,bow_vec_,feat_vec_,4);
-    }
+    // BoW - without vocabulary, BoW data has to be set by the caller (e.g. when restored from a saved map)
+    if(voc) this->ComputeBoW(voc);
 
     // PreIntegration
     if(msg.preintegration.dt.empty()) {
@@ -225,6 +204,10 @@ Keyframe::Keyframe(MsgKeyframe msg, MapPtr map, VocabularyPtr voc)
     }
 }
 
+Keyframe::~Keyframe() {
+    if(pager_) pager_->Remove(this);
+}
+
 auto Keyframe::ComputeRedundancyValue()->double {
     // calculates a redundancy value based on [Schmuck and Chli, 3DV'19]
     double red_sum = 0;
@@ -297,6 +280,13 @@ auto Keyframe::ConvertToMsg(MsgKeyframe &msg, KeyframePtr kf_ref, bool is_update
 }
 
 auto Keyframe::ConvertToMsgFileExport(MsgKeyframe &msg)->void {
+    this->ConvertToMsgFileExportState(msg);
+    this->ConvertToMsgFileExportFeatures(msg);
+    msg.descriptors = msg.descriptors.clone();
+    msg.descriptors_add = msg.descriptors_add.clone();
+}
+
+auto Keyframe::ConvertToMsgFileExportState(MsgKeyframe &msg)->void {
     std::unique_lock<std::mutex> lock_conn(mtx_connections_);
     std::unique_lock<std::mutex> lock_feat(mtx_features_);
     std::unique_lock<std::mutex> lock_pose(mtx_pose_);
@@ -305,21 +295,6 @@ auto Keyframe::ConvertToMsgFileExport(MsgKeyframe &msg)->void {
 
     msg.id = id_;
     msg.timestamp = timestamp_;
-    msg.calibration = calibration_;
-    msg.img_dim_x_min = img_dim_x_min_;
-    msg.img_dim_y_min = img_dim_y_min_;
-    msg.img_dim_x_max = img_dim_x_max_;
-    msg.img_dim_y_max = img_dim_y_max_;
-
-    msg.keypoints_aors = keypoints_aors_;
-    msg.keypoints_distorted = keypoints_distorted_;
-    msg.keypoints_undistorted = keypoints_undistorted_;
-    msg.descriptors = descriptors_.clone();
-
-    msg.keypoints_aors_add = keypoints_aors_add_;
-    msg.keypoints_distorted_add = keypoints_distorted_add_;
-    msg.keypoints_undistorted_add = keypoints_undistorted_add_;
-    msg.descriptors_add = descriptors_add_.clone();
 
     msg.T_s_c = T_s_c_;
     msg.T_w_s = T_w_s_;
@@ -336,8 +311,6 @@ auto Keyframe::ConvertToMsgFileExport(MsgKeyframe &msg)->void {
 
     ConvertPreintegrationToMsg(msg.preintegration);
 
-    msg.img = img_;
-
     if(predecessor_) msg.id_predecessor = predecessor_->id_;
     if(successor_) msg.id_successor = successor_->id_;
 
@@ -347,6 +320,53 @@ auto Keyframe::ConvertToMsgFileExport(MsgKeyframe &msg)->void {
     }
 }
 
+auto Keyframe::ConvertToMsgFileExportFeatures(MsgKeyframe &msg)->void {
+    // calibration, keypoints, descriptors and image do not change after creation - descriptors are not copied
+    KeyframePayloadGuard guard(shared_from_this());
+    msg.calibration = calibration_;
+    msg.img_dim_x_min = img_dim_x_min_;
+    msg.img_dim_y_min = img_dim_y_min_;
+    msg.img_dim_x_max = img_dim_x_max_;
+    msg.img_dim_y_max = img_dim_y_max_;
+
+    msg.keypoints_aors = keypoints_aors_;
+    msg.keypoints_distorted = keypoints_distorted_;
+    msg.keypoints_undistorted = keypoints_undistorted_;
+    msg.descriptors = descriptors_;
+
+    msg.keypoints_aors_add = keypoints_aors_add_;
+    msg.keypoints_distorted_add = keypoints_distorted_add_;
+    msg.keypoints_undistorted_add = keypoints_undistorted_add_;
+    msg.descriptors_add = descriptors_add_;
+
+    msg.img = img_;
+}
+
+auto Keyframe::ComputeBoW(VocabularyPtr voc)->void {
+    if(!bow_vec_.empty() || !feat_vec_.empty()){
+        cout << COUTERROR << " !mBowVec.empty() || !mFeatVec.empty()" << endl;
+        exit(-1);
+    }
+
+    // Unless we are using SIFT descriptors, we will use the additional
+    // features for both Place Recognition and Image Matching.
+    // For SIFT features, we will use additional features (descriptors_add_)
+    // (SIFT) for Image matching and the regular features (descriptors_)
+    // (ORB) for Place Recognition
+
+    vector<cv::Mat> current_desc;
+    
+    if (covins_params::features::type == "SIFT") {
+      current_desc = Utils::ToDescriptorVector(descriptors_);
+    } else {
+      current_desc = Utils::ToDescriptorVector(descriptors_add_);
+    }
+
+    // Feature vector associate features with nodes in the 4th level (from leaves up)
+    // We assume the vocabulary tree has 6 levels, change the 4 otherwise
+    voc->transform(current_desc,bow_vec_,feat_vec_,4);
+}
+
 auto Keyframe::EstablishConnections(MsgKeyframe msg, MapPtr map)->void {
     //Temporal neighborhood
     bool expect_pred_null = msg.id_predecessor == defpair ? true : false;
@@ -382,15 +402,15 @@ auto Keyframe::EstablishConnections(MsgKeyframe msg, MapPtr map)->void {
      
 }
 
-auto Keyframe::EstablishNeighbors(MsgKeyframe msg, MapPtr map) -> void {
+auto Keyframe::EstablishNeighbors(MapPtr map) -> void {
 
     // Add Temporal Neighbors (These are only used of COVINS_G during Plcae Recognition) 
     int n_neigh = 20;
     int min_neigh;
 
     {
-        KeyframeBase::idpair curr_id = msg.id;
-        KeyframeBase::idpair temp_id = msg.id;
+        KeyframeBase::idpair curr_id = id_;
+        KeyframeBase::idpair temp_id = id_;
 
         if (int(curr_id.first) - n_neigh <= 1) {
         min_neigh = 1;
@@ -648,4 +668,79 @@ const unsigned char* Keyframe::GetDescriptorAdd(size_t ind) {
   return descriptors_add_.data + descriptors_add_.cols*ind;
 }
 
+auto Keyframe::IsPaged()->bool {
+    return pager_ != nullptr;
+}
+
+auto Keyframe::LoadPayload(const char *data, size_t size)->void {
+    MapArchive::MemoryBuffer buf(data,size);
+    std::istream is(&buf);
+    cereal::BinaryInputArchive iarchive(is);
+    iarchive(descriptors_,descriptors_add_,
+             keypoints_undistorted_,keypoints_aors_add_,keypoints_distorted_add_,keypoints_undistorted_add_,
+             bearings_,bearings_add_,img_);
+    this->AssignFeaturesToGrid();
+}
+
+auto Keyframe::PinPayload()->void {
+    if(!pager_) return;
+    {
+        std::unique_lock<std::mutex> lock(mtx_payload_);
+        ++payload_pins_;
+        if(!payload_resident_) {
+            const char *data;
+            size_t size;
+            if(!pager_->GetPage(this,data,size)) {
+                std::cout << COUTFATAL << this->id_.first << "|" << this->id_.second << ": payload not found in backing file" << std::endl;
+                exit(-1);
+            }
+            this->LoadPayload(data,size);
+            payload_resident_ = true;
+        }
+    }
+    pager_->Touch(this);
+}
+
+auto Keyframe::SerializePayload()->std::string {
+    std::stringstream ss;
+    {
+        cereal::BinaryOutputArchive oarchive(ss);
+        oarchive(descriptors_,descriptors_add_,
+                 keypoints_undistorted_,keypoints_aors_add_,keypoints_distorted_add_,keypoints_undistorted_add_,
+                 bearings_,bearings_add_,img_);
+    }
+    return ss.str();
+}
+
+auto Keyframe::TryReleasePayload()->bool {
+    std::unique_lock<std::mutex> lock(mtx_payload_,std::try_to_lock);
+    if(!lock.owns_lock() || payload_pins_ > 0) return false;
+    if(!payload_resident_) return true;
+
+    descriptors_ = cv::Mat();
+    descriptors_add_ = cv::Mat();
+    img_ = cv::Mat();
+    KeypointVector().swap(keypoints_undistorted_);
+    AorsVector().swap(keypoints_aors_add_);
+    KeypointVector().swap(keypoints_distorted_add_);
+    KeypointVector().swap(keypoints_undistorted_add_);
+    std::vector<Vector3Type>().swap(bearings_);
+    std::vector<Vector3Type>().swap(bearings_add_);
+    for(int i=0;i<FRAME_GRID_COLS;++i) {
+        for(int j=0;j<FRAME_GRID_ROWS;++j) {
+            std::vector<size_t>().swap(keypoint_grid_[i][j]);
+        }
+    }
+    assigned_to_grid_ = false;
+
+    payload_resident_ = false;
+    return true;
+}
+
+auto Keyframe::UnpinPayload()->void {
+    if(!pager_) return;
+    std::unique_lock<std::mutex> lock(mtx_payload_);
+    --payload_pins_;
+}
+
 } //end ns
@@ -0,0 +1,204 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/keyframe_pager.hpp"
+
+// C++
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// COVINS
+#include "covins_backend/keyframe_be.hpp"
+
+namespace covins {
+
+KeyframePager::KeyframePager(const std::string &path_name, size_t budget_bytes)
+    : path_name_(path_name), budget_bytes_(budget_bytes)
+{
+    if(path_name_.empty() || path_name_.back() != '/') path_name_ += "/";
+    mkdir(path_name_.c_str(),0777);
+
+    // backing files are only valid for the lifetime of the process
+    if(DIR *dir = opendir(path_name_.c_str())) {
+        struct dirent *entry;
+        while((entry = readdir(dir)) != nullptr) {
+            unsigned int number;
+            if(sscanf(entry->d_name,"kf_payload_%u.bin",&number) == 1) std::remove((path_name_ + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+}
+
+KeyframePager::~KeyframePager() {
+    for(auto& segment : segments_) {
+        if(segment.data) munmap(segment.data,segment.size);
+        std::remove(segment.filename.c_str());
+    }
+}
+
+auto KeyframePager::AddKeyframes(const KeyframeVector &keyframes)->bool {
+    std::unique_lock<std::mutex> lock(mtx_pager_);
+
+    std::stringstream ss;
+    ss << path_name_ << "kf_payload_" << segments_.size() << ".bin";
+    Segment segment;
+    segment.filename = ss.str();
+
+    std::ofstream fs(segment.filename,std::ios::binary | std::ios::trunc);
+    if(!fs.is_open()) {
+        std::cout << COUTERROR << "cannot create backing file " << segment.filename << std::endl;
+        return false;
+    }
+    std::vector<std::pair<Keyframe*,Page>> pages;
+    pages.reserve(keyframes.size());
+    size_t offset = 0;
+    for(const auto& kf : keyframes) {
+        if(kf->pager_ || pages_.count(kf.get())) continue;                                  // already paged
+        const std::string payload = kf->SerializePayload();
+        fs.write(payload.data(),payload.size());
+        Page page;
+        page.segment = segments_.size();
+        page.offset = offset;
+        page.size = payload.size();
+        page.resident = false;
+        pages.push_back(std::make_pair(kf.get(),page));
+        offset += payload.size();
+    }
+    fs.close();
+    if(!fs || offset == 0) {
+        if(offset > 0) std::cout << COUTERROR << "error writing backing file " << segment.filename << std::endl;
+        std::remove(segment.filename.c_str());
+        return offset == 0;
+    }
+
+    int fd = open(segment.filename.c_str(),O_RDONLY);
+    if(fd < 0) {
+        std::cout << COUTERROR << "cannot open backing file " << segment.filename << std::endl;
+        std::remove(segment.filename.c_str());
+        return false;
+    }
+    void *addr = mmap(nullptr,offset,PROT_READ,MAP_SHARED,fd,0);
+    close(fd);                                                                              // the mapping stays valid
+    if(addr == MAP_FAILED) {
+        std::cout << COUTERROR << "cannot map backing file " << segment.filename << std::endl;
+        std::remove(segment.filename.c_str());
+        return false;
+    }
+    madvise(addr,offset,MADV_RANDOM);
+    segment.data = static_cast<char*>(addr);
+    segment.size = offset;
+    segments_.push_back(segment);
+
+    // evict all payloads - the KFs are not accessed concurrently before they are registered
+    std::shared_ptr<KeyframePager> self(shared_from_this());
+    for(auto& entry : pages) {
+        Keyframe *kf = entry.first;
+        Page &page = pages_[kf];
+        page = entry.second;
+        kf->pager_ = self;
+        if(!kf->TryReleasePayload()) {
+            lru_.push_front(kf);
+            page.lru = lru_.begin();
+            page.resident = true;
+            stats_.resident_bytes += page.size;
+            ++stats_.num_resident;
+        }
+        ++stats_.num_pages;
+    }
+    stats_.file_bytes += offset;
+
+    std::cout << "--> Paged " << pages.size() << " KFs: " << offset / (1024*1024) << " MB in " << segment.filename
+              << " | budget: " << budget_bytes_ / (1024*1024) << " MB" << std::endl;
+    return true;
+}
+
+auto KeyframePager::EvictOverBudget()->void {
+    // oldest first - skip pinned payloads
+    auto lit = lru_.end();
+    while(stats_.resident_bytes > budget_bytes_ && lit != lru_.begin()) {
+        --lit;
+        Keyframe *kf = *lit;
+        if(!kf->TryReleasePayload()) continue;
+        Page &page = pages_[kf];
+        page.resident = false;
+        stats_.resident_bytes -= page.size;
+        --stats_.num_resident;
+        ++stats_.num_evictions;
+        lit = lru_.erase(lit);
+    }
+}
+
+auto KeyframePager::GetPage(const Keyframe *kf, const char *&data, size_t &size)->bool {
+    std::unique_lock<std::mutex> lock(mtx_pager_);
+    auto mit = pages_.find(kf);
+    if(mit == pages_.end()) return false;
+    const Page &page = mit->second;
+    data = segments_[page.segment].data + page.offset;
+    size = page.size;
+    return true;
+}
+
+auto KeyframePager::GetStats()->Stats {
+    std::unique_lock<std::mutex> lock(mtx_pager_);
+    return stats_;
+}
+
+auto KeyframePager::Remove(Keyframe *kf)->void {
+    std::unique_lock<std::mutex> lock(mtx_pager_);
+    auto mit = pages_.find(kf);
+    if(mit == pages_.end()) return;
+    if(mit->second.resident) {
+        lru_.erase(mit->second.lru);
+        stats_.resident_bytes -= mit->second.size;
+        --stats_.num_resident;
+    }
+    pages_.erase(mit);
+    --stats_.num_pages;
+}
+
+auto KeyframePager::Touch(Keyframe *kf)->void {
+    std::unique_lock<std::mutex> lock(mtx_pager_);
+    auto mit = pages_.find(kf);
+    if(mit == pages_.end()) return;
+    Page &page = mit->second;
+    if(page.resident) {
+        lru_.splice(lru_.begin(),lru_,page.lru);
+    } else {
+        lru_.push_front(kf);
+        page.lru = lru_.begin();
+        page.resident = true;
+        stats_.resident_bytes += page.size;
+        ++stats_.num_resident;
+        ++stats_.num_faults;
+    }
+    this->EvictOverBudget();
+}
+
+} //end ns
@@ -44,6 +44,14 @@ auto KeyframeDatabase::AddKeyframe(KeyframePtr kf)->void {
         inverted_file_index_[vit->first].push_back(kf);
 }
 
+auto KeyframeDatabase::AddKeyframes(const KeyframeVector &kfs)->void {
+    unique_lock<std::mutex> lock(mtx_);
+    for(const auto& kf : kfs) {
+        for(auto vit= kf->bow_vec_.begin(), vend=kf->bow_vec_.end(); vit!=vend; vit++)
+            inverted_file_index_[vit->first].push_back(kf);
+    }
+}
+
 auto KeyframeDatabase::DetectCandidates(KeyframePtr kf, precision_t min_score)->KeyframeVector {
     KeyframeSet connected_kfs;
     KeyframeVector connections;
@@ -40,7 +40,6 @@ Landmark::Landmark(MsgLandmark msg, MapPtr map)
 {
     if(msg.save_to_file) {
         pos_w_ = msg.pos_w;
-        msg_ = msg;
     } else {
         this->UpdatePosFromMsg(msg,map);
     }
@@ -60,6 +59,7 @@ auto Landmark::ComputeDescriptor()->void {
         if(kf->IsInvalid()){
             continue;
         }
+        KeyframePayloadGuard guard(kf);                                     // the row keeps the descriptor data alive after the guard is released
         descriptor_candidates.push_back(kf->descriptors_.row(feat_idx));
     }
     if(descriptor_candidates.empty()) {
@@ -0,0 +1,219 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/landmark_lod.hpp"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+// COVINS
+#include "covins_backend/landmark_be.hpp"
+
+namespace covins {
+
+namespace {
+
+auto FloorDiv(int64_t a, int64_t b)->int64_t {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+auto PackKey(int64_t x, int64_t y, int64_t z)->int64_t {
+    // 21 bits per axis
+    const int64_t offset = 1 << 20;
+    const int64_t mask = (1 << 21) - 1;
+    return (((x + offset) & mask) << 42) | (((y + offset) & mask) << 21) | ((z + offset) & mask);
+}
+
+} //end anonymous ns
+
+LandmarkLod::LandmarkLod(precision_t voxel_size, int chunk_voxels)
+    : voxel_size_(voxel_size > 0.0 ? voxel_size : 0.1), chunk_voxels_(std::max(chunk_voxels,1))
+{
+    //...
+}
+
+auto LandmarkLod::AddToVoxel(VoxelKey voxel, ChunkKey chunk, const Vector3Type &pos, size_t client_id)->void {
+    std::unordered_map<ChunkKey,ChunkData>::iterator cit = chunks_.find(chunk);
+    if(cit == chunks_.end()) {
+        ChunkData data;
+        std::unordered_map<ChunkKey,int>::iterator eit = erased_chunks_.find(chunk);
+        if(eit != erased_chunks_.end()) {
+            data.id = eit->second;
+            erased_chunks_.erase(eit);
+        } else {
+            data.id = next_chunk_id_++;
+        }
+        cit = chunks_.insert(std::make_pair(chunk,data)).first;
+    }
+
+    Voxel &vox = cit->second.voxels[voxel];
+    if(!vox.count) vox.client_id = client_id;
+    vox.sum += pos;
+    ++vox.count;
+    this->MarkChanged(chunk);
+}
+
+auto LandmarkLod::Clear()->void {
+    for(const auto &cit : chunks_) {
+        erased_chunks_[cit.first] = cit.second.id;
+        this->MarkChanged(cit.first);
+    }
+    chunks_.clear();
+    entries_.clear();
+    refresh_pos_ = defpair;
+}
+
+auto LandmarkLod::GetNumVoxels()->size_t {
+    size_t num = 0;
+    for(const auto &cit : chunks_) num += cit.second.voxels.size();
+    return num;
+}
+
+auto LandmarkLod::GetVoxelKey(const Vector3Type &pos, ChunkKey &chunk)->VoxelKey {
+    const int64_t x = static_cast<int64_t>(std::floor(pos[0] / voxel_size_));
+    const int64_t y = static_cast<int64_t>(std::floor(pos[1] / voxel_size_));
+    const int64_t z = static_cast<int64_t>(std::floor(pos[2] / voxel_size_));
+    chunk = PackKey(FloorDiv(x,chunk_voxels_),FloorDiv(y,chunk_voxels_),FloorDiv(z,chunk_voxels_));
+    return PackKey(x,y,z);
+}
+
+auto LandmarkLod::HasChanges()->bool {
+    return !changed_.empty();
+}
+
+auto LandmarkLod::Insert(LandmarkPtr lm)->void {
+    if(!lm || lm->IsInvalid()) return;
+    if(entries_.count(lm->id_)) return;
+
+    Entry entry;
+    entry.lm = lm;
+    entry.pos = lm->GetWorldPos();
+    entry.voxel = this->GetVoxelKey(entry.pos,entry.chunk);
+    this->AddToVoxel(entry.voxel,entry.chunk,entry.pos,lm->id_.second);
+    entries_.insert(std::make_pair(lm->id_,entry));
+}
+
+auto LandmarkLod::MarkChanged(ChunkKey chunk)->void {
+    if(changed_set_.insert(chunk).second) changed_.push_back(chunk);
+}
+
+auto LandmarkLod::PopChangedChunk(Chunk &chunk, size_t max_points)->bool {
+    while(!changed_.empty()) {
+        const ChunkKey key = changed_.front();
+
+        std::unordered_map<ChunkKey,ChunkData>::iterator cit = chunks_.find(key);
+        if(cit == chunks_.end()) {
+            std::unordered_map<ChunkKey,int>::iterator eit = erased_chunks_.find(key);
+            changed_.pop_front();
+            changed_set_.erase(key);
+            if(eit == erased_chunks_.end()) continue;
+            chunk.id = eit->second;
+            chunk.erased = true;
+            chunk.points.clear();
+            chunk.client_ids.clear();
+            erased_chunks_.erase(eit);
+            return true;
+        }
+
+        const VoxelMap &voxels = cit->second.voxels;
+        if(voxels.size() > max_points) return false;
+
+        changed_.pop_front();
+        changed_set_.erase(key);
+        chunk.id = cit->second.id;
+        chunk.erased = false;
+        chunk.points.clear();
+        chunk.client_ids.clear();
+        chunk.points.reserve(voxels.size());
+        chunk.client_ids.reserve(voxels.size());
+        for(const auto &vit : voxels) {
+            chunk.points.push_back(vit.second.sum / static_cast<precision_t>(vit.second.count));
+            chunk.client_ids.push_back(vit.second.client_id);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+auto LandmarkLod::Refresh(size_t max_num)->void {
+    if(entries_.empty() || !max_num) return;
+
+    EntryMap::iterator mit = (refresh_pos_ == defpair) ? entries_.begin() : entries_.upper_bound(refresh_pos_);
+    const size_t num = std::min(max_num,entries_.size());
+    for(size_t i=0;i<num;++i) {
+        if(mit == entries_.end()) mit = entries_.begin();
+        Entry &entry = mit->second;
+
+        if(entry.lm->IsInvalid()) {
+            this->RemoveFromVoxel(entry.voxel,entry.chunk,entry.pos);
+            mit = entries_.erase(mit);
+            if(entries_.empty()) break;
+            continue;
+        }
+
+        const Vector3Type pos = entry.lm->GetWorldPos();
+        if((pos - entry.pos).squaredNorm() > 1e-12) {
+            ChunkKey chunk;
+            const VoxelKey voxel = this->GetVoxelKey(pos,chunk);
+            if(voxel != entry.voxel) {
+                this->RemoveFromVoxel(entry.voxel,entry.chunk,entry.pos);
+                this->AddToVoxel(voxel,chunk,pos,mit->first.second);
+                entry.voxel = voxel;
+                entry.chunk = chunk;
+            } else {
+                // centroid moves inside the voxel - only published with the next change of the chunk
+                chunks_[entry.chunk].voxels[voxel].sum += pos - entry.pos;
+            }
+            entry.pos = pos;
+        }
+
+        refresh_pos_ = mit->first;
+        ++mit;
+    }
+}
+
+auto LandmarkLod::Remove(idpair id)->void {
+    EntryMap::iterator mit = entries_.find(id);
+    if(mit == entries_.end()) return;
+    this->RemoveFromVoxel(mit->second.voxel,mit->second.chunk,mit->second.pos);
+    entries_.erase(mit);
+}
+
+auto LandmarkLod::RemoveFromVoxel(VoxelKey voxel, ChunkKey chunk, const Vector3Type &pos)->void {
+    std::unordered_map<ChunkKey,ChunkData>::iterator cit = chunks_.find(chunk);
+    if(cit == chunks_.end()) return;
+    VoxelMap::iterator vit = cit->second.voxels.find(voxel);
+    if(vit == cit->second.voxels.end()) return;
+
+    vit->second.sum -= pos;
+    if(!--vit->second.count) cit->second.voxels.erase(vit);
+    if(cit->second.voxels.empty()) {
+        erased_chunks_[chunk] = cit->second.id;
+        chunks_.erase(cit);
+    }
+    this->MarkChanged(chunk);
+}
+
+} //end ns
@@ -0,0 +1,372 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/map_archive.hpp"
+
+// C++
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Thirdparty
+#include <zlib.h>
+
+namespace covins {
+
+auto MapArchive::BowRecord::FromBow(const DBoW2::BowVector &bow_vec, const DBoW2::FeatureVector &feat_vec)->void {
+    words.clear();
+    values.clear();
+    words.reserve(bow_vec.size());
+    values.reserve(bow_vec.size());
+    for(const auto& w : bow_vec) {
+        words.push_back(w.first);
+        values.push_back(w.second);
+    }
+
+    nodes.clear();
+    node_offsets.clear();
+    features.clear();
+    nodes.reserve(feat_vec.size());
+    node_offsets.reserve(feat_vec.size()+1);
+    for(const auto& n : feat_vec) {
+        nodes.push_back(n.first);
+        node_offsets.push_back(features.size());
+        features.insert(features.end(),n.second.begin(),n.second.end());
+    }
+    node_offsets.push_back(features.size());
+}
+
+auto MapArchive::BowRecord::ToBow(DBoW2::BowVector &bow_vec, DBoW2::FeatureVector &feat_vec) const->void {
+    bow_vec.clear();
+    for(size_t i=0;i<words.size() && i<values.size();++i) {
+        bow_vec.emplace_hint(bow_vec.end(),words[i],values[i]);
+    }
+
+    feat_vec.clear();
+    if(node_offsets.size() != nodes.size()+1) return;
+    for(size_t i=0;i<nodes.size();++i) {
+        auto it = feat_vec.emplace_hint(feat_vec.end(),nodes[i],std::vector<unsigned int>());
+        it->second.assign(features.begin()+node_offsets[i],features.begin()+node_offsets[i+1]);
+    }
+}
+
+auto MapArchive::VocabularyFingerprint(CovinsVocabulary::VocabularyPtr voc)->uint64_t {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void *data, size_t size) {
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        for(size_t i=0;i<size;++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    if(!voc) return 0;
+
+    const int32_t k = voc->getBranchingFactor();
+    const int32_t L = voc->getDepthLevels();
+    const int32_t weighting = voc->getWeightingType();
+    const int32_t scoring = voc->getScoringType();
+    const uint32_t num_words = voc->size();
+    add(&k,sizeof(k));
+    add(&L,sizeof(L));
+    add(&weighting,sizeof(weighting));
+    add(&scoring,sizeof(scoring));
+    add(&num_words,sizeof(num_words));
+    for(uint32_t wid=0;wid<num_words;++wid) {
+        const cv::Mat word = voc->getWord(wid);
+        add(word.data,word.total()*word.elemSize());
+        const double weight = voc->getWordWeight(wid);
+        add(&weight,sizeof(weight));
+    }
+
+    return hash;
+}
+
+MapArchiveWriter::MapArchiveWriter(bool compress)
+    : compress_(compress)
+{
+    //...
+}
+
+auto MapArchiveWriter::AddRaw(const void *data, size_t size, size_t count)->void {
+    this->Append(reinterpret_cast<const char*>(data),size);
+    count_ += count;
+}
+
+auto MapArchiveWriter::Append(const char *data, size_t size)->void {
+    if(!in_section_) {
+        std::cout << COUTFATAL << "no open section" << std::endl;
+        exit(-1);
+    }
+    if(buffered_) {
+        buffer_.append(data,size);
+    } else {
+        fs_.write(data,size);
+        bytes_written_ += size;
+    }
+    current_.raw_size += size;
+}
+
+auto MapArchiveWriter::BeginSection(eSection section)->void {
+    if(in_section_) {
+        std::cout << COUTFATAL << "section " << current_.type << " not closed" << std::endl;
+        exit(-1);
+    }
+    if(table_.size() >= MapArchive::NUM_SECTIONS) {
+        std::cout << COUTFATAL << "too many sections" << std::endl;
+        exit(-1);
+    }
+    this->Pad();
+    in_section_ = true;
+    buffered_ = compress_;  // compressed sections need to be buffered entirely
+    count_ = 0;
+    current_.type = section;
+    current_.flags = MapArchive::FLAG_NONE;
+    current_.count = 0;
+    current_.offset = bytes_written_;
+    current_.size = 0;
+    current_.raw_size = 0;
+}
+
+auto MapArchiveWriter::Close()->bool {
+    if(in_section_) this->EndSection();
+
+    // Write section table
+    MapArchive::Header header;
+    std::memcpy(header.magic,MapArchive::magic,sizeof(header.magic));
+    header.version = MapArchive::version;
+    header.num_sections = table_.size();
+    fs_.seekp(0);
+    fs_.write(reinterpret_cast<const char*>(&header),sizeof(header));
+    fs_.write(reinterpret_cast<const char*>(table_.data()),table_.size()*sizeof(MapArchive::SectionEntry));
+    fs_.close();
+
+    return !fs_.fail();
+}
+
+auto MapArchiveWriter::EndSection()->void {
+    if(!in_section_) return;
+
+    if(buffered_) {
+        uLongf size_compressed = compressBound(buffer_.size());
+        std::string compressed(size_compressed,'\0');
+        int res = compress2(reinterpret_cast<Bytef*>(&compressed[0]),&size_compressed,
+                            reinterpret_cast<const Bytef*>(buffer_.data()),buffer_.size(),Z_BEST_SPEED);
+        // Only keep the compressed version if it actually pays off (descriptors, for instance, hardly compress)
+        if(res == Z_OK && size_compressed < 0.9 * buffer_.size()) {
+            current_.flags |= MapArchive::FLAG_ZLIB;
+            fs_.write(compressed.data(),size_compressed);
+            bytes_written_ += size_compressed;
+        } else {
+            fs_.write(buffer_.data(),buffer_.size());
+            bytes_written_ += buffer_.size();
+        }
+        std::string().swap(buffer_);
+    }
+
+    current_.count = count_;
+    current_.size = bytes_written_ - current_.offset;
+    table_.push_back(current_);
+    in_section_ = false;
+}
+
+auto MapArchiveWriter::Open(const std::string &filename)->bool {
+    fs_.open(filename,std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!fs_.is_open()) {
+        std::cout << COUTERROR << "cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    // Reserve space for header and section table - written in Close()
+    const size_t table_size = sizeof(MapArchive::Header) + MapArchive::NUM_SECTIONS * sizeof(MapArchive::SectionEntry);
+    std::string placeholder(table_size,'\0');
+    fs_.write(placeholder.data(),placeholder.size());
+    bytes_written_ = table_size;
+
+    return true;
+}
+
+auto MapArchiveWriter::Pad()->void {
+    static const char zeros[64] = {0};
+    const size_t rem = bytes_written_ % 64;
+    if(rem) {
+        fs_.write(zeros,64-rem);
+        bytes_written_ += 64-rem;
+    }
+}
+
+//-------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------------------
+
+MapArchiveReader::~MapArchiveReader() {
+    this->Close();
+}
+
+auto MapArchiveReader::Close()->void {
+    if(mapped_) munmap(const_cast<char*>(mapped_),mapped_size_);
+    if(fd_ >= 0) close(fd_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+    fd_ = -1;
+    table_.clear();
+    inflated_.clear();
+}
+
+auto MapArchiveReader::FindSection(eSection section)->const MapArchive::SectionEntry* {
+    for(const auto& entry : table_) {
+        if(entry.type == section) return &entry;
+    }
+    return nullptr;
+}
+
+auto MapArchiveReader::GetCount(eSection section)->size_t {
+    const MapArchive::SectionEntry *entry = this->FindSection(section);
+    return entry ? entry->count : 0;
+}
+
+auto MapArchiveReader::GetRecords(eSection section, RecordVector &records)->bool {
+    const char *data;
+    size_t size;
+    if(!this->GetSection(section,data,size)) return false;
+
+    const size_t count = this->GetCount(section);
+    records.clear();
+    records.reserve(count);
+    size_t pos = 0;
+    for(size_t i=0;i<count;++i) {
+        uint64_t len;
+        if(pos + sizeof(len) > size) break;
+        std::memcpy(&len,data+pos,sizeof(len));
+        pos += sizeof(len);
+        if(pos + len > size) break;
+        RecordSpan rec;
+        rec.data = data + pos;
+        rec.size = len;
+        records.push_back(rec);
+        pos += len;
+    }
+
+    if(records.size() != count) {
+        std::cout << COUTERROR << "section " << section << ": corrupted record table (" << records.size() << "/" << count << " records)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+auto MapArchiveReader::GetSection(eSection section, const char *&data, size_t &size)->bool {
+    const MapArchive::SectionEntry *entry = this->FindSection(section);
+    if(!entry) return false;
+
+    if(!(entry->flags & MapArchive::FLAG_ZLIB)) {
+        data = mapped_ + entry->offset;
+        size = entry->size;
+        return true;
+    }
+
+    std::string &buf = inflated_[section];
+    if(buf.size() != entry->raw_size) {
+        buf.resize(entry->raw_size);
+        uLongf size_raw = entry->raw_size;
+        int res = uncompress(reinterpret_cast<Bytef*>(&buf[0]),&size_raw,
+                             reinterpret_cast<const Bytef*>(mapped_ + entry->offset),entry->size);
+        if(res != Z_OK || size_raw != entry->raw_size) {
+            std::cout << COUTERROR << "section " << section << ": decompression failed (" << res << ")" << std::endl;
+            std::string().swap(buf);
+            return false;
+        }
+    }
+    data = buf.data();
+    size = buf.size();
+    return true;
+}
+
+auto MapArchiveReader::HasSection(eSection section)->bool {
+    return this->FindSection(section) != nullptr;
+}
+
+auto MapArchiveReader::Open(const std::string &filename)->bool {
+    this->Close();
+
+    fd_ = open(filename.c_str(),O_RDONLY);
+    if(fd_ < 0) {
+        std::cout << COUTERROR << "cannot open file: " << filename << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd_,&st) != 0 || (size_t)st.st_size < sizeof(MapArchive::Header)) {
+        std::cout << COUTERROR << "invalid file: " << filename << std::endl;
+        this->Close();
+        return false;
+    }
+    mapped_size_ = st.st_size;
+
+    void *addr = mmap(nullptr,mapped_size_,PROT_READ,MAP_PRIVATE,fd_,0);
+    if(addr == MAP_FAILED) {
+        std::cout << COUTERROR << "mmap failed: " << filename << std::endl;
+        mapped_ = nullptr;
+        this->Close();
+        return false;
+    }
+    mapped_ = static_cast<const char*>(addr);
+    madvise(addr,mapped_size_,MADV_SEQUENTIAL);
+
+    MapArchive::Header header;
+    std::memcpy(&header,mapped_,sizeof(header));
+    if(std::memcmp(header.magic,MapArchive::magic,sizeof(header.magic)) != 0) {
+        std::cout << COUTERROR << "not a COVINS map archive: " << filename << std::endl;
+        this->Close();
+        return false;
+    }
+    if(header.version > MapArchive::version) {
+        std::cout << COUTERROR << "unsupported map archive version " << header.version << " (max. " << MapArchive::version << ")" << std::endl;
+        this->Close();
+        return false;
+    }
+
+    const size_t table_end = sizeof(header) + header.num_sections * sizeof(MapArchive::SectionEntry);
+    if(table_end > mapped_size_) {
+        std::cout << COUTERROR << "corrupted section table: " << filename << std::endl;
+        this->Close();
+        return false;
+    }
+    table_.resize(header.num_sections);
+    std::memcpy(table_.data(),mapped_+sizeof(header),header.num_sections*sizeof(MapArchive::SectionEntry));
+    for(const auto& entry : table_) {
+        if(entry.offset + entry.size > mapped_size_) {
+            std::cout << COUTERROR << "section " << entry.type << " exceeds file size: " << filename << std::endl;
+            this->Close();
+            return false;
+        }
+    }
+    inflated_.resize(MapArchive::NUM_SECTIONS);
+
+    return true;
+}
+
+} //end ns
@@ -24,13 +24,22 @@
 #include "covins_backend/map_be.hpp"
 
 // C++
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <dirent.h>
+#include <functional>
+#include <future>
+#include <sys/stat.h>
 
 // COVINS
 #include "covins_backend/keyframe_be.hpp"
 #include "covins_backend/landmark_be.hpp"
 #include "covins_backend/kf_database.hpp"
+#include "covins_backend/map_archive.hpp"
+#include "covins_backend/map_journal.hpp"
 #include "covins_backend/optimization_be.hpp"
+#include "covins/dense_matcher/ThreadPool.hpp"
 
 namespace covins {
 
@@ -70,6 +79,11 @@ auto MapManager::AddToDatabase(KeyframePtr kf)->void {
     database_->AddKeyframe(kf);
 }
 
+auto MapManager::AddToDatabase(const KeyframeVector &kfs)->void {
+    std::unique_lock<std::mutex> lock(mtx_access_);
+    database_->AddKeyframes(kfs);
+}
+
 auto MapManager::CheckMergeBuffer()->bool {
     std::unique_lock<std::mutex> lock(mtx_access_);
     return !(buffer_merge_.empty());
@@ -176,6 +190,14 @@ auto MapManager::GetDatabase()->DatabasePtr {
     return database_;
 }
 
+auto MapManager::GetMapIds()->std::vector<int> {
+    std::unique_lock<std::mutex> lock(mtx_access_);
+    std::vector<int> map_ids;
+    map_ids.reserve(maps_.size());
+    for(const auto& mit : maps_) map_ids.push_back(mit.first);
+    return map_ids;
+}
+
 auto MapManager::InitializeMap(int map_id)->void {
     std::unique_lock<std::mutex> lock(mtx_access_);
 
@@ -226,6 +248,7 @@ auto MapManager::PerformMerge()->void {
     TransformType T_wmatch_wquery = T_w_smatch * T_smatch_squery * T_w_squery.inverse();
 
     MapInstancePtr map_merged(new MapInstance(map_match,map_query,T_wmatch_wquery));
+    if(auto journal = MapJournal::GetInstance()) journal->MergeMaps(map_match->map->id_map_,map_query->map->id_map_,T_wmatch_wquery);
 
     LoopConstraint lc(kf_match,kf_query,T_smatch_squery, cov_mat);
     map_merged->map->AddLoopConstraint(lc);
@@ -247,9 +270,7 @@ auto MapManager::RegisterMap(MapPtr external_map, bool enter_kfs_in_database)->b
 
     if(enter_kfs_in_database) {
         auto keyframes = external_map->GetKeyframesVec();
-        for(const auto& kf : keyframes) {
-            this->AddToDatabase(kf);
-        }
+        this->AddToDatabase(keyframes);
     } else {
         // skip this because we do a PR test
         std::cout << COUTNOTICE << "!!! KFs not entered in database !!!" << std::endl;
@@ -388,10 +409,11 @@ auto Map::AddKeyframe(covins::MapBase::KeyframePtr kf, bool suppress_output)->vo
     std::unique_lock<std::mutex> lock(mtx_map_);
     keyframes_[kf->id_] = kf;
     max_id_kf_ = std::max(max_id_kf_,kf->id_.first);
+    if(vis_tracking_) vis_changes_.keyframes_added[kf->id_] = kf;
     if(!suppress_output && !(keyframes_.size() % 50)) {
         std::cout << "Map " << this->id_map_  << " : " << keyframes_.size() << " KFs | " << landmarks_.size() << " LMs" << std::endl;
-        this->WriteKFsToFile();
-        this->WriteKFsToFileAllAg();
+        this->WriteKFsToFile(std::string(),covins_params::sys::trajectory_incremental);
+        this->WriteKFsToFileAllAg(std::string(),covins_params::sys::trajectory_incremental);
     }
 }
 
@@ -399,13 +421,16 @@ auto Map::AddLandmark(covins::MapBase::LandmarkPtr lm)->void {
     std::unique_lock<std::mutex> lock(mtx_map_);
     landmarks_[lm->id_] = lm;
     max_id_lm_ = std::max(max_id_lm_,lm->id_.first);
+    if(vis_tracking_) vis_changes_.landmarks_added[lm->id_] = lm;
 }
 
 auto Map::AddLoopConstraint(LoopConstraint lc)->void {
     std::unique_lock<std::mutex> lock(mtx_map_);
     loop_constraints_.push_back(lc);
+    vis_changes_.loops_changed = true;
     lc.kf1->is_loop_kf_ = true;
     lc.kf2->is_loop_kf_ = true;
+    if(auto journal = MapJournal::GetInstance()) journal->AddLoopConstraint(id_map_,lc);
 }
 
 auto Map::ApplyLoopCorrection(KeyframePtr kf_query, KeyframePtr kf_match, TransformType T_smatch_squery)->void {
@@ -428,6 +453,8 @@ auto Map::ApplyLoopCorrection(KeyframePtr kf_query, KeyframePtr kf_match, Transf
 
     LoopConstraint lc(kf_match,kf_query,T_smatch_squery);
     loop_constraints_.push_back(lc);
+    vis_changes_.loops_changed = true;
+    if(auto journal = MapJournal::GetInstance()) journal->AddLoopConstraint(id_map_,lc);
 }
 
 auto Map::ConvertToMsgFileExport(MsgMap &msg)->void {
@@ -445,6 +472,13 @@ auto Map::ConvertToMsgFileExport(MsgMap &msg)->void {
     }
 }
 
+auto Map::Clear()->void {
+    std::unique_lock<std::mutex> lock(mtx_map_);
+    MapBase::Clear();
+    vis_changes_ = MapVisChanges();
+    vis_tracking_ = false;
+}
+
 auto Map::Clean()->void {
     std::unique_lock<std::mutex> lock(mtx_map_);
     std::cout << "+++ Clean Map +++" << std::endl;
@@ -465,6 +499,8 @@ auto Map::EraseKeyframe(KeyframePtr kf, bool mtx_lock)->bool {
             keyframes_.erase(mit);
             std::cout << "Map " << this->id_map_ << " : erased " << kf << std::endl;
             keyframes_erased_[kf->id_] = kf;
+            if(vis_tracking_ && !vis_changes_.keyframes_added.erase(kf->id_)) vis_changes_.keyframes_erased[kf->id_] = kf;
+            if(auto journal = MapJournal::GetInstance()) journal->EraseKeyframe(id_map_,kf->id_);
             success = true;
         }
     }
@@ -492,6 +528,8 @@ auto Map::EraseLandmark(LandmarkPtr lm, bool mtx_lock)->bool {
             std::cout << COUTWARN << "Map " << this->id_map_ << ": could not remove " << lm << std::endl;
         } else {
             landmarks_.erase(mit);
+            if(vis_tracking_ && !vis_changes_.landmarks_added.erase(lm->id_)) vis_changes_.landmarks_erased.insert(lm->id_);
+            if(auto journal = MapJournal::GetInstance()) journal->EraseLandmark(id_map_,lm->id_);
             success = true;
         }
     }
@@ -505,17 +543,115 @@ auto Map::GetLoopConstraints()->LoopVector {
     return loop_constraints_;
 }
 
-auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
-    std::cout << "+++ Load Map from File +++" << std::endl;
+auto Map::GetNumLoadThreads()->size_t {
+    if(covins_params::sys::threads_map_load > 0) return covins_params::sys::threads_map_load;
+    return std::max<size_t>(1,std::thread::hardware_concurrency());
+}
 
-    if(!voc && covins_params::placerec::type != "VINS") {
-        std::cout << COUTFATAL << "invalid vocabulary ptr" << std::endl;
-        exit(-1);
+auto Map::LoadFromArchive(const std::string &path_name, VocabularyPtr voc, LoadData &data)->bool {
+    MapArchiveReader reader;
+    if(!reader.Open(path_name+"/"+MapArchive::filename)) return false;
+
+    MapArchiveReader::RecordVector records_kf, records_desc, records_lm, records_map;
+    if(!reader.GetRecords(MapArchive::KEYFRAMES,records_kf)) return false;
+    if(!reader.GetRecords(MapArchive::DESCRIPTORS,records_desc)) return false;
+    if(!reader.GetRecords(MapArchive::LANDMARKS,records_lm)) return false;
+    if(!reader.GetRecords(MapArchive::MAPDATA,records_map)) return false;
+    if(records_desc.size() != records_kf.size() || records_map.size() != 1) {
+        std::cout << COUTERROR << "inconsistent map archive: #KFs|#descriptors|#mapdata: " << records_kf.size() << "|" << records_desc.size() << "|" << records_map.size() << std::endl;
+        return false;
+    }
+
+    const char *obs_data;
+    size_t obs_size;
+    if(!reader.GetSection(MapArchive::OBSERVATIONS,obs_data,obs_size)) return false;
+    const size_t num_obs = reader.GetCount(MapArchive::OBSERVATIONS);
+    if(num_obs * sizeof(MapArchive::ObservationRecord) != obs_size) {
+        std::cout << COUTERROR << "inconsistent map archive: observation section size " << obs_size << " for " << num_obs << " observations" << std::endl;
+        return false;
+    }
+
+    // observations are stored ordered by landmark: find the first observation of every LM
+    std::vector<size_t> obs_begin(records_lm.size()+1,num_obs);
+    {
+        size_t idx_lm = 0;
+        for(size_t idx_obs=0;idx_obs<num_obs;++idx_obs) {
+            MapArchive::ObservationRecord obs;
+            std::memcpy(&obs,obs_data+idx_obs*sizeof(obs),sizeof(obs));
+            if(obs.lm_idx < idx_lm || obs.lm_idx >= records_lm.size()) {
+                std::cout << COUTERROR << "inconsistent map archive: observation " << idx_obs << " has invalid LM index " << obs.lm_idx << std::endl;
+                return false;
+            }
+            while(idx_lm <= obs.lm_idx) obs_begin[idx_lm++] = idx_obs;
+        }
     }
 
+    // BoW vectors are only valid for the vocabulary they were computed with
+    MapArchiveReader::RecordVector records_bow;
+    bool use_bow = false;
+    if(reader.HasSection(MapArchive::BOW) && reader.GetRecords(MapArchive::BOW,records_bow)) {
+        uint64_t fingerprint = 0;
+        if(records_bow.size() == records_kf.size()+1) MapArchive::Deserialize(records_bow[0],fingerprint);
+        if(fingerprint != 0 && fingerprint == MapArchive::VocabularyFingerprint(voc)) {
+            use_bow = true;
+        } else {
+            std::cout << COUTNOTICE << "stored BoW vectors do not match the vocabulary -- recompute" << std::endl;
+        }
+    }
+
+    std::cout << "--> Loading Keyframes" << (use_bow ? " (stored BoW)" : "") << std::endl;
+    std::atomic<size_t> msg_bytes(0);
+    data.keyframes.resize(records_kf.size());
+    data.kf_links.resize(records_kf.size());
+    this->ParallelFor(records_kf.size(),[&](size_t i){
+        MsgKeyframe msg(true);
+        MapArchive::Deserialize(records_kf[i],msg);
+        MapArchive::DescriptorRecord desc;
+        MapArchive::Deserialize(records_desc[i],desc);
+        msg.descriptors = desc.descriptors;
+        msg.descriptors_add = desc.descriptors_add;
+        KeyframePtr kf(new Keyframe(msg,nullptr,use_bow ? nullptr : voc));
+        if(use_bow) {
+            MapArchive::BowRecord bow;
+            MapArchive::Deserialize(records_bow[i+1],bow);
+            bow.ToBow(kf->bow_vec_,kf->feat_vec_);
+        }
+        kf->is_loaded_ = true;
+        data.keyframes[i] = kf;
+        data.kf_links[i].id_predecessor = msg.id_predecessor;
+        data.kf_links[i].id_successor = msg.id_successor;
+        msg_bytes += GetMsgBytes(msg);
+        data.kf_links[i].landmarks = std::move(msg.landmarks);
+    });
+
+    std::cout << "--> Loading Landmarks" << std::endl;
+    data.landmarks.resize(records_lm.size());
+    data.lm_links.resize(records_lm.size());
+    this->ParallelFor(records_lm.size(),[&](size_t i){
+        MsgLandmark msg(true);
+        MapArchive::Deserialize(records_lm[i],msg);
+        for(size_t idx_obs=obs_begin[i];idx_obs<obs_begin[i+1];++idx_obs) {
+            MapArchive::ObservationRecord obs;
+            std::memcpy(&obs,obs_data+idx_obs*sizeof(obs),sizeof(obs));
+            msg.observations[std::make_pair((size_t)obs.kf_id,(size_t)obs.client_id)] = obs.feat_id;
+        }
+        LandmarkPtr lm(new Landmark(msg,nullptr));
+        lm->is_loaded_ = true;
+        data.landmarks[i] = lm;
+        msg_bytes += GetMsgBytes(msg);
+        data.lm_links[i].observations = std::move(msg.observations);
+        data.lm_links[i].id_reference = msg.id_reference;
+    });
+    data.msg_bytes = msg_bytes;
+
+    std::cout << "--> Loading Map Data" << std::endl;
+    MapArchive::Deserialize(records_map[0],data.msg_map);
+
+    return true;
+}
+
+auto Map::LoadFromDirectory(const std::string &path_name, VocabularyPtr voc, LoadData &data)->bool {
     std::vector<std::string> filenames_kf, filenames_mp;
-    KeyframeVector keyframes;
-    LandmarkVector landmarks;
 
     // quickfix char*/string compatibility [TODO] cleaner solution
     std::string kf_tmp = "/keyframes/";
@@ -531,7 +667,7 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
 
     if (dir == nullptr) {
         std::cout << "Directory is empty." << std::endl;
-        return;
+        return false;
     }
 
     while ((entry = readdir(dir)) != nullptr) {
@@ -551,7 +687,7 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
     DIR *dir2 = opendir(cstr1);
     if (dir2 == nullptr) {
         std::cout << "Directory is empty." << std::endl;
-        return;
+        return false;
     }
 
      while ((entry2 = readdir(dir2)) != nullptr) {
@@ -564,13 +700,13 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
             filenames_mp.push_back(path.str());
         }
     }
-    closedir(dir);
-
-    Eigen::Matrix4d T_ow = Eigen::Matrix4d::Identity();
+    closedir(dir2);
 
     std::cout << "--> Loading Keyframes" << std::endl;
-    for(unsigned long int i = 0; i < filenames_kf.size(); i++) {
-        if(i % 50 == 0) std::cout << "----> Loaded " << i << " of " << filenames_kf.size() << " KFs" << std::endl;
+    std::atomic<size_t> msg_bytes(0);
+    data.keyframes.resize(filenames_kf.size());
+    data.kf_links.resize(filenames_kf.size());
+    this->ParallelFor(filenames_kf.size(),[&](size_t i){
         MsgKeyframe msg(true);
         std::stringstream buf;
         std::ifstream fs;
@@ -581,24 +717,22 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
             iarchive(msg);
             KeyframePtr kf(new Keyframe(msg,nullptr,voc));
             kf->is_loaded_ = true;
-            keyframes.push_back(kf);
-            if(kf->id_.first == 0) {
-                T_ow.block<3,3>(0,0) = Eigen::Matrix3d::Zero();
-                T_ow(0,1) = 1.0;
-                T_ow(1,0) = -1.0;
-                T_ow(2,2) = 1.0;
-                T_ow.block<3,1>(0,3) = -1.0 * T_ow.block<3,3>(0,0) * kf->GetPoseTws().block<3,1>(0,3);
-            }
+            data.keyframes[i] = kf;
+            data.kf_links[i].id_predecessor = msg.id_predecessor;
+            data.kf_links[i].id_successor = msg.id_successor;
+            msg_bytes += GetMsgBytes(msg);
+            data.kf_links[i].landmarks = std::move(msg.landmarks);
             fs.close();
         } else {
             std::cout << filenames_kf[i] << std::endl;
             exit(-1);
         }
-    }
+    });
 
     std::cout << "--> Loading Landmarks" << std::endl;
-    for(unsigned long int i = 0; i < filenames_mp.size(); i++) {
-        if(i % 1000 == 0) std::cout << "----> Loaded " << i << " of " << filenames_mp.size() << " LMs" << std::endl;
+    data.landmarks.resize(filenames_mp.size());
+    data.lm_links.resize(filenames_mp.size());
+    this->ParallelFor(filenames_mp.size(),[&](size_t i){
         MsgLandmark msg(true);
         std::stringstream buf;
         std::ifstream fs;
@@ -609,16 +743,19 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
             iarchive(msg);
             LandmarkPtr lm(new Landmark(msg,nullptr));
             lm->is_loaded_ = true;
-            landmarks.push_back(lm);
+            data.landmarks[i] = lm;
+            msg_bytes += GetMsgBytes(msg);
+            data.lm_links[i].observations = std::move(msg.observations);
+            data.lm_links[i].id_reference = msg.id_reference;
             fs.close();
         } else {
             std::cout << COUTERROR << "Cannot read file: " << filenames_mp[i] << std::endl;
             exit(-1);
         }
-    }
+    });
+    data.msg_bytes = msg_bytes;
 
     std::cout << "--> Loading Map Data" << std::endl;
-    MsgMap msg_map;
     {
         std::stringstream buf;
         std::ifstream fs;
@@ -626,7 +763,7 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
         if(fs.is_open()) {
             buf << fs.rdbuf();
             cereal::BinaryInputArchive iarchive(buf);
-            iarchive(msg_map);
+            iarchive(data.msg_map);
             fs.close();
         } else {
             std::cout << COUTFATAL << "cannot load map data" << std::endl;
@@ -634,6 +771,36 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
         }
     }
 
+    return true;
+}
+
+auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
+    std::cout << "+++ Load Map from File +++" << std::endl;
+
+    if(!voc && covins_params::placerec::type != "VINS") {
+        std::cout << COUTFATAL << "invalid vocabulary ptr" << std::endl;
+        exit(-1);
+    }
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    LoadData data;
+
+    if(MapArchive::Exists(path_name)) {
+        if(!this->LoadFromArchive(path_name,voc,data)) {
+            std::cout << COUTFATAL << "cannot load map archive from " << path_name << std::endl;
+            exit(-1);
+        }
+    } else {
+        std::cout << COUTNOTICE << "no '" << MapArchive::filename << "' found in " << path_name << " -- loading legacy map format" << std::endl;
+        if(!this->LoadFromDirectory(path_name,voc,data)) return;
+    }
+
+    std::chrono::duration<double> t_load = std::chrono::steady_clock::now() - t_start;
+
+    const KeyframeVector &keyframes = data.keyframes;
+    const LandmarkVector &landmarks = data.landmarks;
+
     std::cout << "Map consists of " << keyframes.size() << " keyframes" << std::endl;
     std::cout << "Map consists of " << landmarks.size() << " landmarks" << std::endl;
 
@@ -646,8 +813,11 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
     }
 
     std::cout << "----> Landmarks" << std::endl;
-    for(const auto& lm : landmarks) {
-        for(auto mit = lm->msg_.observations.begin(); mit!=lm->msg_.observations.end();++mit){
+    // each task only modifies its own LM - KFs are accessed read-only
+    this->ParallelFor(landmarks.size(),[&](size_t i){
+        LandmarkPtr lm = landmarks[i];
+        const LandmarkLinks &links = data.lm_links[i];
+        for(auto mit = links.observations.begin(); mit!=links.observations.end();++mit){
             size_t feat_id = mit->second;
             idpair kf_id = mit->first;
             KeyframePtr kf = this->GetKeyframe(kf_id);
@@ -656,27 +826,36 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
             }
             lm->AddObservation(kf,feat_id,true);
         }
-        lm->SetReferenceKeyframe(this->GetKeyframe(lm->msg_.id_reference));
+        lm->SetReferenceKeyframe(this->GetKeyframe(links.id_reference));
         lm->ComputeDescriptor();
         lm->UpdateNormal();
+    });
+    for(const auto& lm : landmarks) {
         this->AddLandmark(lm);
     }
 
     std::cout << "----> Keyframes" << std::endl;
-    for(const auto& kf : keyframes) {
-        kf->SetPredecessor(this->GetKeyframe(kf->msg_.id_predecessor));
-        kf->SetSuccessor(this->GetKeyframe(kf->msg_.id_successor));
-        kf->EstablishNeighbors(kf->msg_, shared_from_this());
-        for(auto mit = kf->msg_.landmarks.begin(); mit!=kf->msg_.landmarks.end();++mit){
+    // each task only modifies its own KF
+    this->ParallelFor(keyframes.size(),[&](size_t i){
+        KeyframePtr kf = keyframes[i];
+        const KeyframeLinks &links = data.kf_links[i];
+        kf->SetPredecessor(this->GetKeyframe(links.id_predecessor));
+        kf->SetSuccessor(this->GetKeyframe(links.id_successor));
+        kf->EstablishNeighbors(shared_from_this());
+        for(auto mit = links.landmarks.begin(); mit!=links.landmarks.end();++mit){
             size_t feat_id = mit->first;
             idpair lm_id = mit->second;
             LandmarkPtr lm = this->GetLandmark(lm_id);
             kf->AddLandmark(lm,feat_id);
         }
+    });
+    // Covisibility updates modify the connections of neighboring KFs - see UpdateCovisibilityConnections()
+    for(const auto& kf : keyframes) {
         kf->UpdateCovisibilityConnections();
     }
 
     std::cout << "----> Map Data" << std::endl;
+    const MsgMap &msg_map = data.msg_map;
     for(size_t i=0;i<msg_map.keyframes1.size();++i) {
         KeyframePtr kf1 = this->GetKeyframe(msg_map.keyframes1[i]);
         KeyframePtr kf2 = this->GetKeyframe(msg_map.keyframes2[i]);
@@ -687,14 +866,62 @@ auto Map::LoadFromFile(const std::string &path_name, VocabularyPtr voc)->void {
         LoopConstraint lc(kf1,kf2,msg_map.transforms12[i],msg_map.cov[i]);
         loop_constraints_.push_back(lc);
     }
+
+    // Memory report: the msgs were only needed during construction, the link tables only until here
+    size_t link_bytes = data.kf_links.capacity()*sizeof(KeyframeLinks) + data.lm_links.capacity()*sizeof(LandmarkLinks);
+    for(const auto& links : data.kf_links) link_bytes += links.landmarks.size()*(sizeof(TypeDefs::LandmarksMinimalType::value_type)+32);
+    for(const auto& links : data.lm_links) link_bytes += links.observations.size()*(sizeof(TypeDefs::ObservationsMinimalType::value_type)+32);
+    const size_t msg_bytes = data.msg_bytes;
+    data = LoadData();
+    std::cout << "----> Memory: " << msg_bytes / (1024*1024) << " MB msg payload not retained | "
+              << link_bytes / (1024*1024) << " MB link tables released" << std::endl;
+
     // std::cout << "+++ Perform PGO +++" << std::endl;
     // TypeDefs::PoseMap corrected_poses;
 
     // Optimization::PoseGraphOptimization(shared_from_this(), corrected_poses);
     // this->WriteKFsToFileAllAg();
+    std::chrono::duration<double> t_total = std::chrono::steady_clock::now() - t_start;
+    std::cout << "----> Load time: " << t_load.count() << "s | Link time: " << t_total.count() - t_load.count() << "s (" << this->GetNumLoadThreads() << " threads)" << std::endl;
     std::cout << "+++ DONE +++" << std::endl;
 }
 
+auto Map::GetMsgBytes(const MsgKeyframe &msg)->size_t {
+    size_t bytes = sizeof(MsgKeyframe);
+    bytes += (msg.keypoints_distorted.size() + msg.keypoints_undistorted.size() + msg.keypoints_distorted_add.size() + msg.keypoints_undistorted_add.size())*sizeof(TypeDefs::KeypointType);
+    bytes += (msg.keypoints_aors.size() + msg.keypoints_aors_add.size())*sizeof(TypeDefs::AorsType);
+    bytes += msg.descriptors.total()*msg.descriptors.elemSize() + msg.descriptors_add.total()*msg.descriptors_add.elemSize();
+    bytes += 7*msg.preintegration.dt.size()*sizeof(double);
+    bytes += msg.landmarks.size()*(sizeof(TypeDefs::LandmarksMinimalType::value_type)+32);     // + approx. map node overhead
+    return bytes;
+}
+
+auto Map::GetMsgBytes(const MsgLandmark &msg)->size_t {
+    return sizeof(MsgLandmark) + msg.observations.size()*(sizeof(TypeDefs::ObservationsMinimalType::value_type)+32);
+}
+
+auto Map::ParallelFor(size_t num, std::function<void(size_t)> func)->void {
+    const size_t num_threads = std::min(this->GetNumLoadThreads(),std::max<size_t>(num,1));
+    if(num_threads == 1) {
+        for(size_t i=0;i<num;++i) func(i);
+        return;
+    }
+
+    // Split into more blocks than threads to balance uneven workloads
+    const size_t num_blocks = std::min(num,4*num_threads);
+    estd2::ThreadPool pool(num_threads);
+    std::vector<std::future<void>> results;
+    results.reserve(num_blocks);
+    for(size_t b=0;b<num_blocks;++b) {
+        const size_t begin = b * num / num_blocks;
+        const size_t end = (b+1) * num / num_blocks;
+        results.push_back(pool.enqueue([&func,begin,end](){
+            for(size_t i=begin;i<end;++i) func(i);
+        }));
+    }
+    for(auto& res : results) res.get(); // rethrows exceptions from the workers, e.g. from deserialization
+}
+
 auto Map::RemoveLandmarkOutliers()->int {
     // assumes mtx is locked by calling method
     int removed_lms = 0;
@@ -810,115 +1037,193 @@ auto Map::CalRedVals(KeyframeVector &kfs)->void {
     std::sort(kfs.begin(),kfs.end(),Keyframe::sort_by_redval);
 }
 
-auto Map::SaveToFile(const std::string &path_name)->void {
+auto Map::SaveToFile(const std::string &path_name, VocabularyPtr voc)->void {
 //    std::unique_lock<std::mutex> lock(mtx_map_); -- do not lock, calls map interfaces (uses mutexes there)
     std::cout << "+++ Save Map to File +++" << std::endl;
 
-    {
-        // check folder (only checks whether a folder "keyframes/" or "mappoints/" exists
-        std::string kf_tmp = "/keyframes/";
-        std::string mp_tmp = "/mappoints/";
-        char cstr0[path_name.size()+kf_tmp.size()+1];
-        char cstr1[path_name.size()+mp_tmp.size()+1];
-        strcpy(cstr0, (path_name+kf_tmp).c_str());
-        strcpy(cstr1, (path_name+mp_tmp).c_str());
-
-        std::vector<std::string> filenames_kf, filenames_mp;
-
-        // Check for KF files
-        DIR *dir = opendir(cstr0);
-        if (dir != nullptr) {
-            std::cout << COUTERROR << "Write directory is not empty: 'keyframes/' found." << std::endl;
-            return;
-        }
-
-        // Check for LM files
-        DIR *dir2 = opendir(cstr1);
-        if (dir2 != nullptr) {
-            std::cout << COUTERROR << "Write directory is not empty: 'mappoints/' found." << std::endl;
-            return;
-        };
+    if(MapArchive::Exists(path_name)) {
+        std::cout << COUTERROR << "Write directory is not empty: '" << MapArchive::filename << "' found." << std::endl;
+        return;
     }
 
     this->Clean();
 
-    std::string kf_tmp = "/keyframes";
-    std::string mp_tmp = "/mappoints";
-
-    char cstr0[path_name.size()+1];
-    char cstr[path_name.size() + kf_tmp.size()+1];
-    char cstr2[path_name.size() + mp_tmp.size()+1];
-    strcpy(cstr0,path_name.c_str());
-    strcpy(cstr, (path_name+kf_tmp).c_str());
-    strcpy(cstr2, (path_name+mp_tmp).c_str());
-    std::cout << cstr0 << std::endl;
-    std::cout << mkdir(cstr0,  0777);
-    std::cout << mkdir(cstr,  0777);
-    std::cout << mkdir(cstr2,  0777);
-    std::cout << std::endl;
-
-    std::cout << "--> Writing Keyframes to file" << std::endl;
-    auto keyframes = this->GetKeyframesVec();
-    for(unsigned long int i = 0; i < keyframes.size(); i++) {
-        std::ofstream fs;
-        fs.open(path_name+"/keyframes/keyframes"+std::to_string(i)+".txt");
-        if(fs.is_open()) {
-            KeyframePtr kfi = keyframes[i];
-            MsgKeyframe msg;
-            kfi->ConvertToMsgFileExport(msg);
+    MapSnapshot snapshot;
+    this->CreateSnapshot(snapshot);
+    if(!Map::WriteSnapshot(snapshot,path_name,voc,false)) return;
 
-            std::stringstream kf_ss;
-            cereal::BinaryOutputArchive oarchive(kf_ss);
-            oarchive(msg);
+    std::cout << "+++ DONE +++" << std::endl;
+}
 
-            fs << kf_ss.str();
-            fs.close();
-        }
+auto Map::CreateSnapshot(MapSnapshot &snapshot)->void {
+    snapshot.keyframes = this->GetKeyframesVec();
+    snapshot.kf_states.resize(snapshot.keyframes.size());
+    for(size_t i=0;i<snapshot.keyframes.size();++i) {
+        snapshot.keyframes[i]->ConvertToMsgFileExportState(snapshot.kf_states[i]);
     }
 
-    std::cout << "--> Writing Landmarks to file" << std::endl;
     auto landmarks = this->GetLandmarksVec();
-    for(unsigned long int i = 0; i < landmarks.size(); i++) {
-        LandmarkPtr lmi = landmarks[i];
+    snapshot.lm_states.clear();
+    snapshot.lm_states.reserve(landmarks.size());
+    snapshot.lm_observations.clear();
+    MsgLandmark msg(true);
+    for(const auto& lmi : landmarks) {
         if(lmi->GetObservations().size() < 2) {
             continue;
         }
         if(!lmi->GetReferenceKeyframe()) {
             continue;
         }
-        std::ofstream fs;
-        fs.open(path_name+"/mappoints/mappoints"+std::to_string(i)+".txt");
-        if(fs.is_open()) {
-            MsgLandmark msg;
-            lmi->ConvertToMsgFileExport(msg);
+        msg.observations.clear();
+        lmi->ConvertToMsgFileExport(msg);
+        snapshot.AddLandmark(msg);
+    }
 
-            std::stringstream mp_ss;
-            cereal::BinaryOutputArchive oarchive(mp_ss);
-            oarchive(msg);
+    this->ConvertToMsgFileExport(snapshot.msg_map);
+}
 
-            fs << mp_ss.str();
-            fs.close();
-        }
+auto MapSnapshot::AddLandmark(const MsgLandmark &msg)->void {
+    LandmarkState state;
+    state.id = msg.id;
+    state.id_reference = msg.id_reference;
+    state.pos_w = msg.pos_w;
+    state.obs_begin = lm_observations.size();
+    for(const auto& obs : msg.observations) {
+        MapArchive::ObservationRecord rec;
+        rec.lm_idx = lm_states.size();
+        rec.kf_id = obs.first.first;
+        rec.client_id = obs.first.second;
+        rec.feat_id = obs.second;
+        lm_observations.push_back(rec);
     }
+    lm_states.push_back(state);
+}
 
-    std::cout << "--> Writing Map Data to file" << std::endl;
-    {
-        std::ofstream fs;
-        fs.open(path_name+"/mapdata"+".txt");
-        if(fs.is_open()) {
-            MsgMap msg;
-            this->ConvertToMsgFileExport(msg);
+auto MapSnapshot::GetLandmark(size_t idx, MsgLandmark &msg) const->void {
+    const LandmarkState &state = lm_states[idx];
+    msg.id = state.id;
+    msg.id_reference = state.id_reference;
+    msg.pos_w = state.pos_w;
+    msg.observations.clear();
+    const size_t obs_end = state.obs_begin + this->GetNumObservations(idx);
+    for(size_t i=state.obs_begin;i<obs_end;++i) {
+        const MapArchive::ObservationRecord &rec = lm_observations[i];
+        msg.observations[std::make_pair((size_t)rec.kf_id,(size_t)rec.client_id)] = rec.feat_id;
+    }
+}
 
-            std::stringstream map_ss;
-            cereal::BinaryOutputArchive oarchive(map_ss);
-            oarchive(msg);
+auto MapSnapshot::GetNumObservations(size_t idx) const->size_t {
+    const size_t obs_end = idx+1 < lm_states.size() ? lm_states[idx+1].obs_begin : lm_observations.size();
+    return obs_end - lm_states[idx].obs_begin;
+}
 
-            fs << map_ss.str();
-            fs.close();
+auto Map::WriteSnapshot(const MapSnapshot &snapshot, const std::string &path_name, VocabularyPtr voc, bool overwrite,
+                        std::function<void(size_t,size_t)> progress)->bool {
+    const std::string filename = path_name + "/" + MapArchive::filename;
+    if(!overwrite && MapArchive::Exists(path_name)) {
+        std::cout << COUTERROR << "Write directory is not empty: '" << MapArchive::filename << "' found." << std::endl;
+        return false;
+    }
+
+    // write to a temporary file first - an existing archive stays valid until the new one is complete
+    const std::string filename_tmp = filename + ".tmp";
+    mkdir(path_name.c_str(),0777);
+    std::cout << "--> Writing map archive to " << filename << std::endl;
+    MapArchiveWriter writer(covins_params::sys::map_archive_compression);
+    if(!writer.Open(filename_tmp)) {
+        std::cout << COUTERROR << "cannot create map archive" << std::endl;
+        return false;
+    }
+
+    const auto& keyframes = snapshot.keyframes;
+    const bool full_msgs = keyframes.empty();               // no KFs given: kf_states hold complete msgs, e.g. replayed from the journal
+    const size_t num_kfs = snapshot.kf_states.size();
+    if(full_msgs) voc = nullptr;
+    const size_t num_total = 2*num_kfs + (voc ? num_kfs : 0) + snapshot.lm_states.size();
+    size_t num_done = 0;
+    auto report = [&](){
+        ++num_done;
+        if(progress) progress(num_done,num_total);
+    };
+
+    std::cout << "--> Writing Keyframes" << std::endl;
+    writer.BeginSection(MapArchive::KEYFRAMES);
+    for(size_t i=0;i<num_kfs;++i) {
+        MsgKeyframe msg = snapshot.kf_states[i];
+        if(!full_msgs) keyframes[i]->ConvertToMsgFileExportFeatures(msg);
+        // descriptors go to their own section
+        msg.descriptors = cv::Mat();
+        msg.descriptors_add = cv::Mat();
+        writer.AddRecord(msg);
+        report();
+    }
+    writer.EndSection();
+
+    writer.BeginSection(MapArchive::DESCRIPTORS);
+    for(size_t i=0;i<num_kfs;++i) {
+        MapArchive::DescriptorRecord desc;
+        if(full_msgs) {
+            desc.descriptors = snapshot.kf_states[i].descriptors;
+            desc.descriptors_add = snapshot.kf_states[i].descriptors_add;
+        } else {
+            KeyframePayloadGuard guard(keyframes[i]);
+            desc.descriptors = keyframes[i]->descriptors_;           // descriptors do not change after creation - no copy needed
+            desc.descriptors_add = keyframes[i]->descriptors_add_;
+        }
+        writer.AddRecord(desc);
+        report();
+    }
+    writer.EndSection();
+
+    if(voc) {
+        std::cout << "--> Writing BoW Vectors" << std::endl;
+        writer.BeginSection(MapArchive::BOW);
+        writer.AddRecord(MapArchive::VocabularyFingerprint(voc));
+        for(const auto& kfi : keyframes) {
+            MapArchive::BowRecord bow;
+            bow.FromBow(kfi->bow_vec_,kfi->feat_vec_);  // BoW does not change after creation
+            writer.AddRecord(bow);
+            report();
         }
+        writer.EndSection();
     }
 
-    std::cout << "+++ DONE +++" << std::endl;
+    std::cout << "--> Writing Landmarks" << std::endl;
+    const auto& observations = snapshot.lm_observations;       // already in the layout of the archive
+    const size_t num_lms = snapshot.lm_states.size();
+    writer.BeginSection(MapArchive::LANDMARKS);
+    for(const auto& lm_state : snapshot.lm_states) {
+        // observations go to their own section
+        MsgLandmark msg(true);
+        msg.id = lm_state.id;
+        msg.id_reference = lm_state.id_reference;
+        msg.pos_w = lm_state.pos_w;
+        writer.AddRecord(msg);
+        report();
+    }
+    writer.EndSection();
+
+    writer.BeginSection(MapArchive::OBSERVATIONS);
+    writer.AddRaw(observations.data(),observations.size()*sizeof(MapArchive::ObservationRecord),observations.size());
+    writer.EndSection();
+
+    std::cout << "--> Writing Map Data" << std::endl;
+    writer.BeginSection(MapArchive::MAPDATA);
+    writer.AddRecord(snapshot.msg_map);
+    writer.EndSection();
+
+    if(!writer.Close()) {
+        std::cout << COUTERROR << "error writing map archive " << filename << std::endl;
+        std::remove(filename_tmp.c_str());
+        return false;
+    }
+    if(std::rename(filename_tmp.c_str(),filename.c_str()) != 0) {
+        std::cout << COUTERROR << "cannot move " << filename_tmp << " to " << filename << std::endl;
+        return false;
+    }
+
+    std::cout << "----> " << num_kfs << " KFs | " << num_lms << " LMs | " << observations.size() << " observations | " << writer.GetBytesWritten() / (1024*1024) << " MB" << std::endl;
+    return true;
 }
 
 auto Map::UpdateCovisibilityConnections(idpair kf_id)->void {
@@ -941,50 +1246,27 @@ auto Map::UpdateCovisibilityConnections(idpair kf_id)->void {
     }
 }
 
-auto Map::WriteKFsToFile(std::string suffix)->void{
-    for(std::set<size_t>::iterator sit = associated_clients_.begin();sit!=associated_clients_.end();++sit){
-        int client_id = *sit;
-        if(covins_params::sys::trajectory_format == "EUROC") {
-            std::stringstream ss;
-            ss << covins_params::sys::output_dir << "KF_" << client_id << suffix << "_feuroc" << ".csv";
-            this->WriteStateToCsv(ss.str(),client_id);
-        } else if(covins_params::sys::trajectory_format == "TUM") {
-            std::stringstream ss;
-            ss << covins_params::sys::output_dir << "KF_" << client_id << suffix << "_ftum" << ".csv";
-            this->WriteStateToCsvTUM(ss.str(),client_id);
-        } else {
-            std::cout << COUTFATAL << "trajectory_format '" << covins_params::sys::trajectory_format << "' not in { EUROC | TUM }" << std::endl;
-            exit(-1);
-        }
+auto Map::PullVisChanges(MapVisChanges &changes, bool full)->void {
+    std::unique_lock<std::mutex> lock(mtx_map_);
+    if(full || !vis_tracking_) {
+        changes = MapVisChanges();
+        changes.full = true;
+        changes.keyframes_added = keyframes_;
+        changes.keyframes_erased = keyframes_erased_;
+        changes.landmarks_added = landmarks_;
+        changes.loops_changed = true;
+        changes.loops = loop_constraints_;
+        vis_changes_ = MapVisChanges();
+        vis_tracking_ = true;
+        return;
     }
-}
 
-auto Map::WriteKFsToFileAllAg(std::string prefix) -> void {
-    for(std::set<size_t>::iterator sit = associated_clients_.begin();sit!=associated_clients_.end();++sit){
-        int client_id = *sit;
-        std::stringstream ss;
-        ss << covins_params::sys::output_dir /*<< covins_params::sys::time*/
-           << "stamped_traj_estimate" << prefix << ".txt";
-
-        if(covins_params::sys::trajectory_format == "EUROC") {
-            if(sit == associated_clients_.begin())
-              this->WriteStateToCsv(ss.str(), client_id);
-            else
-              this->WriteStateToCsv(ss.str(), client_id, false);
-        } else if(covins_params::sys::trajectory_format == "TUM") {
-            if(sit == associated_clients_.begin())
-              this->WriteStateToCsvTUM(ss.str(), client_id);
-            else
-              this->WriteStateToCsvTUM(ss.str(), client_id, false);
-        } else {
-            std::cout << COUTFATAL << "trajectory_format '" << covins_params::sys::trajectory_format << "' not in { EUROC | TUM }" << std::endl;
-            exit(-1);
-        }
-          
-    }
+    changes = MapVisChanges();
+    std::swap(changes,vis_changes_);
+    if(changes.loops_changed) changes.loops = loop_constraints_;
 }
 
-auto Map::WriteStateToCsv(const std::string& filename, const size_t client_id, const bool trnc)->void {
+auto Map::GetTrajectoryStates(const size_t client_id, TrajectoryWriter::StateVector &states)->void {
     KeyframeVector found_kfs;
     found_kfs.reserve(keyframes_.size());
     // Get all frames from the required client
@@ -996,82 +1278,53 @@ auto Map::WriteStateToCsv(const std::string& filename, const size_t client_id, c
         }
     }
 
-    if(found_kfs.empty()) //do not overwrite files from other maps with empty files
-        return;
-
-    // Sort the keyframes by timestamp
+    // Sort the keyframes by timestamp - newest first
     std::sort(found_kfs.begin(), found_kfs.end(), Keyframe::CompStamp);
 
-    // Write out the keyframe data
-    std::ofstream keyframes_file;
-    if(trnc)
-      keyframes_file.open(filename, std::ios::out | std::ios::trunc);
-    else
-      keyframes_file.open(filename, std::ios::out | std::ios::app);
-    
-    if (keyframes_file.is_open()) {
-        for (KeyframeVector::const_iterator vit = found_kfs.begin(); vit != found_kfs.end(); ++vit) {
-            KeyframePtr kf = (*vit);
-            const double stamp = kf->timestamp_;
-            Eigen::Vector3d bias_accel, bias_gyro;
-            kf->GetStateBias(bias_accel, bias_gyro);
-            Eigen::Vector3d vel = kf->GetStateVelocity();
-            const Eigen::Matrix4d Tws = kf->GetPoseTws();
-            const Eigen::Quaterniond q(Tws.block<3,3>(0,0));
-
-            keyframes_file << std::setprecision(25) << stamp * 1e9f << ",";
-            keyframes_file << Tws(0,3) << "," << Tws(1,3) << "," << Tws(2,3) << ",";
-            keyframes_file << q.w() << "," << q.x() << "," << q.y() << "," << q.z() << ",";
-            keyframes_file << vel[0] << "," << vel[1] << "," << vel[2] << ",";
-            keyframes_file << bias_gyro[0] << "," << bias_gyro[1] << "," << bias_gyro[2] << ",";
-            keyframes_file << bias_accel[0] << "," << bias_accel[1] << "," << bias_accel[2] << std::endl;
-        }
-        keyframes_file.close();
+    // states are written oldest first - trajectory tools (and appended blocks) expect increasing stamps
+    states.reserve(states.size() + found_kfs.size());
+    for (KeyframeVector::const_reverse_iterator vit = found_kfs.rbegin(); vit != found_kfs.rend(); ++vit) {
+        KeyframePtr kf = (*vit);
+        TrajectoryWriter::State state;
+        state.client_id = client_id;
+        state.stamp = kf->timestamp_;
+        state.T_w_s = kf->GetPoseTws();
+        state.velocity = kf->GetStateVelocity();
+        kf->GetStateBias(state.bias_accel, state.bias_gyro);
+        states.push_back(state);
     }
-    else
-        std::cout << COUTERROR << ": Unable to open file: " << filename << std::endl;
 }
 
-auto Map::WriteStateToCsvTUM(const std::string& filename, const size_t client_id, const bool trnc)->void {
-    KeyframeVector found_kfs;
-    found_kfs.reserve(keyframes_.size());
-    // Get all frames from the required client
-    for (KeyframeMap::const_iterator mit = keyframes_.begin(); mit != keyframes_.end(); ++mit) {
-        KeyframePtr kf = mit->second;
-        idpair curr_id = mit->first;
-        if (curr_id.second == client_id) {
-            found_kfs.push_back(kf);
-        }
+auto Map::WriteKFsToFile(std::string suffix, bool incremental)->void{
+    const TrajectoryWriter::eFormat format = TrajectoryWriter::GetFormat();
+    for(std::set<size_t>::iterator sit = associated_clients_.begin();sit!=associated_clients_.end();++sit){
+        int client_id = *sit;
+        TrajectoryWriter::Job job;
+        std::stringstream ss;
+        if(format == TrajectoryWriter::EUROC)
+            ss << covins_params::sys::output_dir << "KF_" << client_id << suffix << "_feuroc" << ".csv";
+        else
+            ss << covins_params::sys::output_dir << "KF_" << client_id << suffix << "_ftum" << ".csv";
+        job.filename = ss.str();
+        job.format = format;
+        job.incremental = incremental;
+        this->GetTrajectoryStates(client_id,job.states);
+        TrajectoryWriter::Submit(std::move(job));
     }
+}
 
-    if(found_kfs.empty()) //do not overwrite files from other maps with empty files
-        return;
-
-    // Sort the keyframes by timestamp
-    std::sort(found_kfs.begin(), found_kfs.end(), Keyframe::CompStamp);
+auto Map::WriteKFsToFileAllAg(std::string prefix, bool incremental) -> void {
+    std::stringstream ss;
+    ss << covins_params::sys::output_dir /*<< covins_params::sys::time*/
+       << "stamped_traj_estimate" << prefix << ".txt";
 
-    // Write out the keyframe data
-    std::ofstream keyframes_file;
-    if(trnc)
-      keyframes_file.open(filename, std::ios::out | std::ios::trunc);
-    else
-      keyframes_file.open(filename, std::ios::out | std::ios::app);
-    
-    if (keyframes_file.is_open()) {
-        for (KeyframeVector::const_iterator vit = found_kfs.begin(); vit != found_kfs.end(); ++vit) {
-            KeyframePtr kf = (*vit);
-            const double stamp = kf->timestamp_;
-            const Eigen::Matrix4d Tws = kf->GetPoseTws();
-            const Eigen::Quaterniond q(Tws.block<3,3>(0,0));
-
-            keyframes_file << std::setprecision(25) << stamp << " ";
-            keyframes_file << Tws(0,3) << " " << Tws(1,3) << " " << Tws(2,3) << " ";
-            keyframes_file << q.x() << " " << q.y() << " " << q.z() << " " << q.w() 
-            << std::endl;
-        }
-        keyframes_file.close();
+    TrajectoryWriter::Job job;
+    job.filename = ss.str();
+    job.format = TrajectoryWriter::GetFormat();
+    job.incremental = incremental;
+    for(std::set<size_t>::iterator sit = associated_clients_.begin();sit!=associated_clients_.end();++sit){
+        this->GetTrajectoryStates(*sit,job.states);
     }
-    else
-        std::cout << COUTERROR << ": Unable to open file: " << filename << std::endl;
+    TrajectoryWriter::Submit(std::move(job));
 }
 } //end ns
@@ -0,0 +1,771 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/map_journal.hpp"
+
+// C++
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// COVINS
+#include "covins_backend/keyframe_be.hpp"
+#include "covins_backend/landmark_be.hpp"
+#include "covins_backend/map_archive.hpp"
+
+// Thirdparty
+#include <cereal/types/string.hpp>
+#include <zlib.h>
+
+namespace covins {
+
+MapJournal::JournalPtr MapJournal::instance_ = nullptr;
+std::mutex MapJournal::mtx_instance_;
+
+namespace {
+
+auto ApplyKeyframeState(MsgKeyframe &msg, const MsgKeyframe &state)->void {
+    // fields written by Keyframe::ConvertToMsgFileExportState()
+    msg.timestamp = state.timestamp;
+    msg.T_s_c = state.T_s_c;
+    msg.T_w_s = state.T_w_s;
+    msg.T_w_s_vio = state.T_w_s_vio;
+    msg.velocity = state.velocity;
+    msg.bias_accel = state.bias_accel;
+    msg.bias_gyro = state.bias_gyro;
+    msg.lin_acc_init = state.lin_acc_init;
+    msg.ang_vel_init = state.ang_vel_init;
+    msg.preintegration = state.preintegration;
+    msg.id_predecessor = state.id_predecessor;
+    msg.id_successor = state.id_successor;
+    msg.landmarks = state.landmarks;
+}
+
+} //end anonymous ns
+
+MapJournal::MapJournal(const std::string &path_name)
+    : path_name_(path_name), compaction_running_(false)
+{
+    if(path_name_.empty() || path_name_.back() != '/') path_name_ += "/";
+    mkdir(path_name_.c_str(),0777);
+
+    // never append to an existing segment - it might end with a torn record
+    auto segments = this->GetSegments();
+    const uint32_t number = segments.empty() ? 1 : segments.back() + 1;
+    if(!this->OpenSegment(number)) {
+        std::cout << COUTFATAL << "cannot open journal segment " << this->GetSegmentPath(number) << std::endl;
+        exit(-1);
+    }
+}
+
+MapJournal::~MapJournal() {
+    if(thread_compaction_ && thread_compaction_->joinable()) thread_compaction_->join();
+    if(fd_ >= 0) close(fd_);
+}
+
+auto MapJournal::AddKeyframe(size_t map_id, KeyframePtr kf)->void {
+    Entry entry;
+    entry.type = KF_INSERT;
+    entry.map_id = map_id;
+    entry.kf = kf;
+    entry.kf_state.reset(new MsgKeyframe(true));
+    kf->ConvertToMsgFileExportState(*entry.kf_state);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::AddLandmark(size_t map_id, LandmarkPtr lm)->void {
+    if(!lm->GetReferenceKeyframe()) return;
+    MsgLandmark msg(true);
+    lm->ConvertToMsgFileExport(msg);
+    Entry entry;
+    entry.type = LM_INSERT;
+    entry.map_id = map_id;
+    entry.payload = Serialize(msg);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::AddLoopConstraint(size_t map_id, const LoopConstraint &lc)->void {
+    LoopRecord rec;
+    rec.kf1 = lc.kf1->id_;
+    rec.kf2 = lc.kf2->id_;
+    rec.T_s1_s2 = lc.T_s1_s2;
+    rec.cov = lc.cov_mat;
+    Entry entry;
+    entry.type = LOOP;
+    entry.map_id = map_id;
+    entry.payload = Serialize(rec);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::ApplyRecord(eRecord type, uint32_t map_id, const char *data, size_t size, MapTables &tables)->void {
+    MapArchive::RecordSpan record;
+    record.data = data;
+    record.size = size;
+    MapTable &table = tables[map_id];
+    if(table.failed) return;
+
+    switch(type) {
+    case KF_INSERT: {
+        MsgKeyframe msg(true);
+        MapArchive::Deserialize(record,msg);
+        table.keyframes.erase(msg.id);
+        table.keyframes.emplace(msg.id,msg);
+        break;
+    }
+    case LM_INSERT: {
+        MsgLandmark msg(true);
+        MapArchive::Deserialize(record,msg);
+        table.landmarks.erase(msg.id);
+        table.landmarks.emplace(msg.id,msg);
+        break;
+    }
+    case KF_POSE: {
+        KeyframePoseRecord rec;
+        MapArchive::Deserialize(record,rec);
+        auto mit = table.keyframes.find(rec.id);
+        if(mit == table.keyframes.end()) break;
+        mit->second.T_w_s = rec.T_w_s;
+        mit->second.T_w_s_vio = rec.T_w_s_vio;
+        mit->second.velocity = rec.velocity;
+        mit->second.bias_accel = rec.bias_accel;
+        mit->second.bias_gyro = rec.bias_gyro;
+        break;
+    }
+    case LM_POS: {
+        LandmarkPosRecord rec;
+        MapArchive::Deserialize(record,rec);
+        auto mit = table.landmarks.find(rec.id);
+        if(mit != table.landmarks.end()) mit->second.pos_w = rec.pos_w;
+        break;
+    }
+    case KF_ERASE: {
+        idpair id;
+        MapArchive::Deserialize(record,id);
+        table.keyframes.erase(id);
+        break;
+    }
+    case LM_ERASE: {
+        idpair id;
+        MapArchive::Deserialize(record,id);
+        table.landmarks.erase(id);
+        break;
+    }
+    case LOOP: {
+        LoopRecord rec;
+        MapArchive::Deserialize(record,rec);
+        table.msg_map.keyframes1.push_back(rec.kf1);
+        table.msg_map.keyframes2.push_back(rec.kf2);
+        table.msg_map.transforms12.push_back(rec.T_s1_s2);
+        table.msg_map.cov.push_back(rec.cov);
+        break;
+    }
+    case MERGE: {
+        // same as Map::Map(map_target,map_tofuse,T_wtarget_wtofuse)
+        MergeRecord rec;
+        MapArchive::Deserialize(record,rec);
+        if(rec.map_id_tofuse == map_id) break;
+        auto tit = tables.find(rec.map_id_tofuse);
+        if(tit == tables.end()) break;
+        MapTable &tofuse = tit->second;
+        const TypeDefs::Matrix3Type R = rec.T_wtarget_wtofuse.block<3,3>(0,0);
+        const Vector3Type t = rec.T_wtarget_wtofuse.block<3,1>(0,3);
+        for(auto& mit : tofuse.keyframes) {
+            mit.second.T_w_s = rec.T_wtarget_wtofuse * mit.second.T_w_s;
+            mit.second.velocity = R * mit.second.velocity;
+            table.keyframes.erase(mit.first);
+            table.keyframes.emplace(mit.first,std::move(mit.second));
+        }
+        for(auto& mit : tofuse.landmarks) {
+            mit.second.pos_w = R * mit.second.pos_w + t;
+            table.landmarks.erase(mit.first);
+            table.landmarks.emplace(mit.first,std::move(mit.second));
+        }
+        MsgMap &mm = table.msg_map;
+        const MsgMap &mm_tofuse = tofuse.msg_map;
+        mm.keyframes1.insert(mm.keyframes1.end(),mm_tofuse.keyframes1.begin(),mm_tofuse.keyframes1.end());
+        mm.keyframes2.insert(mm.keyframes2.end(),mm_tofuse.keyframes2.begin(),mm_tofuse.keyframes2.end());
+        mm.transforms12.insert(mm.transforms12.end(),mm_tofuse.transforms12.begin(),mm_tofuse.transforms12.end());
+        mm.cov.insert(mm.cov.end(),mm_tofuse.cov.begin(),mm_tofuse.cov.end());
+        tables.erase(tit);
+        break;
+    }
+    case STATE: {
+        MapArchive::MemoryBuffer buf(data,size);
+        std::istream is(&buf);
+        cereal::BinaryInputArchive iarchive(is);
+        uint64_t num_kfs, num_lms;
+        iarchive(num_kfs);
+        for(uint64_t i=0;i<num_kfs;++i) {
+            MsgKeyframe state(true);
+            iarchive(state);
+            auto mit = table.keyframes.find(state.id);
+            if(mit != table.keyframes.end()) ApplyKeyframeState(mit->second,state);
+        }
+        iarchive(num_lms);
+        for(uint64_t i=0;i<num_lms;++i) {
+            MsgLandmark msg(true);
+            iarchive(msg);
+            table.landmarks.erase(msg.id);
+            table.landmarks.emplace(msg.id,msg);
+        }
+        iarchive(table.msg_map);
+        break;
+    }
+    case MAP_LOAD: {
+        MapLoadRecord rec;
+        MapArchive::Deserialize(record,rec);
+        const bool ok = rec.format == FORMAT_DIRECTORY ? ReadDirectory(rec.path_name,table) : ReadArchive(rec.path_name,table);
+        if(!ok) {
+            // the rest of the records of the map would only build on a partial table
+            std::cout << COUTERROR << "Map " << map_id << ": cannot read loaded map " << rec.path_name << std::endl;
+            table = MapTable();
+            table.failed = true;
+        }
+        break;
+    }
+    default:
+        std::cout << COUTWARN << "unknown journal record type " << type << " -- skip" << std::endl;
+    }
+}
+
+auto MapJournal::Compact()->void {
+    // rotate: new records go to a new segment, all closed segments are folded in the background
+    if(!this->OpenSegment(segment_+1)) {
+        std::cout << COUTERROR << "cannot open journal segment " << this->GetSegmentPath(segment_+1) << " -- compaction skipped" << std::endl;
+        return;
+    }
+    std::vector<uint32_t> segments;
+    for(auto number : this->GetSegments()) {
+        if(number < segment_) segments.push_back(number);
+    }
+    if(thread_compaction_ && thread_compaction_->joinable()) thread_compaction_->join();
+    compaction_running_ = true;
+    thread_compaction_.reset(new std::thread([this,segments](){
+        this->FoldSegments(segments);
+        compaction_running_ = false;
+    }));
+}
+
+auto MapJournal::EraseKeyframe(size_t map_id, idpair id)->void {
+    Entry entry;
+    entry.type = KF_ERASE;
+    entry.map_id = map_id;
+    entry.payload = Serialize(id);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::EraseLandmark(size_t map_id, idpair id)->void {
+    Entry entry;
+    entry.type = LM_ERASE;
+    entry.map_id = map_id;
+    entry.payload = Serialize(id);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::FoldSegments(const std::vector<uint32_t> &segments)->bool {
+    std::unique_lock<std::mutex> lock(mtx_fold_);
+    if(segments.empty()) return true;
+    auto t_start = std::chrono::steady_clock::now();
+
+    // base archives
+    MapTables tables;
+    std::vector<uint32_t> base_ids;
+    if(DIR *dir = opendir(path_name_.c_str())) {
+        struct dirent *entry;
+        while((entry = readdir(dir)) != nullptr) {
+            unsigned int map_id;
+            char tail;
+            if(sscanf(entry->d_name,"map_%u%c",&map_id,&tail) == 1 && MapArchive::Exists(this->GetBasePath(map_id))) {
+                base_ids.push_back(map_id);
+            }
+        }
+        closedir(dir);
+    }
+    for(auto map_id : base_ids) {
+        if(!ReadArchive(this->GetBasePath(map_id),tables[map_id])) {
+            std::cout << COUTERROR << "cannot read journal base archive of map " << map_id << " -- compaction aborted" << std::endl;
+            return false;
+        }
+    }
+
+    size_t num_records = 0;
+    for(auto number : segments) {
+        num_records += ReplaySegment(this->GetSegmentPath(number),tables);
+    }
+    for(auto& mit : tables) {
+        if(mit.second.failed) {
+            std::cout << COUTERROR << "cannot replay the journal of map " << mit.first << " -- compaction aborted" << std::endl;
+            return false;
+        }
+    }
+
+    for(auto& mit : tables) {
+        if(!WriteArchive(mit.first,mit.second,this->GetBasePath(mit.first))) {
+            std::cout << COUTERROR << "cannot write journal base archive of map " << mit.first << " -- compaction aborted" << std::endl;
+            return false;
+        }
+    }
+    // maps that were merged into others
+    for(auto map_id : base_ids) {
+        if(!tables.count(map_id)) std::remove((this->GetBasePath(map_id) + "/" + MapArchive::filename).c_str());
+    }
+    for(auto number : segments) {
+        std::remove(this->GetSegmentPath(number).c_str());
+    }
+
+    std::chrono::duration<double> t_fold = std::chrono::steady_clock::now() - t_start;
+    std::cout << "Journal: folded " << segments.size() << " segment(s) with " << num_records << " records into " << tables.size() << " map(s) in " << t_fold.count() << "s" << std::endl;
+    return true;
+}
+
+auto MapJournal::GetBasePath(uint32_t map_id)->std::string {
+    std::stringstream ss;
+    ss << path_name_ << "map_" << map_id;
+    return ss.str();
+}
+
+auto MapJournal::GetInstance()->JournalPtr {
+    std::unique_lock<std::mutex> lock(mtx_instance_);
+    return instance_;
+}
+
+auto MapJournal::GetSegmentPath(uint32_t number)->std::string {
+    char name[32];
+    snprintf(name,sizeof(name),"journal_%06u.cvmj",number);
+    return path_name_ + name;
+}
+
+auto MapJournal::GetSegments()->std::vector<uint32_t> {
+    std::vector<uint32_t> segments;
+    DIR *dir = opendir(path_name_.c_str());
+    if(!dir) return segments;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != nullptr) {
+        unsigned int number;
+        if(sscanf(entry->d_name,"journal_%u.cvmj",&number) == 1) segments.push_back(number);
+    }
+    closedir(dir);
+    std::sort(segments.begin(),segments.end());
+    return segments;
+}
+
+auto MapJournal::LoadMap(size_t map_id, const std::string &path_name)->void {
+    MapLoadRecord rec;
+    rec.path_name = path_name;
+    rec.format = MapArchive::Exists(path_name) ? FORMAT_ARCHIVE : FORMAT_DIRECTORY; // same choice as Map::LoadFromFile()
+    Entry entry;
+    entry.type = MAP_LOAD;
+    entry.map_id = map_id;
+    entry.payload = Serialize(rec);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::MergeMaps(size_t map_id_target, size_t map_id_tofuse, TransformType T_wtarget_wtofuse)->void {
+    MergeRecord rec;
+    rec.map_id_tofuse = map_id_tofuse;
+    rec.T_wtarget_wtofuse = T_wtarget_wtofuse;
+    Entry entry;
+    entry.type = MERGE;
+    entry.map_id = map_id_target;
+    entry.payload = Serialize(rec);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::OpenSegment(uint32_t number)->bool {
+    const std::string filename = this->GetSegmentPath(number);
+    int fd = open(filename.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,0644);
+    if(fd < 0) return false;
+
+    SegmentHeader header;
+    std::memset(&header,0,sizeof(header));
+    std::memcpy(header.magic,magic,sizeof(header.magic));
+    header.version = version;
+    if(write(fd,&header,sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+        close(fd);
+        return false;
+    }
+
+    if(fd_ >= 0) {
+        fdatasync(fd_);
+        close(fd_);
+    }
+    fd_ = fd;
+    segment_ = number;
+    segment_bytes_ = sizeof(header);
+    return true;
+}
+
+auto MapJournal::Push(Entry &&entry)->void {
+    {
+        std::unique_lock<std::mutex> lock(mtx_queue_);
+        queue_.push_back(std::move(entry));
+    }
+    cv_queue_.notify_one();
+}
+
+auto MapJournal::ReadArchive(const std::string &path_name, MapTable &table)->bool {
+    MapArchiveReader reader;
+    if(!reader.Open(path_name+"/"+MapArchive::filename)) return false;
+
+    MapArchiveReader::RecordVector records_kf, records_desc, records_lm, records_map;
+    if(!reader.GetRecords(MapArchive::KEYFRAMES,records_kf)) return false;
+    if(!reader.GetRecords(MapArchive::DESCRIPTORS,records_desc)) return false;
+    if(!reader.GetRecords(MapArchive::LANDMARKS,records_lm)) return false;
+    if(!reader.GetRecords(MapArchive::MAPDATA,records_map)) return false;
+    if(records_desc.size() != records_kf.size() || records_map.size() != 1) return false;
+
+    const char *obs_data;
+    size_t obs_size;
+    if(!reader.GetSection(MapArchive::OBSERVATIONS,obs_data,obs_size)) return false;
+    const size_t num_obs = reader.GetCount(MapArchive::OBSERVATIONS);
+    if(num_obs * sizeof(MapArchive::ObservationRecord) != obs_size) return false;
+
+    for(size_t i=0;i<records_kf.size();++i) {
+        MsgKeyframe msg(true);
+        MapArchive::Deserialize(records_kf[i],msg);
+        MapArchive::DescriptorRecord desc;
+        MapArchive::Deserialize(records_desc[i],desc);
+        msg.descriptors = desc.descriptors;
+        msg.descriptors_add = desc.descriptors_add;
+        table.keyframes.erase(msg.id);
+        table.keyframes.emplace(msg.id,msg);
+    }
+
+    std::vector<idpair> lm_ids(records_lm.size());
+    for(size_t i=0;i<records_lm.size();++i) {
+        MsgLandmark msg(true);
+        MapArchive::Deserialize(records_lm[i],msg);
+        lm_ids[i] = msg.id;
+        table.landmarks.erase(msg.id);
+        table.landmarks.emplace(msg.id,msg);
+    }
+    for(size_t idx_obs=0;idx_obs<num_obs;++idx_obs) {
+        MapArchive::ObservationRecord obs;
+        std::memcpy(&obs,obs_data+idx_obs*sizeof(obs),sizeof(obs));
+        if(obs.lm_idx >= lm_ids.size()) return false;
+        table.landmarks.at(lm_ids[obs.lm_idx]).observations[std::make_pair((size_t)obs.kf_id,(size_t)obs.client_id)] = obs.feat_id;
+    }
+
+    MsgMap msg_map;
+    MapArchive::Deserialize(records_map[0],msg_map);
+    MsgMap &mm = table.msg_map;
+    mm.keyframes1.insert(mm.keyframes1.end(),msg_map.keyframes1.begin(),msg_map.keyframes1.end());
+    mm.keyframes2.insert(mm.keyframes2.end(),msg_map.keyframes2.begin(),msg_map.keyframes2.end());
+    mm.transforms12.insert(mm.transforms12.end(),msg_map.transforms12.begin(),msg_map.transforms12.end());
+    mm.cov.insert(mm.cov.end(),msg_map.cov.begin(),msg_map.cov.end());
+    return true;
+}
+
+auto MapJournal::ReadDirectory(const std::string &path_name, MapTable &table)->bool {
+    // same files as Map::LoadFromDirectory()
+    auto read_file = [](const std::string &filename, std::stringstream &buf)->bool {
+        std::ifstream fs(filename,std::ios::binary);
+        if(!fs.is_open()) return false;
+        buf << fs.rdbuf();
+        return true;
+    };
+    auto list_dir = [](const std::string &dirname, std::vector<std::string> &filenames)->bool {
+        DIR *dir = opendir(dirname.c_str());
+        if(!dir) return false;
+        struct dirent *entry;
+        while((entry = readdir(dir)) != nullptr) {
+            if(!strcmp(entry->d_name,".") || !strcmp(entry->d_name,"..")) continue;
+            filenames.push_back(dirname + entry->d_name);
+        }
+        closedir(dir);
+        return true;
+    };
+
+    std::vector<std::string> filenames_kf, filenames_mp;
+    if(!list_dir(path_name+"/keyframes/",filenames_kf)) return false;
+    if(!list_dir(path_name+"/mappoints/",filenames_mp)) return false;
+
+    for(const auto& filename : filenames_kf) {
+        std::stringstream buf;
+        if(!read_file(filename,buf)) return false;
+        cereal::BinaryInputArchive iarchive(buf);
+        MsgKeyframe msg(true);
+        iarchive(msg);
+        table.keyframes.erase(msg.id);
+        table.keyframes.emplace(msg.id,msg);
+    }
+    for(const auto& filename : filenames_mp) {
+        std::stringstream buf;
+        if(!read_file(filename,buf)) return false;
+        cereal::BinaryInputArchive iarchive(buf);
+        MsgLandmark msg(true);
+        iarchive(msg);
+        table.landmarks.erase(msg.id);
+        table.landmarks.emplace(msg.id,msg);
+    }
+    std::stringstream buf;
+    if(!read_file(path_name+"/mapdata.txt",buf)) return false;
+    cereal::BinaryInputArchive iarchive(buf);
+    MsgMap msg_map;
+    iarchive(msg_map);
+    MsgMap &mm = table.msg_map;
+    mm.keyframes1.insert(mm.keyframes1.end(),msg_map.keyframes1.begin(),msg_map.keyframes1.end());
+    mm.keyframes2.insert(mm.keyframes2.end(),msg_map.keyframes2.begin(),msg_map.keyframes2.end());
+    mm.transforms12.insert(mm.transforms12.end(),msg_map.transforms12.begin(),msg_map.transforms12.end());
+    mm.cov.insert(mm.cov.end(),msg_map.cov.begin(),msg_map.cov.end());
+    return true;
+}
+
+auto MapJournal::Recover(std::map<uint32_t,std::string> &map_paths)->bool {
+    std::vector<uint32_t> segments;
+    for(auto number : this->GetSegments()) {
+        if(number < segment_) segments.push_back(number);
+    }
+    if(!segments.empty()) {
+        std::cout << "--> Journal: replay " << segments.size() << " segment(s)" << std::endl;
+        if(!this->FoldSegments(segments)) return false;
+    }
+
+    map_paths.clear();
+    DIR *dir = opendir(path_name_.c_str());
+    if(!dir) return true;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != nullptr) {
+        unsigned int map_id;
+        char tail;
+        if(sscanf(entry->d_name,"map_%u%c",&map_id,&tail) == 1 && MapArchive::Exists(this->GetBasePath(map_id))) {
+            map_paths[map_id] = this->GetBasePath(map_id);
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+auto MapJournal::ReplaySegment(const std::string &filename, MapTables &tables)->size_t {
+    std::ifstream fs(filename,std::ios::binary);
+    if(!fs.is_open()) {
+        std::cout << COUTERROR << "cannot open journal segment " << filename << std::endl;
+        return 0;
+    }
+    std::string data((std::istreambuf_iterator<char>(fs)),std::istreambuf_iterator<char>());
+
+    SegmentHeader header;
+    if(data.size() < sizeof(header)) return 0;
+    std::memcpy(&header,data.data(),sizeof(header));
+    if(std::memcmp(header.magic,magic,sizeof(header.magic)) != 0 || header.version != version) {
+        std::cout << COUTERROR << filename << " is not a journal segment of version " << version << std::endl;
+        return 0;
+    }
+
+    size_t num_records = 0;
+    size_t offset = sizeof(header);
+    while(offset + sizeof(RecordHeader) <= data.size()) {
+        RecordHeader rec;
+        std::memcpy(&rec,data.data()+offset,sizeof(rec));
+        offset += sizeof(rec);
+        const char *payload = data.data()+offset;
+        if(rec.size > data.size() - offset
+                || crc32(0L,reinterpret_cast<const Bytef*>(payload),rec.size) != rec.crc) {
+            std::cout << COUTWARN << filename << ": incomplete record at offset " << offset - sizeof(rec) << " -- ignore rest of segment" << std::endl;
+            break;
+        }
+        ApplyRecord(static_cast<eRecord>(rec.type),rec.map_id,payload,rec.size,tables);
+        offset += rec.size;
+        ++num_records;
+    }
+
+    return num_records;
+}
+
+auto MapJournal::Run()->void {
+    const size_t compaction_bytes = static_cast<size_t>(std::max(covins_params::sys::map_journal_compaction_mb,0)) * 1024 * 1024;
+
+    while(1) {
+        EntryList entries;
+        {
+            std::unique_lock<std::mutex> lock(mtx_queue_);
+            cv_queue_.wait_for(lock,std::chrono::milliseconds(100),[this](){return !queue_.empty();});
+            entries.swap(queue_);
+        }
+
+        if(!entries.empty() && !this->WriteBatch(entries)) {
+            std::cout << COUTERROR << "Journal: writing " << entries.size() << " records failed" << std::endl;
+        }
+
+        if(compaction_bytes > 0 && segment_bytes_ >= compaction_bytes && !compaction_running_) {
+            this->Compact();
+        }
+    }
+}
+
+template<typename T> auto MapJournal::Serialize(const T &data)->std::string {
+    std::stringstream ss;
+    {
+        cereal::BinaryOutputArchive oarchive(ss);
+        oarchive(data);
+    }
+    return ss.str();
+}
+
+auto MapJournal::SetInstance(JournalPtr journal)->void {
+    std::unique_lock<std::mutex> lock(mtx_instance_);
+    instance_ = journal;
+}
+
+auto MapJournal::UpdateKeyframePose(size_t map_id, KeyframePtr kf)->void {
+    KeyframePoseRecord rec;
+    rec.id = kf->id_;
+    rec.T_w_s = kf->GetPoseTws();
+    rec.T_w_s_vio = kf->GetPoseTws_vio();
+    rec.velocity = kf->GetStateVelocity();
+    kf->GetStateBias(rec.bias_accel,rec.bias_gyro);
+    Entry entry;
+    entry.type = KF_POSE;
+    entry.map_id = map_id;
+    entry.payload = Serialize(rec);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::UpdateLandmarkPos(size_t map_id, LandmarkPtr lm)->void {
+    LandmarkPosRecord rec;
+    rec.id = lm->id_;
+    rec.pos_w = lm->GetWorldPos();
+    Entry entry;
+    entry.type = LM_POS;
+    entry.map_id = map_id;
+    entry.payload = Serialize(rec);
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::UpdateMapState(MapPtr map)->void {
+    Entry entry;
+    entry.type = STATE;
+    entry.map_id = map->id_map_;
+    entry.snapshot.reset(new MapSnapshot);
+    map->CreateSnapshot(*entry.snapshot);
+    entry.snapshot->keyframes.clear();                                              // features are already journaled
+    this->Push(std::move(entry));
+}
+
+auto MapJournal::WriteArchive(uint32_t map_id, MapTable &table, const std::string &path_name)->bool {
+    // complete the associations in both directions - the loader links KF->LM and LM->KF separately
+    for(auto& mit : table.keyframes) {
+        MsgKeyframe &kf = mit.second;
+        for(auto lit = kf.landmarks.begin(); lit != kf.landmarks.end();) {
+            auto lm = table.landmarks.find(lit->second);
+            if(lm == table.landmarks.end()) {
+                lit = kf.landmarks.erase(lit);
+                continue;
+            }
+            lm->second.observations.emplace(kf.id,lit->first);
+            ++lit;
+        }
+    }
+    for(auto& mit : table.landmarks) {
+        MsgLandmark &lm = mit.second;
+        for(auto oit = lm.observations.begin(); oit != lm.observations.end();) {
+            auto kf = table.keyframes.find(oit->first);
+            if(kf == table.keyframes.end()) {
+                oit = lm.observations.erase(oit);
+                continue;
+            }
+            kf->second.landmarks.emplace(oit->second,lm.id);
+            ++oit;
+        }
+        if(!lm.observations.empty() && !table.keyframes.count(lm.id_reference)) {
+            lm.id_reference = lm.observations.begin()->first;                           // reference KF was erased
+        }
+    }
+
+    MapSnapshot snapshot;
+    snapshot.kf_states.reserve(table.keyframes.size());
+    for(auto& mit : table.keyframes) snapshot.kf_states.push_back(std::move(mit.second));
+    table.keyframes.clear();
+    snapshot.lm_states.reserve(table.landmarks.size());
+    for(auto& mit : table.landmarks) {
+        if(mit.second.observations.size() < 2) continue;
+        snapshot.AddLandmark(mit.second);
+    }
+    table.landmarks.clear();
+    snapshot.msg_map = table.msg_map;
+    snapshot.msg_map.id_map = map_id;
+
+    return Map::WriteSnapshot(snapshot,path_name,nullptr,true);
+}
+
+auto MapJournal::WriteBatch(EntryList &entries)->bool {
+    std::string buf;
+    for(auto& entry : entries) {
+        if(entry.type == KF_INSERT) {
+            entry.kf->ConvertToMsgFileExportFeatures(*entry.kf_state);
+            entry.payload = Serialize(*entry.kf_state);
+        } else if(entry.type == STATE) {
+            std::stringstream ss;
+            {
+                cereal::BinaryOutputArchive oarchive(ss);
+                oarchive(static_cast<uint64_t>(entry.snapshot->kf_states.size()));
+                for(const auto& msg : entry.snapshot->kf_states) oarchive(msg);
+                oarchive(static_cast<uint64_t>(entry.snapshot->lm_states.size()));
+                MsgLandmark msg(true);
+                for(size_t i=0;i<entry.snapshot->lm_states.size();++i) {
+                    entry.snapshot->GetLandmark(i,msg);
+                    oarchive(msg);
+                }
+                oarchive(entry.snapshot->msg_map);
+            }
+            entry.payload = ss.str();
+        }
+
+        RecordHeader header;
+        std::memset(&header,0,sizeof(header));
+        header.type = entry.type;
+        header.map_id = entry.map_id;
+        header.size = entry.payload.size();
+        header.crc = crc32(0L,reinterpret_cast<const Bytef*>(entry.payload.data()),entry.payload.size());
+        buf.append(reinterpret_cast<const char*>(&header),sizeof(header));
+        buf.append(entry.payload);
+    }
+
+    // group commit: one write (and sync) per batch
+    size_t written = 0;
+    while(written < buf.size()) {
+        ssize_t ret = write(fd_,buf.data()+written,buf.size()-written);
+        if(ret < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        written += ret;
+    }
+    if(covins_params::sys::map_journal_sync) fdatasync(fd_);
+
+    segment_bytes_ += buf.size();
+    num_records_ += entries.size();
+    ++num_batches_;
+    return true;
+}
+
+} //end ns
@@ -0,0 +1,146 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/map_saver.hpp"
+
+// C++
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+// COVINS
+#include "covins_backend/map_be.hpp"
+
+namespace covins {
+
+MapSaver::MapSaver(ManagerPtr manager, VocabularyPtr voc)
+    : mapmanager_(manager), voc_(voc),
+      busy_(false), num_done_(0), num_total_(0),
+      last_checkpoint_(std::chrono::steady_clock::now())
+{
+    //...
+}
+
+auto MapSaver::Checkpoint()->void {
+    if(covins_params::sys::map_checkpoint_interval <= 0.0) return;
+
+    std::chrono::duration<double> t_since = std::chrono::steady_clock::now() - last_checkpoint_;
+    if(t_since.count() < covins_params::sys::map_checkpoint_interval) return;
+    if(this->IsBusy()) return;
+    last_checkpoint_ = std::chrono::steady_clock::now();
+
+    // one map per interval - maps are checkpointed round-robin
+    auto map_ids = mapmanager_->GetMapIds();
+    if(map_ids.empty()) return;
+    const int map_id = map_ids[next_checkpoint_map_++ % map_ids.size()];
+
+    std::stringstream path_name;
+    path_name << covins_params::sys::output_dir << "map_checkpoint_" << map_id << "/";
+    this->SaveAsync(map_id,path_name.str(),true,false);
+}
+
+auto MapSaver::GetProgress()->double {
+    const size_t num_total = num_total_;
+    if(num_total == 0) return 0.0;
+    return static_cast<double>(num_done_) / static_cast<double>(num_total);
+}
+
+auto MapSaver::IsBusy()->bool {
+    return busy_;
+}
+
+auto MapSaver::Run()->void {
+    while(1) {
+        this->WriteJob();
+        this->Checkpoint();
+        usleep(5000);
+    }
+}
+
+auto MapSaver::SaveAsync(int map_id, const std::string &path_name, bool overwrite, bool clean)->bool {
+    bool expected = false;
+    if(!busy_.compare_exchange_strong(expected,true)) {
+        std::cout << COUTWARN << "Map " << map_id << ": save requested while another save is in progress (" << static_cast<int>(100.0*this->GetProgress()) << "%) -- skip" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<SaveJob> job(new SaveJob);
+    job->map_id = map_id;
+    job->path_name = path_name;
+    job->overwrite = overwrite;
+    job->snapshot.reset(new MapSnapshot);
+
+    auto t_start = std::chrono::steady_clock::now();
+    int check_num_map;
+    TypeDefs::MapPtr map = mapmanager_->CheckoutMapExclusiveOrWait(map_id,check_num_map);
+    if(!map) {
+        std::cout << COUTERROR << "No map found with ID " << map_id << std::endl;
+        busy_ = false;
+        return false;
+    }
+    if(clean) map->Clean();
+    map->CreateSnapshot(*job->snapshot);
+    mapmanager_->ReturnMap(map_id,check_num_map);
+    std::chrono::duration<double> t_snapshot = std::chrono::steady_clock::now() - t_start;
+
+    std::cout << "Map " << map_id << ": snapshot with " << job->snapshot->keyframes.size() << " KFs | " << job->snapshot->lm_states.size() << " LMs taken in " << t_snapshot.count() << "s -- writing to " << path_name << std::endl;
+
+    num_done_ = 0;
+    num_total_ = 0;
+    std::unique_lock<std::mutex> lock(mtx_job_);
+    job_ = job;
+    return true;
+}
+
+auto MapSaver::WriteJob()->void {
+    std::shared_ptr<SaveJob> job;
+    {
+        std::unique_lock<std::mutex> lock(mtx_job_);
+        if(!job_) return;
+        job = job_;
+        job_.reset();
+    }
+
+    auto t_start = std::chrono::steady_clock::now();
+    int last_report = 0;
+    auto progress = [&](size_t done, size_t total) {
+        num_done_ = done;
+        num_total_ = total;
+        const int percent = static_cast<int>(100 * done / std::max<size_t>(total,1));
+        if(percent >= last_report + 10) {
+            last_report = percent - percent % 10;
+            std::cout << "Map " << job->map_id << ": saving... " << last_report << "%" << std::endl;
+        }
+    };
+
+    const bool success = Map::WriteSnapshot(*job->snapshot,job->path_name,voc_,job->overwrite,progress);
+    std::chrono::duration<double> t_write = std::chrono::steady_clock::now() - t_start;
+    if(success) std::cout << "Map " << job->map_id << ": saved to " << job->path_name << " in " << t_write.count() << "s" << std::endl;
+    else std::cout << COUTERROR << "Map " << job->map_id << ": saving to " << job->path_name << " failed" << std::endl;
+
+    job.reset();                                                                    // release the snapshot before accepting the next one
+    busy_ = false;
+}
+
+} //end ns
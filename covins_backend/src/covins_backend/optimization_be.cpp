@@ -33,6 +33,7 @@
 #include "covins_backend/keyframe_be.hpp"
 #include "covins_backend/landmark_be.hpp"
 #include "covins_backend/map_be.hpp"
+#include "covins_backend/map_journal.hpp"
 
 // Thirdparty
 #include <ceres/ceres.h>
@@ -614,6 +615,8 @@ auto Optimization::GlobalBundleAdjustment(MapPtr map, int interations_limit, dou
     map->Clean();
     std::cout << "--> done." << std::endl;
 
+    if(auto journal = MapJournal::GetInstance()) journal->UpdateMapState(map);
+
     std::cout << "+++ GBA: End +++" << std::endl;
 }
 
@@ -1082,6 +1085,8 @@ auto Optimization::PoseGraphOptimization(
         lm->SetOptimized();
     }
 
+    if(auto journal = MapJournal::GetInstance()) journal->UpdateMapState(map);
+
     std::cout << "--> PGO END " << std::endl;
 }
 
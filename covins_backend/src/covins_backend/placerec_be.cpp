@@ -65,6 +65,7 @@ auto PlaceRecognition::ComputeSE3()->bool {
     // We compute first ORB matches for each candidate
     // If enough matches are found, we setup a Sim3Solver
     FeatureMatcher matcher(0.75,true);
+    KeyframePayloadGuard guard_query(kf_query_);
 
     vecVecMP vvpMapPointMatches;
     vvpMapPointMatches.resize(nInitialCandidates);
@@ -81,6 +82,8 @@ auto PlaceRecognition::ComputeSE3()->bool {
           continue;
         }
 
+        KeyframePayloadGuard guard(pKF);
+
         // Setup the threaded BF matcher
         std::shared_ptr<LandmarkMatchingAlgorithm> matchingAlgorithm
                 (new LandmarkMatchingAlgorithm(50.0)); // default: 50.0
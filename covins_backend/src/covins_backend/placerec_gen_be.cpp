@@ -68,6 +68,7 @@ auto PlaceRecognitionG::ComputeSE3() -> bool {
     Eigen::Matrix4d Tc1c2; // Relative TF between the frames
     Eigen::Matrix<double, 6, 6> cov_loop; // Covariance Matrix for the Loop
     bool foundRelTransform;
+    KeyframePayloadGuard guard_query(kf_query_);
 
     for (size_t i = 0; i < nInitialCandidates; i++) {
         KeyframePtr pKF = mvpEnoughConsistentCandidates[i];
@@ -79,6 +80,8 @@ auto PlaceRecognitionG::ComputeSE3() -> bool {
           continue;
         }
 
+        KeyframePayloadGuard guard(pKF);
+
         std::shared_ptr<cv::DescriptorMatcher> matcher;
 
         if (covins_params::features::type == "ORB") {
@@ -0,0 +1,186 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "covins_backend/trajectory_writer.hpp"
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <eigen3/Eigen/Geometry>
+
+// COVINS
+#include <covins/covins_base/config_backend.hpp>
+
+namespace covins {
+
+TrajectoryWriter::WriterPtr TrajectoryWriter::instance_ = nullptr;
+std::mutex TrajectoryWriter::mtx_instance_;
+
+TrajectoryWriter::TrajectoryWriter() {
+    //...
+}
+
+auto TrajectoryWriter::GetFormat()->eFormat {
+    if(covins_params::sys::trajectory_format == "EUROC") {
+        return EUROC;
+    } else if(covins_params::sys::trajectory_format == "TUM") {
+        return TUM;
+    } else {
+        std::cout << COUTFATAL << "trajectory_format '" << covins_params::sys::trajectory_format << "' not in { EUROC | TUM }" << std::endl;
+        exit(-1);
+    }
+}
+
+auto TrajectoryWriter::GetInstance()->WriterPtr {
+    std::unique_lock<std::mutex> lock(mtx_instance_);
+    return instance_;
+}
+
+auto TrajectoryWriter::Push(Job &&job)->void {
+    {
+        std::unique_lock<std::mutex> lock(mtx_queue_);
+        queue_.push_back(std::move(job));
+    }
+    cv_queue_.notify_one();
+}
+
+auto TrajectoryWriter::Run()->void {
+    while(1) {
+        std::list<Job> jobs;
+        {
+            std::unique_lock<std::mutex> lock(mtx_queue_);
+            cv_queue_.wait_for(lock,std::chrono::milliseconds(100),[this](){return !queue_.empty();});
+            jobs.swap(queue_);
+        }
+
+        // a full rewrite supersedes all earlier jobs for the same file
+        std::set<std::string> rewritten;
+        for(std::list<Job>::reverse_iterator rit = jobs.rbegin();rit!=jobs.rend();) {
+            if(rewritten.count(rit->filename)) {
+                rit = std::list<Job>::reverse_iterator(jobs.erase(std::next(rit).base()));
+                continue;
+            }
+            if(!rit->incremental) rewritten.insert(rit->filename);
+            ++rit;
+        }
+
+        for(const auto &job : jobs) {
+            this->Write(job,last_stamps_[job.filename]);
+        }
+    }
+}
+
+auto TrajectoryWriter::SetInstance(WriterPtr writer)->void {
+    std::unique_lock<std::mutex> lock(mtx_instance_);
+    instance_ = writer;
+}
+
+auto TrajectoryWriter::Submit(Job &&job)->void {
+    if(job.states.empty()) //do not overwrite files from other maps with empty files
+        return;
+
+    WriterPtr writer = GetInstance();
+    if(writer) {
+        writer->Push(std::move(job));
+    } else {
+        StampMap last_stamps;
+        Write(job,last_stamps);
+    }
+}
+
+auto TrajectoryWriter::Write(const Job &job, StampMap &last_stamps)->bool {
+    // Format into one buffer - the file is written with a single call
+    std::stringstream buffer;
+    buffer << std::setprecision(25);
+    StampMap newest;
+    size_t num_states = 0;
+
+    for(const auto &state : job.states) {
+        if(job.incremental) {
+            StampMap::const_iterator mit = last_stamps.find(state.client_id);
+            if(mit != last_stamps.end() && state.stamp <= mit->second) continue;
+        }
+
+        const Eigen::Quaterniond q(state.T_w_s.block<3,3>(0,0));
+        if(job.format == EUROC) {
+            buffer << state.stamp * 1e9f << ",";
+            buffer << state.T_w_s(0,3) << "," << state.T_w_s(1,3) << "," << state.T_w_s(2,3) << ",";
+            buffer << q.w() << "," << q.x() << "," << q.y() << "," << q.z() << ",";
+            buffer << state.velocity[0] << "," << state.velocity[1] << "," << state.velocity[2] << ",";
+            buffer << state.bias_gyro[0] << "," << state.bias_gyro[1] << "," << state.bias_gyro[2] << ",";
+            buffer << state.bias_accel[0] << "," << state.bias_accel[1] << "," << state.bias_accel[2] << "\n";
+        } else {
+            buffer << state.stamp << " ";
+            buffer << state.T_w_s(0,3) << " " << state.T_w_s(1,3) << " " << state.T_w_s(2,3) << " ";
+            buffer << q.x() << " " << q.y() << " " << q.z() << " " << q.w() << "\n";
+        }
+
+        StampMap::iterator mit = newest.find(state.client_id);
+        if(mit == newest.end()) newest[state.client_id] = state.stamp;
+        else mit->second = std::max(mit->second,state.stamp);
+        ++num_states;
+    }
+
+    if(job.incremental && !num_states) return true;
+
+    const std::string data = buffer.str();
+    if(job.incremental) {
+        std::ofstream file(job.filename,std::ios::out | std::ios::app);
+        if(!file.is_open()) {
+            std::cout << COUTERROR << ": Unable to open file: " << job.filename << std::endl;
+            return false;
+        }
+        file.write(data.data(),data.size());
+        file.close();
+        for(const auto &mit : newest) {
+            StampMap::iterator it = last_stamps.find(mit.first);
+            if(it == last_stamps.end()) last_stamps[mit.first] = mit.second;
+            else it->second = std::max(it->second,mit.second);
+        }
+    } else {
+        // write to a temporary file and replace the old one, so readers never see a partially written trajectory
+        const std::string tmp_name = job.filename + ".tmp";
+        std::ofstream file(tmp_name,std::ios::out | std::ios::trunc);
+        if(!file.is_open()) {
+            std::cout << COUTERROR << ": Unable to open file: " << tmp_name << std::endl;
+            return false;
+        }
+        file.write(data.data(),data.size());
+        file.close();
+        if(std::rename(tmp_name.c_str(),job.filename.c_str())) {
+            std::cout << COUTERROR << ": Unable to replace file: " << job.filename << std::endl;
+            return false;
+        }
+        last_stamps = newest;
+    }
+
+    return true;
+}
+
+} //end ns
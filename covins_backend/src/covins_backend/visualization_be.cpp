@@ -24,11 +24,13 @@
 #include "covins_backend/visualization_be.hpp"
 
 // C++
+#include <limits>
 #include <set>
 #include <eigen3/Eigen/Core>
 
 // COVINS
 #include "covins_backend/landmark_be.hpp"
+#include "covins_backend/landmark_lod.hpp"
 #include "covins_backend/map_be.hpp"
 
 // Thirdparty
@@ -43,21 +45,15 @@ Visualizer::Visualizer(std::string topic_prefix)
     //...
 }
 
+auto Visualizer::CheckVisData()->bool {
+    std::unique_lock<std::mutex> lock(mtx_draw_);
+    return !draw_requests_.empty();
+}
+
 auto Visualizer::DrawMap(MapPtr map)->void {
     if(!map) return;
     std::unique_lock<std::mutex> lock(mtx_draw_);
-    VisBundle vb;
-    vb.keyframes = map->GetKeyframes();
-    vb.keyframes_erased = map->GetKeyframesErased();
-    vb.landmarks = map->GetLandmarks();
-    vb.id_map = map->id_map_;
-    vb.associated_clients = map->associated_clients_;
-    vb.loops = map->GetLoopConstraints();
-    vb.frame = "odom";
-
-    if(vb.keyframes.size() < 3) return;
-
-    vis_data_[map->id_map_] = vb;
+    draw_requests_[map->id_map_] = map;
 }
 
 auto Visualizer::PubCovGraph()->void {
@@ -323,11 +319,94 @@ auto Visualizer::PubKeyframesAsFrusta()->void {
     }
 }
 
+auto Visualizer::PubLandmarkLod()->void {
+    if(!curr_lod_ || !lod_cycle_) return;
+
+    curr_lod_->Refresh(static_cast<size_t>(std::max(covins_params::vis::lod_refresh_num,0)));
+
+    // bytes per msg: header + ns, bytes per point: position + color
+    const double bytes_msg = 256.0;
+    const double bytes_point = sizeof(geometry_msgs::Point) + sizeof(std_msgs::ColorRGBA);
+    const bool unlimited = covins_params::vis::lod_kbytes_per_sec <= 0;
+    const double bytes_max = 1024.0 * covins_params::vis::lod_kbytes_per_sec;
+
+    const precision_t scale = covins_params::vis::scalefactor;
+    std::stringstream ss;
+    ss << "LandmarkLod" << curr_bundle_.id_map << topic_prefix_;
+
+    LandmarkLod::Chunk chunk;
+    while(curr_lod_->HasChanges()) {
+        size_t max_points = std::numeric_limits<size_t>::max();
+        // a full bucket always admits one chunk, so chunks larger than the budget cannot starve
+        if(!unlimited && lod_bytes_available_ < bytes_max) {
+            if(lod_bytes_available_ < bytes_msg) break;
+            max_points = static_cast<size_t>((lod_bytes_available_ - bytes_msg) / bytes_point);
+        }
+        if(!curr_lod_->PopChangedChunk(chunk,max_points)) break;
+
+        visualization_msgs::Marker msg;
+        msg.header.frame_id = curr_bundle_.frame;
+        msg.header.stamp = ros::Time::now();
+        msg.ns = ss.str();
+        msg.id = chunk.id;
+        msg.type = visualization_msgs::Marker::POINTS;
+        msg.pose.orientation.w = 1.0;
+        msg.scale.x = scale*covins_params::vis::lod_voxel_size*0.5;
+        msg.scale.y = scale*covins_params::vis::lod_voxel_size*0.5;
+
+        if(chunk.erased) {
+            msg.action = visualization_msgs::Marker::DELETE;
+        } else {
+            msg.action = visualization_msgs::Marker::ADD;
+            msg.points.reserve(chunk.points.size());
+            msg.colors.reserve(chunk.points.size());
+            for(size_t idx=0;idx<chunk.points.size();++idx) {
+                geometry_msgs::Point p;
+                p.x = scale*chunk.points[idx](0);
+                p.y = scale*chunk.points[idx](1);
+                p.z = scale*chunk.points[idx](2);
+                msg.points.push_back(p);
+                const size_t cid = chunk.client_ids[idx];
+                if(cid < 12) {
+                    covins_params::VisColorRGB col = covins_params::colors::col_vec[cid];
+                    msg.colors.push_back(MakeColorMsg(col.mfR,col.mfG,col.mfB));
+                } else
+                    msg.colors.push_back(MakeColorMsg(0.5,0.5,0.5));
+            }
+        }
+
+        pub_marker_.publish(msg);
+        lod_bytes_available_ -= bytes_msg + bytes_point * chunk.points.size();
+    }
+}
+
+auto Visualizer::PubLandmarkLodDelete(MapCache &cache)->void {
+    if(!cache.lod) return;
+
+    std::stringstream ss;
+    ss << "LandmarkLod" << cache.bundle.id_map << topic_prefix_;
+
+    // not limited by the byte budget - the chunks would otherwise stay forever
+    cache.lod->Clear();
+    LandmarkLod::Chunk chunk;
+    while(cache.lod->PopChangedChunk(chunk,std::numeric_limits<size_t>::max())) {
+        if(!chunk.erased) continue;
+        visualization_msgs::Marker msg;
+        msg.header.frame_id = cache.bundle.frame;
+        msg.header.stamp = ros::Time::now();
+        msg.ns = ss.str();
+        msg.id = chunk.id;
+        msg.action = visualization_msgs::Marker::DELETE;
+        pub_marker_.publish(msg);
+    }
+}
+
 auto Visualizer::PubLandmarksAsCloud()->void {
     pcl::PointCloud<pcl::PointXYZRGB> cloud;
 
     for(LandmarkMap::const_iterator mit=curr_bundle_.landmarks.begin();mit!=curr_bundle_.landmarks.end();++mit) {
         LandmarkPtr lm_i = mit->second;
+        if(!lm_i) continue;
 
         pcl::PointXYZRGB p;
         Eigen::Vector3d PosWorld = lm_i->GetWorldPos();
@@ -469,12 +548,47 @@ auto Visualizer::PubLoopEdges()->void {
     pub_marker_.publish(msg_inter);
 }
 
+auto Visualizer::ResetIfRequested()->void {
+    std::unique_lock<std::mutex> lock(mtx_reset_);
+
+    if(reset_) {
+        std::unique_lock<std::mutex> lock(mtx_draw_);
+        draw_requests_.clear();
+        map_cache_.clear();
+        reset_=false;
+    }
+}
+
 auto Visualizer::Run()->void {
+    const int wait_us = covins_params::vis::publish_rate > 0.0 ? static_cast<int>(1e6 / covins_params::vis::publish_rate) : 5000;
+
     while(1) {
         if(this->CheckVisData()) {
-            std::unique_lock<std::mutex> lock(mtx_draw_);
-            for(std::map<size_t,VisBundle>::iterator mit = vis_data_.begin();mit!=vis_data_.end();++mit){
-                curr_bundle_ = mit->second;
+            std::map<size_t,MapPtr> requests;
+            {
+                std::unique_lock<std::mutex> lock(mtx_draw_);
+                requests.swap(draw_requests_);
+            }
+
+            // LOD landmarks are published at most at vis.lod_rate - the byte budget is refilled accordingly and shared by all maps
+            if(covins_params::vis::landmark_lod) {
+                const TimePoint now = std::chrono::steady_clock::now();
+                const double dt = std::chrono::duration<double>(now - last_lod_cycle_).count();
+                lod_cycle_ = covins_params::vis::lod_rate <= 0.0 || dt >= 1.0 / covins_params::vis::lod_rate;
+                if(lod_cycle_) {
+                    const double bytes_max = 1024.0 * covins_params::vis::lod_kbytes_per_sec;
+                    lod_bytes_available_ = std::min(lod_bytes_available_ + dt * bytes_max,bytes_max);
+                    last_lod_cycle_ = now;
+                }
+            }
+            for(std::map<size_t,MapPtr>::iterator mit = requests.begin();mit!=requests.end();++mit){
+                MapCache &cache = map_cache_[mit->first];
+                this->UpdateCache(mit->second,cache);
+
+                if(cache.bundle.keyframes.size() < 3) continue;
+
+                std::swap(curr_bundle_,cache.bundle);
+                curr_lod_ = cache.lod;
 
                 if(covins_params::vis::showkeyframes)
                     this->PubKeyframesAsFrusta();
@@ -482,19 +596,71 @@ auto Visualizer::Run()->void {
                 if(covins_params::vis::showtraj)
                     this->PubTrajectories();
 
-                if(covins_params::vis::showlandmarks)
+                if(covins_params::vis::showlandmarks && covins_params::vis::landmark_lod)
+                    this->PubLandmarkLod();
+                else if(covins_params::vis::showlandmarks)
                     this->PubLandmarksAsCloud();
 
                 if(covins_params::vis::showcovgraph)
                     this->PubCovGraph();
 
                 this->PubLoopEdges();
+                std::swap(curr_bundle_,cache.bundle);
+                curr_lod_ = nullptr;
+            }
+
+            // drop maps that no longer exist, e.g. after a merge
+            for(std::map<size_t,MapCache>::iterator mit = map_cache_.begin();mit!=map_cache_.end();) {
+                if(mit->second.map.expired()) {
+                    this->PubLandmarkLodDelete(mit->second);
+                    mit = map_cache_.erase(mit);
+                } else ++mit;
             }
-            vis_data_.clear();
         }
         this->ResetIfRequested();
-        usleep(5000);
+        usleep(wait_us);
+    }
+}
+
+auto Visualizer::UpdateCache(MapPtr map, MapCache &cache)->void {
+    // a map that replaced the cached one (e.g. merged map with the same ID) is pulled completely
+    const bool full = cache.map.lock() != map;
+    MapVisChanges changes;
+    map->PullVisChanges(changes,full);
+    cache.map = map;
+
+    if(covins_params::vis::landmark_lod && !cache.lod)
+        cache.lod.reset(new LandmarkLod(covins_params::vis::lod_voxel_size));
+
+    VisBundle &vb = cache.bundle;
+    if(changes.full) {
+        vb.keyframes.swap(changes.keyframes_added);
+        vb.keyframes_erased.swap(changes.keyframes_erased);
+        vb.landmarks.swap(changes.landmarks_added);
+        if(cache.lod) {
+            cache.lod->Clear();
+            for(LandmarkMap::iterator mit = vb.landmarks.begin();mit!=vb.landmarks.end();++mit) cache.lod->Insert(mit->second);
+        }
+    } else {
+        for(KeyframeMap::iterator mit = changes.keyframes_erased.begin();mit!=changes.keyframes_erased.end();++mit) {
+            vb.keyframes.erase(mit->first);
+            vb.keyframes_erased[mit->first] = mit->second;
+        }
+        vb.keyframes.insert(changes.keyframes_added.begin(),changes.keyframes_added.end());
+        for(std::set<idpair>::iterator sit = changes.landmarks_erased.begin();sit!=changes.landmarks_erased.end();++sit) {
+            vb.landmarks.erase(*sit);
+            if(cache.lod) cache.lod->Remove(*sit);
+        }
+        vb.landmarks.insert(changes.landmarks_added.begin(),changes.landmarks_added.end());
+        if(cache.lod) {
+            for(LandmarkMap::iterator mit = changes.landmarks_added.begin();mit!=changes.landmarks_added.end();++mit) cache.lod->Insert(mit->second);
+        }
     }
+    if(changes.loops_changed) vb.loops.swap(changes.loops);
+
+    vb.id_map = map->id_map_;
+    vb.associated_clients = map->associated_clients_;
+    vb.frame = "odom";
 }
 
 } //end ns
@@ -47,6 +47,15 @@ auto ShowParamsBackend()->void
     std::cout << "--------------------------" << std::endl;
     std::cout << "output_dir: " << covins_params::sys::output_dir << std::endl;
     std::cout << "trajectory_format: " << covins_params::sys::trajectory_format << std::endl;
+    std::cout << "trajectory_incremental: " << (int)covins_params::sys::trajectory_incremental << std::endl;
+    std::cout << "map_archive_compression: " << (int)covins_params::sys::map_archive_compression << std::endl;
+    std::cout << "threads_map_load: " << covins_params::sys::threads_map_load << std::endl;
+    std::cout << "map_checkpoint_interval: " << covins_params::sys::map_checkpoint_interval << std::endl;
+    std::cout << "map_journal: " << (int)covins_params::sys::map_journal << std::endl;
+    std::cout << "map_journal_sync: " << (int)covins_params::sys::map_journal_sync << std::endl;
+    std::cout << "map_journal_compaction_mb: " << covins_params::sys::map_journal_compaction_mb << std::endl;
+    std::cout << "map_paging: " << (int)covins_params::sys::map_paging << std::endl;
+    std::cout << "map_paging_budget_mb: " << covins_params::sys::map_paging_budget_mb << std::endl;
     std::cout << std::endl;
     std::cout << "++++++++++ Feature Extraction ++++++++++" << std::endl;
     std::cout << "feature type: " << covins_params::features::type << std::endl;
@@ -125,6 +134,12 @@ auto ShowParamsBackend()->void
     std::cout << "showkeyframes: " << (int)covins_params::vis::showkeyframes << std::endl;
     std::cout << "covgraph_minweight: " << covins_params::vis::covgraph_minweight << std::endl;
     std::cout << "covgraph_shared_edges_only: " << (int)covins_params::vis::covgraph_shared_edges_only << std::endl;
+    std::cout << "publish_rate: " << covins_params::vis::publish_rate << std::endl;
+    std::cout << "landmark_lod: " << (int)covins_params::vis::landmark_lod << std::endl;
+    std::cout << "lod_voxel_size: " << covins_params::vis::lod_voxel_size << std::endl;
+    std::cout << "lod_rate: " << covins_params::vis::lod_rate << std::endl;
+    std::cout << "lod_kbytes_per_sec: " << covins_params::vis::lod_kbytes_per_sec << std::endl;
+    std::cout << "lod_refresh_num: " << covins_params::vis::lod_refresh_num << std::endl;
     std::cout << "scalefactor: " << covins_params::vis::scalefactor << std::endl;
     std::cout << "trajmarkersize: " << covins_params::vis::trajmarkersize << std::endl;
     std::cout << "covmarkersize: " << covins_params::vis::covmarkersize << std::endl;
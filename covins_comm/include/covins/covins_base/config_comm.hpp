@@ -53,12 +53,16 @@ namespace comm {
     const int kf_buffer_withold                         = estd2::GetValFromYaml<int>(conf_comm,"comm.kf_buffer_withold");
     const int max_sent_kfs_per_iteration                = estd2::GetValFromYaml<int>(conf_comm,"comm.max_sent_kfs_per_iteration");
     const int update_window_size                        = estd2::GetValFromYaml<int>(conf_comm,"comm.update_window_size");
+    const int kf_queue_size_default                     = 64;
+    const int kf_queue_size_yaml                        = estd2::GetValFromYaml<int>(conf_comm,"comm.kf_queue_size");
+    const int kf_queue_size                             = kf_queue_size_yaml > 0 ? kf_queue_size_yaml : kf_queue_size_default;     // capacity of the KF handoff queues on the agent - missing or <= 0: 64
     const precision_t to_agent_freq                     = estd2::GetValFromYaml<precision_t>(conf_comm,"comm.to_agent_freq");
 }
 
 namespace orb {
     const bool activate_visualization                   = estd2::GetValFromYaml<bool>(conf_comm,"orb.activate_visualization");
     const precision_t imu_stamp_max_diff                = estd2::GetValFromYaml<precision_t>(conf_comm,"orb.imu_stamp_max_diff");
+    const bool send_images                              = estd2::GetValFromYaml<bool>(conf_comm,"orb.send_images");              // KFs keep their left image and send it to the server
 }
 
 void ShowParamsComm();
@@ -46,10 +46,12 @@ auto ShowParamsComm()->void
     std::cout << "kf_buffer_withold: " << covins_params::comm::kf_buffer_withold << std::endl;
     std::cout << "max_sent_kfs_per_iteration: " << covins_params::comm::max_sent_kfs_per_iteration << std::endl;
     std::cout << "update_window_size: " << covins_params::comm::update_window_size << std::endl;
+    std::cout << "kf_queue_size: " << covins_params::comm::kf_queue_size << (covins_params::comm::kf_queue_size_yaml > 0 ? "" : " (default)") << std::endl;
     std::cout << "to_agent_freq: " << covins_params::comm::to_agent_freq << std::endl;
     std::cout << "++++++++++ ORB-SLAM3 ++++++++++" << std::endl;
     std::cout << "activate_visualization: " << (int)covins_params::orb::activate_visualization << std::endl;
     std::cout << "imu_stamp_max_diff: " << covins_params::orb::imu_stamp_max_diff << std::endl;
+    std::cout << "send_images: " << (int)covins_params::orb::send_images << std::endl;
     std::cout << std::endl;
 }
 
@@ -0,0 +1,348 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ORBkernels.h"
+
+#include <opencv2/core/core.hpp>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ORB_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace covins {
+
+namespace {
+
+const int HALF_PATCH_SIZE = 15;
+
+// ----------------------------------------------------------------------------
+// Scalar reference
+
+void ICMomentsScalar(const uchar* center, int step, const int* umax, int &m_01, int &m_10)
+{
+    m_01 = 0;
+    m_10 = 0;
+
+    // Treat the center line differently, v=0
+    for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
+        m_10 += u * center[u];
+
+    // Go line by line in the circular patch
+    for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+    {
+        // Proceed over the two lines
+        int v_sum = 0;
+        int d = umax[v];
+        for (int u = -d; u <= d; ++u)
+        {
+            int val_plus = center[u + v*step], val_minus = center[u - v*step];
+            v_sum += (val_plus - val_minus);
+            m_10 += u * (val_plus + val_minus);
+        }
+        m_01 += v * v_sum;
+    }
+}
+
+void DescriptorScalar(const uchar* center, int step, float a, float b, const int* pattern, uchar* desc)
+{
+#define GET_VALUE(idx) \
+        center[cvRound(pattern[2*(idx)]*b + pattern[2*(idx)+1]*a)*step + \
+               cvRound(pattern[2*(idx)]*a - pattern[2*(idx)+1]*b)]
+
+    for (int i = 0; i < 32; ++i, pattern += 32)
+    {
+        int t0, t1, val;
+        t0 = GET_VALUE(0); t1 = GET_VALUE(1);
+        val = t0 < t1;
+        t0 = GET_VALUE(2); t1 = GET_VALUE(3);
+        val |= (t0 < t1) << 1;
+        t0 = GET_VALUE(4); t1 = GET_VALUE(5);
+        val |= (t0 < t1) << 2;
+        t0 = GET_VALUE(6); t1 = GET_VALUE(7);
+        val |= (t0 < t1) << 3;
+        t0 = GET_VALUE(8); t1 = GET_VALUE(9);
+        val |= (t0 < t1) << 4;
+        t0 = GET_VALUE(10); t1 = GET_VALUE(11);
+        val |= (t0 < t1) << 5;
+        t0 = GET_VALUE(12); t1 = GET_VALUE(13);
+        val |= (t0 < t1) << 6;
+        t0 = GET_VALUE(14); t1 = GET_VALUE(15);
+        val |= (t0 < t1) << 7;
+
+        desc[i] = (uchar)val;
+    }
+
+#undef GET_VALUE
+}
+
+#ifdef ORB_KERNELS_X86
+
+// ----------------------------------------------------------------------------
+// SSE2 (baseline on x86-64)
+//
+// Moments: a patch row covers u=-15..15, loaded as u=-15..0 and u=0..15 (the second u=0 lane is masked out). Lanes with
+// |u|>umax[v] are masked per row, products are summed in 32 bit with madd.
+// Descriptor: the rotated pattern is computed 4 points at a time, cvtps rounds to nearest even like cvRound. The pixels
+// are fetched scalar, the 256 comparisons are done 8 pairs per vector and packed to bits with movemask.
+
+inline int HorizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(1,0,3,2)));
+    v = _mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+void ICMomentsSSE2(const uchar* center, int step, const int* umax, int &m_01, int &m_10)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // u and |u| of the 4x8 lanes of a row. |u| of the duplicate u=0 lane is set out of range.
+    const __m128i u[4] = {_mm_setr_epi16(-15,-14,-13,-12,-11,-10,-9,-8),_mm_setr_epi16(-7,-6,-5,-4,-3,-2,-1,0),
+                          _mm_setr_epi16(0,1,2,3,4,5,6,7),_mm_setr_epi16(8,9,10,11,12,13,14,15)};
+    const __m128i absu[4] = {_mm_setr_epi16(15,14,13,12,11,10,9,8),_mm_setr_epi16(7,6,5,4,3,2,1,0),
+                             _mm_setr_epi16(127,1,2,3,4,5,6,7),_mm_setr_epi16(8,9,10,11,12,13,14,15)};
+
+    __m128i m10 = zero;
+    __m128i m01 = zero;
+
+    for (int v = 0; v <= HALF_PATCH_SIZE; ++v)
+    {
+        const __m128i d = _mm_set1_epi16(v == 0 ? HALF_PATCH_SIZE+1 : umax[v]+1);
+        const uchar* plus = center + v*step;
+        const __m128i p8[2] = {_mm_loadu_si128((const __m128i*)(plus-HALF_PATCH_SIZE)),_mm_loadu_si128((const __m128i*)plus)};
+
+        if(v == 0)
+        {
+            for(int k=0; k<4; ++k)
+            {
+                const __m128i mask = _mm_cmplt_epi16(absu[k],d);
+                const __m128i p = k%2 ? _mm_unpackhi_epi8(p8[k/2],zero) : _mm_unpacklo_epi8(p8[k/2],zero);
+                m10 = _mm_add_epi32(m10,_mm_madd_epi16(_mm_and_si128(p,mask),u[k]));
+            }
+            continue;
+        }
+
+        const uchar* minus = center - v*step;
+        const __m128i m8[2] = {_mm_loadu_si128((const __m128i*)(minus-HALF_PATCH_SIZE)),_mm_loadu_si128((const __m128i*)minus)};
+
+        __m128i v_sum = zero;
+        for(int k=0; k<4; ++k)
+        {
+            const __m128i mask = _mm_cmplt_epi16(absu[k],d);
+            const __m128i p = k%2 ? _mm_unpackhi_epi8(p8[k/2],zero) : _mm_unpacklo_epi8(p8[k/2],zero);
+            const __m128i m = k%2 ? _mm_unpackhi_epi8(m8[k/2],zero) : _mm_unpacklo_epi8(m8[k/2],zero);
+            v_sum = _mm_add_epi16(v_sum,_mm_and_si128(_mm_sub_epi16(p,m),mask));
+            m10 = _mm_add_epi32(m10,_mm_madd_epi16(_mm_and_si128(_mm_add_epi16(p,m),mask),u[k]));
+        }
+        m01 = _mm_add_epi32(m01,_mm_madd_epi16(v_sum,_mm_set1_epi16(v)));
+    }
+
+    m_01 = HorizontalSum(m01);
+    m_10 = HorizontalSum(m10);
+}
+
+// 512 sampled intensities -> 32 descriptor bytes, 16 pairs (2 bytes) per iteration
+inline void PackComparisonsSSE2(const uchar* vals, uchar* desc)
+{
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for(int i=0; i<32; i+=2, vals+=32)
+    {
+        const __m128i v0 = _mm_loadu_si128((const __m128i*)vals);
+        const __m128i v1 = _mm_loadu_si128((const __m128i*)(vals+16));
+        // t0 < t1, t0 is the even (low) byte of each pair
+        const __m128i r0 = _mm_cmplt_epi16(_mm_and_si128(v0,lowBytes),_mm_srli_epi16(v0,8));
+        const __m128i r1 = _mm_cmplt_epi16(_mm_and_si128(v1,lowBytes),_mm_srli_epi16(v1,8));
+        const int bits = _mm_movemask_epi8(_mm_packs_epi16(r0,r1));
+        desc[i] = (uchar)(bits & 0xff);
+        desc[i+1] = (uchar)(bits >> 8);
+    }
+}
+
+void DescriptorSSE2(const uchar* center, int step, float a, float b, const int* pattern, uchar* desc)
+{
+    alignas(16) int rows[512];
+    alignas(16) int cols[512];
+    alignas(16) uchar vals[512];
+
+    const __m128 va = _mm_set1_ps(a);
+    const __m128 vb = _mm_set1_ps(b);
+    for(int i=0; i<512; i+=4)
+    {
+        // (x0,y0,x1,y1), (x2,y2,x3,y3) -> (x0..x3), (y0..y3)
+        const __m128 p0 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(pattern+2*i)));
+        const __m128 p1 = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(pattern+2*i+4)));
+        const __m128 x = _mm_shuffle_ps(p0,p1,_MM_SHUFFLE(2,0,2,0));
+        const __m128 y = _mm_shuffle_ps(p0,p1,_MM_SHUFFLE(3,1,3,1));
+        _mm_store_si128((__m128i*)(rows+i),_mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(x,vb),_mm_mul_ps(y,va))));
+        _mm_store_si128((__m128i*)(cols+i),_mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(x,va),_mm_mul_ps(y,vb))));
+    }
+
+    for(int i=0; i<512; ++i)
+        vals[i] = center[rows[i]*step + cols[i]];
+
+    PackComparisonsSSE2(vals,desc);
+}
+
+// ----------------------------------------------------------------------------
+// AVX2 - a patch row fits into 2 vectors, the pattern offsets are computed 8 points at a time incl. the row step, 32
+// pairs are compared per iteration.
+
+__attribute__((target("avx2")))
+inline int HorizontalSumAVX2(__m256i v)
+{
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),_mm256_extracti128_si256(v,1));
+    s = _mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(1,0,3,2)));
+    s = _mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(2,3,0,1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+void ICMomentsAVX2(const uchar* center, int step, const int* umax, int &m_01, int &m_10)
+{
+    const __m256i u[2] = {_mm256_setr_epi16(-15,-14,-13,-12,-11,-10,-9,-8,-7,-6,-5,-4,-3,-2,-1,0),
+                          _mm256_setr_epi16(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)};
+    const __m256i absu[2] = {_mm256_setr_epi16(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0),
+                             _mm256_setr_epi16(127,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)};
+
+    __m256i m10 = _mm256_setzero_si256();
+    __m256i m01 = _mm256_setzero_si256();
+
+    for (int v = 0; v <= HALF_PATCH_SIZE; ++v)
+    {
+        const __m256i d = _mm256_set1_epi16(v == 0 ? HALF_PATCH_SIZE+1 : umax[v]+1);
+        const uchar* plus = center + v*step;
+        const __m256i p[2] = {_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(plus-HALF_PATCH_SIZE))),
+                              _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)plus))};
+
+        if(v == 0)
+        {
+            for(int k=0; k<2; ++k)
+            {
+                const __m256i mask = _mm256_cmpgt_epi16(d,absu[k]);
+                m10 = _mm256_add_epi32(m10,_mm256_madd_epi16(_mm256_and_si256(p[k],mask),u[k]));
+            }
+            continue;
+        }
+
+        const uchar* minus = center - v*step;
+        const __m256i m[2] = {_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(minus-HALF_PATCH_SIZE))),
+                              _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)minus))};
+
+        __m256i v_sum = _mm256_setzero_si256();
+        for(int k=0; k<2; ++k)
+        {
+            const __m256i mask = _mm256_cmpgt_epi16(d,absu[k]);
+            v_sum = _mm256_add_epi16(v_sum,_mm256_and_si256(_mm256_sub_epi16(p[k],m[k]),mask));
+            m10 = _mm256_add_epi32(m10,_mm256_madd_epi16(_mm256_and_si256(_mm256_add_epi16(p[k],m[k]),mask),u[k]));
+        }
+        m01 = _mm256_add_epi32(m01,_mm256_madd_epi16(v_sum,_mm256_set1_epi16(v)));
+    }
+
+    m_01 = HorizontalSumAVX2(m01);
+    m_10 = HorizontalSumAVX2(m10);
+}
+
+__attribute__((target("avx2")))
+void DescriptorAVX2(const uchar* center, int step, float a, float b, const int* pattern, uchar* desc)
+{
+    alignas(32) int offsets[512];
+    alignas(32) uchar vals[512];
+
+    // no FMA on purpose: the products must be rounded like in the scalar version
+    const __m256 va = _mm256_set1_ps(a);
+    const __m256 vb = _mm256_set1_ps(b);
+    const __m256i vstep = _mm256_set1_epi32(step);
+    const __m256i evenOdd = _mm256_setr_epi32(0,2,4,6,1,3,5,7);
+    for(int i=0; i<512; i+=8)
+    {
+        // (x0,y0,..,x3,y3), (x4,y4,..,x7,y7) -> (x0..x7), (y0..y7)
+        const __m256i p0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(pattern+2*i)),evenOdd);
+        const __m256i p1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(pattern+2*i+8)),evenOdd);
+        const __m256 x = _mm256_cvtepi32_ps(_mm256_permute2x128_si256(p0,p1,0x20));
+        const __m256 y = _mm256_cvtepi32_ps(_mm256_permute2x128_si256(p0,p1,0x31));
+        const __m256i row = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(x,vb),_mm256_mul_ps(y,va)));
+        const __m256i col = _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_mul_ps(x,va),_mm256_mul_ps(y,vb)));
+        _mm256_store_si256((__m256i*)(offsets+i),_mm256_add_epi32(_mm256_mullo_epi32(row,vstep),col));
+    }
+
+    for(int i=0; i<512; ++i)
+        vals[i] = center[offsets[i]];
+
+    const __m256i lowBytes = _mm256_set1_epi16(0x00ff);
+    for(int i=0; i<32; i+=4)
+    {
+        const __m256i v0 = _mm256_load_si256((const __m256i*)(vals+16*i));
+        const __m256i v1 = _mm256_load_si256((const __m256i*)(vals+16*i+32));
+        const __m256i r0 = _mm256_cmpgt_epi16(_mm256_srli_epi16(v0,8),_mm256_and_si256(v0,lowBytes));
+        const __m256i r1 = _mm256_cmpgt_epi16(_mm256_srli_epi16(v1,8),_mm256_and_si256(v1,lowBytes));
+        // packs works per 128 bit lane, restore the pair order before collecting the bits
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(r0,r1),_MM_SHUFFLE(3,1,2,0));
+        const unsigned int bits = (unsigned int)_mm256_movemask_epi8(packed);
+        desc[i] = (uchar)(bits & 0xff);
+        desc[i+1] = (uchar)((bits >> 8) & 0xff);
+        desc[i+2] = (uchar)((bits >> 16) & 0xff);
+        desc[i+3] = (uchar)(bits >> 24);
+    }
+}
+
+#endif
+
+const ORBkernels kernelsScalar = {&ICMomentsScalar,&DescriptorScalar,ORBkernels::SCALAR,"scalar"};
+#ifdef ORB_KERNELS_X86
+const ORBkernels kernelsSSE2 = {&ICMomentsSSE2,&DescriptorSSE2,ORBkernels::SSE2,"sse2"};
+const ORBkernels kernelsAVX2 = {&ICMomentsAVX2,&DescriptorAVX2,ORBkernels::AVX2,"avx2"};
+#endif
+
+} //end anonymous ns
+
+const ORBkernels* ORBkernels::Get(eIsa isa)
+{
+    switch(isa)
+    {
+    case SCALAR:
+        return &kernelsScalar;
+#ifdef ORB_KERNELS_X86
+    case SSE2:
+        return &kernelsSSE2;
+    case AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &kernelsAVX2 : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const ORBkernels& ORBkernels::GetBest()
+{
+    static const ORBkernels* best = []()
+    {
+        const ORBkernels* kernels = nullptr;
+        for(int isa = AVX2; isa >= SCALAR && !kernels; --isa)
+            kernels = Get(static_cast<eIsa>(isa));
+        return kernels;
+    }();
+    return *best;
+}
+
+} //end ns
@@ -0,0 +1,53 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace covins {
+
+// Orientation and descriptor kernels of the ORBextractor
+//
+// Besides the scalar reference there are SSE2 and AVX2 implementations (x86-64 only), selected at runtime from what
+// the CPU supports. All of them produce bit-identical output: the rotated pattern is rounded like cvRound (round to
+// nearest even), and the moments are exact integer sums.
+struct ORBkernels
+{
+    enum eIsa {SCALAR=0, SSE2=1, AVX2=2};
+
+    // Intensity centroid moments of the circular patch with radius 15 around center, umax[v] is the half width of row v
+    void (*ICMoments)(const unsigned char* center, int step, const int* umax, int &m_01, int &m_10);
+
+    // 32 byte rBRIEF descriptor, a=cos(angle), b=sin(angle), pattern holds 512 points as (x,y) pairs
+    void (*Descriptor)(const unsigned char* center, int step, float a, float b, const int* pattern, unsigned char* desc);
+
+    eIsa isa;
+    const char* name;
+
+    // Kernels for isa, nullptr if not supported by this CPU / build
+    static const ORBkernels* Get(eIsa isa);
+
+    // Fastest supported kernels, determined on first use
+    static const ORBkernels& GetBest();
+};
+
+} //end ns
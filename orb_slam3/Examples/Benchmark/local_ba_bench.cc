@@ -0,0 +1,140 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the parallel g2o linearization and Schur complement on recorded local BA problems
+//
+// Usage: ./local_ba_bench max_threads problem_files...
+// The problems are recorded by setting LocalMapping.baRecordDir in the settings file. Every problem is optimized like
+// in Optimizer::LocalBundleAdjustment (5 + 10 Levenberg iterations) with 1, 2, 4, ... max_threads threads. Reports the
+// optimization time per thread count and checks that the estimates match the serial run bit by bit.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Thirdparty/g2o/g2o/core/block_solver.h"
+#include "Thirdparty/g2o/g2o/core/optimization_algorithm_levenberg.h"
+#include "Thirdparty/g2o/g2o/solvers/linear_solver_eigen.h"
+#include "Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"
+
+#include "CameraModels/GeometricCamera.h"
+#include "LocalBAProblem.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+// Optimizes the problem, returns the optimization time [ms] (-1 on failure) and the estimates of all vertices
+static double Run(const string &strFile, int nThreads, vector<double> &vEstimates, size_t &nEdges)
+{
+    g2o::SparseOptimizer optimizer;
+    g2o::BlockSolver_6_3::LinearSolverType * linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+    g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
+    optimizer.setAlgorithm(new g2o::OptimizationAlgorithmLevenberg(solver_ptr));
+    optimizer.setNumThreads(nThreads);
+
+    vector<GeometricCamera*> vpCameras;
+    if(!LocalBAProblem::Load(strFile,optimizer,vpCameras))
+        return -1;
+
+    optimizer.initializeOptimization();
+    nEdges = optimizer.activeEdges().size();
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    optimizer.optimize(5);
+    optimizer.initializeOptimization(0);
+    optimizer.optimize(10);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    vEstimates.clear();
+    const g2o::SparseOptimizer::VertexContainer &vpVertices = optimizer.activeVertices();
+    for(size_t i=0; i<vpVertices.size(); ++i)
+    {
+        if(const g2o::VertexSE3Expmap* vSE3 = dynamic_cast<const g2o::VertexSE3Expmap*>(vpVertices[i]))
+        {
+            const g2o::Vector7d v = vSE3->estimate().toVector();
+            vEstimates.insert(vEstimates.end(),v.data(),v.data()+7);
+        }
+        else if(const g2o::VertexSBAPointXYZ* vPoint = dynamic_cast<const g2o::VertexSBAPointXYZ*>(vpVertices[i]))
+            vEstimates.insert(vEstimates.end(),vPoint->estimate().data(),vPoint->estimate().data()+3);
+    }
+
+    for(size_t i=0; i<vpCameras.size(); ++i)
+        delete vpCameras[i];
+
+    return std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(t1-t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3)
+    {
+        cerr << "Usage: ./local_ba_bench max_threads problem_files..." << endl;
+        return 1;
+    }
+
+    const int nMaxThreads = max(atoi(argv[1]),1);
+    const vector<string> vstrFiles(argv+2,argv+argc);
+
+    vector<int> vnThreads;
+    for(int n=1; n<nMaxThreads; n*=2)
+        vnThreads.push_back(n);
+    vnThreads.push_back(nMaxThreads);
+
+    // serial reference
+    vector<vector<double> > vvReference(vstrFiles.size());
+    size_t nEdges = 0;
+    double tSerial = 0;
+    for(size_t i=0; i<vstrFiles.size(); ++i)
+    {
+        size_t n;
+        const double t = Run(vstrFiles[i],1,vvReference[i],n);
+        if(t < 0)
+            return 1;
+        tSerial += t;
+        nEdges += n;
+    }
+    cout << vstrFiles.size() << " problems, " << nEdges / vstrFiles.size() << " edges on average" << endl;
+
+    cout << fixed << setprecision(3);
+    for(size_t k=0; k<vnThreads.size(); ++k)
+    {
+        double tTotal = 0;
+        bool bIdentical = true;
+        for(size_t i=0; i<vstrFiles.size(); ++i)
+        {
+            vector<double> vEstimates;
+            size_t n;
+            tTotal += Run(vstrFiles[i],vnThreads[k],vEstimates,n);
+            bIdentical = bIdentical && vEstimates.size() == vvReference[i].size() &&
+                         memcmp(vEstimates.data(),vvReference[i].data(),vEstimates.size()*sizeof(double)) == 0;
+        }
+        cout << setw(3) << vnThreads[k] << " threads: " << setw(9) << tTotal / vstrFiles.size() << " ms/problem, speedup "
+             << setw(6) << tSerial / tTotal << (bIdentical ? "" : "  RESULT DIFFERS FROM SERIAL") << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Micro-benchmark of the ORBextractor orientation and descriptor kernels and of the stereo matching kernels
+//
+// Usage: ./orb_kernels_bench [image] [num_keypoints]
+// Runs every kernel set supported by this CPU on the same random keypoints (on the image or on noise), checks that the
+// output matches the scalar reference bit by bit and reports the time per keypoint, per descriptor pair and per
+// correlation search (11 windows).
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include "ORBkernels.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+int main(int argc, char **argv)
+{
+    const int nKeys = argc > 2 ? atoi(argv[2]) : 100000;
+    const int nRepetitions = 10;
+
+    std::mt19937 rng(42);
+
+    cv::Mat im;
+    if(argc > 1)
+        im = cv::imread(argv[1],cv::IMREAD_GRAYSCALE);
+    if(im.empty())
+    {
+        im = cv::Mat(480,752,CV_8U);
+        cv::randu(im,0,256);
+    }
+
+    // umax as in the ORBextractor
+    const int HALF_PATCH_SIZE = 15;
+    vector<int> umax(HALF_PATCH_SIZE + 1);
+    int v, v0, vmax = cvFloor(HALF_PATCH_SIZE * sqrt(2.f) / 2 + 1);
+    int vmin = cvCeil(HALF_PATCH_SIZE * sqrt(2.f) / 2);
+    const double hp2 = HALF_PATCH_SIZE*HALF_PATCH_SIZE;
+    for (v = 0; v <= vmax; ++v)
+        umax[v] = cvRound(sqrt(hp2 - v * v));
+    for (v = HALF_PATCH_SIZE, v0 = 0; v >= vmin; --v)
+    {
+        while (umax[v0] == umax[v0 + 1])
+            ++v0;
+        umax[v] = v0;
+        ++v0;
+    }
+
+    // random pattern with the extent of bit_pattern_31_
+    vector<int> pattern(512*2);
+    std::uniform_int_distribution<int> coord(-13,13);
+    for(int &c : pattern)
+        c = coord(rng);
+
+    // keypoints keep the same distance to the border as in the extractor
+    const int border = 19;
+    std::uniform_int_distribution<int> x(border,im.cols-border-1), y(border,im.rows-border-1);
+    std::uniform_real_distribution<float> angle(0.f,(float)(2.0*CV_PI));
+    vector<const uchar*> vCenters(nKeys);
+    vector<float> vCos(nKeys), vSin(nKeys);
+    for(int i=0; i<nKeys; ++i)
+    {
+        vCenters[i] = &im.at<uchar>(y(rng),x(rng));
+        const float a = angle(rng);
+        vCos[i] = cos(a);
+        vSin[i] = sin(a);
+    }
+
+    const int step = (int)im.step;
+    vector<int> vRefMoments(2*nKeys);
+    vector<uchar> vRefDesc(32*nKeys);
+    double tRefMoments = 0.0, tRefDesc = 0.0;
+
+    cout << "Keypoints: " << nKeys << ", image " << im.cols << "x" << im.rows << endl;
+    cout << "Best kernels on this CPU: " << ORBkernels::GetBest().name << endl << endl;
+    cout << left << setw(8) << "isa" << setw(18) << "moments[ns/kp]" << setw(18) << "descriptor[ns/kp]"
+         << setw(12) << "speedup" << "identical" << endl;
+
+    for(int isa = ORBkernels::SCALAR; isa <= ORBkernels::AVX2; ++isa)
+    {
+        const ORBkernels* kernels = ORBkernels::Get(static_cast<ORBkernels::eIsa>(isa));
+        if(!kernels)
+            continue;
+
+        vector<int> vMoments(2*nKeys);
+        vector<uchar> vDesc(32*nKeys);
+        double tMoments = 1e12, tDesc = 1e12;
+        for(int r=0; r<nRepetitions; ++r)
+        {
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            for(int i=0; i<nKeys; ++i)
+                kernels->ICMoments(vCenters[i],step,&umax[0],vMoments[2*i],vMoments[2*i+1]);
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            for(int i=0; i<nKeys; ++i)
+                kernels->Descriptor(vCenters[i],step,vCos[i],vSin[i],&pattern[0],&vDesc[32*i]);
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+            tMoments = std::min(tMoments,std::chrono::duration_cast<std::chrono::duration<double,std::nano> >(t1 - t0).count()/nKeys);
+            tDesc = std::min(tDesc,std::chrono::duration_cast<std::chrono::duration<double,std::nano> >(t2 - t1).count()/nKeys);
+        }
+
+        if(isa == ORBkernels::SCALAR)
+        {
+            vRefMoments = vMoments;
+            vRefDesc = vDesc;
+            tRefMoments = tMoments;
+            tRefDesc = tDesc;
+        }
+
+        const bool bIdentical = vMoments == vRefMoments && vDesc == vRefDesc;
+        cout << left << setw(8) << kernels->name << fixed << setprecision(1) << setw(18) << tMoments << setw(18) << tDesc
+             << setprecision(2) << setw(12) << (tRefMoments+tRefDesc)/(tMoments+tDesc) << (bIdentical ? "yes" : "NO") << endl;
+    }
+
+    // Stereo matching: distances of every descriptor to a band of 64 others, SAD search at every keypoint
+    const int nBand = 64;
+    vector<int> vBand(nBand);
+    std::uniform_int_distribution<int> other(0,nKeys-1);
+    for(int &idx : vBand)
+        idx = other(rng);
+
+    vector<int> vRefDist(nBand*nKeys), vRefSAD(11*nKeys);
+    double tRefDist = 0.0, tRefSAD = 0.0;
+
+    cout << endl << left << setw(8) << "isa" << setw(18) << "hamming[ns/pair]" << setw(18) << "sad[ns/search]"
+         << setw(12) << "speedup" << "identical" << endl;
+
+    for(int isa = ORBkernels::SCALAR; isa <= ORBkernels::AVX2; ++isa)
+    {
+        const ORBkernels* kernels = ORBkernels::Get(static_cast<ORBkernels::eIsa>(isa));
+        if(!kernels)
+            continue;
+
+        vector<int> vDist(nBand*nKeys), vSAD(11*nKeys);
+        double tDist = 1e12, tSAD = 1e12;
+        for(int r=0; r<nRepetitions; ++r)
+        {
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            for(int i=0; i<nKeys; ++i)
+                kernels->DescriptorDistances(&vRefDesc[32*i],&vRefDesc[0],32,&vBand[0],nBand,&vDist[nBand*i]);
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            // right strip 5 pixels left of the window, both inside the extractor border
+            for(int i=0; i<nKeys; ++i)
+                kernels->StereoSAD(vCenters[i]-5*step-5,step,vCenters[i]-5*step-15,step,&vSAD[11*i]);
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+            tDist = std::min(tDist,std::chrono::duration_cast<std::chrono::duration<double,std::nano> >(t1 - t0).count()/(nKeys*nBand));
+            tSAD = std::min(tSAD,std::chrono::duration_cast<std::chrono::duration<double,std::nano> >(t2 - t1).count()/nKeys);
+        }
+
+        if(isa == ORBkernels::SCALAR)
+        {
+            vRefDist = vDist;
+            vRefSAD = vSAD;
+            tRefDist = tDist;
+            tRefSAD = tSAD;
+        }
+
+        const bool bIdentical = vDist == vRefDist && vSAD == vRefSAD;
+        cout << left << setw(8) << kernels->name << fixed << setprecision(2) << setw(18) << tDist << setprecision(1)
+             << setw(18) << tSAD << setprecision(2) << setw(12) << (tRefDist*nBand+tRefSAD)/(tDist*nBand+tSAD)
+             << (bIdentical ? "yes" : "NO") << endl;
+    }
+
+    return 0;
+}
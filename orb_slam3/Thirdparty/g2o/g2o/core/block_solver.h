@@ -32,6 +32,8 @@
 #include "sparse_block_matrix.h"
 #include "sparse_block_matrix_diagonal.h"
 #include "openmp_mutex.h"
+#include "jacobian_workspace.h"
+#include "thread_pool.h"
 #include "../../config.h"
 
 namespace g2o {
@@ -147,6 +149,13 @@ namespace g2o {
 
       void deallocate();
 
+      //! pose -> landmark lookup of _HplCCS for the parallel Schur complement
+      void buildPoseLandmarkLookup();
+      //! description of the structure of the current active graph, see buildStructure()
+      void computeStructureSignature(std::vector<size_t>& signature) const;
+      //! fill _Hschur and _coefficients with numThreads threads, same result as the serial version
+      void computeSchurComplementParallel(int numThreads);
+
       SparseBlockMatrix<PoseMatrixType>* _Hpp;
       SparseBlockMatrix<LandmarkMatrixType>* _Hll;
       SparseBlockMatrix<PoseLandmarkMatrixType>* _Hpl;
@@ -166,6 +175,16 @@ namespace g2o {
       std::vector<OpenMPMutex> _coefficientsMutex;
 #    endif
 
+      // state of the parallel buildSystem() and solve(), see SparseOptimizer::numThreads()
+      std::vector<double> _jacobianMemory;                ///< the Jacobians of all active edges
+      std::vector<size_t> _jacobianOffsets;               ///< start of the Jacobians of an active edge in _jacobianMemory
+      std::vector<JacobianWorkspace> _threadWorkspaces;   ///< one workspace per thread, mapped to _jacobianMemory
+      std::vector<int> _poseLandmarkStart;                ///< start of the entries of a pose in _poseLandmarks
+      std::vector<std::pair<int, int> > _poseLandmarks;   ///< (landmark, position in the landmark column of _HplCCS), ordered by landmark
+      std::vector<double> _landmarkDb;                    ///< Dinv * b of the landmarks
+
+      std::vector<size_t> _structureSignature;            ///< signature of the structure built last, empty if none
+
       bool _doSchur;
 
       double* _coefficients;
@@ -139,11 +139,46 @@ BlockSolver<Traits>::~BlockSolver()
   deallocate();
 }
 
+template <typename Traits>
+void BlockSolver<Traits>::computeStructureSignature(std::vector<size_t>& signature) const
+{
+  const SparseOptimizer::VertexContainer& indexMapping = _optimizer->indexMapping();
+  const SparseOptimizer::EdgeContainer& activeEdges = _optimizer->activeEdges();
+  signature.clear();
+  signature.reserve(4 + indexMapping.size() + activeEdges.size());
+  signature.push_back(_optimizer->revision());
+  signature.push_back(_doSchur);
+  signature.push_back(indexMapping.size());
+  for (size_t i = 0; i < indexMapping.size(); ++i)
+    signature.push_back(reinterpret_cast<size_t>(indexMapping[i]) | (indexMapping[i]->marginalized() ? 1 : 0));
+  signature.push_back(activeEdges.size());
+  for (size_t i = 0; i < activeEdges.size(); ++i)
+    signature.push_back(reinterpret_cast<size_t>(activeEdges[i]));
+}
+
 template <typename Traits>
 bool BlockSolver<Traits>::buildStructure(bool zeroBlocks)
 {
   assert(_optimizer);
 
+  // Nothing was added to or removed from the graph and the active vertices and edges are the same as in
+  // the last call: the blocks and the Hessian memory mapped into the vertices and edges are still valid,
+  // and the linear solver keeps its symbolic factorization.
+  std::vector<size_t> signature;
+  computeStructureSignature(signature);
+  if (_Hpp && signature == _structureSignature) {
+    if (zeroBlocks) {
+      _Hpp->clear();
+      if (_doSchur) {
+        _Hll->clear();
+        _Hpl->clear();
+      }
+    }
+    return true;
+  }
+  _structureSignature.swap(signature);
+  _linearSolver->init();
+
   size_t sparseDim = 0;
   _numPoses=0;
   _numLandmarks=0;
@@ -258,6 +293,7 @@ bool BlockSolver<Traits>::buildStructure(bool zeroBlocks)
 
   _DInvSchur->diagonal().resize(landmarkIdx);
   _Hpl->fillSparseBlockMatrixCCS(*_HplCCS);
+  buildPoseLandmarkLookup();
 
   for (size_t i = 0; i < _optimizer->indexMapping().size(); ++i) {
     OptimizableGraph::Vertex* v = _optimizer->indexMapping()[i];
@@ -294,9 +330,32 @@ bool BlockSolver<Traits>::buildStructure(bool zeroBlocks)
   return true;
 }
 
+template <typename Traits>
+void BlockSolver<Traits>::buildPoseLandmarkLookup()
+{
+  _poseLandmarkStart.assign(_numPoses + 1, 0);
+  for (size_t landmarkIndex = 0; landmarkIndex < _HplCCS->blockCols().size(); ++landmarkIndex) {
+    const typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn& landmarkColumn = _HplCCS->blockCols()[landmarkIndex];
+    for (size_t k = 0; k < landmarkColumn.size(); ++k)
+      ++_poseLandmarkStart[landmarkColumn[k].row + 1];
+  }
+  for (int i = 0; i < _numPoses; ++i)
+    _poseLandmarkStart[i + 1] += _poseLandmarkStart[i];
+
+  _poseLandmarks.resize(_poseLandmarkStart[_numPoses]);
+  std::vector<int> next(_poseLandmarkStart.begin(), _poseLandmarkStart.end() - 1);
+  for (size_t landmarkIndex = 0; landmarkIndex < _HplCCS->blockCols().size(); ++landmarkIndex) {
+    const typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn& landmarkColumn = _HplCCS->blockCols()[landmarkIndex];
+    for (size_t k = 0; k < landmarkColumn.size(); ++k)
+      _poseLandmarks[next[landmarkColumn[k].row]++] = std::make_pair(static_cast<int>(landmarkIndex), static_cast<int>(k));
+  }
+  _landmarkDb.resize(_sizeLandmarks);
+}
+
 template <typename Traits>
 bool BlockSolver<Traits>::updateStructure(const std::vector<HyperGraph::Vertex*>& vset, const HyperGraph::EdgeSet& edges)
 {
+  _structureSignature.clear();
   for (std::vector<HyperGraph::Vertex*>::const_iterator vit = vset.begin(); vit != vset.end(); ++vit) {
     OptimizableGraph::Vertex* v = static_cast<OptimizableGraph::Vertex*>(*vit);
     int dim = v->dimension();
@@ -375,58 +434,62 @@ bool BlockSolver<Traits>::solve(){
 
   //_DInvSchur->clear();
   memset (_coefficients, 0, _sizePoses*sizeof(double));
+  if (_optimizer->numThreads() > 1) {
+    computeSchurComplementParallel(_optimizer->numThreads());
+  } else {
 # ifdef G2O_OPENMP
 # pragma omp parallel for default (shared) schedule(dynamic, 10)
 # endif
-  for (int landmarkIndex = 0; landmarkIndex < static_cast<int>(_Hll->blockCols().size()); ++landmarkIndex) {
-    const typename SparseBlockMatrix<LandmarkMatrixType>::IntBlockMap& marginalizeColumn = _Hll->blockCols()[landmarkIndex];
-    assert(marginalizeColumn.size() == 1 && "more than one block in _Hll column");
-
-    // calculate inverse block for the landmark
-    const LandmarkMatrixType * D = marginalizeColumn.begin()->second;
-    assert (D && D->rows()==D->cols() && "Error in landmark matrix");
-    LandmarkMatrixType& Dinv = _DInvSchur->diagonal()[landmarkIndex];
-    Dinv = D->inverse();
-
-    LandmarkVectorType  db(D->rows());
-    for (int j=0; j<D->rows(); ++j) {
-      db[j]=_b[_Hll->rowBaseOfBlock(landmarkIndex) + _sizePoses + j];
-    }
-    db=Dinv*db;
+    for (int landmarkIndex = 0; landmarkIndex < static_cast<int>(_Hll->blockCols().size()); ++landmarkIndex) {
+      const typename SparseBlockMatrix<LandmarkMatrixType>::IntBlockMap& marginalizeColumn = _Hll->blockCols()[landmarkIndex];
+      assert(marginalizeColumn.size() == 1 && "more than one block in _Hll column");
+
+      // calculate inverse block for the landmark
+      const LandmarkMatrixType * D = marginalizeColumn.begin()->second;
+      assert (D && D->rows()==D->cols() && "Error in landmark matrix");
+      LandmarkMatrixType& Dinv = _DInvSchur->diagonal()[landmarkIndex];
+      Dinv = D->inverse();
+
+      LandmarkVectorType  db(D->rows());
+      for (int j=0; j<D->rows(); ++j) {
+        db[j]=_b[_Hll->rowBaseOfBlock(landmarkIndex) + _sizePoses + j];
+      }
+      db=Dinv*db;
 
-    assert((size_t)landmarkIndex < _HplCCS->blockCols().size() && "Index out of bounds");
-    const typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn& landmarkColumn = _HplCCS->blockCols()[landmarkIndex];
+      assert((size_t)landmarkIndex < _HplCCS->blockCols().size() && "Index out of bounds");
+      const typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn& landmarkColumn = _HplCCS->blockCols()[landmarkIndex];
 
-    for (typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_outer = landmarkColumn.begin();
-        it_outer != landmarkColumn.end(); ++it_outer) {
-      int i1 = it_outer->row;
+      for (typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_outer = landmarkColumn.begin();
+          it_outer != landmarkColumn.end(); ++it_outer) {
+        int i1 = it_outer->row;
 
-      const PoseLandmarkMatrixType* Bi = it_outer->block;
-      assert(Bi);
+        const PoseLandmarkMatrixType* Bi = it_outer->block;
+        assert(Bi);
 
-      PoseLandmarkMatrixType BDinv = (*Bi)*(Dinv);
-      assert(_HplCCS->rowBaseOfBlock(i1) < _sizePoses && "Index out of bounds");
-      typename PoseVectorType::MapType Bb(&_coefficients[_HplCCS->rowBaseOfBlock(i1)], Bi->rows());
+        PoseLandmarkMatrixType BDinv = (*Bi)*(Dinv);
+        assert(_HplCCS->rowBaseOfBlock(i1) < _sizePoses && "Index out of bounds");
+        typename PoseVectorType::MapType Bb(&_coefficients[_HplCCS->rowBaseOfBlock(i1)], Bi->rows());
 #    ifdef G2O_OPENMP
-      ScopedOpenMPMutex mutexLock(&_coefficientsMutex[i1]);
+        ScopedOpenMPMutex mutexLock(&_coefficientsMutex[i1]);
 #    endif
-      Bb.noalias() += (*Bi)*db;
-
-      assert(i1 >= 0 && i1 < static_cast<int>(_HschurTransposedCCS->blockCols().size()) && "Index out of bounds");
-      typename SparseBlockMatrixCCS<PoseMatrixType>::SparseColumn::iterator targetColumnIt = _HschurTransposedCCS->blockCols()[i1].begin();
-
-      typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::RowBlock aux(i1, 0);
-      typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_inner = lower_bound(landmarkColumn.begin(), landmarkColumn.end(), aux);
-      for (; it_inner != landmarkColumn.end(); ++it_inner) {
-        int i2 = it_inner->row;
-        const PoseLandmarkMatrixType* Bj = it_inner->block;
-        assert(Bj); 
-        while (targetColumnIt->row < i2 /*&& targetColumnIt != _HschurTransposedCCS->blockCols()[i1].end()*/)
-          ++targetColumnIt;
-        assert(targetColumnIt != _HschurTransposedCCS->blockCols()[i1].end() && targetColumnIt->row == i2 && "invalid iterator, something wrong with the matrix structure");
-        PoseMatrixType* Hi1i2 = targetColumnIt->block;//_Hschur->block(i1,i2);
-        assert(Hi1i2);
-        (*Hi1i2).noalias() -= BDinv*Bj->transpose();
+        Bb.noalias() += (*Bi)*db;
+
+        assert(i1 >= 0 && i1 < static_cast<int>(_HschurTransposedCCS->blockCols().size()) && "Index out of bounds");
+        typename SparseBlockMatrixCCS<PoseMatrixType>::SparseColumn::iterator targetColumnIt = _HschurTransposedCCS->blockCols()[i1].begin();
+
+        typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::RowBlock aux(i1, 0);
+        typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_inner = lower_bound(landmarkColumn.begin(), landmarkColumn.end(), aux);
+        for (; it_inner != landmarkColumn.end(); ++it_inner) {
+          int i2 = it_inner->row;
+          const PoseLandmarkMatrixType* Bj = it_inner->block;
+          assert(Bj); 
+          while (targetColumnIt->row < i2 /*&& targetColumnIt != _HschurTransposedCCS->blockCols()[i1].end()*/)
+            ++targetColumnIt;
+          assert(targetColumnIt != _HschurTransposedCCS->blockCols()[i1].end() && targetColumnIt->row == i2 && "invalid iterator, something wrong with the matrix structure");
+          PoseMatrixType* Hi1i2 = targetColumnIt->block;//_Hschur->block(i1,i2);
+          assert(Hi1i2);
+          (*Hi1i2).noalias() -= BDinv*Bj->transpose();
+        }
       }
     }
   }
@@ -486,6 +549,76 @@ bool BlockSolver<Traits>::solve(){
 }
 
 
+template <typename Traits>
+void BlockSolver<Traits>::computeSchurComplementParallel(int numThreads)
+{
+  // invert the landmark blocks and compute Dinv * b
+  ThreadPool::global().parallelFor(static_cast<int>(_Hll->blockCols().size()), numThreads, 32,
+      [this](int begin, int end, int) {
+    for (int landmarkIndex = begin; landmarkIndex < end; ++landmarkIndex) {
+      const typename SparseBlockMatrix<LandmarkMatrixType>::IntBlockMap& marginalizeColumn = _Hll->blockCols()[landmarkIndex];
+      assert(marginalizeColumn.size() == 1 && "more than one block in _Hll column");
+
+      const LandmarkMatrixType * D = marginalizeColumn.begin()->second;
+      assert (D && D->rows()==D->cols() && "Error in landmark matrix");
+      LandmarkMatrixType& Dinv = _DInvSchur->diagonal()[landmarkIndex];
+      Dinv = D->inverse();
+
+      int landmarkBase = _Hll->rowBaseOfBlock(landmarkIndex);
+      LandmarkVectorType  db(D->rows());
+      for (int j=0; j<D->rows(); ++j) {
+        db[j]=_b[landmarkBase + _sizePoses + j];
+      }
+      db=Dinv*db;
+      for (int j=0; j<D->rows(); ++j) {
+        _landmarkDb[landmarkBase + j]=db[j];
+      }
+    }
+  });
+
+  // each pose owns its row of the upper triangle of _Hschur and its part of _coefficients, no locking needed.
+  // The landmarks of a pose are visited in increasing order, which sums up every block in the same order as the serial loop.
+  ThreadPool::global().parallelFor(_numPoses, numThreads, 4,
+      [this](int begin, int end, int) {
+    for (int i1 = begin; i1 < end; ++i1) {
+      for (int p = _poseLandmarkStart[i1]; p < _poseLandmarkStart[i1 + 1]; ++p) {
+        int landmarkIndex = _poseLandmarks[p].first;
+        const typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn& landmarkColumn = _HplCCS->blockCols()[landmarkIndex];
+        typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_outer = landmarkColumn.begin() + _poseLandmarks[p].second;
+        assert(it_outer->row == i1);
+
+        const LandmarkMatrixType& Dinv = _DInvSchur->diagonal()[landmarkIndex];
+        int landmarkBase = _Hll->rowBaseOfBlock(landmarkIndex);
+        LandmarkVectorType  db(Dinv.rows());
+        for (int j=0; j<Dinv.rows(); ++j) {
+          db[j]=_landmarkDb[landmarkBase + j];
+        }
+
+        const PoseLandmarkMatrixType* Bi = it_outer->block;
+        assert(Bi);
+
+        PoseLandmarkMatrixType BDinv = (*Bi)*(Dinv);
+        typename PoseVectorType::MapType Bb(&_coefficients[_HplCCS->rowBaseOfBlock(i1)], Bi->rows());
+        Bb.noalias() += (*Bi)*db;
+
+        typename SparseBlockMatrixCCS<PoseMatrixType>::SparseColumn::iterator targetColumnIt = _HschurTransposedCCS->blockCols()[i1].begin();
+        for (typename SparseBlockMatrixCCS<PoseLandmarkMatrixType>::SparseColumn::const_iterator it_inner = it_outer;
+            it_inner != landmarkColumn.end(); ++it_inner) {
+          int i2 = it_inner->row;
+          const PoseLandmarkMatrixType* Bj = it_inner->block;
+          assert(Bj);
+          while (targetColumnIt->row < i2)
+            ++targetColumnIt;
+          assert(targetColumnIt != _HschurTransposedCCS->blockCols()[i1].end() && targetColumnIt->row == i2 && "invalid iterator, something wrong with the matrix structure");
+          PoseMatrixType* Hi1i2 = targetColumnIt->block;
+          assert(Hi1i2);
+          (*Hi1i2).noalias() -= BDinv*Bj->transpose();
+        }
+      }
+    }
+  });
+}
+
 template <typename Traits>
 bool BlockSolver<Traits>::computeMarginals(SparseBlockMatrix<MatrixXd>& spinv, const std::vector<std::pair<int, int> >& blockIndices)
 {
@@ -518,30 +651,69 @@ bool BlockSolver<Traits>::buildSystem()
 
   // resetting the terms for the pairwise constraints
   // built up the current system by storing the Hessian blocks in the edges and vertices
+  const int numThreads = _optimizer->numThreads();
+  if (numThreads > 1) {
+    // the Jacobians are computed in parallel into memory kept for every edge. The quadratic forms are
+    // accumulated afterwards in the original order, the edges share the Hessian blocks of their vertices.
+    const SparseOptimizer::EdgeContainer& activeEdges = _optimizer->activeEdges();
+    _jacobianOffsets.resize(activeEdges.size() + 1);
+    _jacobianOffsets[0] = 0;
+    for (size_t k = 0; k < activeEdges.size(); ++k)
+      _jacobianOffsets[k + 1] = _jacobianOffsets[k] + JacobianWorkspace::externalSize(activeEdges[k]);
+    _jacobianMemory.resize(_jacobianOffsets.back());
+    if (static_cast<int>(_threadWorkspaces.size()) < numThreads)
+      _threadWorkspaces.resize(numThreads);
+
+    ThreadPool::global().parallelFor(static_cast<int>(activeEdges.size()), numThreads, 32,
+        [this, &activeEdges](int begin, int end, int thread) {
+      JacobianWorkspace& jacobianWorkspace = _threadWorkspaces[thread];
+      for (int k = begin; k < end; ++k) {
+        OptimizableGraph::Edge* e = activeEdges[k];
+        jacobianWorkspace.mapExternal(e, _jacobianMemory.data() + _jacobianOffsets[k]);
+        e->linearizeOplus(jacobianWorkspace); // jacobian of the nodes' oplus (manifold)
+#  ifndef NDEBUG
+        for (size_t i = 0; i < e->vertices().size(); ++i) {
+          const OptimizableGraph::Vertex* v = static_cast<const OptimizableGraph::Vertex*>(e->vertex(i));
+          if (! v->fixed()) {
+            bool hasANan = arrayHasNaN(jacobianWorkspace.workspaceForVertex(i), e->dimension() * v->dimension());
+            if (hasANan) {
+              cerr << "buildSystem(): NaN within Jacobian for edge " << e << " for vertex " << i << endl;
+              break;
+            }
+          }
+        }
+#  endif
+      }
+    });
+
+    for (size_t k = 0; k < activeEdges.size(); ++k)
+      activeEdges[k]->constructQuadraticForm();
+  } else {
 # ifndef G2O_OPENMP
-  // no threading, we do not need to copy the workspace
-  JacobianWorkspace& jacobianWorkspace = _optimizer->jacobianWorkspace();
+    // no threading, we do not need to copy the workspace
+    JacobianWorkspace& jacobianWorkspace = _optimizer->jacobianWorkspace();
 # else
-  // if running with threads need to produce copies of the workspace for each thread
-  JacobianWorkspace jacobianWorkspace = _optimizer->jacobianWorkspace();
+    // if running with threads need to produce copies of the workspace for each thread
+    JacobianWorkspace jacobianWorkspace = _optimizer->jacobianWorkspace();
 # pragma omp parallel for default (shared) firstprivate(jacobianWorkspace) if (_optimizer->activeEdges().size() > 100)
 # endif
-  for (int k = 0; k < static_cast<int>(_optimizer->activeEdges().size()); ++k) {
-    OptimizableGraph::Edge* e = _optimizer->activeEdges()[k];
-    e->linearizeOplus(jacobianWorkspace); // jacobian of the nodes' oplus (manifold)
-    e->constructQuadraticForm();
+    for (int k = 0; k < static_cast<int>(_optimizer->activeEdges().size()); ++k) {
+      OptimizableGraph::Edge* e = _optimizer->activeEdges()[k];
+      e->linearizeOplus(jacobianWorkspace); // jacobian of the nodes' oplus (manifold)
+      e->constructQuadraticForm();
 #  ifndef NDEBUG
-    for (size_t i = 0; i < e->vertices().size(); ++i) {
-      const OptimizableGraph::Vertex* v = static_cast<const OptimizableGraph::Vertex*>(e->vertex(i));
-      if (! v->fixed()) {
-        bool hasANan = arrayHasNaN(jacobianWorkspace.workspaceForVertex(i), e->dimension() * v->dimension());
-        if (hasANan) {
-          cerr << "buildSystem(): NaN within Jacobian for edge " << e << " for vertex " << i << endl;
-          break;
+      for (size_t i = 0; i < e->vertices().size(); ++i) {
+        const OptimizableGraph::Vertex* v = static_cast<const OptimizableGraph::Vertex*>(e->vertex(i));
+        if (! v->fixed()) {
+          bool hasANan = arrayHasNaN(jacobianWorkspace.workspaceForVertex(i), e->dimension() * v->dimension());
+          if (hasANan) {
+            cerr << "buildSystem(): NaN within Jacobian for edge " << e << " for vertex " << i << endl;
+            break;
+          }
         }
       }
-    }
 #  endif
+    }
   }
 
   // flush the current system in a sparse block matrix
@@ -614,8 +786,11 @@ bool BlockSolver<Traits>::init(SparseOptimizer* optimizer, bool online)
       _Hpl->clear();
     if (_Hll)
       _Hll->clear();
+  } else {
+    // buildStructure() initializes the linear solver only if the structure changed
+    _structureSignature.clear();
+    _linearSolver->init();
   }
-  _linearSolver->init();
   return true;
 }
 
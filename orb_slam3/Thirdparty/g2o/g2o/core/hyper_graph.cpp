@@ -79,6 +79,7 @@ namespace g2o {
     if (vn)
       return false;
     _vertices.insert( std::make_pair(v->id(),v) );
+    ++_revision;
     return true;
   }
 
@@ -93,6 +94,7 @@ namespace g2o {
     _vertices.erase(v->id());
     v->setId(newId);
     _vertices.insert(std::make_pair(v->id(), v));
+    ++_revision;
     return true;
   }
 
@@ -105,10 +107,27 @@ namespace g2o {
       Vertex* v = *it;
       v->edges().insert(e);
     }
+    ++_revision;
     return true;
   }
 
   bool HyperGraph::removeVertex(Vertex* v)
+  {
+    if (! releaseVertex(v))
+      return false;
+    delete v;
+    return true;
+  }
+
+  bool HyperGraph::removeEdge(Edge* e)
+  {
+    if (! releaseEdge(e))
+      return false;
+    delete e;
+    return true;
+  }
+
+  bool HyperGraph::releaseVertex(Vertex* v)
   {
     VertexIDMap::iterator it=_vertices.find(v->id());
     if (it==_vertices.end())
@@ -122,11 +141,11 @@ namespace g2o {
       }
     }
     _vertices.erase(it);
-    delete v;
+    ++_revision;
     return true;
   }
 
-  bool HyperGraph::removeEdge(Edge* e)
+  bool HyperGraph::releaseEdge(Edge* e)
   {
     EdgeSet::iterator it = _edges.find(e);
     if (it == _edges.end())
@@ -139,12 +158,12 @@ namespace g2o {
       assert(it!=v->edges().end());
       v->edges().erase(it);
     }
-
-    delete e;
+    ++_revision;
     return true;
   }
 
-  HyperGraph::HyperGraph()
+  HyperGraph::HyperGraph() :
+    _revision(0)
   {
   }
 
@@ -156,6 +175,14 @@ namespace g2o {
       delete (*it);
     _vertices.clear();
     _edges.clear();
+    ++_revision;
+  }
+
+  void HyperGraph::releaseAll()
+  {
+    _vertices.clear();
+    _edges.clear();
+    ++_revision;
   }
 
   HyperGraph::~HyperGraph()
@@ -170,8 +170,24 @@ namespace g2o {
       virtual bool removeVertex(Vertex* v);
       //! removes a vertex from the graph. Returns true on success (edge was present)
       virtual bool removeEdge(Edge* e);
+      /**
+       * removes a vertex from the graph without deleting it, the caller takes the ownership.
+       * The edges still attached to the vertex are removed and deleted.
+       * Returns true on success (vertex was present)
+       */
+      virtual bool releaseVertex(Vertex* v);
+      /**
+       * removes an edge from the graph without deleting it, the caller takes the ownership.
+       * Returns true on success (edge was present)
+       */
+      virtual bool releaseEdge(Edge* e);
       //! clears the graph and empties all structures.
       virtual void clear();
+      /**
+       * empties the graph like clear(), but without deleting the vertices and edges, the caller takes the
+       * ownership (and destroys them altogether, e.g. if they live in an arena).
+       */
+      virtual void releaseAll();
 
       //! @returns the map <i>id -> vertex</i> where the vertices are stored
       const VertexIDMap& vertices() const {return _vertices;}
@@ -203,9 +219,16 @@ namespace g2o {
        */
       virtual bool changeId(Vertex* v, int newId);
 
+      /**
+       * counter of the modifications of the graph, incremented whenever a vertex or an edge is added
+       * or removed. Allows to detect that the structure of the graph did not change.
+       */
+      size_t revision() const { return _revision;}
+
     protected:
       VertexIDMap _vertices;
       EdgeSet _edges;
+      size_t _revision;
 
     private:
       // Disable the copy constructor and assignment operator
@@ -86,4 +86,30 @@ void JacobianWorkspace::updateSize(int numVertices, int dimension)
   _maxDimension = max(dimension, _maxDimension);
 }
 
+int JacobianWorkspace::externalSize(const HyperGraph::Edge* e_)
+{
+  const OptimizableGraph::Edge* e = static_cast<const OptimizableGraph::Edge*>(e_);
+  int size = 0;
+  for (size_t i = 0; i < e->vertices().size(); ++i) {
+    const OptimizableGraph::Vertex* v = static_cast<const OptimizableGraph::Vertex*>(e->vertex(i));
+    size += v->dimension() * e->dimension();
+  }
+  return size;
+}
+
+void JacobianWorkspace::mapExternal(const HyperGraph::Edge* e_, double* memory)
+{
+  if (! memory) {
+    _external.clear();
+    return;
+  }
+  const OptimizableGraph::Edge* e = static_cast<const OptimizableGraph::Edge*>(e_);
+  _external.resize(e->vertices().size());
+  for (size_t i = 0; i < e->vertices().size(); ++i) {
+    const OptimizableGraph::Vertex* v = static_cast<const OptimizableGraph::Vertex*>(e->vertex(i));
+    _external[i] = memory;
+    memory += v->dimension() * e->dimension();
+  }
+}
+
 } // end namespace
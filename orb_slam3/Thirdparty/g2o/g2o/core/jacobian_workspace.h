@@ -81,12 +81,29 @@ namespace g2o {
        */
       double* workspaceForVertex(int vertexIndex)
       {
+        if (! _external.empty()) {
+          assert(vertexIndex >= 0 && (size_t)vertexIndex < _external.size() && "Index out of bounds");
+          return _external[vertexIndex];
+        }
         assert(vertexIndex >= 0 && (size_t)vertexIndex < _workspace.size() && "Index out of bounds");
         return _workspace[vertexIndex].data();
       }
 
+      /**
+       * number of elements needed to keep all the Jacobians of the edge, see mapExternal()
+       */
+      static int externalSize(const HyperGraph::Edge* e);
+
+      /**
+       * let the workspace point to external memory instead of the pre-allocated one, e.g., to keep
+       * the Jacobians of an edge until its quadratic form is built. The memory holds the Jacobians
+       * of the vertices of e one after another (externalSize() elements). Passing 0 switches back.
+       */
+      void mapExternal(const HyperGraph::Edge* e, double* memory);
+
     protected:
       WorkspaceVector _workspace;   ///< the memory pre-allocated for computing the Jacobians
+      std::vector<double*> _external; ///< Jacobians of the vertices if mapped to external memory
       int _maxNumVertices;          ///< the maximum number of vertices connected by a hyper-edge
       int _maxDimension;            ///< the maximum dimension (number of elements) for a Jacobian
   };
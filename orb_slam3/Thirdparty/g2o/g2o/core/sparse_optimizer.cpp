@@ -38,6 +38,7 @@
 #include "batch_stats.h"
 #include "hyper_graph_action.h"
 #include "robust_kernel.h"
+#include "thread_pool.h"
 #include "../stuff/timeutil.h"
 #include "../stuff/macros.h"
 #include "../stuff/misc.h"
@@ -48,7 +49,7 @@ namespace g2o{
 
 
   SparseOptimizer::SparseOptimizer() :
-    _forceStopFlag(0), _verbose(false), _algorithm(0), _computeBatchStatistics(false)
+    _forceStopFlag(0), _verbose(false), _numThreads(1), _algorithm(0), _computeBatchStatistics(false)
   {
     _graphActions.resize(AT_NUM_ELEMENTS);
   }
@@ -67,12 +68,20 @@ namespace g2o{
         (*(*it))(this);
     }
 
-#   ifdef G2O_OPENMP
-#   pragma omp parallel for default (shared) if (_activeEdges.size() > 50)
-#   endif
-    for (int k = 0; k < static_cast<int>(_activeEdges.size()); ++k) {
-      OptimizableGraph::Edge* e = _activeEdges[k];
-      e->computeError();
+    if (_numThreads > 1) {
+      ThreadPool::global().parallelFor(static_cast<int>(_activeEdges.size()), _numThreads, 64,
+          [this](int begin, int end, int) {
+            for (int k = begin; k < end; ++k)
+              _activeEdges[k]->computeError();
+          });
+    } else {
+#     ifdef G2O_OPENMP
+#     pragma omp parallel for default (shared) if (_activeEdges.size() > 50)
+#     endif
+      for (int k = 0; k < static_cast<int>(_activeEdges.size()); ++k) {
+        OptimizableGraph::Edge* e = _activeEdges[k];
+        e->computeError();
+      }
     }
 
 #  ifndef NDEBUG
@@ -493,6 +502,13 @@ namespace g2o{
     OptimizableGraph::clear();
   }
 
+  void SparseOptimizer::releaseAll() {
+    _ivMap.clear();
+    _activeVertices.clear();
+    _activeEdges.clear();
+    OptimizableGraph::releaseAll();
+  }
+
   SparseOptimizer::VertexContainer::const_iterator SparseOptimizer::findActiveVertex(const OptimizableGraph::Vertex* v) const
   {
     VertexContainer::const_iterator lower = lower_bound(_activeVertices.begin(), _activeVertices.end(), v, VertexIDCompare());
@@ -558,6 +574,11 @@ namespace g2o{
     _verbose = verbose;
   }
 
+  void SparseOptimizer::setNumThreads(int numThreads)
+  {
+    _numThreads = numThreads > 1 ? numThreads : 1;
+  }
+
   void SparseOptimizer::setAlgorithm(OptimizationAlgorithm* algorithm)
   {
     if (_algorithm) // reset the optimizer for the formerly used solver
@@ -576,14 +597,14 @@ namespace g2o{
     _forceStopFlag=flag;
   }
 
-  bool SparseOptimizer::removeVertex(HyperGraph::Vertex* v)
+  bool SparseOptimizer::releaseVertex(HyperGraph::Vertex* v)
   {
     OptimizableGraph::Vertex* vv = static_cast<OptimizableGraph::Vertex*>(v);
     if (vv->hessianIndex() >= 0) {
       clearIndexMapping();
       _ivMap.clear();
     }
-    return HyperGraph::removeVertex(v);
+    return HyperGraph::releaseVertex(v);
   }
 
   bool SparseOptimizer::addComputeErrorAction(HyperGraphAction* action)
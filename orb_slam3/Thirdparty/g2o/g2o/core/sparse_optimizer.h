@@ -178,6 +178,14 @@ namespace g2o {
     bool verbose()  const {return _verbose;}
     void setVerbose(bool verbose);
 
+    /**
+     * number of threads used to compute the errors, the Jacobians and the Schur complement
+     * (1 = serial). Only use more than one thread if all the edges compute their Jacobians
+     * analytically, the numeric differentiation temporarily modifies the vertices.
+     */
+    int numThreads() const { return _numThreads;}
+    void setNumThreads(int numThreads);
+
     /**
      * sets a variable checked at every iteration to force a user stop. The iteration exits when the variable is true;
      */
@@ -195,12 +203,12 @@ namespace g2o {
     const EdgeContainer& activeEdges() const { return _activeEdges;}
 
     /**
-     * Remove a vertex. If the vertex is contained in the currently active set
+     * Remove or release a vertex. If the vertex is contained in the currently active set
      * of vertices, then the internal temporary structures are cleaned, e.g., the index
      * mapping is erased. In case you need the index mapping for manipulating the
      * graph, you have to store it in your own copy.
      */
-    virtual bool removeVertex(HyperGraph::Vertex* v);
+    virtual bool releaseVertex(HyperGraph::Vertex* v);
 
     /**
      * search for an edge in _activeVertices and return the iterator pointing to it
@@ -243,6 +251,8 @@ namespace g2o {
      * with clearParameters().
      */
     virtual void clear();
+    //! like clear(), without deleting the vertices and edges, see HyperGraph::releaseAll()
+    virtual void releaseAll();
 
     /**
      * computes the error vectors of all edges in the activeSet, and caches them
@@ -289,6 +299,7 @@ namespace g2o {
     protected:
     bool* _forceStopFlag;
     bool _verbose;
+    int _numThreads;
 
     VertexContainer _ivMap;
     VertexContainer _activeVertices;   ///< sorted according to VertexIDCompare
@@ -0,0 +1,124 @@
+// g2o - General Graph Optimization
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace g2o {
+
+ThreadPool::ThreadPool() :
+  _generation(0), _stop(false), _job(0), _n(0), _grain(1), _helpers(0), _running(0), _next(0)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+  for (size_t i = 0; i < _workers.size(); ++i)
+    _workers[i].join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::reserve(int numWorkers)
+{
+  // called with _callMutex held, so _generation is stable and a new worker waits for the next job
+  while (static_cast<int>(_workers.size()) < numWorkers) {
+    int index = static_cast<int>(_workers.size()) + 1;
+    _workers.push_back(std::thread(&ThreadPool::workerLoop, this, index, _generation));
+  }
+}
+
+void ThreadPool::parallelFor(int n, int numThreads, int grain, const RangeFunction& f)
+{
+  if (n <= 0)
+    return;
+  grain = std::max(grain, 1);
+  numThreads = std::min(numThreads, (n + grain - 1) / grain);
+
+  std::unique_lock<std::mutex> callLock(_callMutex, std::defer_lock);
+  if (numThreads <= 1 || ! callLock.try_lock()) {
+    f(0, n, 0);
+    return;
+  }
+
+  reserve(numThreads - 1);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = &f;
+    _n = n;
+    _grain = grain;
+    _helpers = numThreads - 1;
+    _running = _helpers;
+    _next.store(0);
+    ++_generation;
+  }
+  _wake.notify_all();
+
+  runChunks(0);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _done.wait(lock, [this] { return _running == 0; });
+  _job = 0;
+}
+
+void ThreadPool::workerLoop(int index, unsigned long generation)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (;;) {
+    _wake.wait(lock, [&] { return _stop || _generation != generation; });
+    if (_stop)
+      return;
+    generation = _generation;
+    if (index > _helpers)
+      continue;
+    lock.unlock();
+    runChunks(index);
+    lock.lock();
+    if (--_running == 0)
+      _done.notify_one();
+  }
+}
+
+void ThreadPool::runChunks(int thread)
+{
+  const RangeFunction& f = *_job;
+  for (;;) {
+    int begin = _next.fetch_add(_grain);
+    if (begin >= _n)
+      break;
+    f(begin, std::min(begin + _grain, _n), thread);
+  }
+}
+
+} // end namespace
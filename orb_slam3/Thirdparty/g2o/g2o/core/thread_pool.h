@@ -0,0 +1,93 @@
+// g2o - General Graph Optimization
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef G2O_THREAD_POOL_H
+#define G2O_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace g2o {
+
+  /**
+   * \brief persistent worker threads for the parallel parts of the optimization
+   *
+   * parallelFor() splits a range into chunks which are processed by the calling thread
+   * and by the workers. Only one parallelFor() runs at a time, a concurrent call (e.g., from
+   * a second optimizer in another thread) processes its range serially instead of waiting.
+   */
+  class ThreadPool
+  {
+    public:
+      //! processes the elements [begin, end), thread is in [0, numThreads) and 0 for the caller
+      typedef std::function<void(int begin, int end, int thread)> RangeFunction;
+
+    public:
+      ThreadPool();
+      ~ThreadPool();
+
+      //! the pool shared by all optimizers, workers are started on demand
+      static ThreadPool& global();
+
+      /**
+       * process [0, n) in chunks of grain elements with up to numThreads threads (including the caller).
+       * Returns after all elements have been processed.
+       */
+      void parallelFor(int n, int numThreads, int grain, const RangeFunction& f);
+
+      //! number of worker threads started so far
+      int numWorkers() const { return static_cast<int>(_workers.size()); }
+
+    protected:
+      void reserve(int numWorkers);
+      void workerLoop(int index, unsigned long generation);
+      void runChunks(int thread);
+
+      std::vector<std::thread> _workers;
+      std::mutex _callMutex;              ///< serializes parallelFor()
+      std::mutex _mutex;                  ///< protects the job description below
+      std::condition_variable _wake;
+      std::condition_variable _done;
+      unsigned long _generation;          ///< incremented for every job
+      bool _stop;
+
+      const RangeFunction* _job;
+      int _n;
+      int _grain;
+      int _helpers;                       ///< workers 1.._helpers take part in the current job
+      int _running;                       ///< helpers which did not finish the current job yet
+      std::atomic<int> _next;
+
+    private:
+      ThreadPool(const ThreadPool&);
+      void operator=(const ThreadPool&);
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,199 @@
+// g2o - General Graph Optimization
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+// IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+// TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+// LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef G2O_LINEAR_SOLVER_CHOLMOD_H
+#define G2O_LINEAR_SOLVER_CHOLMOD_H
+
+#include <cholmod.h>
+
+#include "../core/linear_solver.h"
+#include "../core/batch_stats.h"
+#include "../stuff/timeutil.h"
+
+#include "../core/eigen_types.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace g2o {
+
+/**
+ * \brief linear solver which uses the supernodal sparse Cholesky decomposition of CHOLMOD
+ *
+ * The fill-reducing ordering (AMD or METIS) and the symbolic decomposition are computed once
+ * after init() and re-used for all the following iterations, as the pattern of A does not change.
+ * If CHOLMOD is built without METIS, the METIS ordering falls back to AMD.
+ */
+template <typename MatrixType>
+class LinearSolverCholmod : public LinearSolver<MatrixType>
+{
+  public:
+    enum Ordering { AMD, METIS };
+
+  public:
+    LinearSolverCholmod() :
+      LinearSolver<MatrixType>(),
+      _init(true), _ordering(AMD), _writeDebug(false), _factor(0)
+    {
+      cholmod_start(&_common);
+      _common.supernodal = CHOLMOD_SUPERNODAL;
+      _common.print = 0;
+      memset(&_sparse, 0, sizeof(_sparse));
+    }
+
+    virtual ~LinearSolverCholmod()
+    {
+      if (_factor)
+        cholmod_free_factor(&_factor, &_common);
+      cholmod_finish(&_common);
+    }
+
+    virtual bool init()
+    {
+      _init = true;
+      return true;
+    }
+
+    bool solve(const SparseBlockMatrix<MatrixType>& A, double* x, double* b)
+    {
+      if (_init) {
+        fillSparseMatrix(A, false);
+        if (! computeSymbolicDecomposition())
+          return false;
+        _init = false;
+      } else {
+        fillSparseMatrix(A, true);
+      }
+
+      double t=get_monotonic_time();
+      cholmod_factorize(&_sparse, _factor, &_common);
+      if (_common.status == CHOLMOD_NOT_POSDEF || _factor->minor < _factor->n) { // the matrix is not positive definite
+        if (_writeDebug) {
+          std::cerr << "Cholesky failure, writing debug.txt (Hessian loadable by Octave)" << std::endl;
+          A.writeOctave("debug.txt");
+        }
+        return false;
+      }
+
+      // Solving the system
+      cholmod_dense bb;
+      memset(&bb, 0, sizeof(bb));
+      bb.nrow = bb.nzmax = bb.d = _sparse.nrow;
+      bb.ncol = 1;
+      bb.x = b;
+      bb.xtype = CHOLMOD_REAL;
+      bb.dtype = CHOLMOD_DOUBLE;
+      cholmod_dense* xx = cholmod_solve(CHOLMOD_A, _factor, &bb, &_common);
+      if (! xx)
+        return false;
+      memcpy(x, xx->x, _sparse.nrow * sizeof(double));
+      cholmod_free_dense(&xx, &_common);
+
+      G2OBatchStatistics* globalStats = G2OBatchStatistics::globalStats();
+      if (globalStats) {
+        globalStats->timeNumericDecomposition = get_monotonic_time() - t;
+        globalStats->choleskyNNZ = static_cast<size_t>(_common.lnz);
+      }
+
+      return true;
+    }
+
+    //! the fill-reducing ordering used by the next symbolic decomposition
+    Ordering ordering() const { return _ordering;}
+    void setOrdering(Ordering ordering) { _ordering = ordering;}
+
+    //! write a debug dump of the system matrix if it is not SPD in solve
+    virtual bool writeDebug() const { return _writeDebug;}
+    virtual void setWriteDebug(bool b) { _writeDebug = b;}
+
+  protected:
+    bool _init;
+    Ordering _ordering;
+    bool _writeDebug;
+    cholmod_common _common;
+    cholmod_factor* _factor;
+    cholmod_sparse _sparse;       ///< upper triangle of A, pointing to the vectors below
+    std::vector<int> _colPtr;
+    std::vector<int> _rowInd;
+    std::vector<double> _values;
+
+    bool computeSymbolicDecomposition()
+    {
+      double t=get_monotonic_time();
+      if (_factor)
+        cholmod_free_factor(&_factor, &_common);
+
+      _common.nmethods = 1;
+      _common.method[0].ordering = _ordering == METIS ? CHOLMOD_METIS : CHOLMOD_AMD;
+      _common.postorder = 1;
+      _factor = cholmod_analyze(&_sparse, &_common);
+      if (! _factor && _ordering == METIS) {
+        std::cerr << "LinearSolverCholmod: METIS ordering not available, using AMD" << std::endl;
+        _common.method[0].ordering = CHOLMOD_AMD;
+        _factor = cholmod_analyze(&_sparse, &_common);
+      }
+      if (! _factor) {
+        std::cerr << "LinearSolverCholmod: symbolic decomposition failed" << std::endl;
+        return false;
+      }
+
+      G2OBatchStatistics* globalStats = G2OBatchStatistics::globalStats();
+      if (globalStats)
+        globalStats->timeSymbolicDecomposition = get_monotonic_time() - t;
+      return true;
+    }
+
+    void fillSparseMatrix(const SparseBlockMatrix<MatrixType>& A, bool onlyValues)
+    {
+      if (onlyValues) {
+        A.fillCCS(&_values[0], true);
+        return;
+      }
+
+      _colPtr.resize(A.cols() + 1);
+      _rowInd.resize(A.nonZeros());
+      _values.resize(A.nonZeros());
+      int nz = A.fillCCS(&_colPtr[0], &_rowInd[0], &_values[0], true);
+
+      _sparse.nrow = A.rows();
+      _sparse.ncol = A.cols();
+      _sparse.nzmax = nz;
+      _sparse.p = &_colPtr[0];
+      _sparse.i = &_rowInd[0];
+      _sparse.nz = 0;
+      _sparse.x = &_values[0];
+      _sparse.z = 0;
+      _sparse.stype = 1; // upper triangle
+      _sparse.itype = CHOLMOD_INT;
+      _sparse.xtype = CHOLMOD_REAL;
+      _sparse.dtype = CHOLMOD_DOUBLE;
+      _sparse.sorted = 1;
+      _sparse.packed = 1;
+    }
+};
+
+} // end namespace
+
+#endif
@@ -42,6 +42,7 @@ class KeyFrame;
 class ConstraintPoseImu;
 class GeometricCamera;
 class ORBextractor;
+class WorkerPool;
 
 class Frame
 {
@@ -100,6 +101,19 @@ public:
     // and fill variables of the MapPoint to be used by the tracking
     bool isInFrustum(MapPoint* pMP, float viewingCosLimit);
 
+    // Caller-owned buffers of the batched isInFrustum, kept from frame to frame
+    struct FrustumBuffers
+    {
+        std::vector<MapPoint*> vpMPs;                                   // points to check, filled by the caller
+        std::vector<float> vPx, vPy, vPz, vNx, vNy, vNz;                // world position and normal
+        std::vector<float> vMinDist, vMaxDist;                          // mfMinDistance, mfMaxDistance
+        std::vector<float> vPcx, vPcy, vPcz, vDist, vViewCos;           // camera coordinates, distance to and view cos from mOw
+    };
+
+    // isInFrustum for all buffers.vpMPs (frames with Nleft == -1): the point data is read with one lock per point and
+    // transformed in one pass over flat arrays. Sets the same MapPoint variables, mbTrackInView tells the result.
+    void isInFrustum(FrustumBuffers &buffers, float viewingCosLimit);
+
     bool ProjectPointDistort(MapPoint* pMP, cv::Point2f &kp, float &u, float &v);
 
     cv::Mat inRefCoordinates(cv::Mat pCw);
@@ -109,6 +123,9 @@ public:
 
     vector<size_t> GetFeaturesInArea(const float &x, const float  &y, const float  &r, const int minLevel=-1, const int maxLevel=-1, const bool bRight = false) const;
 
+    // Same search on the flat grid, into vIndices (cleared first, capacity kept). Returns the number of features.
+    int GetFeaturesInArea(const float &x, const float &y, const float &r, const int minLevel, const int maxLevel, const bool bRight, vector<int> &vIndices) const;
+
     // Search a match for each keypoint in the left image to a keypoint in the right image.
     // If there is a match, depth is computed and the right coordinate associated to the left keypoint is stored.
     void ComputeStereoMatches();
@@ -188,6 +205,17 @@ public:
     static float mfGridElementHeightInv;
     std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
 
+    // mGrid/mGridRight in flat arrays: cell (i,j) holds the entries [vStart[c],vStart[c+1]) with c=i*FRAME_GRID_ROWS+j,
+    // keypoint coordinates and octave are stored next to the index
+    struct FlatGrid
+    {
+        std::vector<int> vStart;
+        std::vector<int> vIdx;
+        std::vector<float> vX, vY;
+        std::vector<int> vOctave;
+    };
+    FlatGrid mFlatGrid, mFlatGridRight;
+
 
     // Camera pose.
     cv::Mat mTcw;
@@ -216,6 +244,10 @@ public:
     static long unsigned int nNextId;
     long unsigned int mnId;
 
+    // Runs the left and right extraction of the stereo constructors, set by the Tracking. Without one, a thread is
+    // spawned per image.
+    static WorkerPool* mpStereoPool;
+
     // Reference Keyframe.
     KeyFrame* mpReferenceKF;
 
@@ -260,6 +292,7 @@ private:
 
     // Assign keypoints to the grid for speed up feature matching (called in the constructor).
     void AssignFeaturesToGrid();
+    void BuildFlatGrid(const bool bRight);
 
     // Rotation, translation and camera center
     cv::Mat mRcw;
@@ -0,0 +1,120 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Thirdparty
+#include "Thirdparty/g2o/g2o/core/sparse_optimizer.h"
+
+namespace ORB_SLAM3 {
+
+// Arena for the vertices and edges of one optimization
+//
+// The graph objects of an optimization are created with New() in large blocks instead of one heap allocation each,
+// and are all destroyed by Reset() after the solve, which makes the whole memory available again at once. The blocks
+// are kept, so a warmed-up arena does not allocate. Every vertex and edge added to the optimizer must come from the
+// arena (robust kernels stay on the heap, the edges delete them).
+//
+// Typical use, with the scope declared after the optimizer so that it resets the arena before the optimizer is
+// destroyed:
+//
+//     g2o::SparseOptimizer optimizer;
+//     G2oArena &arena = G2oArena::ThreadArena();
+//     G2oArena::Scope arenaScope(arena, optimizer);
+//     VertexPose* VP = arena.New<VertexPose>(pKF);
+class G2oArena
+{
+public:
+    struct Stats
+    {
+        size_t nObjects;        // objects created since the last reset
+        size_t nBytes;          // bytes used since the last reset
+        size_t nPeakBytes;      // highest nBytes
+        size_t nCapacity;       // bytes of the blocks owned by the arena
+        size_t nBlocks;
+        size_t nTotalObjects;   // objects created by the arena
+        size_t nResets;
+    };
+
+    explicit G2oArena(size_t nBlockSize = 1 << 20);
+    ~G2oArena();
+
+    // Arena of the calling thread
+    static G2oArena& ThreadArena();
+
+    template<typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        void* pMemory = Allocate(sizeof(T), alignof(T));
+        T* pObject = ::new(pMemory) T(std::forward<Args>(args)...);
+        mvpObjects.push_back(pObject);
+        return pObject;
+    }
+
+    // Empties optimizer without deleting its vertices and edges, then destroys all the objects created since the last
+    // reset. The memory of the blocks is reused from the start.
+    void Reset(g2o::SparseOptimizer &optimizer);
+
+    const Stats& GetStats() const { return mStats; }
+
+    // Resets the arena at the end of the scope
+    class Scope
+    {
+    public:
+        Scope(G2oArena &arena, g2o::SparseOptimizer &optimizer);
+        ~Scope();
+
+    private:
+        G2oArena &mArena;
+        g2o::SparseOptimizer &mOptimizer;
+    };
+
+protected:
+    struct Block
+    {
+        char* pData;
+        size_t nSize;
+    };
+
+    void* Allocate(size_t nSize, size_t nAlign);
+
+    const size_t mnBlockSize;
+    std::vector<Block> mvBlocks;
+    size_t mnBlock;     // block in use
+    size_t mnOffset;    // first free byte in the block in use
+    std::vector<g2o::HyperGraph::HyperGraphElement*> mvpObjects;
+    bool mbInScope;
+    Stats mStats;
+
+private:
+    G2oArena(const G2oArena&);
+    G2oArena& operator=(const G2oArena&);
+};
+
+} //end ns
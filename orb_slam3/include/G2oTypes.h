@@ -502,6 +502,18 @@ public:
     void computeError();
     virtual void linearizeOplus();
 
+    Eigen::Matrix<double,9,24> GetJacobian(){
+        linearizeOplus();
+        Eigen::Matrix<double,9,24> J;
+        J.block<9,6>(0,0) = _jacobianOplus[0];
+        J.block<9,3>(0,6) = _jacobianOplus[1];
+        J.block<9,3>(0,9) = _jacobianOplus[2];
+        J.block<9,3>(0,12) = _jacobianOplus[3];
+        J.block<9,6>(0,15) = _jacobianOplus[4];
+        J.block<9,3>(0,21) = _jacobianOplus[5];
+        return J;
+    }
+
     Eigen::Matrix<double,24,24> GetHessian(){
         linearizeOplus();
         Eigen::Matrix<double,9,24> J;
@@ -757,6 +769,16 @@ public:
         void computeError();
         virtual void linearizeOplus();
 
+        Eigen::Matrix<double,15,15> GetJacobian(){
+            linearizeOplus();
+            Eigen::Matrix<double,15,15> J;
+            J.block<15,6>(0,0) = _jacobianOplus[0];
+            J.block<15,3>(0,6) = _jacobianOplus[1];
+            J.block<15,3>(0,9) = _jacobianOplus[2];
+            J.block<15,3>(0,12) = _jacobianOplus[3];
+            return J;
+        }
+
         Eigen::Matrix<double,15,15> GetHessian(){
             linearizeOplus();
             Eigen::Matrix<double,15,15> J;
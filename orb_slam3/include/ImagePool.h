@@ -0,0 +1,79 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+// Thirdparty
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM3 {
+
+// Recycling allocator for frame images
+//
+// Mats created by Copy() use this allocator: they are refcounted as usual, and the buffer returns to the pool once the
+// last Mat referencing it is released (e.g. the Frame was not promoted to a KeyFrame) instead of being freed. Frames
+// and KeyFrames share the same buffer. Stats count the copies (each was a clone, i.e. a malloc, before) against the
+// buffers that actually had to be allocated.
+class ImagePool : public cv::MatAllocator
+{
+public:
+    struct Stats {
+        size_t nCopies = 0;
+        size_t nAllocations = 0;
+        size_t nBytesAllocated = 0;                                                                 // total, including recycled buffers
+        size_t nBytesPooled = 0;                                                                    // currently unused
+    };
+
+#if CV_VERSION_MAJOR >= 4
+    using AccessFlagType = cv::AccessFlag;
+#else
+    using AccessFlagType = int;
+#endif
+
+public:
+    static ImagePool* GetInstance();
+
+    cv::Mat Copy(const cv::Mat &im);
+    Stats GetStats();
+
+    // cv::MatAllocator
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           AccessFlagType flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* u, AccessFlagType accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* u) const override;
+
+protected:
+    ImagePool(size_t nMaxPooledBytes);
+
+    const size_t mnMaxPooledBytes;
+    mutable std::multimap<size_t,uchar*> mmFreeBuffers;                                            // size -> buffer
+    mutable Stats mStats;
+    mutable std::mutex mMutex;
+};
+
+} //end ns
@@ -31,6 +31,7 @@
 
 #include "GeometricCamera.h"
 
+#include <atomic>
 #include <mutex>
 
 #include <boost/serialization/base_object.hpp>
@@ -265,7 +266,9 @@ public:
     static double img_width;
     static double img_height;
 
-    bool sent_once_ = false;
+    bool sent_once_ = false;                // comm thread only
+    bool passed_to_comm_ = false;           // LocalMapping only - later passes are queued as updates
+    std::atomic<bool> update_queued_{false};// an update of the KF waits in the comm - further ones are coalesced into it
     //Msg creation
     auto ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame* kf_ref, bool is_update, size_t cliend_id)->void;
     auto ConvertPreintegrationToMsg(covins::PreintegrationData &data)->void;
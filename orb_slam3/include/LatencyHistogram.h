@@ -0,0 +1,58 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+// Latency histogram with fixed bucket edges
+//
+// Add() is cheap enough to run for every frame and may be called from several threads. Percentiles are reported as
+// the upper edge of the bucket they fall into, the mean and max are exact.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram(const std::string &name);
+
+    void Add(double ms);
+    void Print(std::ostream &out);
+
+protected:
+    double Percentile(double p);                                                                    // needs mMutex
+
+    const std::string mName;
+    std::vector<double> mvEdges;                                                                    // upper edges [ms]
+    std::vector<size_t> mvCounts;                                                                   // +1 overflow bucket
+    size_t mnSamples;
+    double mdSum;
+    double mdMax;
+    std::mutex mMutex;
+};
+
+} //end ns
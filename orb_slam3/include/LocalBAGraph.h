@@ -0,0 +1,129 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <unordered_map>
+#include <vector>
+
+// Thirdparty
+#include "Thirdparty/g2o/g2o/core/sparse_optimizer.h"
+#include "Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"
+
+#include "OptimizableTypes.h"
+
+namespace ORB_SLAM3 {
+
+// g2o graph of the visual local BA that persists between calls
+//
+// Consecutive local windows share most of their keyframes and map points. Instead of rebuilding the graph,
+// Optimizer::LocalBundleAdjustment adds the vertices and edges of the current window between BeginWindow() and
+// EndWindow(): the ones already present are returned as they are (the caller refreshes their estimate and
+// measurement), the missing ones are created, and EndWindow() removes what was not added again. Removed vertices
+// and edges go to pools and are reused by the following windows. The solver persists with the graph, so if the
+// structure did not change the block solver also keeps its matrices and the symbolic factorization (see
+// g2o::BlockSolver::buildStructure()).
+//
+// Vertices are identified by the ids of the keyframes and map points only, the graph does not keep pointers to them.
+// Used by the local mapping thread only.
+class LocalBAGraph
+{
+public:
+    LocalBAGraph();
+    ~LocalBAGraph();
+
+    g2o::SparseOptimizer& GetOptimizer() { return mOptimizer; }
+
+    static int KeyFrameVertexId(unsigned long nKFId) { return static_cast<int>(2*nKFId); }
+    static int MapPointVertexId(unsigned long nMPId) { return static_cast<int>(2*nMPId+1); }
+
+    void BeginWindow();
+
+    // Vertices are added not fixed. Map point vertices are marginalized.
+    g2o::VertexSE3Expmap* AddKeyFrame(unsigned long nKFId);
+    g2o::VertexSBAPointXYZ* AddMapPoint(unsigned long nMPId);
+
+    // The map point and the keyframe must have been added in this window. New edges come with a Huber kernel.
+    EdgeSE3ProjectXYZ* AddMonoEdge(unsigned long nMPId, unsigned long nKFId);
+    EdgeSE3ProjectXYZToBody* AddBodyEdge(unsigned long nMPId, unsigned long nKFId);
+    g2o::EdgeStereoSE3ProjectXYZ* AddStereoEdge(unsigned long nMPId, unsigned long nKFId);
+
+    void EndWindow();
+
+    // Drops the whole graph (the pools are kept)
+    void Clear();
+
+    // Statistics of the last window
+    int mnReusedVertices, mnNewVertices, mnRemovedVertices;
+    int mnReusedEdges, mnNewEdges, mnRemovedEdges;
+
+protected:
+    enum eEdgeType
+    {
+        EDGE_MONO=0,
+        EDGE_BODY,
+        EDGE_STEREO
+    };
+
+    struct EdgeEntry
+    {
+        g2o::OptimizableGraph::Edge* pEdge;
+        unsigned long nKFId;
+        eEdgeType type;
+        unsigned long nWindow;
+    };
+
+    struct KeyFrameEntry
+    {
+        g2o::VertexSE3Expmap* pVertex;
+        unsigned long nWindow;
+    };
+
+    struct MapPointEntry
+    {
+        g2o::VertexSBAPointXYZ* pVertex;
+        unsigned long nWindow;
+        std::vector<EdgeEntry> vEdges;
+    };
+
+    template<typename EdgeType>
+    EdgeType* AddEdge(unsigned long nMPId, unsigned long nKFId, eEdgeType type, std::vector<EdgeType*> &vpFree);
+
+    void ReleaseEdge(const EdgeEntry &entry);
+
+    g2o::SparseOptimizer mOptimizer;
+
+    unsigned long mnWindow;
+    std::unordered_map<unsigned long,KeyFrameEntry> mmKeyFrames;
+    std::unordered_map<unsigned long,MapPointEntry> mmMapPoints;
+
+    // Pools of the vertices and edges removed from the graph
+    std::vector<g2o::VertexSE3Expmap*> mvpFreeKeyFrameVertices;
+    std::vector<g2o::VertexSBAPointXYZ*> mvpFreeMapPointVertices;
+    std::vector<EdgeSE3ProjectXYZ*> mvpFreeMonoEdges;
+    std::vector<EdgeSE3ProjectXYZToBody*> mvpFreeBodyEdges;
+    std::vector<g2o::EdgeStereoSE3ProjectXYZ*> mvpFreeStereoEdges;
+};
+
+} //end ns
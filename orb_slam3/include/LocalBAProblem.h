@@ -0,0 +1,53 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <string>
+#include <vector>
+
+// Thirdparty
+#include "Thirdparty/g2o/g2o/core/sparse_optimizer.h"
+
+namespace ORB_SLAM3 {
+
+class GeometricCamera;
+
+// Text dump of a visual local BA problem
+//
+// Stores the vertices and the mono, stereo and right camera (body) projection edges of the g2o graph built by
+// Optimizer::LocalBundleAdjustment, so that recorded problems can be replayed offline (Examples/Benchmark/
+// local_ba_bench). Edges are written in the order of optimizer.activeEdges(), i.e. Save() expects an initialized
+// optimization, and Load() rebuilds the graph in the same order. Information matrices are assumed isotropic.
+class LocalBAProblem
+{
+public:
+    static bool Save(const std::string &strFile, const g2o::SparseOptimizer &optimizer);
+
+    // optimizer needs an algorithm already. The cameras referenced by the edges are appended to vpCameras and owned
+    // by the caller.
+    static bool Load(const std::string &strFile, g2o::SparseOptimizer &optimizer, std::vector<GeometricCamera*> &vpCameras);
+};
+
+} //end ns
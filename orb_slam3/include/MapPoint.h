@@ -88,6 +88,8 @@ public:
     void ComputeDistinctiveDescriptors();
 
     cv::Mat GetDescriptor();
+    // 32 bytes, without allocating
+    void GetDescriptor(uchar* desc);
 
     void UpdateNormalAndDepth();
     void SetNormalVector(cv::Mat& normal);
@@ -97,6 +99,9 @@ public:
     int PredictScale(const float &currentDist, KeyFrame*pKF);
     int PredictScale(const float &currentDist, Frame* pF);
 
+    // Position, normal and mfMinDistance/mfMaxDistance under one lock, for Frame::isInFrustum on many points
+    void GetProjectionData(cv::Matx31f &Pos, cv::Matx31f &Normal, float &minDistance, float &maxDistance);
+
     Map* GetMap();
     void UpdateMap(Map* pMap);
 
@@ -21,8 +21,11 @@
 
 #include <vector>
 #include <list>
+#include <memory>
 #include <opencv2/opencv.hpp>
 
+#include "WorkerPool.h"
+
 
 namespace ORB_SLAM3
 {
@@ -46,8 +49,18 @@ public:
     
     enum {HARRIS_SCORE=0, FAST_SCORE=1 };
 
+    // Wall time of the stages of the last extraction [ms]
+    struct StageTimes {
+        double pyramid = 0.0;
+        double fast = 0.0;                  // FAST over the grid cells of all levels
+        double distribute = 0.0;            // octree distribution and orientation
+        double descriptors = 0.0;           // blur and rBRIEF
+    };
+
+    // With nThreads>1, FAST (per cell row), distribution, orientation and descriptors (per level) run on a persistent
+    // pool. The result is identical to the sequential extraction.
     ORBextractor(int nfeatures, float scaleFactor, int nlevels,
-                 int iniThFAST, int minThFAST);
+                 int iniThFAST, int minThFAST, int nThreads = 1);
 
     ~ORBextractor(){}
 
@@ -84,12 +97,27 @@ public:
         return mvInvLevelSigma2;
     }
 
+    int inline GetNumThreads(){
+        return mpPool->GetNumThreads();
+    }
+
+    // see WorkerPool::SetAffinity
+    int inline SetAffinity(const std::vector<int> &vCpus, int nFirst=0){
+        return mpPool->SetAffinity(vCpus,nFirst);
+    }
+
+    StageTimes inline GetStageTimes(){
+        return mStageTimes;
+    }
+
     std::vector<cv::Mat> mvImagePyramid;
 
 protected:
 
+    void AllocatePyramid(const cv::Size &imageSize);
     void ComputePyramid(cv::Mat image);
     void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> >& allKeypoints);    
+    void ComputeDescriptors(std::vector<std::vector<cv::KeyPoint> >& allKeypoints, std::vector<cv::Mat>& vDescriptors);
     std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint>& vToDistributeKeys, const int &minX,
                                            const int &maxX, const int &minY, const int &maxY, const int &nFeatures, const int &level);
 
@@ -110,6 +138,21 @@ protected:
     std::vector<float> mvInvScaleFactor;    
     std::vector<float> mvLevelSigma2;
     std::vector<float> mvInvLevelSigma2;
+
+    std::unique_ptr<WorkerPool> mpPool;
+    StageTimes mStageTimes;
+
+    // Pyramid arena: all levels incl. their borders in one buffer, allocated once per image size. mvImagePyramid
+    // holds the views without border.
+    cv::Mat mPyramidArena;
+    cv::Size mPyramidImageSize;
+    std::vector<cv::Mat> mvPyramidBordered;
+    std::vector<cv::Mat> mvBlurredPyramid;
+
+    // Scratch buffers, kept across calls
+    std::vector<std::vector<cv::KeyPoint> > mvvCellRowKeys;     // FAST output per (level, cell row)
+    std::vector<cv::Mat> mvLevelDescriptorBuffers;              // grown on demand
+    std::vector<cv::Mat> mvLevelDescriptors;                    // views into mvLevelDescriptorBuffers
 };
 
 } //namespace ORB_SLAM
@@ -41,9 +41,18 @@ public:
     // Computes the Hamming distance between two ORB descriptors
     static int DescriptorDistance(const cv::Mat &a, const cv::Mat &b);
 
+    // Caller-owned scratch of the local map search, reused from frame to frame so that the search does not allocate
+    struct SearchBuffers
+    {
+        std::vector<int> vIndices;          // keypoints in the search area
+        std::vector<int> vCandidates;       // ... that may be matched
+        std::vector<int> vDist;             // their descriptor distances
+    };
+
     // Search matches between Frame keypoints and projected MapPoints. Returns number of matches
     // Used to track the local map (Tracking)
     int SearchByProjection(Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float th=3, const bool bFarPoints = false, const float thFarPoints = 50.0f);
+    int SearchByProjection(Frame &F, const std::vector<MapPoint*> &vpMapPoints, SearchBuffers &buffers, const float th=3, const bool bFarPoints = false, const float thFarPoints = 50.0f);
 
     // Project MapPoints tracked in last frame into the current frame and search matches.
     // Used to track from previous frame (Tracking)
@@ -45,6 +45,7 @@ namespace ORB_SLAM3
 {
 
 class LoopClosing;
+class LocalBAGraph;
 
 class Optimizer
 {
@@ -128,6 +129,45 @@ public:
     void static InertialOptimization(Map *pMap, Eigen::Vector3d &bg, Eigen::Vector3d &ba, float priorG = 1e2, float priorA = 1e6);
     void static InertialOptimization(vector<KeyFrame*> vpKFs, Eigen::Vector3d &bg, Eigen::Vector3d &ba, float priorG = 1e2, float priorA = 1e6);
     void static InertialOptimization(Map *pMap, Eigen::Matrix3d &Rwg, double &scale);
+
+    // Threads for the edge linearization and the Schur complement of LocalBundleAdjustment and LocalInertialBA
+    // (1 = serial, results are identical for any number)
+    void static SetLocalBAThreads(int nThreads);
+    // Write every visual local BA problem to strDir as LocalBAProblem (for Examples/Benchmark/local_ba_bench)
+    void static SetLocalBARecordDir(const std::string &strDir);
+    // Keep the graph of the visual LocalBundleAdjustment between calls (LocalBAGraph) instead of building it again
+    // for every keyframe. Only for the local mapping thread.
+    void static SetIncrementalLocalBA(bool bIncremental);
+
+    // Sparse linear solver of the g2o optimizations, selectable per kind of optimization
+    enum eLinearSolver
+    {
+        LS_EIGEN=0,             // Eigen simplicial LDLT, AMD on the scalar matrix
+        LS_EIGEN_BLOCK_AMD=1,   // Eigen simplicial LDLT, AMD on the block structure
+        LS_CHOLMOD_AMD=2,       // CHOLMOD supernodal LLT, AMD (needs G2O_HAVE_CHOLMOD)
+        LS_CHOLMOD_METIS=3      // CHOLMOD supernodal LLT, METIS (needs G2O_HAVE_CHOLMOD)
+    };
+    enum eOptimization
+    {
+        OPT_LOCAL_BA=0,         // LocalBundleAdjustment, MergeBundleAdjustmentVisual
+        OPT_LOCAL_INERTIAL_BA,  // LocalInertialBA, MergeInertialBA
+        OPT_GLOBAL_BA,          // BundleAdjustment
+        OPT_FULL_INERTIAL_BA,   // FullInertialBA, InertialOptimization
+        OPT_ESSENTIAL_GRAPH,    // OptimizeEssentialGraph*
+        OPT_NUM
+    };
+    // strName is one of "eigen", "eigen_block_amd", "cholmod_amd", "cholmod_metis". Returns false (and keeps the
+    // current solver) if the name is unknown or CHOLMOD is not compiled in.
+    bool static SetLinearSolver(eOptimization opt, const std::string &strName);
+
+protected:
+    template<typename MatrixType>
+    static g2o::LinearSolver<MatrixType>* CreateLinearSolver(eOptimization opt);
+
+    static int mnLocalBAThreads;
+    static std::string mStrLocalBARecordDir;
+    static LocalBAGraph* mpLocalBAGraph;
+    static eLinearSolver meLinearSolver[OPT_NUM];
 };
 
 } //namespace ORB_SLAM3
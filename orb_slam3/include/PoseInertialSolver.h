@@ -0,0 +1,124 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <vector>
+
+// Thirdparty
+#include <Eigen/Core>
+#include "Thirdparty/g2o/g2o/core/jacobian_workspace.h"
+
+#include "PoseOnlySolver.h"
+
+namespace ORB_SLAM3 {
+
+class VertexPose;
+class VertexVelocity;
+class VertexGyroBias;
+class VertexAccBias;
+class EdgeInertial;
+class EdgeGyroRW;
+class EdgeAccRW;
+class EdgePriorPoseImu;
+
+// Pose-only optimization of the visual-inertial tracking, with the states of one or two frames
+//
+// Dedicated Gauss-Newton, with the same iterations as g2o::OptimizationAlgorithmGaussNewton, on D x D normal equations:
+//  - D==15: pose, velocity and biases of the current frame, the previous keyframe is fixed
+//  - D==30: the states of the previous frame at 0 and the ones of the current frame at 15, as the Hessian that
+//           PoseInertialOptimizationLastFrame marginalizes
+// Each block is [pose 6, velocity 3, gyro bias 3, acc bias 3]. The reprojection terms of the current frame are
+// PoseOnlyTerms, the few inertial edges are still evaluated by their g2o classes. The vertices and edges are owned by
+// the caller, the solver updates the vertex estimates.
+template<int D>
+class PoseInertialSolver
+{
+public:
+    typedef Eigen::Matrix<double,D,D> MatrixD;
+    typedef Eigen::Matrix<double,D,1> VectorD;
+
+    PoseInertialSolver();
+
+    // Solver of the calling thread
+    static PoseInertialSolver& ThreadSolver();
+
+    // Empties the terms and forgets the vertices and edges
+    void Clear();
+
+    PoseOnlyTerms& Terms() { return mTerms; }
+
+    // States of the current frame. Sets the cameras of the terms from the VertexPose.
+    void SetFrameVertices(VertexPose* VP, VertexVelocity* VV, VertexGyroBias* VG, VertexAccBias* VA);
+    // States of the previous frame, only optimized with D==30
+    void SetPreviousVertices(VertexPose* VPk, VertexVelocity* VVk, VertexGyroBias* VGk, VertexAccBias* VAk);
+
+    // Inertial edges between the previous and the current frame
+    void SetInertialEdges(EdgeInertial* ei, EdgeGyroRW* egr, EdgeAccRW* ear);
+    // Prior of the previous frame with a Huber kernel, only with D==30
+    void SetPrior(EdgePriorPoseImu* ep, double thHuber);
+
+    // Returns the number of iterations. The errors of the level 0 terms are the ones before the last update.
+    int Optimize(int nIterations);
+
+    // Errors of the terms at the current estimate, all of them or the level 1 ones
+    void ComputeErrors(bool bOnlyInactive=false);
+
+    bool IsDepthPositive(size_t i) const;
+
+    // J^T*Info*J of term i at the current estimate, as GetHessian() of EdgeMonoOnlyPose and EdgeStereoOnlyPose
+    PoseOnlyTerms::Matrix6d Hessian(size_t i) const;
+
+protected:
+    // Points the Jacobians of all the edges to the workspace, after it is (re)allocated
+    void MapJacobians();
+
+    // Pose of the body frame of the current frame, reference of the terms
+    void GetBodyPose(Eigen::Matrix3d &Rbw, Eigen::Vector3d &tbw) const;
+
+    // Offset of the current frame states
+    static const int mnFrame = D-15;
+
+    PoseOnlyTerms mTerms;
+
+    VertexPose* mpVP;
+    VertexVelocity* mpVV;
+    VertexGyroBias* mpVG;
+    VertexAccBias* mpVA;
+    VertexPose* mpVPk;
+    VertexVelocity* mpVVk;
+    VertexGyroBias* mpVGk;
+    VertexAccBias* mpVAk;
+
+    EdgeInertial* mpEI;
+    EdgeGyroRW* mpEGR;
+    EdgeAccRW* mpEAR;
+    EdgePriorPoseImu* mpEP;
+    double mthHuberPrior;
+
+    // Memory the Jacobians of the g2o edges map to
+    g2o::JacobianWorkspace mWorkspace;
+};
+
+} //end ns
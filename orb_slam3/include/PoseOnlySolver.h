@@ -0,0 +1,159 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <vector>
+
+// Thirdparty
+#include <Eigen/Core>
+#include "Thirdparty/g2o/g2o/types/se3quat.h"
+
+namespace ORB_SLAM3 {
+
+class GeometricCamera;
+
+// Reprojection terms of the map points matched in one frame, which all depend on a single pose
+//
+// Replaces the unary g2o edges of the pose-only optimizations (EdgeSE3ProjectXYZOnlyPose, EdgeStereoSE3ProjectXYZOnlyPose,
+// EdgeMonoOnlyPose, ...) with the same residuals, Huber kernels and levels. The terms are stored as structure of
+// arrays, so that the residuals, the Jacobians and the normal equations are computed in flat loops over contiguous
+// memory, with the pinhole projection inlined when all the terms are seen by a pinhole camera 0. The buffers are only
+// cleared between frames, a warmed-up instance does not allocate.
+//
+// The pose is the one of a reference frame r (the left camera or the IMU body), the cameras are given relative to it.
+// Information matrices are isotropic.
+class PoseOnlyTerms
+{
+public:
+    typedef Eigen::Matrix<double,6,6> Matrix6d;
+    typedef Eigen::Matrix<double,6,1> Vector6d;
+
+    // How the 6-vector update of the solver changes the pose
+    enum eUpdate
+    {
+        UPDATE_LEFT=0,    // Trw = exp(d)*Trw, as g2o::VertexSE3Expmap
+        UPDATE_BODY=1     // Rwr = Rwr*Exp(dr), twr += Rwr*dt, as VertexPose
+    };
+
+    explicit PoseOnlyTerms(eUpdate update);
+
+    void Clear();
+
+    void SetCamera(int nCam, GeometricCamera* pCamera, const Eigen::Matrix3d &Rcr, const Eigen::Vector3d &tcr);
+    void SetStereoBaseline(double bf) { mbf = bf; }
+
+    // Return the index of the term
+    size_t AddMono(const Eigen::Vector3d &Xw, const Eigen::Vector2d &obs, double invSigma2, double thHuber, int nCam=0);
+    size_t AddStereo(const Eigen::Vector3d &Xw, const Eigen::Vector3d &obs, double invSigma2, double thHuber);
+
+    size_t size() const { return mvLevel.size(); }
+
+    // Terms of level 1 are left out of the optimization, as g2o edges with setLevel(1)
+    void SetLevel(size_t i, int nLevel) { mvLevel[i] = nLevel; }
+    // Huber kernel of all the terms, as setRobustKernel(0) on the edges
+    void SetRobust(bool bRobust) { mbRobust = bRobust; }
+
+    // Residuals at the reference pose Trw. With bOnlyInactive the errors of the level 0 terms are kept, they stay the
+    // ones of the last evaluation inside the solver exactly as the _error of the g2o edges.
+    void ComputeErrors(const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, bool bOnlyInactive=false);
+    double Chi2(size_t i) const { return mvChi2[i]; }
+    bool IsDepthPositive(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw) const;
+
+    // Sum of the (robust) chi2 of the level 0 terms
+    double ActiveRobustChi2() const;
+
+    // Adds J^T*W*J and -J^T*W*e of the level 0 terms, W being the information weighted by the Huber kernel at the
+    // stored errors. Returns the number of terms.
+    int BuildSystem(const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, Matrix6d &H, Vector6d &b);
+
+    // J^T*Info*J of term i, as GetHessian() of the g2o edges
+    Matrix6d Hessian(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw) const;
+
+protected:
+    void Jacobian(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, Eigen::Matrix<double,3,6> &J) const;
+    bool IsPinhole() const;
+
+    const double mdSign;
+
+    GeometricCamera* mpCamera[2];
+    Eigen::Matrix3d mRcr[2];
+    Eigen::Vector3d mtcr[2];
+    double mbf;
+    bool mbRobust;
+    size_t mnRight;
+
+    // Terms
+    std::vector<double> mvX, mvY, mvZ;
+    std::vector<double> mvU, mvV, mvUr;
+    std::vector<double> mvStereo;  // 1 for stereo terms, 0 for mono ones
+    std::vector<double> mvInfo;
+    std::vector<double> mvDelta;
+    std::vector<int> mvCam;
+    std::vector<int> mvLevel;
+
+    // Last errors
+    std::vector<double> mvEu, mvEv, mvEr;
+    std::vector<double> mvChi2;
+
+    // Scratch of BuildSystem: weights of the terms
+    std::vector<double> mvW;
+};
+
+// Pose-only optimization of one camera pose, with the reprojection terms of the matched map points
+//
+// Dedicated 6-DoF Levenberg-Marquardt, with the same damping, step acceptance and stop rules as
+// g2o::OptimizationAlgorithmLevenberg, on fixed-size normal equations.
+class PoseOnlySolver
+{
+public:
+    PoseOnlySolver();
+
+    // Solver of the calling thread
+    static PoseOnlySolver& ThreadSolver();
+
+    // Empties the terms
+    void Clear();
+
+    PoseOnlyTerms& Terms() { return mTerms; }
+
+    void SetEstimate(const g2o::SE3Quat &Tcw);
+    const g2o::SE3Quat& GetEstimate() const { return mTcw; }
+
+    // Returns the number of iterations, -1 if no term is at level 0
+    int Optimize(int nIterations);
+
+    // Errors of the terms at the current estimate, all of them or the level 1 ones
+    void ComputeErrors(bool bOnlyInactive=false);
+
+    bool IsDepthPositive(size_t i) const;
+
+protected:
+    PoseOnlyTerms mTerms;
+    g2o::SE3Quat mTcw;
+    Eigen::Matrix3d mRcw;
+    Eigen::Vector3d mtcw;
+};
+
+} //end ns
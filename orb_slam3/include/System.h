@@ -105,6 +105,7 @@ public:
     // Proccess the given stereo frame. Images must be synchronized and rectified.
     // Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
     // Returns the camera pose (empty if tracking fails).
+    // With Tracking.pipelineDepth>0 it is the pose of the image pipelineDepth calls back.
     cv::Mat TrackStereo(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timestamp, const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(), string filename="");
 
     // Process the given rgbd frame. Depthmap must be registered to the RGB frame.
@@ -116,6 +117,7 @@ public:
     // Proccess the given monocular frame and optionally imu data
     // Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
     // Returns the camera pose (empty if tracking fails).
+    // With Tracking.pipelineDepth>0 it is the pose of the image pipelineDepth calls back.
     cv::Mat TrackMonocular(const cv::Mat &im, const double &timestamp, const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(), string filename="");
 
 
@@ -183,6 +185,9 @@ public:
 
 private:
 
+    // Pipelined tracking: track the frames still in flight if a reset or mode change is pending
+    void FlushPipelineOnChange();
+
     // Input sensor
     eSensor mSensor;
 
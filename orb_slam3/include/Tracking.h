@@ -33,15 +33,22 @@
 #include "ORBVocabulary.h"
 #include"KeyFrameDatabase.h"
 #include"ORBextractor.h"
+#include "ORBmatcher.h"
 #include "Initializer.h"
 #include "MapDrawer.h"
 #include "System.h"
 #include "ImuTypes.h"
 
 #include "GeometricCamera.h"
+#include "LatencyHistogram.h"
+#include "WorkerPool.h"
 
 #include <mutex>
 #include <unordered_set>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 namespace ORB_SLAM3
 {
@@ -75,6 +82,20 @@ public:
 
     void GrabImuData(const IMU::Point &imuMeasurement);
 
+    // Pipelined tracking (Tracking.pipelineDepth > 0 in the settings, monocular and stereo): the Frame of an image (ORB
+    // extraction, stereo matching) is built on a worker thread while the caller tracks the previous one.
+    // GrabImageMonocular/Stereo then return the pose of the frame pipelineDepth images back, an empty Mat while the
+    // pipeline fills up.
+    bool IsPipelined(){
+        return mnPipelineDepth > 0;
+    }
+
+    // Track all frames still in the pipeline, e.g. before a reset or at shutdown
+    void FlushPipeline();
+
+    // Frame build (extraction, stereo matching), Track() and image-to-pose latency histograms, always recorded
+    void PrintLatencyStats();
+
     void SetLocalMapper(LocalMapping* pLocalMapper);
     void SetLoopClosing(LoopClosing* pLoopClosing);
     void SetViewer(Viewer* pViewer);
@@ -167,6 +188,10 @@ public:
 
     vector<double> vdRectStereo_ms;
     vector<double> vdORBExtract_ms;
+    vector<double> vdORBPyramid_ms;
+    vector<double> vdORBFast_ms;
+    vector<double> vdORBDistribute_ms;
+    vector<double> vdORBDescriptor_ms;
     vector<double> vdStereoMatch_ms;
     vector<double> vdIMUInteg_ms;
     vector<double> vdPosePred_ms;
@@ -238,6 +263,40 @@ protected:
     // Imu calibration parameters
     IMU::Calib *mpImuCalib;
 
+    // An image on its way from GrabImage* to Track()
+    struct PendingFrame
+    {
+        cv::Mat imLeft;                 // gray
+        cv::Mat imRight;                // gray, stereo only
+        double timestamp;
+        string filename;
+        bool bIniExtractor;             // extracted with mpIniORBextractor
+        bool bLinkPrevFrame;            // built without mLastFrame, IMU link still to be set
+        bool bReady;
+        Frame frame;
+        std::chrono::steady_clock::time_point tGrab;
+#ifdef REGISTER_TIMES
+        ORBextractor::StageTimes stages;
+#endif
+    };
+
+    bool UseIniExtractor();
+    void BuildFrame(PendingFrame &pending, Frame* pPrevF);
+    cv::Mat TrackFrame(PendingFrame &pending);
+    cv::Mat ProcessFrame(PendingFrame* pPending);
+    cv::Mat TrackPipelineFront();
+    void RunFrameBuilder();
+
+    // Pipeline - at most mnPipelineDepth+1 frames are in flight, the caller blocks on the oldest one
+    int mnPipelineDepth;
+    std::deque<PendingFrame*> mdPipeline;                       // image order
+    std::deque<PendingFrame*> mdPipelineInput;                  // still to be built by the worker
+    bool mbStopPipeline;
+    std::thread* mptFrameBuilder;
+    std::mutex mMutexPipeline;
+    std::condition_variable mcvPipelineInput;
+    std::condition_variable mcvPipelineReady;
+
     // Last Bias Estimation (at keyframe creation)
     IMU::Bias mLastBias;
 
@@ -344,6 +403,17 @@ protected:
 
     cv::Mat mTlr;
 
+    // Left/right ORB extraction of stereo frames (Frame::mpStereoPool), stereo sensors only
+    WorkerPool* mpStereoPool;
+
+    // Scratch of SearchLocalPoints, kept across frames
+    Frame::FrustumBuffers mFrustumBuffers;
+    ORBmatcher::SearchBuffers mSearchBuffers;
+
+    LatencyHistogram mHistFrameBuild;
+    LatencyHistogram mHistTrack;
+    LatencyHistogram mHistLatency;
+
 public:
     cv::Mat mImRight;
 };
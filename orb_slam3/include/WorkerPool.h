@@ -0,0 +1,75 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+// Persistent worker threads for data-parallel loops
+//
+// ParallelFor(n,f) runs f(0)...f(n-1) on the workers and the calling thread and returns once all indices are done.
+// Tasks are handed out in increasing index order, so callers should put the most expensive ones first. Results must be
+// written to per-index slots - the pool does not impose any order on execution. With nThreads<=1 no worker is started
+// and the loop runs inline. One ParallelFor at a time per pool.
+//
+// SetAffinity(vCpus,nFirst) pins worker i to vCpus[(nFirst+i)%size] (the calling thread is left alone) and returns the
+// index for the next pool, so that several pools can share one CPU list. No-op if the list is empty or not on Linux.
+class WorkerPool
+{
+public:
+    WorkerPool(int nThreads);
+    ~WorkerPool();
+
+    void ParallelFor(int n, const std::function<void(int)> &f);
+
+    int SetAffinity(const std::vector<int> &vCpus, int nFirst=0);
+
+    int inline GetNumThreads(){
+        return mvThreads.size()+1;
+    }
+
+protected:
+    void Run();
+
+    std::vector<std::thread> mvThreads;
+
+    const std::function<void(int)>* mpTask;
+    int mnTasks;
+    int mnNext;
+    int mnDone;
+    bool mbStop;
+
+    std::mutex mMutex;
+    std::mutex mMutexCall;
+    std::condition_variable mCondWork;
+    std::condition_variable mCondDone;
+};
+
+} //end ns
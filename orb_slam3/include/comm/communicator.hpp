@@ -23,8 +23,15 @@
 
 #pragma once
 
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <set>
+
 // COVINS
 #include <covins/covins_base/communicator_base.hpp>
+#include "comm/mpsc_queue.hpp"
 
 #define NO_LOOP_FINDER
 #define NO_RELOC
@@ -39,21 +46,23 @@ class Communicator : public covins::CommunicatorBase, public std::enable_shared_
 public:
 
     struct cmp_by_id{
-        bool operator() (const std::pair<size_t,KeyFrame*> a, const std::pair<size_t,KeyFrame*> b){
+        bool operator() (const std::pair<size_t,KeyFrame*> a, const std::pair<size_t,KeyFrame*> b) const {
             if(a.first < b.first) return true;
             else return false;
     }};
 
+    enum eKfPriority {
+        KF_NEW          = 0,                                                                        // never sent - always processed first
+        KF_UPDATE       = 1                                                                         // coalesced per KF - the KF is converted when it is sent
+    };
+
 public:
     Communicator(std::string server_ip, std::string port, Atlas*);
 
     // main function
     virtual auto Run()                                                                  ->void;
 
-    virtual auto PassKfToComm(KeyFrame* kf)                                             ->void {
-        std::unique_lock<std::mutex>(mtx_kf_queue_);
-        kf_out_buffer_.push_back(kf);
-    }
+    virtual auto PassKfToComm(KeyFrame* kf, eKfPriority prio = KF_NEW)                  ->void;     // lock-free - only blocks while the queue for new KFs is full and the comm is running
 
 protected:
 
@@ -65,13 +74,35 @@ protected:
     virtual auto ProcessNewLandmarks()                                                  ->void;
 
     virtual auto ProcessKfBuffer()                                                      ->void;
+    virtual auto ProcessKf(KeyFrame* kf)                                                ->void;
+    virtual auto WaitForKfs(int timeout_ms)                                             ->void;     // returns early when a KF is passed or a msg is received
+    virtual auto HasKfs()                                                               ->bool;     // comm thread only
+    virtual auto Wakeup()                                                               ->void;
+
+    // Message passing
+    virtual auto RecvMsg()                                                              ->void;
+    virtual auto WriteToBuffer()                                                        ->void;
 
     // Infrastructure
     Atlas*                  map_                                                                = nullptr;  // the map is not necessary to send data to the server. However, we keep a ptr to it to facilitate implementing potetnial interaction
 
     bool sending_init_ = false;
-    std::list<KeyFrame*> kf_out_buffer_;
-    std::mutex              mtx_kf_queue_;
+
+    // KF handoff from LocalMapping
+    MpscQueue<KeyFrame*>    queue_kfs_new_;
+    MpscQueue<KeyFrame*>    queue_kfs_update_;
+    std::set<std::pair<size_t,KeyFrame*>,cmp_by_id> set_kfs_update_overflow_;                                  // updates that did not fit into the queue
+    std::mutex              mtx_update_overflow_;
+    std::list<KeyFrame*>    list_kfs_new_overflow_;                                                         // new KFs passed while the comm is finishing
+    std::atomic<size_t>     num_kfs_new_overflow_                                               = {0};
+    std::mutex              mtx_new_overflow_;
+    size_t                  num_kfs_dropped_                                                    = 0;        // LocalMapping only
+    std::mutex              mtx_space_;
+    std::condition_variable cv_space_;                                                                      // the comm took new KFs from the queue
+    std::atomic<bool>       data_in_                                                            = {false};  // RecvMsg wrote to the receive buffer
+    std::atomic<bool>       waiting_                                                            = {false};
+    std::mutex              mtx_wakeup_;
+    std::condition_variable cv_wakeup_;
 };
 
 } //end ns
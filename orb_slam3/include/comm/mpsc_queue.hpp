@@ -0,0 +1,104 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ORB_SLAM3 {
+
+// Bounded lock-free multi-producer / single-consumer queue
+//
+// Ring buffer with a sequence number per cell (D. Vyukov's bounded queue). Producers claim a cell with a CAS on the
+// enqueue position, the single consumer owns the dequeue position. The capacity is rounded up to a power of two.
+template<typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while(size < capacity) size <<= 1;
+        mask_ = size - 1;
+        buffer_.reset(new Cell[size]);
+        for(size_t i=0;i<size;++i) buffer_[i].sequence.store(i,std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&)                                                         = delete;
+    MpscQueue& operator=(const MpscQueue&)                                              = delete;
+
+    // Producers - false if the queue is full
+    auto TryPush(const T &data)->bool {
+        Cell *cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &buffer_[pos & mask_];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0) {
+                if(enqueue_pos_.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) break;
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = data;
+        cell->sequence.store(pos+1,std::memory_order_release);
+        return true;
+    }
+
+    // Consumer - false if the queue is empty
+    auto TryPop(T &data)->bool {
+        Cell *cell = &buffer_[dequeue_pos_ & mask_];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if(static_cast<intptr_t>(seq) - static_cast<intptr_t>(dequeue_pos_+1) < 0) return false;
+        data = cell->data;
+        cell->sequence.store(dequeue_pos_ + mask_ + 1,std::memory_order_release);
+        ++dequeue_pos_;
+        return true;
+    }
+
+    auto Empty()->bool {                                                                            // consumer only
+        const Cell *cell = &buffer_[dequeue_pos_ & mask_];
+        return static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(dequeue_pos_+1) < 0;
+    }
+
+    auto Capacity()->size_t { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t>     sequence;
+        T                       data;
+    };
+
+    std::unique_ptr<Cell[]>     buffer_;
+    size_t                      mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) size_t          dequeue_pos_                                    = 0;        // consumer only
+};
+
+} //end ns
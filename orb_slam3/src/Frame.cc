@@ -24,7 +24,12 @@
 #include "ORBextractor.h"
 #include "Converter.h"
 #include "ORBmatcher.h"
+#include "ORBkernels.h"
 #include "GeometricCamera.h"
+#include "ImagePool.h"
+#include "WorkerPool.h"
+
+#include <covins/covins_base/config_comm.hpp> //for covins_params
 
 #include <thread>
 #include <include/CameraModels/Pinhole.h>
@@ -34,6 +39,7 @@ namespace ORB_SLAM3
 {
 
 long unsigned int Frame::nNextId=0;
+WorkerPool* Frame::mpStereoPool=nullptr;
 bool Frame::mbInitialComputations=true;
 float Frame::cx, Frame::cy, Frame::fx, Frame::fy, Frame::invfx, Frame::invfy;
 float Frame::mnMinX, Frame::mnMinY, Frame::mnMaxX, Frame::mnMaxY;
@@ -78,6 +84,8 @@ Frame::Frame(const Frame &frame)
                 mGridRight[i][j] = frame.mGridRight[i][j];
             }
         }
+    mFlatGrid = frame.mFlatGrid;
+    mFlatGridRight = frame.mFlatGridRight;
 
     if(!frame.mTcw.empty())
         SetPose(frame.mTcw);
@@ -116,10 +124,19 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
 #endif
-    thread threadLeft(&Frame::ExtractORB,this,0,imLeft,0,0);
-    thread threadRight(&Frame::ExtractORB,this,1,imRight,0,0);
-    threadLeft.join();
-    threadRight.join();
+    if(mpStereoPool)
+    {
+        mpStereoPool->ParallelFor(2,[&](int i){
+            ExtractORB(i,i==0 ? imLeft : imRight,0,0);
+        });
+    }
+    else
+    {
+        thread threadLeft(&Frame::ExtractORB,this,0,imLeft,0,0);
+        thread threadRight(&Frame::ExtractORB,this,1,imRight,0,0);
+        threadLeft.join();
+        threadRight.join();
+    }
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndExtORB = std::chrono::steady_clock::now();
 
@@ -299,7 +316,13 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extra
     mvLevelSigma2 = mpORBextractorLeft->GetScaleSigmaSquares();
     mvInvLevelSigma2 = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
+#ifdef COVINS_MOD
+    // only needed if KFs send their image - pooled buffer, shared with the KeyFrame
+    if(covins_params::orb::send_images)
+        imgLeft = ImagePool::GetInstance()->Copy(imGray);
+#else
     imgLeft = imGray.clone();
+#endif
     // ORB extraction
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
@@ -409,6 +432,48 @@ void Frame::AssignFeaturesToGrid()
                 mGridRight[nGridPosX][nGridPosY].push_back(i - Nleft);
         }
     }
+
+    BuildFlatGrid(false);
+    if(Nleft != -1)
+        BuildFlatGrid(true);
+}
+
+void Frame::BuildFlatGrid(const bool bRight)
+{
+    FlatGrid &grid = bRight ? mFlatGridRight : mFlatGrid;
+    const int nCells = FRAME_GRID_COLS*FRAME_GRID_ROWS;
+
+    grid.vStart.resize(nCells+1);
+    grid.vStart[0] = 0;
+    for(int i=0; i<FRAME_GRID_COLS; i++)
+        for(int j=0; j<FRAME_GRID_ROWS; j++)
+        {
+            const int c = i*FRAME_GRID_ROWS+j;
+            grid.vStart[c+1] = grid.vStart[c] + (bRight ? mGridRight[i][j].size() : mGrid[i][j].size());
+        }
+
+    const int nEntries = grid.vStart[nCells];
+    grid.vIdx.resize(nEntries);
+    grid.vX.resize(nEntries);
+    grid.vY.resize(nEntries);
+    grid.vOctave.resize(nEntries);
+
+    int k = 0;
+    for(int i=0; i<FRAME_GRID_COLS; i++)
+        for(int j=0; j<FRAME_GRID_ROWS; j++)
+        {
+            const vector<size_t> &vCell = bRight ? mGridRight[i][j] : mGrid[i][j];
+            for(size_t n=0; n<vCell.size(); n++, k++)
+            {
+                const cv::KeyPoint &kp = (Nleft == -1) ? mvKeysUn[vCell[n]]
+                                                       : (!bRight) ? mvKeys[vCell[n]]
+                                                                   : mvKeysRight[vCell[n]];
+                grid.vIdx[k] = vCell[n];
+                grid.vX[k] = kp.pt.x;
+                grid.vY[k] = kp.pt.y;
+                grid.vOctave[k] = kp.octave;
+            }
+        }
 }
 
 void Frame::ExtractORB(int flag, const cv::Mat &im, const int x0, const int x1)
@@ -572,6 +637,104 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit)
     }
 }
 
+void Frame::isInFrustum(FrustumBuffers &buffers, float viewingCosLimit)
+{
+    const int n = buffers.vpMPs.size();
+    if(n == 0)
+        return;
+
+    buffers.vPx.resize(n); buffers.vPy.resize(n); buffers.vPz.resize(n);
+    buffers.vNx.resize(n); buffers.vNy.resize(n); buffers.vNz.resize(n);
+    buffers.vMinDist.resize(n); buffers.vMaxDist.resize(n);
+    buffers.vPcx.resize(n); buffers.vPcy.resize(n); buffers.vPcz.resize(n);
+    buffers.vDist.resize(n); buffers.vViewCos.resize(n);
+
+    // Gather
+    for(int i=0; i<n; i++)
+    {
+        MapPoint* pMP = buffers.vpMPs[i];
+        pMP->mbTrackInView = false;
+        pMP->mTrackProjX = -1;
+        pMP->mTrackProjY = -1;
+
+        cv::Matx31f Px, Pn;
+        pMP->GetProjectionData(Px,Pn,buffers.vMinDist[i],buffers.vMaxDist[i]);
+        buffers.vPx[i] = Px(0); buffers.vPy[i] = Px(1); buffers.vPz[i] = Px(2);
+        buffers.vNx[i] = Pn(0); buffers.vNy[i] = Pn(1); buffers.vNz[i] = Pn(2);
+    }
+
+    // Transform - same operations and order as with the Matx in isInFrustum(MapPoint*)
+    {
+        const float r00 = mRcwx(0,0), r01 = mRcwx(0,1), r02 = mRcwx(0,2);
+        const float r10 = mRcwx(1,0), r11 = mRcwx(1,1), r12 = mRcwx(1,2);
+        const float r20 = mRcwx(2,0), r21 = mRcwx(2,1), r22 = mRcwx(2,2);
+        const float t0 = mtcwx(0), t1 = mtcwx(1), t2 = mtcwx(2);
+        const float o0 = mOwx(0), o1 = mOwx(1), o2 = mOwx(2);
+
+        const float* px = &buffers.vPx[0]; const float* py = &buffers.vPy[0]; const float* pz = &buffers.vPz[0];
+        const float* nx = &buffers.vNx[0]; const float* ny = &buffers.vNy[0]; const float* nz = &buffers.vNz[0];
+        float* pcx = &buffers.vPcx[0]; float* pcy = &buffers.vPcy[0]; float* pcz = &buffers.vPcz[0];
+        float* dist = &buffers.vDist[0]; float* viewCos = &buffers.vViewCos[0];
+        for(int i=0; i<n; i++)
+        {
+            pcx[i] = r00*px[i] + r01*py[i] + r02*pz[i] + t0;
+            pcy[i] = r10*px[i] + r11*py[i] + r12*pz[i] + t1;
+            pcz[i] = r20*px[i] + r21*py[i] + r22*pz[i] + t2;
+
+            const float ox = px[i]-o0, oy = py[i]-o1, oz = pz[i]-o2;
+            dist[i] = std::sqrt((double)ox*ox + (double)oy*oy + (double)oz*oz);                  // cv::norm sums in double
+            viewCos[i] = (ox*nx[i] + oy*ny[i] + oz*nz[i])/dist[i];
+        }
+    }
+
+    // Checks
+    for(int i=0; i<n; i++)
+    {
+        MapPoint* pMP = buffers.vpMPs[i];
+
+        // Check positive depth
+        const float PcZ = buffers.vPcz[i];
+        if(PcZ<0.0f)
+            continue;
+        const float invz = 1.0f/PcZ;
+
+        const cv::Matx31f Pc(buffers.vPcx[i],buffers.vPcy[i],PcZ);
+        const cv::Point2f uv = mpCamera->project(Pc);
+
+        if(uv.x<mnMinX || uv.x>mnMaxX)
+            continue;
+        if(uv.y<mnMinY || uv.y>mnMaxY)
+            continue;
+
+        pMP->mTrackProjX = uv.x;
+        pMP->mTrackProjY = uv.y;
+
+        // Check distance is in the scale invariance region of the MapPoint
+        const float dist = buffers.vDist[i];
+        if(dist<0.8f*buffers.vMinDist[i] || dist>1.2f*buffers.vMaxDist[i])
+            continue;
+
+        // Check viewing angle
+        const float viewCos = buffers.vViewCos[i];
+        if(viewCos<viewingCosLimit)
+            continue;
+
+        // Predict scale in the image, as MapPoint::PredictScale
+        int nPredictedLevel = ceil(log(buffers.vMaxDist[i]/dist)/mfLogScaleFactor);
+        if(nPredictedLevel<0)
+            nPredictedLevel = 0;
+        else if(nPredictedLevel>=mnScaleLevels)
+            nPredictedLevel = mnScaleLevels-1;
+
+        // Data used by the tracking
+        pMP->mbTrackInView = true;
+        pMP->mTrackProjXR = uv.x - mbf*invz;
+        pMP->mTrackDepth = cv::norm(Pc);
+        pMP->mnTrackScaleLevel= nPredictedLevel;
+        pMP->mTrackViewCos = viewCos;
+    }
+}
+
 bool Frame::ProjectPointDistort(MapPoint* pMP, cv::Point2f &kp, float &u, float &v)
 {
 
@@ -679,7 +842,7 @@ vector<size_t> Frame::GetFeaturesInArea(const float &x, const float  &y, const f
     {
         for(int iy = nMinCellY; iy<=nMaxCellY; iy++)
         {
-            const vector<size_t> vCell = (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
+            const vector<size_t> &vCell = (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
             if(vCell.empty())
                 continue;
 
@@ -709,6 +872,58 @@ vector<size_t> Frame::GetFeaturesInArea(const float &x, const float  &y, const f
     return vIndices;
 }
 
+int Frame::GetFeaturesInArea(const float &x, const float &y, const float &r, const int minLevel, const int maxLevel, const bool bRight, vector<int> &vIndices) const
+{
+    vIndices.clear();
+
+    const FlatGrid &grid = (!bRight) ? mFlatGrid : mFlatGridRight;
+    if(grid.vStart.empty())
+        return 0;
+
+    const int nMinCellX = max(0,(int)floor((x-mnMinX-r)*mfGridElementWidthInv));
+    if(nMinCellX>=FRAME_GRID_COLS)
+        return 0;
+
+    const int nMaxCellX = min((int)FRAME_GRID_COLS-1,(int)ceil((x-mnMinX+r)*mfGridElementWidthInv));
+    if(nMaxCellX<0)
+        return 0;
+
+    const int nMinCellY = max(0,(int)floor((y-mnMinY-r)*mfGridElementHeightInv));
+    if(nMinCellY>=FRAME_GRID_ROWS)
+        return 0;
+
+    const int nMaxCellY = min((int)FRAME_GRID_ROWS-1,(int)ceil((y-mnMinY+r)*mfGridElementHeightInv));
+    if(nMaxCellY<0)
+        return 0;
+
+    const bool bCheckLevels = (minLevel>0) || (maxLevel>=0);
+
+    // the cells nMinCellY..nMaxCellY of a grid column are one contiguous range
+    for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
+    {
+        const int kend = grid.vStart[ix*FRAME_GRID_ROWS+nMaxCellY+1];
+        for(int k = grid.vStart[ix*FRAME_GRID_ROWS+nMinCellY]; k<kend; k++)
+        {
+            if(bCheckLevels)
+            {
+                if(grid.vOctave[k]<minLevel)
+                    continue;
+                if(maxLevel>=0)
+                    if(grid.vOctave[k]>maxLevel)
+                        continue;
+            }
+
+            const float distx = grid.vX[k]-x;
+            const float disty = grid.vY[k]-y;
+
+            if(fabs(distx)<r && fabs(disty)<r)
+                vIndices.push_back(grid.vIdx[k]);
+        }
+    }
+
+    return vIndices.size();
+}
+
 bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY)
 {
     posX = round((kp.pt.x-mnMinX)*mfGridElementWidthInv);
@@ -804,24 +1019,43 @@ void Frame::ComputeStereoMatches()
 
     const int nRows = mpORBextractorLeft->mvImagePyramid[0].rows;
 
-    //Assign keypoints to row table
-    vector<vector<size_t> > vRowIndices(nRows,vector<size_t>());
-
-    for(int i=0; i<nRows; i++)
-        vRowIndices[i].reserve(200);
+    const ORBkernels &kernels = ORBkernels::GetBest();
 
+    //Assign keypoints to row table - flat: the candidates of row y are [vRowStart[y],vRowStart[y+1]) in vRowIdx/vRowU/
+    //vRowOctave, in increasing right index as before
     const int Nr = mvKeysRight.size();
 
+    vector<int> vMinRow(Nr), vMaxRow(Nr);
+    vector<int> vRowStart(nRows+1,0);
     for(int iR=0; iR<Nr; iR++)
     {
         const cv::KeyPoint &kp = mvKeysRight[iR];
         const float &kpY = kp.pt.y;
         const float r = 2.0f*mvScaleFactors[mvKeysRight[iR].octave];
-        const int maxr = ceil(kpY+r);
-        const int minr = floor(kpY-r);
+        vMaxRow[iR] = std::min((int)ceil(kpY+r),nRows-1);
+        vMinRow[iR] = std::max((int)floor(kpY-r),0);
 
-        for(int yi=minr;yi<=maxr;yi++)
-            vRowIndices[yi].push_back(iR);
+        for(int yi=vMinRow[iR];yi<=vMaxRow[iR];yi++)
+            vRowStart[yi+1]++;
+    }
+    for(int yi=0; yi<nRows; yi++)
+        vRowStart[yi+1] += vRowStart[yi];
+
+    vector<int> vRowIdx(vRowStart[nRows]);
+    vector<float> vRowU(vRowStart[nRows]);
+    vector<int> vRowOctave(vRowStart[nRows]);
+    {
+        vector<int> vRowFill(vRowStart.begin(),vRowStart.end()-1);
+        for(int iR=0; iR<Nr; iR++)
+        {
+            for(int yi=vMinRow[iR];yi<=vMaxRow[iR];yi++)
+            {
+                const int k = vRowFill[yi]++;
+                vRowIdx[k] = iR;
+                vRowU[k] = mvKeysRight[iR].pt.x;
+                vRowOctave[k] = mvKeysRight[iR].octave;
+            }
+        }
     }
 
     // Set limits for search
@@ -833,6 +1067,11 @@ void Frame::ComputeStereoMatches()
     vector<pair<int, int> > vDistIdx;
     vDistIdx.reserve(N);
 
+    // candidates of the current left keypoint and their descriptor distances
+    vector<int> vBand, vBandDist;
+    vBand.reserve(Nr);
+    vBandDist.resize(Nr);
+
     for(int iL=0; iL<N; iL++)
     {
         const cv::KeyPoint &kpL = mvKeys[iL];
@@ -840,9 +1079,10 @@ void Frame::ComputeStereoMatches()
         const float &vL = kpL.pt.y;
         const float &uL = kpL.pt.x;
 
-        const vector<size_t> &vCandidates = vRowIndices[vL];
+        const int rowStart = vRowStart[(int)vL];
+        const int rowEnd = vRowStart[(int)vL+1];
 
-        if(vCandidates.empty())
+        if(rowStart == rowEnd)
             continue;
 
         const float minU = uL-maxD;
@@ -854,28 +1094,29 @@ void Frame::ComputeStereoMatches()
         int bestDist = ORBmatcher::TH_HIGH;
         size_t bestIdxR = 0;
 
-        const cv::Mat &dL = mDescriptors.row(iL);
-
-        // Compare descriptor to right keypoints
-        for(size_t iC=0; iC<vCandidates.size(); iC++)
+        // Compare descriptor to right keypoints, all candidates of the band at once
+        vBand.clear();
+        for(int k=rowStart; k<rowEnd; k++)
         {
-            const size_t iR = vCandidates[iC];
-            const cv::KeyPoint &kpR = mvKeysRight[iR];
-
-            if(kpR.octave<levelL-1 || kpR.octave>levelL+1)
+            if(vRowOctave[k]<levelL-1 || vRowOctave[k]>levelL+1)
                 continue;
 
-            const float &uR = kpR.pt.x;
+            const float &uR = vRowU[k];
 
             if(uR>=minU && uR<=maxU)
-            {
-                const cv::Mat &dR = mDescriptorsRight.row(iR);
-                const int dist = ORBmatcher::DescriptorDistance(dL,dR);
+                vBand.push_back(vRowIdx[k]);
+        }
 
-                if(dist<bestDist)
+        if(!vBand.empty())
+        {
+            kernels.DescriptorDistances(mDescriptors.ptr<uchar>(iL),mDescriptorsRight.ptr<uchar>(0),mDescriptorsRight.step,
+                                        &vBand[0],vBand.size(),&vBandDist[0]);
+            for(size_t iC=0; iC<vBand.size(); iC++)
+            {
+                if(vBandDist[iC]<bestDist)
                 {
-                    bestDist = dist;
-                    bestIdxR = iR;
+                    bestDist = vBandDist[iC];
+                    bestIdxR = vBand[iC];
                 }
             }
         }
@@ -892,31 +1133,30 @@ void Frame::ComputeStereoMatches()
 
             // sliding window search
             const int w = 5;
-            cv::Mat IL = mpORBextractorLeft->mvImagePyramid[kpL.octave].rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduL-w,scaleduL+w+1);
+            const cv::Mat &imL = mpORBextractorLeft->mvImagePyramid[kpL.octave];
+            const cv::Mat &imR = mpORBextractorRight->mvImagePyramid[kpL.octave];
 
             int bestDist = INT_MAX;
             int bestincR = 0;
             const int L = 5;
-            vector<float> vDists;
-            vDists.resize(2*L+1);
+            int vDists[2*L+1];
 
             const float iniu = scaleduR0+L-w;
             const float endu = scaleduR0+L+w+1;
-            if(iniu<0 || endu >= mpORBextractorRight->mvImagePyramid[kpL.octave].cols)
+            if(iniu<0 || endu >= imR.cols)
                 continue;
 
+            // L1 distance of the window around the left keypoint to the windows at scaleduR0-L..scaleduR0+L
+            kernels.StereoSAD(imL.ptr<uchar>((int)scaledvL-w) + (int)scaleduL-w,imL.step,
+                              imR.ptr<uchar>((int)scaledvL-w) + (int)scaleduR0-L-w,imR.step,vDists);
+
             for(int incR=-L; incR<=+L; incR++)
             {
-                cv::Mat IR = mpORBextractorRight->mvImagePyramid[kpL.octave].rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduR0+incR-w,scaleduR0+incR+w+1);
-
-                float dist = cv::norm(IL,IR,cv::NORM_L1);
-                if(dist<bestDist)
+                if(vDists[L+incR]<bestDist)
                 {
-                    bestDist =  dist;
+                    bestDist = vDists[L+incR];
                     bestincR = incR;
                 }
-
-                vDists[L+incR] = dist;
             }
 
             if(bestincR==-L || bestincR==L)
@@ -1023,8 +1263,14 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
         :mpcpi(NULL), mpORBvocabulary(voc),mpORBextractorLeft(extractorLeft),mpORBextractorRight(extractorRight), mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
          mImuCalib(ImuCalib), mpImuPreintegrated(NULL), mpPrevFrame(pPrevF),mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbImuPreintegrated(false), mpCamera(pCamera), mpCamera2(pCamera2), mTlr(Tlr)
 {
+#ifdef COVINS_MOD
+    // only needed if KFs send their image - pooled buffer, shared with the KeyFrame
+    if(covins_params::orb::send_images)
+        imgLeft = ImagePool::GetInstance()->Copy(imLeft);
+#else
     imgLeft = imLeft.clone();
     imgRight = imRight.clone();
+#endif
 
     // Frame ID
     mnId=nNextId++;
@@ -1042,10 +1288,20 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
 #endif
-    thread threadLeft(&Frame::ExtractORB,this,0,imLeft,static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1]);
-    thread threadRight(&Frame::ExtractORB,this,1,imRight,static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1]);
-    threadLeft.join();
-    threadRight.join();
+    if(mpStereoPool)
+    {
+        mpStereoPool->ParallelFor(2,[&](int i){
+            KannalaBrandt8* pCam = static_cast<KannalaBrandt8*>(i==0 ? mpCamera : mpCamera2);
+            ExtractORB(i,i==0 ? imLeft : imRight,pCam->mvLappingArea[0],pCam->mvLappingArea[1]);
+        });
+    }
+    else
+    {
+        thread threadLeft(&Frame::ExtractORB,this,0,imLeft,static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1]);
+        thread threadRight(&Frame::ExtractORB,this,1,imRight,static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1]);
+        threadLeft.join();
+        threadRight.join();
+    }
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndExtORB = std::chrono::steady_clock::now();
 
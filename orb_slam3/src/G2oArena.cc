@@ -0,0 +1,125 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "G2oArena.h"
+
+// C++
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace ORB_SLAM3 {
+
+G2oArena::G2oArena(size_t nBlockSize)
+    : mnBlockSize(nBlockSize), mnBlock(0), mnOffset(0), mbInScope(false)
+{
+    mStats.nObjects = mStats.nBytes = mStats.nPeakBytes = mStats.nCapacity = mStats.nBlocks = 0;
+    mStats.nTotalObjects = mStats.nResets = 0;
+}
+
+G2oArena::~G2oArena()
+{
+    // Objects left by a missing Reset() are not destroyed, their optimizer may still reference them
+    assert(mvpObjects.empty());
+    for(size_t i=0; i<mvBlocks.size(); ++i)
+        std::free(mvBlocks[i].pData);
+}
+
+G2oArena& G2oArena::ThreadArena()
+{
+    static thread_local G2oArena arena;
+    return arena;
+}
+
+void* G2oArena::Allocate(size_t nSize, size_t nAlign)
+{
+    nAlign = std::max(nAlign, alignof(std::max_align_t));
+    while(true)
+    {
+        if(mnBlock < mvBlocks.size())
+        {
+            const Block &block = mvBlocks[mnBlock];
+            const uintptr_t start = reinterpret_cast<uintptr_t>(block.pData);
+            const size_t offset = ((start + mnOffset + nAlign - 1) & ~(uintptr_t)(nAlign - 1)) - start;
+            if(offset + nSize <= block.nSize)
+            {
+                mnOffset = offset + nSize;
+                mStats.nObjects++;
+                mStats.nTotalObjects++;
+                mStats.nBytes += nSize;
+                mStats.nPeakBytes = std::max(mStats.nPeakBytes, mStats.nBytes);
+                return block.pData + offset;
+            }
+            if(mnBlock + 1 < mvBlocks.size() && mvBlocks[mnBlock + 1].nSize >= nSize + nAlign)
+            {
+                mnBlock++;
+                mnOffset = 0;
+                continue;
+            }
+        }
+
+        // New block after the one in use, objects larger than a block get their own
+        Block block;
+        block.nSize = std::max(mnBlockSize, nSize + nAlign);
+        block.pData = static_cast<char*>(std::malloc(block.nSize));
+        if(!block.pData)
+            throw std::bad_alloc();
+        const size_t nInsert = mvBlocks.empty() ? 0 : mnBlock + 1;
+        mvBlocks.insert(mvBlocks.begin() + nInsert, block);
+        mnBlock = nInsert;
+        mnOffset = 0;
+        mStats.nCapacity += block.nSize;
+        mStats.nBlocks++;
+    }
+}
+
+void G2oArena::Reset(g2o::SparseOptimizer &optimizer)
+{
+    optimizer.releaseAll();
+    for(size_t i=mvpObjects.size(); i>0; --i)
+        mvpObjects[i-1]->~HyperGraphElement();
+    mvpObjects.clear();
+
+    mnBlock = 0;
+    mnOffset = 0;
+    mStats.nObjects = 0;
+    mStats.nBytes = 0;
+    mStats.nResets++;
+}
+
+G2oArena::Scope::Scope(G2oArena &arena, g2o::SparseOptimizer &optimizer)
+    : mArena(arena), mOptimizer(optimizer)
+{
+    // Nested optimizations on the same arena would destroy the objects of the outer one
+    assert(!mArena.mbInScope);
+    mArena.mbInScope = true;
+}
+
+G2oArena::Scope::~Scope()
+{
+    mArena.Reset(mOptimizer);
+    mArena.mbInScope = false;
+}
+
+} //end ns
@@ -0,0 +1,131 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ImagePool.h"
+
+namespace ORB_SLAM3 {
+
+ImagePool::ImagePool(size_t nMaxPooledBytes)
+    : mnMaxPooledBytes(nMaxPooledBytes)
+{
+    //...
+}
+
+ImagePool* ImagePool::GetInstance()
+{
+    // never destroyed - Mats allocated from the pool may outlive static destruction order
+    static ImagePool* pool = new ImagePool(64*1024*1024);
+    return pool;
+}
+
+cv::Mat ImagePool::Copy(const cv::Mat &im)
+{
+    cv::Mat copy;
+    copy.allocator = this;
+    copy.create(im.size(),im.type());
+    im.copyTo(copy);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mStats.nCopies++;
+    return copy;
+}
+
+ImagePool::Stats ImagePool::GetStats()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+cv::UMatData* ImagePool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                  AccessFlagType /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    // same layout as the default allocator
+    size_t total = CV_ELEM_SIZE(type);
+    for(int i = dims-1; i >= 0; i--)
+    {
+        if(step)
+        {
+            if(data0 && step[i] != CV_AUTOSTEP)
+                total = step[i];
+            else
+                step[i] = total;
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = static_cast<uchar*>(data0);
+    if(!data)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        std::multimap<size_t,uchar*>::iterator it = mmFreeBuffers.find(total);
+        if(it != mmFreeBuffers.end())
+        {
+            data = it->second;
+            mmFreeBuffers.erase(it);
+            mStats.nBytesPooled -= total;
+        }
+        else
+        {
+            data = static_cast<uchar*>(cv::fastMalloc(total));
+            mStats.nAllocations++;
+            mStats.nBytesAllocated += total;
+        }
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if(data0)
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+
+    return u;
+}
+
+bool ImagePool::allocate(cv::UMatData* u, AccessFlagType /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return u != nullptr;
+}
+
+void ImagePool::deallocate(cv::UMatData* u) const
+{
+    if(!u)
+        return;
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if(!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(mStats.nBytesPooled + u->size <= mnMaxPooledBytes)
+        {
+            mmFreeBuffers.insert(std::make_pair(u->size,u->origdata));
+            mStats.nBytesPooled += u->size;
+        }
+        else
+            cv::fastFree(u->origdata);
+        u->origdata = 0;
+    }
+    delete u;
+}
+
+} //end ns
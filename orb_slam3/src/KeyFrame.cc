@@ -43,16 +43,27 @@ double KeyFrame::img_width = -1.0;
 double KeyFrame::img_height = -1.0;
 
 auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_update, size_t cliend_id)->void {
-    std::unique_lock<std::mutex> lock_conn(mMutexConnections);
-    std::unique_lock<std::mutex> lock_feat(mMutexFeatures);
-    std::unique_lock<std::mutex> lock_pose(mMutexPose);
-
     if(kf_ref && kf_ref->mnId == mnId) {
-        //This will cause a deadlock when calling kf_ref->GetPoseTws();
         std::cout << COUTERROR << "kf_ref && kf_ref->id_ == id_" << std::endl;
         exit(-1);
     }
 
+    // Snapshot of the mutable state - the mutexes are only held for these copies. Calibration, keypoints and
+    // descriptors are not changed after construction and are copied without locks below.
+    cv::Mat Twc_snap, Vw_snap;
+    IMU::Bias bias_snap;
+    {
+        std::unique_lock<std::mutex> lock_pose(mMutexPose);
+        Twc_snap = Twc.clone();
+        Vw_snap = Vw.clone();
+        bias_snap = mImuBias;
+    }
+    std::vector<MapPoint*> mps_snap;
+    if(!is_update) {
+        std::unique_lock<std::mutex> lock_feat(mMutexFeatures);
+        mps_snap = mvpMapPoints;
+    }
+
     msg.is_update_msg = is_update;
 
     msg.id.first = mnId;
@@ -110,9 +121,6 @@ auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_
     }
 
     if (!is_update) {
-      
-        cv::Mat img = imgLeft;
-        const size_t num_keys = mvKeys.size();
         msg.keypoints_aors          = this->keys_eigen_aors_;
         msg.keypoints_distorted     = this->keys_eigen_;
         msg.keypoints_undistorted = this->keys_eigen_un_;
@@ -121,9 +129,11 @@ auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_
 
     if(!is_update) {
         msg.descriptors = mDescriptors.clone();
+        if(covins_params::orb::send_images)
+            msg.img = imgLeft;
     }
 
-    Eigen::Matrix4d Tws = covins::Utils::ToEigenMat44d(Twc*mImuCalib.Tcb);
+    Eigen::Matrix4d Tws = covins::Utils::ToEigenMat44d(Twc_snap*mImuCalib.Tcb);
 
     if(!is_update){
         ConvertPreintegrationToMsg(msg.preintegration);
@@ -131,11 +141,11 @@ auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_
 
     msg.T_s_c = covins::Utils::ToEigenMat44d(mImuCalib.Tbc);
 
-    covins::TypeDefs::Vector3Type v_in_s = Tws.block<3,3>(0,0).inverse() *  covins::Utils::ToEigenVec3d(Vw);
+    covins::TypeDefs::Vector3Type v_in_s = Tws.block<3,3>(0,0).inverse() *  covins::Utils::ToEigenVec3d(Vw_snap);
     msg.velocity = v_in_s;
 
-    msg.bias_accel = Eigen::Vector3d(mImuBias.bax,mImuBias.bay,mImuBias.baz);
-    msg.bias_gyro = Eigen::Vector3d(mImuBias.bwx,mImuBias.bwy,mImuBias.bwz);
+    msg.bias_accel = Eigen::Vector3d(bias_snap.bax,bias_snap.bay,bias_snap.baz);
+    msg.bias_gyro = Eigen::Vector3d(bias_snap.bwx,bias_snap.bwy,bias_snap.bwz);
     msg.lin_acc = msg.preintegration.acc;
     msg.ang_vel = msg.preintegration.gyr;
 
@@ -146,12 +156,14 @@ auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_
         std::cout << COUTERROR << "KF " << mnId << ": no kf_ref" << std::endl;
     }
 
-    if(mPrevKF) {
-        msg.id_predecessor.first = mPrevKF->mnId;
+    KeyFrame* prev_kf = mPrevKF;
+    KeyFrame* next_kf = mNextKF;
+    if(prev_kf) {
+        msg.id_predecessor.first = prev_kf->mnId;
         msg.id_predecessor.second = cliend_id;
     }
-    if(mNextKF) {
-        msg.id_successor.first = mNextKF->mnId;
+    if(next_kf) {
+        msg.id_successor.first = next_kf->mnId;
         msg.id_successor.second = cliend_id;
     }
     if(kf_ref) {
@@ -161,9 +173,10 @@ auto KeyFrame::ConvertToMsg(covins::MsgKeyframe &msg, KeyFrame *kf_ref, bool is_
     msg.T_sref_s = T_w_sref.inverse() * Tws;
 
     if(!is_update){
-        const int num_lms = mvpMapPoints.size();
+        // MapPoints are never deleted and mnId is constant - safe to read without the feature lock
+        const int num_lms = mps_snap.size();
         for (size_t indx = 0; indx < num_lms; indx++) {
-            const auto lm0 = mvpMapPoints[indx];
+            const auto lm0 = mps_snap[indx];
             if(lm0) msg.landmarks[indx] = std::make_pair(lm0->mnId,cliend_id);
         }
     }
@@ -244,8 +257,14 @@ KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
     mvKeysRight(F.mvKeysRight), NLeft(F.Nleft), NRight(F.Nright), mTrl(F.mTrl), mnNumberOfOpt(0)
 {
 
+#ifdef COVINS_MOD
+    // Frame images are never modified - share the buffer instead of cloning
+    imgLeft = F.imgLeft;
+    imgRight = F.imgRight;
+#else
     imgLeft = F.imgLeft.clone();
     imgRight = F.imgRight.clone();
+#endif
 
     mnId=nNextId++;
 
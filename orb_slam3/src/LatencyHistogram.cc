@@ -0,0 +1,95 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LatencyHistogram.h"
+
+// C++
+#include <algorithm>
+#include <iomanip>
+
+namespace ORB_SLAM3 {
+
+LatencyHistogram::LatencyHistogram(const std::string &name)
+    : mName(name), mvEdges{1,2,5,10,15,20,30,50,75,100,200,500}, mvCounts(mvEdges.size()+1,0),
+      mnSamples(0), mdSum(0.0), mdMax(0.0)
+{
+    //...
+}
+
+void LatencyHistogram::Add(double ms)
+{
+    const size_t idx = std::lower_bound(mvEdges.begin(),mvEdges.end(),ms) - mvEdges.begin();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mvCounts[idx]++;
+    mnSamples++;
+    mdSum += ms;
+    mdMax = std::max(mdMax,ms);
+}
+
+double LatencyHistogram::Percentile(double p)
+{
+    const size_t nTarget = static_cast<size_t>(p*mnSamples);
+    size_t nCount = 0;
+    for(size_t i=0; i<mvEdges.size(); ++i)
+    {
+        nCount += mvCounts[i];
+        if(nCount > nTarget)
+            return std::min(mvEdges[i],mdMax);
+    }
+    return mdMax;
+}
+
+void LatencyHistogram::Print(std::ostream &out)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    out << mName << ": " << mnSamples << " samples";
+    if(!mnSamples)
+    {
+        out << std::endl;
+        return;
+    }
+    out << std::fixed << std::setprecision(2) << ", mean " << mdSum/mnSamples << " ms, p50 <= " << Percentile(0.5)
+        << " ms, p90 <= " << Percentile(0.9) << " ms, p99 <= " << Percentile(0.99) << " ms, max " << mdMax << " ms"
+        << std::endl;
+
+    for(size_t i=0; i<mvCounts.size(); ++i)
+    {
+        if(!mvCounts[i])
+            continue;
+        out << "  ";
+        if(i < mvEdges.size())
+            out << "<= " << std::setw(6) << std::setprecision(0) << mvEdges[i] << " ms: ";
+        else
+            out << " > " << std::setw(6) << std::setprecision(0) << mvEdges.back() << " ms: ";
+        out << std::setw(6) << mvCounts[i] << " (" << std::setprecision(1) << 100.0*mvCounts[i]/mnSamples << "%)"
+            << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} //end ns
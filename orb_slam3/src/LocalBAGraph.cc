@@ -0,0 +1,227 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LocalBAGraph.h"
+
+// Thirdparty
+#include "Thirdparty/g2o/g2o/core/robust_kernel_impl.h"
+
+namespace ORB_SLAM3 {
+
+LocalBAGraph::LocalBAGraph()
+    : mnReusedVertices(0), mnNewVertices(0), mnRemovedVertices(0), mnReusedEdges(0), mnNewEdges(0), mnRemovedEdges(0),
+      mnWindow(0)
+{
+}
+
+LocalBAGraph::~LocalBAGraph()
+{
+    Clear();
+    for(size_t i=0; i<mvpFreeKeyFrameVertices.size(); ++i)
+        delete mvpFreeKeyFrameVertices[i];
+    for(size_t i=0; i<mvpFreeMapPointVertices.size(); ++i)
+        delete mvpFreeMapPointVertices[i];
+    for(size_t i=0; i<mvpFreeMonoEdges.size(); ++i)
+        delete mvpFreeMonoEdges[i];
+    for(size_t i=0; i<mvpFreeBodyEdges.size(); ++i)
+        delete mvpFreeBodyEdges[i];
+    for(size_t i=0; i<mvpFreeStereoEdges.size(); ++i)
+        delete mvpFreeStereoEdges[i];
+}
+
+void LocalBAGraph::BeginWindow()
+{
+    mnWindow++;
+    mnReusedVertices = mnNewVertices = mnRemovedVertices = 0;
+    mnReusedEdges = mnNewEdges = mnRemovedEdges = 0;
+}
+
+g2o::VertexSE3Expmap* LocalBAGraph::AddKeyFrame(unsigned long nKFId)
+{
+    KeyFrameEntry &entry = mmKeyFrames[nKFId];
+    if(entry.pVertex)
+        mnReusedVertices++;
+    else
+    {
+        if(mvpFreeKeyFrameVertices.empty())
+            entry.pVertex = new g2o::VertexSE3Expmap();
+        else
+        {
+            entry.pVertex = mvpFreeKeyFrameVertices.back();
+            mvpFreeKeyFrameVertices.pop_back();
+        }
+        entry.pVertex->setId(KeyFrameVertexId(nKFId));
+        mOptimizer.addVertex(entry.pVertex);
+        mnNewVertices++;
+    }
+    entry.pVertex->setFixed(false);
+    entry.nWindow = mnWindow;
+    return entry.pVertex;
+}
+
+g2o::VertexSBAPointXYZ* LocalBAGraph::AddMapPoint(unsigned long nMPId)
+{
+    MapPointEntry &entry = mmMapPoints[nMPId];
+    if(entry.pVertex)
+        mnReusedVertices++;
+    else
+    {
+        if(mvpFreeMapPointVertices.empty())
+            entry.pVertex = new g2o::VertexSBAPointXYZ();
+        else
+        {
+            entry.pVertex = mvpFreeMapPointVertices.back();
+            mvpFreeMapPointVertices.pop_back();
+        }
+        entry.pVertex->setId(MapPointVertexId(nMPId));
+        entry.pVertex->setMarginalized(true);
+        mOptimizer.addVertex(entry.pVertex);
+        mnNewVertices++;
+    }
+    entry.pVertex->setFixed(false);
+    entry.nWindow = mnWindow;
+    return entry.pVertex;
+}
+
+template<typename EdgeType>
+EdgeType* LocalBAGraph::AddEdge(unsigned long nMPId, unsigned long nKFId, eEdgeType type, std::vector<EdgeType*> &vpFree)
+{
+    std::unordered_map<unsigned long,MapPointEntry>::iterator itMP = mmMapPoints.find(nMPId);
+    std::unordered_map<unsigned long,KeyFrameEntry>::iterator itKF = mmKeyFrames.find(nKFId);
+    if(itMP == mmMapPoints.end() || itMP->second.nWindow != mnWindow ||
+       itKF == mmKeyFrames.end() || itKF->second.nWindow != mnWindow)
+        return NULL;
+
+    std::vector<EdgeEntry> &vEdges = itMP->second.vEdges;
+    for(size_t i=0; i<vEdges.size(); ++i)
+    {
+        if(vEdges[i].nKFId == nKFId && vEdges[i].type == type)
+        {
+            vEdges[i].nWindow = mnWindow;
+            vEdges[i].pEdge->setLevel(0);
+            mnReusedEdges++;
+            return static_cast<EdgeType*>(vEdges[i].pEdge);
+        }
+    }
+
+    EdgeType* e;
+    if(vpFree.empty())
+    {
+        e = new EdgeType();
+        e->setRobustKernel(new g2o::RobustKernelHuber);
+    }
+    else
+    {
+        e = vpFree.back();
+        vpFree.pop_back();
+    }
+    e->setVertex(0, itMP->second.pVertex);
+    e->setVertex(1, itKF->second.pVertex);
+    e->setLevel(0);
+    mOptimizer.addEdge(e);
+
+    EdgeEntry entry;
+    entry.pEdge = e;
+    entry.nKFId = nKFId;
+    entry.type = type;
+    entry.nWindow = mnWindow;
+    vEdges.push_back(entry);
+    mnNewEdges++;
+    return e;
+}
+
+EdgeSE3ProjectXYZ* LocalBAGraph::AddMonoEdge(unsigned long nMPId, unsigned long nKFId)
+{
+    return AddEdge(nMPId, nKFId, EDGE_MONO, mvpFreeMonoEdges);
+}
+
+EdgeSE3ProjectXYZToBody* LocalBAGraph::AddBodyEdge(unsigned long nMPId, unsigned long nKFId)
+{
+    return AddEdge(nMPId, nKFId, EDGE_BODY, mvpFreeBodyEdges);
+}
+
+g2o::EdgeStereoSE3ProjectXYZ* LocalBAGraph::AddStereoEdge(unsigned long nMPId, unsigned long nKFId)
+{
+    return AddEdge(nMPId, nKFId, EDGE_STEREO, mvpFreeStereoEdges);
+}
+
+void LocalBAGraph::ReleaseEdge(const EdgeEntry &entry)
+{
+    mOptimizer.releaseEdge(entry.pEdge);
+    if(entry.type == EDGE_MONO)
+        mvpFreeMonoEdges.push_back(static_cast<EdgeSE3ProjectXYZ*>(entry.pEdge));
+    else if(entry.type == EDGE_BODY)
+        mvpFreeBodyEdges.push_back(static_cast<EdgeSE3ProjectXYZToBody*>(entry.pEdge));
+    else
+        mvpFreeStereoEdges.push_back(static_cast<g2o::EdgeStereoSE3ProjectXYZ*>(entry.pEdge));
+    mnRemovedEdges++;
+}
+
+void LocalBAGraph::EndWindow()
+{
+    // Edges first, an edge not added in this window may still connect vertices that were
+    for(std::unordered_map<unsigned long,MapPointEntry>::iterator it=mmMapPoints.begin(); it!=mmMapPoints.end(); )
+    {
+        MapPointEntry &entry = it->second;
+        size_t nKept = 0;
+        for(size_t i=0; i<entry.vEdges.size(); ++i)
+        {
+            if(entry.vEdges[i].nWindow == mnWindow)
+                entry.vEdges[nKept++] = entry.vEdges[i];
+            else
+                ReleaseEdge(entry.vEdges[i]);
+        }
+        entry.vEdges.resize(nKept);
+
+        if(entry.nWindow == mnWindow)
+        {
+            ++it;
+            continue;
+        }
+        mOptimizer.releaseVertex(entry.pVertex);
+        mvpFreeMapPointVertices.push_back(entry.pVertex);
+        mnRemovedVertices++;
+        it = mmMapPoints.erase(it);
+    }
+
+    for(std::unordered_map<unsigned long,KeyFrameEntry>::iterator it=mmKeyFrames.begin(); it!=mmKeyFrames.end(); )
+    {
+        if(it->second.nWindow == mnWindow)
+        {
+            ++it;
+            continue;
+        }
+        mOptimizer.releaseVertex(it->second.pVertex);
+        mvpFreeKeyFrameVertices.push_back(it->second.pVertex);
+        mnRemovedVertices++;
+        it = mmKeyFrames.erase(it);
+    }
+}
+
+void LocalBAGraph::Clear()
+{
+    BeginWindow();
+    EndWindow();
+}
+
+} //end ns
@@ -0,0 +1,253 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LocalBAProblem.h"
+
+// C++
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// Thirdparty
+#include "Thirdparty/g2o/g2o/core/robust_kernel_impl.h"
+#include "Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"
+
+#include "CameraModels/KannalaBrandt8.h"
+#include "CameraModels/Pinhole.h"
+#include "OptimizableTypes.h"
+
+namespace ORB_SLAM3 {
+
+// Line format:
+//   C <cam> <type> <n> <p_0> ... <p_n-1>                            camera model (GeometricCamera::GetType())
+//   V <id> <fixed> <tx> <ty> <tz> <qx> <qy> <qz> <qw>               KF pose Tcw
+//   P <id> <x> <y> <z>                                              map point
+//   M <point> <kf> <u> <v> <info> <huber> <cam>                     mono observation
+//   B <point> <kf> <u> <v> <info> <huber> <cam> <Trl (7 values)>    observation in the right camera of a rig
+//   S <point> <kf> <u> <v> <ur> <info> <huber> <fx> <fy> <cx> <cy> <bf>
+
+static double HuberDelta(const g2o::OptimizableGraph::Edge* e)
+{
+    return e->robustKernel() ? e->robustKernel()->delta() : -1.0;
+}
+
+static void SetHuber(g2o::OptimizableGraph::Edge* e, double delta)
+{
+    if(delta < 0)
+        return;
+    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
+    rk->setDelta(delta);
+    e->setRobustKernel(rk);
+}
+
+static void WriteSE3(std::ostream &out, const g2o::SE3Quat &T)
+{
+    const g2o::Vector7d v = T.toVector();
+    for(int i=0; i<7; ++i)
+        out << " " << v[i];
+}
+
+static g2o::SE3Quat ReadSE3(std::istream &in)
+{
+    g2o::Vector7d v;
+    for(int i=0; i<7; ++i)
+        in >> v[i];
+    g2o::SE3Quat T;
+    T.fromVector(v);
+    return T;
+}
+
+bool LocalBAProblem::Save(const std::string &strFile, const g2o::SparseOptimizer &optimizer)
+{
+    std::ofstream f(strFile.c_str());
+    if(!f.is_open())
+    {
+        std::cerr << "LocalBAProblem: cannot write " << strFile << std::endl;
+        return false;
+    }
+    f << std::setprecision(17);
+
+    std::map<GeometricCamera*,int> mCameraIdx;
+    auto CameraIdx = [&](GeometricCamera* pCam) -> int
+    {
+        std::map<GeometricCamera*,int>::iterator it = mCameraIdx.find(pCam);
+        if(it != mCameraIdx.end())
+            return it->second;
+        const int idx = mCameraIdx.size();
+        mCameraIdx[pCam] = idx;
+        f << "C " << idx << " " << pCam->GetType() << " " << pCam->size();
+        for(size_t i=0; i<pCam->size(); ++i)
+            f << " " << std::setprecision(9) << pCam->getParameter(i) << std::setprecision(17);
+        f << "\n";
+        return idx;
+    };
+
+    const g2o::SparseOptimizer::VertexContainer &vpVertices = optimizer.activeVertices();
+    for(size_t i=0; i<vpVertices.size(); ++i)
+    {
+        if(const g2o::VertexSE3Expmap* vSE3 = dynamic_cast<const g2o::VertexSE3Expmap*>(vpVertices[i]))
+        {
+            f << "V " << vSE3->id() << " " << vSE3->fixed();
+            WriteSE3(f,vSE3->estimate());
+            f << "\n";
+        }
+        else if(const g2o::VertexSBAPointXYZ* vPoint = dynamic_cast<const g2o::VertexSBAPointXYZ*>(vpVertices[i]))
+        {
+            const Eigen::Vector3d &x = vPoint->estimate();
+            f << "P " << vPoint->id() << " " << x[0] << " " << x[1] << " " << x[2] << "\n";
+        }
+    }
+
+    const g2o::SparseOptimizer::EdgeContainer &vpEdges = optimizer.activeEdges();
+    for(size_t i=0; i<vpEdges.size(); ++i)
+    {
+        g2o::OptimizableGraph::Edge* pEdge = vpEdges[i];
+        const int idPoint = pEdge->vertex(0)->id();
+        const int idKF = pEdge->vertex(1)->id();
+        if(EdgeSE3ProjectXYZ* e = dynamic_cast<EdgeSE3ProjectXYZ*>(pEdge))
+        {
+            const int cam = CameraIdx(e->pCamera);
+            f << "M " << idPoint << " " << idKF << " " << e->measurement()[0] << " " << e->measurement()[1] << " "
+              << e->information()(0,0) << " " << HuberDelta(e) << " " << cam << "\n";
+        }
+        else if(EdgeSE3ProjectXYZToBody* e = dynamic_cast<EdgeSE3ProjectXYZToBody*>(pEdge))
+        {
+            const int cam = CameraIdx(e->pCamera);
+            f << "B " << idPoint << " " << idKF << " " << e->measurement()[0] << " " << e->measurement()[1] << " "
+              << e->information()(0,0) << " " << HuberDelta(e) << " " << cam;
+            WriteSE3(f,e->mTrl);
+            f << "\n";
+        }
+        else if(g2o::EdgeStereoSE3ProjectXYZ* e = dynamic_cast<g2o::EdgeStereoSE3ProjectXYZ*>(pEdge))
+        {
+            f << "S " << idPoint << " " << idKF << " " << e->measurement()[0] << " " << e->measurement()[1] << " "
+              << e->measurement()[2] << " " << e->information()(0,0) << " " << HuberDelta(e) << " "
+              << e->fx << " " << e->fy << " " << e->cx << " " << e->cy << " " << e->bf << "\n";
+        }
+    }
+
+    return f.good();
+}
+
+bool LocalBAProblem::Load(const std::string &strFile, g2o::SparseOptimizer &optimizer, std::vector<GeometricCamera*> &vpCameras)
+{
+    std::ifstream f(strFile.c_str());
+    if(!f.is_open())
+    {
+        std::cerr << "LocalBAProblem: cannot read " << strFile << std::endl;
+        return false;
+    }
+
+    const size_t nFirstCamera = vpCameras.size();
+    std::string line;
+    while(std::getline(f,line))
+    {
+        std::istringstream ss(line);
+        char type;
+        if(!(ss >> type))
+            continue;
+
+        if(type == 'C')
+        {
+            int idx, camType, n;
+            ss >> idx >> camType >> n;
+            std::vector<float> vParameters(n);
+            for(int i=0; i<n; ++i)
+                ss >> vParameters[i];
+            if(camType == 0)
+                vpCameras.push_back(new Pinhole(vParameters));
+            else
+                vpCameras.push_back(new KannalaBrandt8(vParameters));
+        }
+        else if(type == 'V')
+        {
+            int id;
+            bool bFixed;
+            ss >> id >> bFixed;
+            g2o::VertexSE3Expmap* vSE3 = new g2o::VertexSE3Expmap();
+            vSE3->setEstimate(ReadSE3(ss));
+            vSE3->setId(id);
+            vSE3->setFixed(bFixed);
+            optimizer.addVertex(vSE3);
+        }
+        else if(type == 'P')
+        {
+            int id;
+            Eigen::Vector3d x;
+            ss >> id >> x[0] >> x[1] >> x[2];
+            g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
+            vPoint->setEstimate(x);
+            vPoint->setId(id);
+            vPoint->setMarginalized(true);
+            optimizer.addVertex(vPoint);
+        }
+        else if(type == 'M' || type == 'B')
+        {
+            int idPoint, idKF, cam;
+            Eigen::Vector2d obs;
+            double info, delta;
+            ss >> idPoint >> idKF >> obs[0] >> obs[1] >> info >> delta >> cam;
+
+            g2o::BaseBinaryEdge<2,Eigen::Vector2d,g2o::VertexSBAPointXYZ,g2o::VertexSE3Expmap>* pEdge;
+            if(type == 'M')
+            {
+                EdgeSE3ProjectXYZ* e = new EdgeSE3ProjectXYZ();
+                e->pCamera = vpCameras[nFirstCamera+cam];
+                pEdge = e;
+            }
+            else
+            {
+                EdgeSE3ProjectXYZToBody* e = new EdgeSE3ProjectXYZToBody();
+                e->pCamera = vpCameras[nFirstCamera+cam];
+                e->mTrl = ReadSE3(ss);
+                pEdge = e;
+            }
+            pEdge->setVertex(0, optimizer.vertex(idPoint));
+            pEdge->setVertex(1, optimizer.vertex(idKF));
+            pEdge->setMeasurement(obs);
+            pEdge->setInformation(Eigen::Matrix2d::Identity()*info);
+            SetHuber(pEdge,delta);
+            optimizer.addEdge(pEdge);
+        }
+        else if(type == 'S')
+        {
+            int idPoint, idKF;
+            Eigen::Vector3d obs;
+            double info, delta;
+            g2o::EdgeStereoSE3ProjectXYZ* e = new g2o::EdgeStereoSE3ProjectXYZ();
+            ss >> idPoint >> idKF >> obs[0] >> obs[1] >> obs[2] >> info >> delta >> e->fx >> e->fy >> e->cx >> e->cy >> e->bf;
+            e->setVertex(0, optimizer.vertex(idPoint));
+            e->setVertex(1, optimizer.vertex(idKF));
+            e->setMeasurement(obs);
+            e->setInformation(Eigen::Matrix3d::Identity()*info);
+            SetHuber(e,delta);
+            optimizer.addEdge(e);
+        }
+    }
+
+    return true;
+}
+
+} //end ns
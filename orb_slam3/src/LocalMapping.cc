@@ -302,7 +302,8 @@ void LocalMapping::Run()
                 while(kf_out_buffer_.size() > covins_params::comm::kf_buffer_withold/* || this->CheckFinish()*/) { // delay sending a bit to achieve more consistency in data association
                     KeyFrame* kfi = *(kf_out_buffer_.begin());
                     kf_out_buffer_.erase(kf_out_buffer_.begin());
-                    comm_->PassKfToComm(kfi);
+                    comm_->PassKfToComm(kfi,kfi->passed_to_comm_ ? Communicator::KF_UPDATE : Communicator::KF_NEW);
+                    kfi->passed_to_comm_ = true;
                 }
             }
             //-----------------------------
@@ -343,7 +344,8 @@ void LocalMapping::Run()
     while(!kf_out_buffer_.empty()) {
         KeyFrame* kfi = *(kf_out_buffer_.begin());
         kf_out_buffer_.erase(kf_out_buffer_.begin());
-        comm_->PassKfToComm(kfi);
+        comm_->PassKfToComm(kfi,kfi->passed_to_comm_ ? Communicator::KF_UPDATE : Communicator::KF_NEW);
+        kfi->passed_to_comm_ = true;
     }
     std::cout << ">>> Done." << std::endl;
 #endif
@@ -20,6 +20,7 @@
 #include "ORBmatcher.h"
 
 #include<mutex>
+#include<cstring>
 
 // COVINS
 #include <covins/covins_base/utils_base.hpp>
@@ -467,6 +468,12 @@ cv::Mat MapPoint::GetDescriptor()
     return mDescriptor.clone();
 }
 
+void MapPoint::GetDescriptor(uchar* desc)
+{
+    unique_lock<mutex> lock(mMutexFeatures);
+    memcpy(desc,mDescriptor.ptr<uchar>(),32);
+}
+
 tuple<int,int> MapPoint::GetIndexInKeyFrame(KeyFrame *pKF)
 {
     unique_lock<mutex> lock(mMutexFeatures);
@@ -570,6 +577,15 @@ float MapPoint::GetMaxDistanceInvariance()
     return 1.2f*mfMaxDistance;
 }
 
+void MapPoint::GetProjectionData(cv::Matx31f &Pos, cv::Matx31f &Normal, float &minDistance, float &maxDistance)
+{
+    unique_lock<mutex> lock(mMutexPos);
+    Pos = mWorldPosx;
+    Normal = mNormalVectorx;
+    minDistance = mfMinDistance;
+    maxDistance = mfMaxDistance;
+}
+
 int MapPoint::PredictScale(const float &currentDist, KeyFrame* pKF)
 {
     float ratio;
@@ -57,8 +57,12 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 
 #include "ORBextractor.h"
+#include "ORBkernels.h"
 
 
 using namespace cv;
@@ -72,38 +76,20 @@ namespace ORB_SLAM3
     const int EDGE_THRESHOLD = 19;
 
 
-    static float IC_Angle(const Mat& image, Point2f pt,  const vector<int> & u_max)
+    static float IC_Angle(const ORBkernels& kernels, const Mat& image, Point2f pt,  const vector<int> & u_max)
     {
         int m_01 = 0, m_10 = 0;
 
         const uchar* center = &image.at<uchar> (cvRound(pt.y), cvRound(pt.x));
 
-        // Treat the center line differently, v=0
-        for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
-            m_10 += u * center[u];
-
-        // Go line by line in the circuI853lar patch
-        int step = (int)image.step1();
-        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
-        {
-            // Proceed over the two lines
-            int v_sum = 0;
-            int d = u_max[v];
-            for (int u = -d; u <= d; ++u)
-            {
-                int val_plus = center[u + v*step], val_minus = center[u - v*step];
-                v_sum += (val_plus - val_minus);
-                m_10 += u * (val_plus + val_minus);
-            }
-            m_01 += v * v_sum;
-        }
+        kernels.ICMoments(center, (int)image.step1(), &u_max[0], m_01, m_10);
 
         return fastAtan2((float)m_01, (float)m_10);
     }
 
 
     const float factorPI = (float)(CV_PI/180.f);
-    static void computeOrbDescriptor(const KeyPoint& kpt,
+    static void computeOrbDescriptor(const ORBkernels& kernels, const KeyPoint& kpt,
                                      const Mat& img, const Point* pattern,
                                      uchar* desc)
     {
@@ -111,37 +97,9 @@ namespace ORB_SLAM3
         float a = (float)cos(angle), b = (float)sin(angle);
 
         const uchar* center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
-        const int step = (int)img.step;
-
-#define GET_VALUE(idx) \
-        center[cvRound(pattern[idx].x*b + pattern[idx].y*a)*step + \
-               cvRound(pattern[idx].x*a - pattern[idx].y*b)]
 
-
-        for (int i = 0; i < 32; ++i, pattern += 16)
-        {
-            int t0, t1, val;
-            t0 = GET_VALUE(0); t1 = GET_VALUE(1);
-            val = t0 < t1;
-            t0 = GET_VALUE(2); t1 = GET_VALUE(3);
-            val |= (t0 < t1) << 1;
-            t0 = GET_VALUE(4); t1 = GET_VALUE(5);
-            val |= (t0 < t1) << 2;
-            t0 = GET_VALUE(6); t1 = GET_VALUE(7);
-            val |= (t0 < t1) << 3;
-            t0 = GET_VALUE(8); t1 = GET_VALUE(9);
-            val |= (t0 < t1) << 4;
-            t0 = GET_VALUE(10); t1 = GET_VALUE(11);
-            val |= (t0 < t1) << 5;
-            t0 = GET_VALUE(12); t1 = GET_VALUE(13);
-            val |= (t0 < t1) << 6;
-            t0 = GET_VALUE(14); t1 = GET_VALUE(15);
-            val |= (t0 < t1) << 7;
-
-            desc[i] = (uchar)val;
-        }
-
-#undef GET_VALUE
+        // Point is (int x, int y)
+        kernels.Descriptor(center, (int)img.step, a, b, (const int*)pattern, desc);
     }
 
 
@@ -406,9 +364,9 @@ namespace ORB_SLAM3
             };
 
     ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
-                               int _iniThFAST, int _minThFAST):
+                               int _iniThFAST, int _minThFAST, int _nThreads):
             nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels),
-            iniThFAST(_iniThFAST), minThFAST(_minThFAST)
+            iniThFAST(_iniThFAST), minThFAST(_minThFAST), mpPool(new WorkerPool(_nThreads))
     {
         mvScaleFactor.resize(nlevels);
         mvLevelSigma2.resize(nlevels);
@@ -429,6 +387,9 @@ namespace ORB_SLAM3
         }
 
         mvImagePyramid.resize(nlevels);
+        mvPyramidBordered.resize(nlevels);
+        mvBlurredPyramid.resize(nlevels);
+        mvLevelDescriptorBuffers.resize(nlevels);
 
         mnFeaturesPerLevel.resize(nlevels);
         float factor = 1.0f / scaleFactor;
@@ -469,10 +430,11 @@ namespace ORB_SLAM3
 
     static void computeOrientation(const Mat& image, vector<KeyPoint>& keypoints, const vector<int>& umax)
     {
+        const ORBkernels& kernels = ORBkernels::GetBest();
         for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
                      keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
         {
-            keypoint->angle = IC_Angle(image, keypoint->pt, umax);
+            keypoint->angle = IC_Angle(kernels, image, keypoint->pt, umax);
         }
     }
 
@@ -766,98 +728,100 @@ namespace ORB_SLAM3
 
         const float W = 35;
 
+        // Cell grid of every level. FAST runs per cell row over all levels, the rows of level 0 first.
+        struct LevelGrid
+        {
+            int minBorderX, minBorderY, maxBorderX, maxBorderY;
+            int nCols, nRows, wCell, hCell;
+            int firstRow;
+        };
+        vector<LevelGrid> vGrids(nlevels);
+        vector<int> vRowLevels;
         for (int level = 0; level < nlevels; ++level)
         {
-            const int minBorderX = EDGE_THRESHOLD-3;
-            const int minBorderY = minBorderX;
-            const int maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
-            const int maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
+            LevelGrid &grid = vGrids[level];
+            grid.minBorderX = EDGE_THRESHOLD-3;
+            grid.minBorderY = grid.minBorderX;
+            grid.maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
+            grid.maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
+
+            const float width = (grid.maxBorderX-grid.minBorderX);
+            const float height = (grid.maxBorderY-grid.minBorderY);
+
+            grid.nCols = width/W;
+            grid.nRows = height/W;
+            grid.wCell = ceil(width/grid.nCols);
+            grid.hCell = ceil(height/grid.nRows);
+            grid.firstRow = vRowLevels.size();
+            vRowLevels.insert(vRowLevels.end(),grid.nRows,level);
+        }
 
-            vector<cv::KeyPoint> vToDistributeKeys;
-            vToDistributeKeys.reserve(nfeatures*10);
+        std::chrono::steady_clock::time_point time_StartFAST = std::chrono::steady_clock::now();
 
-            const float width = (maxBorderX-minBorderX);
-            const float height = (maxBorderY-minBorderY);
+        mvvCellRowKeys.resize(vRowLevels.size());
+        mpPool->ParallelFor(vRowLevels.size(),[&](int r)
+        {
+            const int level = vRowLevels[r];
+            const LevelGrid &grid = vGrids[level];
+            const int i = r-grid.firstRow;
 
-            const int nCols = width/W;
-            const int nRows = height/W;
-            const int wCell = ceil(width/nCols);
-            const int hCell = ceil(height/nRows);
+            vector<cv::KeyPoint> &vRowKeys = mvvCellRowKeys[r];
+            vRowKeys.clear();
 
-            for(int i=0; i<nRows; i++)
-            {
-                const float iniY =minBorderY+i*hCell;
-                float maxY = iniY+hCell+6;
+            const float iniY =grid.minBorderY+i*grid.hCell;
+            float maxY = iniY+grid.hCell+6;
 
-                if(iniY>=maxBorderY-3)
-                    continue;
-                if(maxY>maxBorderY)
-                    maxY = maxBorderY;
+            if(iniY>=grid.maxBorderY-3)
+                return;
+            if(maxY>grid.maxBorderY)
+                maxY = grid.maxBorderY;
 
-                for(int j=0; j<nCols; j++)
-                {
-                    const float iniX =minBorderX+j*wCell;
-                    float maxX = iniX+wCell+6;
-                    if(iniX>=maxBorderX-6)
-                        continue;
-                    if(maxX>maxBorderX)
-                        maxX = maxBorderX;
+            vector<cv::KeyPoint> vKeysCell;
+            for(int j=0; j<grid.nCols; j++)
+            {
+                const float iniX =grid.minBorderX+j*grid.wCell;
+                float maxX = iniX+grid.wCell+6;
+                if(iniX>=grid.maxBorderX-6)
+                    continue;
+                if(maxX>grid.maxBorderX)
+                    maxX = grid.maxBorderX;
 
-                    vector<cv::KeyPoint> vKeysCell;
+                vKeysCell.clear();
+                FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
+                     vKeysCell,iniThFAST,true);
 
+                if(vKeysCell.empty())
+                {
                     FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                         vKeysCell,iniThFAST,true);
-
-                    /*if(bRight && j <= 13){
-                        FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,10,true);
-                    }
-                    else if(!bRight && j >= 16){
-                        FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,10,true);
-                    }
-                    else{
-                        FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,iniThFAST,true);
-                    }*/
+                         vKeysCell,minThFAST,true);
+                }
 
+                for(vector<cv::KeyPoint>::iterator vit=vKeysCell.begin(); vit!=vKeysCell.end();vit++)
+                {
+                    (*vit).pt.x+=j*grid.wCell;
+                    (*vit).pt.y+=i*grid.hCell;
+                    vRowKeys.push_back(*vit);
+                }
+            }
+        });
 
-                    if(vKeysCell.empty())
-                    {
-                        FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,minThFAST,true);
-                        /*if(bRight && j <= 13){
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,5,true);
-                        }
-                        else if(!bRight && j >= 16){
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,5,true);
-                        }
-                        else{
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,minThFAST,true);
-                        }*/
-                    }
+        std::chrono::steady_clock::time_point time_EndFAST = std::chrono::steady_clock::now();
 
-                    if(!vKeysCell.empty())
-                    {
-                        for(vector<cv::KeyPoint>::iterator vit=vKeysCell.begin(); vit!=vKeysCell.end();vit++)
-                        {
-                            (*vit).pt.x+=j*wCell;
-                            (*vit).pt.y+=i*hCell;
-                            vToDistributeKeys.push_back(*vit);
-                        }
-                    }
+        // Rows are concatenated in order, so the octree sees the same keypoint sequence as a sequential pass
+        mpPool->ParallelFor(nlevels,[&](int level)
+        {
+            const LevelGrid &grid = vGrids[level];
 
-                }
-            }
+            vector<cv::KeyPoint> vToDistributeKeys;
+            vToDistributeKeys.reserve(nfeatures*10);
+            for(int r=grid.firstRow; r<grid.firstRow+grid.nRows; r++)
+                vToDistributeKeys.insert(vToDistributeKeys.end(),mvvCellRowKeys[r].begin(),mvvCellRowKeys[r].end());
 
             vector<KeyPoint> & keypoints = allKeypoints[level];
             keypoints.reserve(nfeatures);
 
-            keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
-                                          minBorderY, maxBorderY,mnFeaturesPerLevel[level], level);
+            keypoints = DistributeOctTree(vToDistributeKeys, grid.minBorderX, grid.maxBorderX,
+                                          grid.minBorderY, grid.maxBorderY,mnFeaturesPerLevel[level], level);
 
             const int scaledPatchSize = PATCH_SIZE*mvScaleFactor[level];
 
@@ -865,16 +829,20 @@ namespace ORB_SLAM3
             const int nkps = keypoints.size();
             for(int i=0; i<nkps ; i++)
             {
-                keypoints[i].pt.x+=minBorderX;
-                keypoints[i].pt.y+=minBorderY;
+                keypoints[i].pt.x+=grid.minBorderX;
+                keypoints[i].pt.y+=grid.minBorderY;
                 keypoints[i].octave=level;
                 keypoints[i].size = scaledPatchSize;
             }
-        }
 
-        // compute orientations
-        for (int level = 0; level < nlevels; ++level)
-            computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+            // compute orientations
+            computeOrientation(mvImagePyramid[level], keypoints, umax);
+        });
+
+        std::chrono::steady_clock::time_point time_EndDistribute = std::chrono::steady_clock::now();
+
+        mStageTimes.fast = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndFAST - time_StartFAST).count();
+        mStageTimes.distribute = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndDistribute - time_EndFAST).count();
     }
 
     void ORBextractor::ComputeKeyPointsOld(std::vector<std::vector<KeyPoint> > &allKeypoints)
@@ -1059,10 +1027,35 @@ namespace ORB_SLAM3
     static void computeDescriptors(const Mat& image, vector<KeyPoint>& keypoints, Mat& descriptors,
                                    const vector<Point>& pattern)
     {
-        descriptors = Mat::zeros((int)keypoints.size(), 32, CV_8UC1);
+        // every byte is written, no need to clear. No-op if descriptors already is a view of the right size.
+        descriptors.create((int)keypoints.size(), 32, CV_8UC1);
 
+        const ORBkernels& kernels = ORBkernels::GetBest();
         for (size_t i = 0; i < keypoints.size(); i++)
-            computeOrbDescriptor(keypoints[i], image, &pattern[0], descriptors.ptr((int)i));
+            computeOrbDescriptor(kernels, keypoints[i], image, &pattern[0], descriptors.ptr((int)i));
+    }
+
+    void ORBextractor::ComputeDescriptors(vector<vector<KeyPoint> >& allKeypoints, vector<Mat>& vDescriptors)
+    {
+        vDescriptors.resize(nlevels);
+        mpPool->ParallelFor(nlevels,[&](int level)
+        {
+            vector<KeyPoint>& keypoints = allKeypoints[level];
+            if(keypoints.empty())
+                return;
+
+            // preprocess the resized image. The level's border is the BORDER_REFLECT_101 extension of the level itself,
+            // so blurring the view gives the same result as blurring an isolated copy.
+            GaussianBlur(mvImagePyramid[level], mvBlurredPyramid[level], Size(7, 7), 2, 2, BORDER_REFLECT_101);
+
+            // Compute the descriptors
+            const int nkeypointsLevel = (int)keypoints.size();
+            Mat &buffer = mvLevelDescriptorBuffers[level];
+            if(buffer.rows < nkeypointsLevel)
+                buffer.create(std::max(nkeypointsLevel,2*buffer.rows), 32, CV_8UC1);
+            vDescriptors[level] = buffer.rowRange(0, nkeypointsLevel);
+            computeDescriptors(mvBlurredPyramid[level], keypoints, vDescriptors[level], pattern);
+        });
     }
 
     int ORBextractor::operator()( InputArray _image, InputArray _mask, vector<KeyPoint>& _keypoints,
@@ -1076,12 +1069,18 @@ namespace ORB_SLAM3
         assert(image.type() == CV_8UC1 );
 
         // Pre-compute the scale pyramid
+        std::chrono::steady_clock::time_point time_StartPyramid = std::chrono::steady_clock::now();
         ComputePyramid(image);
+        std::chrono::steady_clock::time_point time_EndPyramid = std::chrono::steady_clock::now();
+        mStageTimes.pyramid = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndPyramid - time_StartPyramid).count();
 
         vector < vector<KeyPoint> > allKeypoints;
         ComputeKeyPointsOctTree(allKeypoints);
         //ComputeKeyPointsOld(allKeypoints);
 
+        std::chrono::steady_clock::time_point time_StartDesc = std::chrono::steady_clock::now();
+        ComputeDescriptors(allKeypoints, mvLevelDescriptors);
+
         Mat descriptors;
 
         int nkeypoints = 0;
@@ -1099,7 +1098,6 @@ namespace ORB_SLAM3
         //_keypoints.reserve(nkeypoints);
         _keypoints = vector<cv::KeyPoint>(nkeypoints);
 
-        int offset = 0;
         //Modified for speeding up stereo fisheye matching
         int monoIndex = 0, stereoIndex = nkeypoints-1;
         for (int level = 0; level < nlevels; ++level)
@@ -1110,17 +1108,7 @@ namespace ORB_SLAM3
             if(nkeypointsLevel==0)
                 continue;
 
-            // preprocess the resized image
-            Mat workingMat = mvImagePyramid[level].clone();
-            GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
-
-            // Compute the descriptors
-            //Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-            Mat desc = cv::Mat(nkeypointsLevel, 32, CV_8U);
-            computeDescriptors(workingMat, keypoints, desc, pattern);
-
-            offset += nkeypointsLevel;
-
+            const Mat &desc = mvLevelDescriptors[level];
 
             float scale = mvScaleFactor[level]; //getScale(level, firstLevel, scaleFactor);
             int i = 0;
@@ -1145,6 +1133,10 @@ namespace ORB_SLAM3
                 i++;
             }
         }
+
+        std::chrono::steady_clock::time_point time_EndDesc = std::chrono::steady_clock::now();
+        mStageTimes.descriptors = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndDesc - time_StartDesc).count();
+
         //cout << "[ORBextractor]: extracted " << _keypoints.size() << " KeyPoints" << endl;
         return monoIndex;
     }
@@ -1160,12 +1152,17 @@ namespace ORB_SLAM3
     assert(image.type() == CV_8UC1 );
 
     // Pre-compute the scale pyramid
+    std::chrono::steady_clock::time_point time_StartPyramid = std::chrono::steady_clock::now();
     ComputePyramid(image);
-
+    std::chrono::steady_clock::time_point time_EndPyramid = std::chrono::steady_clock::now();
+    mStageTimes.pyramid = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndPyramid - time_StartPyramid).count();
 
     std::vector < std::vector<KeyPoint> > allKeypoints;
     ComputeKeyPointsOctTree(allKeypoints);
 
+    std::chrono::steady_clock::time_point time_StartDesc = std::chrono::steady_clock::now();
+    ComputeDescriptors(allKeypoints, mvLevelDescriptors);
+
     Mat descriptors;
 
     int nkeypoints = 0;
@@ -1191,14 +1188,7 @@ namespace ORB_SLAM3
         if(nkeypointsLevel==0)
             continue;
 
-        // preprocess the resized image
-        Mat workingMat = mvImagePyramid[level].clone();
-
-        GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
-
-        // Compute the descriptors
-        Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-        computeDescriptors(workingMat, keypoints, desc, pattern);
+        mvLevelDescriptors[level].copyTo(descriptors.rowRange(offset, offset + nkeypointsLevel));
 
         offset += nkeypointsLevel;
 
@@ -1214,31 +1204,77 @@ namespace ORB_SLAM3
         _keypoints.insert(_keypoints.end(), keypoints.begin(), keypoints.end());
     }
 
+    std::chrono::steady_clock::time_point time_EndDesc = std::chrono::steady_clock::now();
+    mStageTimes.descriptors = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndDesc - time_StartDesc).count();
     }
 
-    void ORBextractor::ComputePyramid(cv::Mat image)
+    // BORDER_REFLECT_101 border around the interior of whole, in place
+    static void fillBorder(Mat& whole, const int border)
+    {
+        const int cols = whole.cols-2*border;
+        const int rows = whole.rows-2*border;
+
+        for(int r=border; r<border+rows; ++r)
+        {
+            uchar* row = whole.ptr<uchar>(r);
+            for(int i=1; i<=border; ++i)
+            {
+                row[border-i] = row[border+i];
+                row[border+cols-1+i] = row[border+cols-1-i];
+            }
+        }
+
+        for(int i=1; i<=border; ++i)
+        {
+            memcpy(whole.ptr<uchar>(border-i), whole.ptr<uchar>(border+i), whole.cols);
+            memcpy(whole.ptr<uchar>(border+rows-1+i), whole.ptr<uchar>(border+rows-1-i), whole.cols);
+        }
+    }
+
+    void ORBextractor::AllocatePyramid(const cv::Size &imageSize)
     {
+        vector<Size> vSizes(nlevels);
+        size_t nBytes = 0;
         for (int level = 0; level < nlevels; ++level)
         {
             float scale = mvInvScaleFactor[level];
-            Size sz(cvRound((float)image.cols*scale), cvRound((float)image.rows*scale));
+            vSizes[level] = Size(cvRound((float)imageSize.width*scale), cvRound((float)imageSize.height*scale));
+            nBytes += (size_t)(vSizes[level].width + EDGE_THRESHOLD*2)*(vSizes[level].height + EDGE_THRESHOLD*2);
+        }
+
+        mPyramidArena.create(1, (int)nBytes, CV_8UC1);
+        uchar* data = mPyramidArena.data;
+        for (int level = 0; level < nlevels; ++level)
+        {
+            const Size &sz = vSizes[level];
             Size wholeSize(sz.width + EDGE_THRESHOLD*2, sz.height + EDGE_THRESHOLD*2);
-            Mat temp(wholeSize, image.type()), masktemp;
-            mvImagePyramid[level] = temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
+            mvPyramidBordered[level] = Mat(wholeSize, CV_8UC1, data);
+            mvImagePyramid[level] = mvPyramidBordered[level](Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
+            mvBlurredPyramid[level].create(sz, CV_8UC1);
+            data += wholeSize.area();
+        }
+
+        mPyramidImageSize = imageSize;
+    }
 
-            // Compute the resized image
+    void ORBextractor::ComputePyramid(cv::Mat image)
+    {
+        if(image.size() != mPyramidImageSize)
+            AllocatePyramid(image.size());
+
+        for (int level = 0; level < nlevels; ++level)
+        {
+            // Compute the resized image directly into the arena, then extend it by the border
             if( level != 0 )
             {
-                resize(mvImagePyramid[level-1], mvImagePyramid[level], sz, 0, 0, INTER_LINEAR);
-
-                copyMakeBorder(mvImagePyramid[level], temp, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                               BORDER_REFLECT_101+BORDER_ISOLATED);
+                resize(mvImagePyramid[level-1], mvImagePyramid[level], mvImagePyramid[level].size(), 0, 0, INTER_LINEAR);
             }
             else
             {
-                copyMakeBorder(image, temp, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                               BORDER_REFLECT_101);
+                image.copyTo(mvImagePyramid[level]);
             }
+
+            fillBorder(mvPyramidBordered[level], EDGE_THRESHOLD);
         }
 
     }
@@ -18,6 +18,7 @@
 
 
 #include "ORBmatcher.h"
+#include "ORBkernels.h"
 
 #include<limits.h>
 
@@ -42,11 +43,23 @@ ORBmatcher::ORBmatcher(float nnratio, bool checkOri): mfNNratio(nnratio), mbChec
 }
 
 int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoints, const float th, const bool bFarPoints, const float thFarPoints)
+{
+    SearchBuffers buffers;
+    return SearchByProjection(F,vpMapPoints,buffers,th,bFarPoints,thFarPoints);
+}
+
+int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoints, SearchBuffers &buffers, const float th, const bool bFarPoints, const float thFarPoints)
 {
     int nmatches=0, left = 0, right = 0;
 
     const bool bFactor = th!=1.0;
 
+    const ORBkernels &kernels = ORBkernels::GetBest();
+    vector<int> &vIndices = buffers.vIndices;
+    vector<int> &vCandidates = buffers.vCandidates;
+    vector<int> &vDist = buffers.vDist;
+    uchar MPdescriptor[32];
+
     for(size_t iMP=0; iMP<vpMapPoints.size(); iMP++)
     {
         MapPoint* pMP = vpMapPoints[iMP];
@@ -69,22 +82,14 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
             if(bFactor)
                 r*=th;
 
-            const vector<size_t> vIndices =
-                    F.GetFeaturesInArea(pMP->mTrackProjX,pMP->mTrackProjY,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel);
+            F.GetFeaturesInArea(pMP->mTrackProjX,pMP->mTrackProjY,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel,false,vIndices);
 
             if(!vIndices.empty()){
-                const cv::Mat MPdescriptor = pMP->GetDescriptor();
-
-                int bestDist=256;
-                int bestLevel= -1;
-                int bestDist2=256;
-                int bestLevel2 = -1;
-                int bestIdx =-1 ;
-
-                // Get best and second matches with near keypoints
-                for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
+                // Keypoints that may be matched, then all their descriptor distances at once
+                vCandidates.clear();
+                for(size_t iC=0; iC<vIndices.size(); iC++)
                 {
-                    const size_t idx = *vit;
+                    const size_t idx = vIndices[iC];
 
                     if(F.mvpMapPoints[idx])
                         if(F.mvpMapPoints[idx]->Observations()>0)
@@ -97,9 +102,29 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
                             continue;
                     }
 
-                    const cv::Mat &d = F.mDescriptors.row(idx);
+                    vCandidates.push_back(idx);
+                }
+
+                if(vDist.size() < vCandidates.size())
+                    vDist.resize(vCandidates.size());
+                if(!vCandidates.empty())
+                {
+                    pMP->GetDescriptor(MPdescriptor);
+                    kernels.DescriptorDistances(MPdescriptor,F.mDescriptors.ptr<uchar>(0),F.mDescriptors.step,
+                                                &vCandidates[0],vCandidates.size(),&vDist[0]);
+                }
 
-                    const int dist = DescriptorDistance(MPdescriptor,d);
+                int bestDist=256;
+                int bestLevel= -1;
+                int bestDist2=256;
+                int bestLevel2 = -1;
+                int bestIdx =-1 ;
+
+                // Get best and second matches with near keypoints
+                for(size_t iC=0; iC<vCandidates.size(); iC++)
+                {
+                    const size_t idx = vCandidates[iC];
+                    const int dist = vDist[iC];
 
                     if(dist<bestDist)
                     {
@@ -147,13 +172,32 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
             if(nPredictedLevel != -1){
                 float r = RadiusByViewingCos(pMP->mTrackViewCosR);
 
-                const vector<size_t> vIndices =
-                        F.GetFeaturesInArea(pMP->mTrackProjXR,pMP->mTrackProjYR,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel,true);
+                F.GetFeaturesInArea(pMP->mTrackProjXR,pMP->mTrackProjYR,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel,true,vIndices);
 
                 if(vIndices.empty())
                     continue;
 
-                const cv::Mat MPdescriptor = pMP->GetDescriptor();
+                vCandidates.clear();
+                for(size_t iC=0; iC<vIndices.size(); iC++)
+                {
+                    const size_t idx = vIndices[iC];
+
+                    if(F.mvpMapPoints[idx + F.Nleft])
+                        if(F.mvpMapPoints[idx + F.Nleft]->Observations()>0)
+                            continue;
+
+                    vCandidates.push_back(idx);
+                }
+
+                // right descriptors follow the left ones
+                if(vDist.size() < vCandidates.size())
+                    vDist.resize(vCandidates.size());
+                if(!vCandidates.empty())
+                {
+                    pMP->GetDescriptor(MPdescriptor);
+                    kernels.DescriptorDistances(MPdescriptor,F.mDescriptors.ptr<uchar>(F.Nleft),F.mDescriptors.step,
+                                                &vCandidates[0],vCandidates.size(),&vDist[0]);
+                }
 
                 int bestDist=256;
                 int bestLevel= -1;
@@ -162,18 +206,10 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
                 int bestIdx =-1 ;
 
                 // Get best and second matches with near keypoints
-                for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
+                for(size_t iC=0; iC<vCandidates.size(); iC++)
                 {
-                    const size_t idx = *vit;
-
-                    if(F.mvpMapPoints[idx + F.Nleft])
-                        if(F.mvpMapPoints[idx + F.Nleft]->Observations()>0)
-                            continue;
-
-
-                    const cv::Mat &d = F.mDescriptors.row(idx + F.Nleft);
-
-                    const int dist = DescriptorDistance(MPdescriptor,d);
+                    const size_t idx = vCandidates[iC];
+                    const int dist = vDist[iC];
 
                     if(dist<bestDist)
                     {
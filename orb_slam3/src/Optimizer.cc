@@ -35,8 +35,16 @@
 #include "Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"
 #include "Thirdparty/g2o/g2o/core/robust_kernel_impl.h"
 #include "Thirdparty/g2o/g2o/solvers/linear_solver_dense.h"
+#ifdef G2O_HAVE_CHOLMOD
+#include "Thirdparty/g2o/g2o/solvers/linear_solver_cholmod.h"
+#endif
 #include "G2oTypes.h"
 #include "Converter.h"
+#include "LocalBAProblem.h"
+#include "LocalBAGraph.h"
+#include "G2oArena.h"
+#include "PoseOnlySolver.h"
+#include "PoseInertialSolver.h"
 
 #include<mutex>
 
@@ -51,6 +59,89 @@ bool sortByVal(const pair<MapPoint*, int> &a, const pair<MapPoint*, int> &b)
     return (a.second < b.second);
 }
 
+int Optimizer::mnLocalBAThreads = 1;
+std::string Optimizer::mStrLocalBARecordDir;
+
+void Optimizer::SetLocalBAThreads(int nThreads)
+{
+    mnLocalBAThreads = max(nThreads,1);
+}
+
+void Optimizer::SetLocalBARecordDir(const std::string &strDir)
+{
+    mStrLocalBARecordDir = strDir;
+}
+
+LocalBAGraph* Optimizer::mpLocalBAGraph = NULL;
+
+void Optimizer::SetIncrementalLocalBA(bool bIncremental)
+{
+    if(bIncremental && !mpLocalBAGraph)
+        mpLocalBAGraph = new LocalBAGraph();
+    else if(!bIncremental && mpLocalBAGraph)
+    {
+        delete mpLocalBAGraph;
+        mpLocalBAGraph = NULL;
+    }
+}
+
+Optimizer::eLinearSolver Optimizer::meLinearSolver[Optimizer::OPT_NUM] = {LS_EIGEN, LS_EIGEN, LS_EIGEN, LS_EIGEN, LS_EIGEN};
+
+bool Optimizer::SetLinearSolver(eOptimization opt, const std::string &strName)
+{
+    eLinearSolver eSolver;
+    if(strName == "eigen")
+        eSolver = LS_EIGEN;
+    else if(strName == "eigen_block_amd")
+        eSolver = LS_EIGEN_BLOCK_AMD;
+    else if(strName == "cholmod_amd")
+        eSolver = LS_CHOLMOD_AMD;
+    else if(strName == "cholmod_metis")
+        eSolver = LS_CHOLMOD_METIS;
+    else
+    {
+        cerr << "Unknown linear solver " << strName << endl;
+        return false;
+    }
+
+#ifndef G2O_HAVE_CHOLMOD
+    if(eSolver == LS_CHOLMOD_AMD || eSolver == LS_CHOLMOD_METIS)
+    {
+        cerr << "Linear solver " << strName << " needs CHOLMOD, which was not found at build time" << endl;
+        return false;
+    }
+#endif
+
+    meLinearSolver[opt] = eSolver;
+    return true;
+}
+
+template<typename MatrixType>
+g2o::LinearSolver<MatrixType>* Optimizer::CreateLinearSolver(eOptimization opt)
+{
+    switch(meLinearSolver[opt])
+    {
+#ifdef G2O_HAVE_CHOLMOD
+    case LS_CHOLMOD_AMD:
+    case LS_CHOLMOD_METIS:
+    {
+        g2o::LinearSolverCholmod<MatrixType>* pSolver = new g2o::LinearSolverCholmod<MatrixType>();
+        pSolver->setOrdering(meLinearSolver[opt] == LS_CHOLMOD_METIS ? g2o::LinearSolverCholmod<MatrixType>::METIS
+                                                                      : g2o::LinearSolverCholmod<MatrixType>::AMD);
+        return pSolver;
+    }
+#endif
+    case LS_EIGEN_BLOCK_AMD:
+    {
+        g2o::LinearSolverEigen<MatrixType>* pSolver = new g2o::LinearSolverEigen<MatrixType>();
+        pSolver->setBlockOrdering(true);
+        return pSolver;
+    }
+    default:
+        return new g2o::LinearSolverEigen<MatrixType>();
+    }
+}
+
 void Optimizer::GlobalBundleAdjustemnt(Map* pMap, int nIterations, bool* pbStopFlag, const unsigned long nLoopKF, const bool bRobust)
 {
     vector<KeyFrame*> vpKFs = pMap->GetAllKeyFrames();
@@ -70,7 +161,7 @@ void Optimizer::BundleAdjustment(const vector<KeyFrame *> &vpKFs, const vector<M
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_GLOBAL_BA);
 
     g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
 
@@ -404,7 +495,7 @@ void Optimizer::FullInertialBA(Map *pMap, int its, const bool bFixLocal, const l
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_FULL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -830,39 +921,33 @@ void Optimizer::FullInertialBA(Map *pMap, int its, const bool bFixLocal, const l
 
 int Optimizer::PoseOptimization(Frame *pFrame)
 {
-    g2o::SparseOptimizer optimizer;
-    g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
-
-    linearSolver = new g2o::LinearSolverDense<g2o::BlockSolver_6_3::PoseMatrixType>();
-
-    g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
-
-    g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
-    optimizer.setAlgorithm(solver);
+    // Dedicated fixed-size solver, same LM iterations as the g2o graph of a single VertexSE3Expmap
+    PoseOnlySolver &solver = PoseOnlySolver::ThreadSolver();
+    solver.Clear();
+    PoseOnlyTerms &terms = solver.Terms();
+    terms.SetCamera(0, pFrame->mpCamera, Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero());
+    if(pFrame->mpCamera2)
+    {
+        const g2o::SE3Quat Trl = Converter::toSE3Quat(pFrame->mTrl);
+        terms.SetCamera(1, pFrame->mpCamera2, Trl.rotation().toRotationMatrix(), Trl.translation());
+    }
+    terms.SetStereoBaseline(pFrame->mbf);
 
     int nInitialCorrespondences=0;
 
-    // Set Frame vertex
-    g2o::VertexSE3Expmap * vSE3 = new g2o::VertexSE3Expmap();
-    vSE3->setEstimate(Converter::toSE3Quat(pFrame->mTcw));
-    vSE3->setId(0);
-    vSE3->setFixed(false);
-    optimizer.addVertex(vSE3);
-
-    // Set MapPoint vertices
+    // Set MapPoint terms
     const int N = pFrame->N;
 
-    vector<ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose*> vpEdgesMono;
-    vector<ORB_SLAM3::EdgeSE3ProjectXYZOnlyPoseToBody *> vpEdgesMono_FHR;
+    vector<size_t> vnTermsMono, vnTermsRight;
     vector<size_t> vnIndexEdgeMono, vnIndexEdgeRight;
-    vpEdgesMono.reserve(N);
-    vpEdgesMono_FHR.reserve(N);
+    vnTermsMono.reserve(N);
+    vnTermsRight.reserve(N);
     vnIndexEdgeMono.reserve(N);
     vnIndexEdgeRight.reserve(N);
 
-    vector<g2o::EdgeStereoSE3ProjectXYZOnlyPose*> vpEdgesStereo;
+    vector<size_t> vnTermsStereo;
     vector<size_t> vnIndexEdgeStereo;
-    vpEdgesStereo.reserve(N);
+    vnTermsStereo.reserve(N);
     vnIndexEdgeStereo.reserve(N);
 
     const float deltaMono = sqrt(5.991);
@@ -888,26 +973,8 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                     const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose* e = new ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose();
-
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(0)));
-                    e->setMeasurement(obs);
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave];
-                    e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(deltaMono);
-
-                    e->pCamera = pFrame->mpCamera;
-                    cv::Mat Xw = pMP->GetWorldPos();
-                    e->Xw[0] = Xw.at<float>(0);
-                    e->Xw[1] = Xw.at<float>(1);
-                    e->Xw[2] = Xw.at<float>(2);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, deltaMono));
                     vnIndexEdgeMono.push_back(i);
                 }
                 else  // Stereo observation
@@ -915,37 +982,13 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                     nInitialCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
-                    //SET EDGE
                     Eigen::Matrix<double,3,1> obs;
                     const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
                     const float &kp_ur = pFrame->mvuRight[i];
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
-                    g2o::EdgeStereoSE3ProjectXYZOnlyPose* e = new g2o::EdgeStereoSE3ProjectXYZOnlyPose();
-
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(0)));
-                    e->setMeasurement(obs);
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave];
-                    Eigen::Matrix3d Info = Eigen::Matrix3d::Identity()*invSigma2;
-                    e->setInformation(Info);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(deltaStereo);
-
-                    e->fx = pFrame->fx;
-                    e->fy = pFrame->fy;
-                    e->cx = pFrame->cx;
-                    e->cy = pFrame->cy;
-                    e->bf = pFrame->mbf;
-                    cv::Mat Xw = pMP->GetWorldPos();
-                    e->Xw[0] = Xw.at<float>(0);
-                    e->Xw[1] = Xw.at<float>(1);
-                    e->Xw[2] = Xw.at<float>(2);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesStereo.push_back(e);
+                    vnTermsStereo.push_back(terms.AddStereo(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, deltaStereo));
                     vnIndexEdgeStereo.push_back(i);
                 }
             }
@@ -963,26 +1006,8 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                     Eigen::Matrix<double, 2, 1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose *e = new ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose();
-
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex *>(optimizer.vertex(0)));
-                    e->setMeasurement(obs);
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave];
-                    e->setInformation(Eigen::Matrix2d::Identity() * invSigma2);
-
-                    g2o::RobustKernelHuber *rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(deltaMono);
-
-                    e->pCamera = pFrame->mpCamera;
-                    cv::Mat Xw = pMP->GetWorldPos();
-                    e->Xw[0] = Xw.at<float>(0);
-                    e->Xw[1] = Xw.at<float>(1);
-                    e->Xw[2] = Xw.at<float>(2);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, deltaMono, 0));
                     vnIndexEdgeMono.push_back(i);
                 }
                 else {   //Right camera observation
@@ -993,28 +1018,8 @@ int Optimizer::PoseOptimization(Frame *pFrame)
 
                     pFrame->mvbOutlier[i] = false;
 
-                    ORB_SLAM3::EdgeSE3ProjectXYZOnlyPoseToBody *e = new ORB_SLAM3::EdgeSE3ProjectXYZOnlyPoseToBody();
-
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex *>(optimizer.vertex(0)));
-                    e->setMeasurement(obs);
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave];
-                    e->setInformation(Eigen::Matrix2d::Identity() * invSigma2);
-
-                    g2o::RobustKernelHuber *rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(deltaMono);
-
-                    e->pCamera = pFrame->mpCamera2;
-                    cv::Mat Xw = pMP->GetWorldPos();
-                    e->Xw[0] = Xw.at<float>(0);
-                    e->Xw[1] = Xw.at<float>(1);
-                    e->Xw[2] = Xw.at<float>(2);
-
-                    e->mTrl = Converter::toSE3Quat(pFrame->mTrl);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono_FHR.push_back(e);
+                    vnTermsRight.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, deltaMono, 1));
                     vnIndexEdgeRight.push_back(i);
                 }
             }
@@ -1035,106 +1040,85 @@ int Optimizer::PoseOptimization(Frame *pFrame)
     for(size_t it=0; it<4; it++)
     {
 
-        vSE3->setEstimate(Converter::toSE3Quat(pFrame->mTcw));
-        optimizer.initializeOptimization(0);
-        optimizer.optimize(its[it]);
+        solver.SetEstimate(Converter::toSE3Quat(pFrame->mTcw));
+        solver.Optimize(its[it]);
+
+        // Outliers are evaluated at the optimized pose, the inliers keep the errors of the last iteration
+        solver.ComputeErrors(true);
 
         nBad=0;
-        for(size_t i=0, iend=vpEdgesMono.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsMono.size(); i<iend; i++)
         {
-            ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose* e = vpEdgesMono[i];
+            const size_t t = vnTermsMono[i];
 
             const size_t idx = vnIndexEdgeMono[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
 
             if(chi2>chi2Mono[it])
             {                
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBad++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
             }
-
-            if(it==2)
-                e->setRobustKernel(0);
         }
 
-        for(size_t i=0, iend=vpEdgesMono_FHR.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsRight.size(); i<iend; i++)
         {
-            ORB_SLAM3::EdgeSE3ProjectXYZOnlyPoseToBody* e = vpEdgesMono_FHR[i];
+            const size_t t = vnTermsRight[i];
 
             const size_t idx = vnIndexEdgeRight[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
 
             if(chi2>chi2Mono[it])
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBad++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
             }
-
-            if(it==2)
-                e->setRobustKernel(0);
         }
 
-        for(size_t i=0, iend=vpEdgesStereo.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsStereo.size(); i<iend; i++)
         {
-            g2o::EdgeStereoSE3ProjectXYZOnlyPose* e = vpEdgesStereo[i];
+            const size_t t = vnTermsStereo[i];
 
             const size_t idx = vnIndexEdgeStereo[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
 
             if(chi2>chi2Stereo[it])
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBad++;
             }
             else
             {                
-                e->setLevel(0);
+                terms.SetLevel(t,0);
                 pFrame->mvbOutlier[idx]=false;
             }
-
-            if(it==2)
-                e->setRobustKernel(0);
         }
 
-        if(optimizer.edges().size()<10)
+        if(it==2)
+            terms.SetRobust(false);
+
+        if(terms.size()<10)
             break;
     }    
 
     // Recover optimized pose and return number of inliers
-    g2o::VertexSE3Expmap* vSE3_recov = static_cast<g2o::VertexSE3Expmap*>(optimizer.vertex(0));
-    g2o::SE3Quat SE3quat_recov = vSE3_recov->estimate();
-    cv::Mat pose = Converter::toCvMat(SE3quat_recov);
+    cv::Mat pose = Converter::toCvMat(solver.GetEstimate());
     pFrame->SetPose(pose);
 
     return nInitialCorrespondences-nBad;
@@ -1269,7 +1253,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, vector<Ke
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_LOCAL_BA);
 
     g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
 
@@ -1756,37 +1740,38 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
         return;
     }
 
-    // Setup optimizer
-    g2o::SparseOptimizer optimizer;
-    g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
+    // Setup optimizer. The graph is either built for this call only or kept from the previous window
+    // (SetIncrementalLocalBA), the vertices and edges below are then only refreshed if they already exist.
+    LocalBAGraph localGraph;
+    LocalBAGraph &graph = mpLocalBAGraph ? *mpLocalBAGraph : localGraph;
+    g2o::SparseOptimizer &optimizer = graph.GetOptimizer();
+    if(!optimizer.algorithm())
+    {
+        g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+        linearSolver = CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_LOCAL_BA);
 
-    g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
+        g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
 
-    g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
-    if (pMap->IsInertial())
-        solver->setUserLambdaInit(100.0);
+        optimizer.setAlgorithm(new g2o::OptimizationAlgorithmLevenberg(solver_ptr));
+    }
+    static_cast<g2o::OptimizationAlgorithmLevenberg*>(optimizer.solver())->setUserLambdaInit(pMap->IsInertial() ? 100.0 : 0.0);
 
-    optimizer.setAlgorithm(solver);
     optimizer.setVerbose(false);
+    optimizer.setNumThreads(mnLocalBAThreads);
 
     if(pbStopFlag)
         optimizer.setForceStopFlag(pbStopFlag);
 
-    unsigned long maxKFid = 0;
+    graph.BeginWindow();
 
     // Set Local KeyFrame vertices
     for(list<KeyFrame*>::iterator lit=lLocalKeyFrames.begin(), lend=lLocalKeyFrames.end(); lit!=lend; lit++)
     {
         KeyFrame* pKFi = *lit;
-        g2o::VertexSE3Expmap * vSE3 = new g2o::VertexSE3Expmap();
+        g2o::VertexSE3Expmap * vSE3 = graph.AddKeyFrame(pKFi->mnId);
         vSE3->setEstimate(Converter::toSE3Quat(pKFi->GetPose()));
-        vSE3->setId(pKFi->mnId);
         vSE3->setFixed(pKFi->mnId==pMap->GetInitKFid());
-        optimizer.addVertex(vSE3);
-        if(pKFi->mnId>maxKFid)
-            maxKFid=pKFi->mnId;
     }
     num_OptKF = lLocalKeyFrames.size();
 
@@ -1794,13 +1779,9 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     for(list<KeyFrame*>::iterator lit=lFixedCameras.begin(), lend=lFixedCameras.end(); lit!=lend; lit++)
     {
         KeyFrame* pKFi = *lit;
-        g2o::VertexSE3Expmap * vSE3 = new g2o::VertexSE3Expmap();
+        g2o::VertexSE3Expmap * vSE3 = graph.AddKeyFrame(pKFi->mnId);
         vSE3->setEstimate(Converter::toSE3Quat(pKFi->GetPose()));
-        vSE3->setId(pKFi->mnId);
         vSE3->setFixed(true);
-        optimizer.addVertex(vSE3);
-        if(pKFi->mnId>maxKFid)
-            maxKFid=pKFi->mnId;
     }
 
     // Set MapPoint vertices
@@ -1843,12 +1824,8 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     for(list<MapPoint*>::iterator lit=lLocalMapPoints.begin(), lend=lLocalMapPoints.end(); lit!=lend; lit++)
     {
         MapPoint* pMP = *lit;
-        g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
+        g2o::VertexSBAPointXYZ* vPoint = graph.AddMapPoint(pMP->mnId);
         vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
-        int id = pMP->mnId+maxKFid+1;
-        vPoint->setId(id);
-        vPoint->setMarginalized(true);
-        optimizer.addVertex(vPoint);
         nPoints++;
 
         const map<KeyFrame*,tuple<int,int>> observations = pMP->GetObservations();
@@ -1869,21 +1846,18 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    ORB_SLAM3::EdgeSE3ProjectXYZ* e = new ORB_SLAM3::EdgeSE3ProjectXYZ();
+                    ORB_SLAM3::EdgeSE3ProjectXYZ* e = graph.AddMonoEdge(pMP->mnId,pKFi->mnId);
+                    if(!e) // keyframe not in the window
+                        continue;
 
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
-                    e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
                     e->setMeasurement(obs);
                     const float &invSigma2 = pKFi->mvInvLevelSigma2[kpUn.octave];
                     e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
 
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberMono);
+                    static_cast<g2o::RobustKernelHuber*>(e->robustKernel())->setDelta(thHuberMono);
 
                     e->pCamera = pKFi->mpCamera;
 
-                    optimizer.addEdge(e);
                     vpEdgesMono.push_back(e);
                     vpEdgeKFMono.push_back(pKFi);
                     vpMapPointEdgeMono.push_back(pMP);
@@ -1897,18 +1871,16 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
                     const float kp_ur = pKFi->mvuRight[get<0>(mit->second)];
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
-                    g2o::EdgeStereoSE3ProjectXYZ* e = new g2o::EdgeStereoSE3ProjectXYZ();
+                    g2o::EdgeStereoSE3ProjectXYZ* e = graph.AddStereoEdge(pMP->mnId,pKFi->mnId);
+                    if(!e) // keyframe not in the window
+                        continue;
 
-                    e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
-                    e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
                     e->setMeasurement(obs);
                     const float &invSigma2 = pKFi->mvInvLevelSigma2[kpUn.octave];
                     Eigen::Matrix3d Info = Eigen::Matrix3d::Identity()*invSigma2;
                     e->setInformation(Info);
 
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberStereo);
+                    static_cast<g2o::RobustKernelHuber*>(e->robustKernel())->setDelta(thHuberStereo);
 
                     e->fx = pKFi->fx;
                     e->fy = pKFi->fy;
@@ -1916,7 +1888,6 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
                     e->cy = pKFi->cy;
                     e->bf = pKFi->mbf;
 
-                    optimizer.addEdge(e);
                     vpEdgesStereo.push_back(e);
                     vpEdgeKFStereo.push_back(pKFi);
                     vpMapPointEdgeStereo.push_back(pMP);
@@ -1934,23 +1905,20 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
                         cv::KeyPoint kp = pKFi->mvKeysRight[rightIndex];
                         obs << kp.pt.x, kp.pt.y;
 
-                        ORB_SLAM3::EdgeSE3ProjectXYZToBody *e = new ORB_SLAM3::EdgeSE3ProjectXYZToBody();
+                        ORB_SLAM3::EdgeSE3ProjectXYZToBody *e = graph.AddBodyEdge(pMP->mnId,pKFi->mnId);
+                        if(!e) // keyframe not in the window
+                            continue;
 
-                        e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
-                        e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
                         e->setMeasurement(obs);
                         const float &invSigma2 = pKFi->mvInvLevelSigma2[kp.octave];
                         e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
 
-                        g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                        e->setRobustKernel(rk);
-                        rk->setDelta(thHuberMono);
+                        static_cast<g2o::RobustKernelHuber*>(e->robustKernel())->setDelta(thHuberMono);
 
                         e->mTrl = Converter::toSE3Quat(pKFi->mTrl);
 
                         e->pCamera = pKFi->mpCamera2;
 
-                        optimizer.addEdge(e);
                         vpEdgesBody.push_back(e);
                         vpEdgeKFBody.push_back(pKFi);
                         vpMapPointEdgeBody.push_back(pMP);
@@ -1963,12 +1931,20 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     }
     num_edges = nEdges;
 
+    graph.EndWindow();
+    Verbose::PrintMess("LM-LBA: graph vertices " + to_string(graph.mnReusedVertices) + " kept, " + to_string(graph.mnNewVertices) +
+                       " added, " + to_string(graph.mnRemovedVertices) + " removed; edges " + to_string(graph.mnReusedEdges) + " kept, " +
+                       to_string(graph.mnNewEdges) + " added, " + to_string(graph.mnRemovedEdges) + " removed", Verbose::VERBOSITY_DEBUG);
+
     if(pbStopFlag)
         if(*pbStopFlag)
             return;
 
     optimizer.initializeOptimization();
 
+    if(!mStrLocalBARecordDir.empty())
+        LocalBAProblem::Save(mStrLocalBARecordDir + "/local_ba_" + to_string(pKF->mnId) + ".txt", optimizer);
+
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
     optimizer.optimize(5);
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
@@ -2103,7 +2079,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     for(list<KeyFrame*>::iterator lit=lLocalKeyFrames.begin(), lend=lLocalKeyFrames.end(); lit!=lend; lit++)
     {
         KeyFrame* pKFi = *lit;
-        g2o::VertexSE3Expmap* vSE3 = static_cast<g2o::VertexSE3Expmap*>(optimizer.vertex(pKFi->mnId));
+        g2o::VertexSE3Expmap* vSE3 = static_cast<g2o::VertexSE3Expmap*>(optimizer.vertex(LocalBAGraph::KeyFrameVertexId(pKFi->mnId)));
         g2o::SE3Quat SE3quat = vSE3->estimate();
         pKFi->SetPose(Converter::toCvMat(SE3quat));
 
@@ -2113,7 +2089,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     for(list<MapPoint*>::iterator lit=lLocalMapPoints.begin(), lend=lLocalMapPoints.end(); lit!=lend; lit++)
     {
         MapPoint* pMP = *lit;
-        g2o::VertexSBAPointXYZ* vPoint = static_cast<g2o::VertexSBAPointXYZ*>(optimizer.vertex(pMP->mnId+maxKFid+1));
+        g2o::VertexSBAPointXYZ* vPoint = static_cast<g2o::VertexSBAPointXYZ*>(optimizer.vertex(LocalBAGraph::MapPointVertexId(pMP->mnId)));
         pMP->SetWorldPos(Converter::toCvMat(vPoint->estimate()));
         pMP->UpdateNormalAndDepth();
     }
@@ -2132,7 +2108,7 @@ void Optimizer::OptimizeEssentialGraph(Map* pMap, KeyFrame* pLoopKF, KeyFrame* p
     g2o::SparseOptimizer optimizer;
     optimizer.setVerbose(false);
     g2o::BlockSolver_7_3::LinearSolverType * linearSolver =
-           new g2o::LinearSolverEigen<g2o::BlockSolver_7_3::PoseMatrixType>();
+           CreateLinearSolver<g2o::BlockSolver_7_3::PoseMatrixType>(OPT_ESSENTIAL_GRAPH);
     g2o::BlockSolver_7_3 * solver_ptr= new g2o::BlockSolver_7_3(linearSolver);
     g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
 
@@ -2437,7 +2413,7 @@ void Optimizer::OptimizeEssentialGraph6DoF(KeyFrame* pCurKF, vector<KeyFrame*> &
     g2o::SparseOptimizer optimizer;
     optimizer.setVerbose(false);
     g2o::BlockSolver_6_3::LinearSolverType * linearSolver =
-           new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+           CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_ESSENTIAL_GRAPH);
     g2o::BlockSolver_6_3 * solver_ptr= new g2o::BlockSolver_6_3(linearSolver);
     g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
 
@@ -2759,7 +2735,7 @@ void Optimizer::OptimizeEssentialGraph(KeyFrame* pCurKF, vector<KeyFrame*> &vpFi
     g2o::SparseOptimizer optimizer;
     optimizer.setVerbose(false);
     g2o::BlockSolver_7_3::LinearSolverType * linearSolver =
-           new g2o::LinearSolverEigen<g2o::BlockSolver_7_3::PoseMatrixType>();
+           CreateLinearSolver<g2o::BlockSolver_7_3::PoseMatrixType>(OPT_ESSENTIAL_GRAPH);
     g2o::BlockSolver_7_3 * solver_ptr= new g2o::BlockSolver_7_3(linearSolver);
     g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
 
@@ -3037,7 +3013,7 @@ void Optimizer::OptimizeEssentialGraph(KeyFrame* pCurKF,
     g2o::SparseOptimizer optimizer;
     optimizer.setVerbose(false);
     g2o::BlockSolver_7_3::LinearSolverType * linearSolver =
-           new g2o::LinearSolverEigen<g2o::BlockSolver_7_3::PoseMatrixType>();
+           CreateLinearSolver<g2o::BlockSolver_7_3::PoseMatrixType>(OPT_ESSENTIAL_GRAPH);
     g2o::BlockSolver_7_3 * solver_ptr= new g2o::BlockSolver_7_3(linearSolver);
     g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
 
@@ -4101,8 +4077,10 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
 
     // Setup optimizer
     g2o::SparseOptimizer optimizer;
+    G2oArena &arena = G2oArena::ThreadArena();
+    G2oArena::Scope arenaScope(arena, optimizer);
     g2o::BlockSolverX::LinearSolverType * linearSolver;
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_LOCAL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -4118,6 +4096,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
         solver->setUserLambdaInit(1e0);
         optimizer.setAlgorithm(solver);
     }
+    optimizer.setNumThreads(mnLocalBAThreads);
 
 
     // Set Local temporal KeyFrame vertices
@@ -4130,22 +4109,22 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
     {
         KeyFrame* pKFi = vpOptimizableKFs[i];
 
-        VertexPose * VP = new VertexPose(pKFi);
+        VertexPose * VP = arena.New<VertexPose>(pKFi);
         VP->setId(pKFi->mnId);
         VP->setFixed(false);
         optimizer.addVertex(VP);
 
         if(pKFi->bImu)
         {
-            VertexVelocity* VV = new VertexVelocity(pKFi);
+            VertexVelocity* VV = arena.New<VertexVelocity>(pKFi);
             VV->setId(maxKFid+3*(pKFi->mnId)+1);
             VV->setFixed(false);
             optimizer.addVertex(VV);
-            VertexGyroBias* VG = new VertexGyroBias(pKFi);
+            VertexGyroBias* VG = arena.New<VertexGyroBias>(pKFi);
             VG->setId(maxKFid+3*(pKFi->mnId)+2);
             VG->setFixed(false);
             optimizer.addVertex(VG);
-            VertexAccBias* VA = new VertexAccBias(pKFi);
+            VertexAccBias* VA = arena.New<VertexAccBias>(pKFi);
             VA->setId(maxKFid+3*(pKFi->mnId)+3);
             VA->setFixed(false);
             optimizer.addVertex(VA);
@@ -4157,7 +4136,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
     for(list<KeyFrame*>::iterator it=lpOptVisKFs.begin(), itEnd = lpOptVisKFs.end(); it!=itEnd; it++)
     {
         KeyFrame* pKFi = *it;
-        VertexPose * VP = new VertexPose(pKFi);
+        VertexPose * VP = arena.New<VertexPose>(pKFi);
         VP->setId(pKFi->mnId);
         VP->setFixed(false);
         optimizer.addVertex(VP);
@@ -4169,22 +4148,22 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
     for(list<KeyFrame*>::iterator lit=lFixedKeyFrames.begin(), lend=lFixedKeyFrames.end(); lit!=lend; lit++)
     {
         KeyFrame* pKFi = *lit;
-        VertexPose * VP = new VertexPose(pKFi);
+        VertexPose * VP = arena.New<VertexPose>(pKFi);
         VP->setId(pKFi->mnId);
         VP->setFixed(true);
         optimizer.addVertex(VP);
 
         if(pKFi->bImu) // This should be done only for keyframe just before temporal window
         {
-            VertexVelocity* VV = new VertexVelocity(pKFi);
+            VertexVelocity* VV = arena.New<VertexVelocity>(pKFi);
             VV->setId(maxKFid+3*(pKFi->mnId)+1);
             VV->setFixed(true);
             optimizer.addVertex(VV);
-            VertexGyroBias* VG = new VertexGyroBias(pKFi);
+            VertexGyroBias* VG = arena.New<VertexGyroBias>(pKFi);
             VG->setId(maxKFid+3*(pKFi->mnId)+2);
             VG->setFixed(true);
             optimizer.addVertex(VG);
-            VertexAccBias* VA = new VertexAccBias(pKFi);
+            VertexAccBias* VA = arena.New<VertexAccBias>(pKFi);
             VA->setId(maxKFid+3*(pKFi->mnId)+3);
             VA->setFixed(true);
             optimizer.addVertex(VA);
@@ -4224,7 +4203,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
                 continue;
             }
 
-            vei[i] = new EdgeInertial(pKFi->mpImuPreintegrated);
+            vei[i] = arena.New<EdgeInertial>(pKFi->mpImuPreintegrated);
 
             vei[i]->setVertex(0,dynamic_cast<g2o::OptimizableGraph::Vertex*>(VP1));
             vei[i]->setVertex(1,dynamic_cast<g2o::OptimizableGraph::Vertex*>(VV1));
@@ -4247,7 +4226,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
             }
             optimizer.addEdge(vei[i]);
 
-            vegr[i] = new EdgeGyroRW();
+            vegr[i] = arena.New<EdgeGyroRW>();
             vegr[i]->setVertex(0,VG1);
             vegr[i]->setVertex(1,VG2);
             cv::Mat cvInfoG = pKFi->mpImuPreintegrated->C.rowRange(9,12).colRange(9,12).inv(cv::DECOMP_SVD);
@@ -4260,7 +4239,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
             optimizer.addEdge(vegr[i]);
             num_edges++;
 
-            vear[i] = new EdgeAccRW();
+            vear[i] = arena.New<EdgeAccRW>();
             vear[i]->setVertex(0,VA1);
             vear[i]->setVertex(1,VA2);
             cv::Mat cvInfoA = pKFi->mpImuPreintegrated->C.rowRange(12,15).colRange(12,15).inv(cv::DECOMP_SVD);
@@ -4324,7 +4303,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
     for(list<MapPoint*>::iterator lit=lLocalMapPoints.begin(), lend=lLocalMapPoints.end(); lit!=lend; lit++)
     {
         MapPoint* pMP = *lit;
-        g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
+        g2o::VertexSBAPointXYZ* vPoint = arena.New<g2o::VertexSBAPointXYZ>();
         vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
 
         unsigned long id = pMP->mnId+iniMPid+1;
@@ -4356,7 +4335,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    EdgeMono* e = new EdgeMono(0);
+                    EdgeMono* e = arena.New<EdgeMono>(0);
 
                     e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
                     e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
@@ -4389,7 +4368,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
                     Eigen::Matrix<double,3,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
-                    EdgeStereo* e = new EdgeStereo(0);
+                    EdgeStereo* e = arena.New<EdgeStereo>(0);
 
                     e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
                     e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
@@ -4425,7 +4404,7 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
                         cv::KeyPoint kp = pKFi->mvKeysRight[rightIndex];
                         obs << kp.pt.x, kp.pt.y;
 
-                        EdgeMono* e = new EdgeMono(1);
+                        EdgeMono* e = arena.New<EdgeMono>(1);
 
                         e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id)));
                         e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(pKFi->mnId)));
@@ -4535,6 +4514,9 @@ void Optimizer::LocalInertialBA(KeyFrame *pKF, bool *pbStopFlag, Map *pMap, int&
     Verbose::PrintMess("LIBA KFs: " + to_string(N), Verbose::VERBOSITY_DEBUG);
     Verbose::PrintMess("LIBA bNonFixed?: " + to_string(bNonFixed), Verbose::VERBOSITY_DEBUG);
     Verbose::PrintMess("LIBA KFs visual outliers: " + to_string(vToErase.size()), Verbose::VERBOSITY_DEBUG);
+    const G2oArena::Stats &arenaStats = arena.GetStats();
+    Verbose::PrintMess("LIBA arena: " + to_string(arenaStats.nObjects) + " objects, " + to_string(arenaStats.nBytes) + " of " +
+                       to_string(arenaStats.nCapacity) + " bytes in " + to_string(arenaStats.nBlocks) + " blocks", Verbose::VERBOSITY_DEBUG);
 
     for(list<KeyFrame*>::iterator lit=lFixedKeyFrames.begin(), lend=lFixedKeyFrames.end(); lit!=lend; lit++)
         (*lit)->mnBAFixedForKF = 0;
@@ -4714,7 +4696,7 @@ void Optimizer::InertialOptimization(Map *pMap, Eigen::Matrix3d &Rwg, double &sc
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_FULL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -4898,7 +4880,7 @@ void Optimizer::InertialOptimization(Map *pMap, Eigen::Vector3d &bg, Eigen::Vect
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_FULL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -5058,7 +5040,7 @@ void Optimizer::InertialOptimization(vector<KeyFrame*> vpKFs, Eigen::Vector3d &b
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_FULL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -5220,7 +5202,7 @@ void Optimizer::InertialOptimization(Map *pMap, Eigen::Matrix3d &Rwg, double &sc
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_FULL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -5320,7 +5302,7 @@ void Optimizer::MergeBundleAdjustmentVisual(KeyFrame* pCurrentKF, vector<KeyFram
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_LOCAL_BA);
 
     g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
 
@@ -5651,7 +5633,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame* pMainKF,vector<KeyFrame*> vpAdju
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolver_6_3::PoseMatrixType>(OPT_LOCAL_BA);
 
     g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
 
@@ -6298,7 +6280,7 @@ void Optimizer::MergeInertialBA(KeyFrame* pCurrKF, KeyFrame* pMergeKF, bool *pbS
 
     g2o::SparseOptimizer optimizer;
     g2o::BlockSolverX::LinearSolverType * linearSolver;
-    linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+    linearSolver = CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_LOCAL_INERTIAL_BA);
 
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
@@ -6716,50 +6698,33 @@ void Optimizer::MergeInertialBA(KeyFrame* pCurrKF, KeyFrame* pMergeKF, bool *pbS
 
 int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit)
 {
-    g2o::SparseOptimizer optimizer;
-    g2o::BlockSolverX::LinearSolverType * linearSolver;
-
-    linearSolver = new g2o::LinearSolverDense<g2o::BlockSolverX::PoseMatrixType>();
-
-    g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
-
-    g2o::OptimizationAlgorithmGaussNewton* solver = new g2o::OptimizationAlgorithmGaussNewton(solver_ptr);
-    optimizer.setVerbose(false);
-    optimizer.setAlgorithm(solver);
+    // Dedicated fixed-size solver, same Gauss-Newton iterations as the g2o graph of the frame states
+    PoseInertialSolver<15> &solver = PoseInertialSolver<15>::ThreadSolver();
+    solver.Clear();
+    PoseOnlyTerms &terms = solver.Terms();
 
     int nInitialMonoCorrespondences=0;
     int nInitialStereoCorrespondences=0;
     int nInitialCorrespondences=0;
 
     // Set Frame vertex
-    VertexPose* VP = new VertexPose(pFrame);
-    VP->setId(0);
-    VP->setFixed(false);
-    optimizer.addVertex(VP);
-    VertexVelocity* VV = new VertexVelocity(pFrame);
-    VV->setId(1);
-    VV->setFixed(false);
-    optimizer.addVertex(VV);
-    VertexGyroBias* VG = new VertexGyroBias(pFrame);
-    VG->setId(2);
-    VG->setFixed(false);
-    optimizer.addVertex(VG);
-    VertexAccBias* VA = new VertexAccBias(pFrame);
-    VA->setId(3);
-    VA->setFixed(false);
-    optimizer.addVertex(VA);
+    VertexPose VP(pFrame);
+    VertexVelocity VV(pFrame);
+    VertexGyroBias VG(pFrame);
+    VertexAccBias VA(pFrame);
+    solver.SetFrameVertices(&VP,&VV,&VG,&VA);
 
-    // Set MapPoint vertices
+    // Set MapPoint terms
     const int N = pFrame->N;
     const int Nleft = pFrame->Nleft;
     const bool bRight = (Nleft!=-1);
 
-    vector<EdgeMonoOnlyPose*> vpEdgesMono;
-    vector<EdgeStereoOnlyPose*> vpEdgesStereo;
+    vector<size_t> vnTermsMono;
+    vector<size_t> vnTermsStereo;
     vector<size_t> vnIndexEdgeMono;
     vector<size_t> vnIndexEdgeStereo;
-    vpEdgesMono.reserve(N);
-    vpEdgesStereo.reserve(N);
+    vnTermsMono.reserve(N);
+    vnTermsStereo.reserve(N);
     vnIndexEdgeMono.reserve(N);
     vnIndexEdgeStereo.reserve(N);
 
@@ -6791,24 +6756,11 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    EdgeMonoOnlyPose* e = new EdgeMonoOnlyPose(pMP->GetWorldPos(),0);
-
-                    e->setVertex(0,VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs);
 
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberMono);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberMono, 0));
                     vnIndexEdgeMono.push_back(i);
                 }
                 // Stereo observation
@@ -6822,24 +6774,11 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                     Eigen::Matrix<double,3,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
-                    EdgeStereoOnlyPose* e = new EdgeStereoOnlyPose(pMP->GetWorldPos());
-
-                    e->setVertex(0, VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs.head(2));
 
                     const float &invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix3d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberStereo);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesStereo.push_back(e);
+                    vnTermsStereo.push_back(terms.AddStereo(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberStereo));
                     vnIndexEdgeStereo.push_back(i);
                 }
 
@@ -6853,24 +6792,11 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    EdgeMonoOnlyPose* e = new EdgeMonoOnlyPose(pMP->GetWorldPos(),1);
-
-                    e->setVertex(0,VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs);
 
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberMono);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberMono, 1));
                     vnIndexEdgeMono.push_back(i);
                 }
             }
@@ -6878,55 +6804,43 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
     }
     nInitialCorrespondences = nInitialMonoCorrespondences + nInitialStereoCorrespondences;
 
+    // Previous keyframe states, fixed: the solver only optimizes the frame ones
     KeyFrame* pKF = pFrame->mpLastKeyFrame;
-    VertexPose* VPk = new VertexPose(pKF);
-    VPk->setId(4);
-    VPk->setFixed(true);
-    optimizer.addVertex(VPk);
-    VertexVelocity* VVk = new VertexVelocity(pKF);
-    VVk->setId(5);
-    VVk->setFixed(true);
-    optimizer.addVertex(VVk);
-    VertexGyroBias* VGk = new VertexGyroBias(pKF);
-    VGk->setId(6);
-    VGk->setFixed(true);
-    optimizer.addVertex(VGk);
-    VertexAccBias* VAk = new VertexAccBias(pKF);
-    VAk->setId(7);
-    VAk->setFixed(true);
-    optimizer.addVertex(VAk);
-
-    EdgeInertial* ei = new EdgeInertial(pFrame->mpImuPreintegrated);
-
-    ei->setVertex(0, VPk);
-    ei->setVertex(1, VVk);
-    ei->setVertex(2, VGk);
-    ei->setVertex(3, VAk);
-    ei->setVertex(4, VP);
-    ei->setVertex(5, VV);
-    optimizer.addEdge(ei);
-
-    EdgeGyroRW* egr = new EdgeGyroRW();
-    egr->setVertex(0,VGk);
-    egr->setVertex(1,VG);
+    VertexPose VPk(pKF);
+    VertexVelocity VVk(pKF);
+    VertexGyroBias VGk(pKF);
+    VertexAccBias VAk(pKF);
+
+    EdgeInertial ei(pFrame->mpImuPreintegrated);
+
+    ei.setVertex(0, &VPk);
+    ei.setVertex(1, &VVk);
+    ei.setVertex(2, &VGk);
+    ei.setVertex(3, &VAk);
+    ei.setVertex(4, &VP);
+    ei.setVertex(5, &VV);
+
+    EdgeGyroRW egr;
+    egr.setVertex(0,&VGk);
+    egr.setVertex(1,&VG);
     cv::Mat cvInfoG = pFrame->mpImuPreintegrated->C.rowRange(9,12).colRange(9,12).inv(cv::DECOMP_SVD);
     Eigen::Matrix3d InfoG;
     for(int r=0;r<3;r++)
         for(int c=0;c<3;c++)
             InfoG(r,c)=cvInfoG.at<float>(r,c);
-    egr->setInformation(InfoG);
-    optimizer.addEdge(egr);
+    egr.setInformation(InfoG);
 
-    EdgeAccRW* ear = new EdgeAccRW();
-    ear->setVertex(0,VAk);
-    ear->setVertex(1,VA);
+    EdgeAccRW ear;
+    ear.setVertex(0,&VAk);
+    ear.setVertex(1,&VA);
     cv::Mat cvInfoA = pFrame->mpImuPreintegrated->C.rowRange(12,15).colRange(12,15).inv(cv::DECOMP_SVD);
     Eigen::Matrix3d InfoA;
     for(int r=0;r<3;r++)
         for(int c=0;c<3;c++)
             InfoA(r,c)=cvInfoA.at<float>(r,c);
-    ear->setInformation(InfoA);
-    optimizer.addEdge(ear);
+    ear.setInformation(InfoA);
+
+    solver.SetInertialEdges(&ei,&egr,&ear);
 
     // We perform 4 optimizations, after each optimization we classify observation as inlier/outlier
     // At the next optimization, outliers are not included, but at the end they can be classified as inliers again.
@@ -6944,8 +6858,10 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
     bool bOut = false;
     for(size_t it=0; it<4; it++)
     {
-        optimizer.initializeOptimization(0);
-        optimizer.optimize(its[it]);
+        solver.Optimize(its[it]);
+
+        // Outliers are evaluated at the optimized states, the inliers keep the errors of the last iteration
+        solver.ComputeErrors(true);
 
         nBad=0;
         nBadMono = 0;
@@ -6956,72 +6872,60 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
         float chi2close = 1.5*chi2Mono[it];
 
         // For monocular observations
-        for(size_t i=0, iend=vpEdgesMono.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsMono.size(); i<iend; i++)
         {
-            EdgeMonoOnlyPose* e = vpEdgesMono[i];
+            const size_t t = vnTermsMono[i];
 
             const size_t idx = vnIndexEdgeMono[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
             bool bClose = pFrame->mvpMapPoints[idx]->mTrackDepth<10.f;
 
-            if((chi2>chi2Mono[it]&&!bClose)||(bClose && chi2>chi2close)||!e->isDepthPositive())
+            if((chi2>chi2Mono[it]&&!bClose)||(bClose && chi2>chi2close)||!solver.IsDepthPositive(t))
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBadMono++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
                 nInliersMono++;
             }
-
-            if (it==2)
-                e->setRobustKernel(0);
         }
 
         // For stereo observations
-        for(size_t i=0, iend=vpEdgesStereo.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsStereo.size(); i<iend; i++)
         {
-            EdgeStereoOnlyPose* e = vpEdgesStereo[i];
+            const size_t t = vnTermsStereo[i];
 
             const size_t idx = vnIndexEdgeStereo[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
 
             if(chi2>chi2Stereo[it])
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1); // not included in next optimization
+                terms.SetLevel(t,1); // not included in next optimization
                 nBadStereo++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
                 nInliersStereo++;
             }
-
-            if(it==2)
-                e->setRobustKernel(0);
         }
 
+        if(it==2)
+            terms.SetRobust(false);
+
         nInliers = nInliersMono + nInliersStereo;
         nBad = nBadMono + nBadStereo;
 
-        if(optimizer.edges().size()<10)
+        // Terms and inertial edges, as the edges of the g2o graph
+        if(terms.size()+3<10)
         {
             cout << "PIOLKF: NOT ENOUGH EDGES" << endl;
             break;
@@ -7035,14 +6939,11 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
         nBad=0;
         const float chi2MonoOut = 18.f;
         const float chi2StereoOut = 24.f;
-        EdgeMonoOnlyPose* e1;
-        EdgeStereoOnlyPose* e2;
+        solver.ComputeErrors();
         for(size_t i=0, iend=vnIndexEdgeMono.size(); i<iend; i++)
         {
             const size_t idx = vnIndexEdgeMono[i];
-            e1 = vpEdgesMono[i];
-            e1->computeError();
-            if (e1->chi2()<chi2MonoOut)
+            if (terms.Chi2(vnTermsMono[i])<chi2MonoOut)
                 pFrame->mvbOutlier[idx]=false;
             else
                 nBad++;
@@ -7050,9 +6951,7 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
         for(size_t i=0, iend=vnIndexEdgeStereo.size(); i<iend; i++)
         {
             const size_t idx = vnIndexEdgeStereo[i];
-            e2 = vpEdgesStereo[i];
-            e2->computeError();
-            if (e2->chi2()<chi2StereoOut)
+            if (terms.Chi2(vnTermsStereo[i])<chi2StereoOut)
                 pFrame->mvbOutlier[idx]=false;
             else
                 nBad++;
@@ -7060,101 +6959,84 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
     }
 
     // Recover optimized pose, velocity and biases
-    pFrame->SetImuPoseVelocity(Converter::toCvMat(VP->estimate().Rwb),Converter::toCvMat(VP->estimate().twb),Converter::toCvMat(VV->estimate()));
+    pFrame->SetImuPoseVelocity(Converter::toCvMat(VP.estimate().Rwb),Converter::toCvMat(VP.estimate().twb),Converter::toCvMat(VV.estimate()));
     Vector6d b;
-    b << VG->estimate(), VA->estimate();
+    b << VG.estimate(), VA.estimate();
     pFrame->mImuBias = IMU::Bias(b[3],b[4],b[5],b[0],b[1],b[2]);
 
     // Recover Hessian, marginalize keyFframe states and generate new prior for frame
     Eigen::Matrix<double,15,15> H;
     H.setZero();
 
-    H.block<9,9>(0,0)+= ei->GetHessian2();
-    H.block<3,3>(9,9) += egr->GetHessian2();
-    H.block<3,3>(12,12) += ear->GetHessian2();
+    H.block<9,9>(0,0)+= ei.GetHessian2();
+    H.block<3,3>(9,9) += egr.GetHessian2();
+    H.block<3,3>(12,12) += ear.GetHessian2();
 
     int tot_in = 0, tot_out = 0;
-    for(size_t i=0, iend=vpEdgesMono.size(); i<iend; i++)
+    for(size_t i=0, iend=vnTermsMono.size(); i<iend; i++)
     {
-        EdgeMonoOnlyPose* e = vpEdgesMono[i];
+        const size_t t = vnTermsMono[i];
 
         const size_t idx = vnIndexEdgeMono[i];
 
         if(!pFrame->mvbOutlier[idx])
         {
-            H.block<6,6>(0,0) += e->GetHessian();
+            H.block<6,6>(0,0) += solver.Hessian(t);
             tot_in++;
         }
         else
             tot_out++;
     }
 
-    for(size_t i=0, iend=vpEdgesStereo.size(); i<iend; i++)
+    for(size_t i=0, iend=vnTermsStereo.size(); i<iend; i++)
     {
-        EdgeStereoOnlyPose* e = vpEdgesStereo[i];
+        const size_t t = vnTermsStereo[i];
 
         const size_t idx = vnIndexEdgeStereo[i];
 
         if(!pFrame->mvbOutlier[idx])
         {
-            H.block<6,6>(0,0) += e->GetHessian();
+            H.block<6,6>(0,0) += solver.Hessian(t);
             tot_in++;
         }
         else
             tot_out++;
     }
 
-    pFrame->mpcpi = new ConstraintPoseImu(VP->estimate().Rwb,VP->estimate().twb,VV->estimate(),VG->estimate(),VA->estimate(),H);
+    pFrame->mpcpi = new ConstraintPoseImu(VP.estimate().Rwb,VP.estimate().twb,VV.estimate(),VG.estimate(),VA.estimate(),H);
 
     return nInitialCorrespondences-nBad;
 }
 
 int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
 {
-    g2o::SparseOptimizer optimizer;
-    g2o::BlockSolverX::LinearSolverType * linearSolver;
-
-    linearSolver = new g2o::LinearSolverDense<g2o::BlockSolverX::PoseMatrixType>();
-
-    g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
-
-    g2o::OptimizationAlgorithmGaussNewton* solver = new g2o::OptimizationAlgorithmGaussNewton(solver_ptr);
-    optimizer.setAlgorithm(solver);
-    optimizer.setVerbose(false);
+    // Dedicated fixed-size solver, same Gauss-Newton iterations as the g2o graph of the frame and previous frame states
+    PoseInertialSolver<30> &solver = PoseInertialSolver<30>::ThreadSolver();
+    solver.Clear();
+    PoseOnlyTerms &terms = solver.Terms();
 
     int nInitialMonoCorrespondences=0;
     int nInitialStereoCorrespondences=0;
     int nInitialCorrespondences=0;
 
     // Set Current Frame vertex
-    VertexPose* VP = new VertexPose(pFrame);
-    VP->setId(0);
-    VP->setFixed(false);
-    optimizer.addVertex(VP);
-    VertexVelocity* VV = new VertexVelocity(pFrame);
-    VV->setId(1);
-    VV->setFixed(false);
-    optimizer.addVertex(VV);
-    VertexGyroBias* VG = new VertexGyroBias(pFrame);
-    VG->setId(2);
-    VG->setFixed(false);
-    optimizer.addVertex(VG);
-    VertexAccBias* VA = new VertexAccBias(pFrame);
-    VA->setId(3);
-    VA->setFixed(false);
-    optimizer.addVertex(VA);
+    VertexPose VP(pFrame);
+    VertexVelocity VV(pFrame);
+    VertexGyroBias VG(pFrame);
+    VertexAccBias VA(pFrame);
+    solver.SetFrameVertices(&VP,&VV,&VG,&VA);
 
-    // Set MapPoint vertices
+    // Set MapPoint terms
     const int N = pFrame->N;
     const int Nleft = pFrame->Nleft;
     const bool bRight = (Nleft!=-1);
 
-    vector<EdgeMonoOnlyPose*> vpEdgesMono;
-    vector<EdgeStereoOnlyPose*> vpEdgesStereo;
+    vector<size_t> vnTermsMono;
+    vector<size_t> vnTermsStereo;
     vector<size_t> vnIndexEdgeMono;
     vector<size_t> vnIndexEdgeStereo;
-    vpEdgesMono.reserve(N);
-    vpEdgesStereo.reserve(N);
+    vnTermsMono.reserve(N);
+    vnTermsStereo.reserve(N);
     vnIndexEdgeMono.reserve(N);
     vnIndexEdgeStereo.reserve(N);
 
@@ -7184,24 +7066,11 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    EdgeMonoOnlyPose* e = new EdgeMonoOnlyPose(pMP->GetWorldPos(),0);
-
-                    e->setVertex(0,VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs);
 
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberMono);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberMono, 0));
                     vnIndexEdgeMono.push_back(i);
                 }
                 // Stereo observation
@@ -7215,24 +7084,11 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
                     Eigen::Matrix<double,3,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
-                    EdgeStereoOnlyPose* e = new EdgeStereoOnlyPose(pMP->GetWorldPos());
-
-                    e->setVertex(0, VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs.head(2));
 
                     const float &invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix3d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberStereo);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesStereo.push_back(e);
+                    vnTermsStereo.push_back(terms.AddStereo(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberStereo));
                     vnIndexEdgeStereo.push_back(i);
                 }
 
@@ -7246,24 +7102,11 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
-                    EdgeMonoOnlyPose* e = new EdgeMonoOnlyPose(pMP->GetWorldPos(),1);
-
-                    e->setVertex(0,VP);
-                    e->setMeasurement(obs);
-
                     // Add here uncerteinty
                     const float unc2 = pFrame->mpCamera->uncertainty2(obs);
 
                     const float invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave]/unc2;
-                    e->setInformation(Eigen::Matrix2d::Identity()*invSigma2);
-
-                    g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-                    e->setRobustKernel(rk);
-                    rk->setDelta(thHuberMono);
-
-                    optimizer.addEdge(e);
-
-                    vpEdgesMono.push_back(e);
+                    vnTermsMono.push_back(terms.AddMono(Converter::toVector3d(pMP->GetWorldPos()), obs, invSigma2, thHuberMono, 1));
                     vnIndexEdgeMono.push_back(i);
                 }
             }
@@ -7275,68 +7118,53 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
     // Set Previous Frame Vertex
     Frame* pFp = pFrame->mpPrevFrame;
 
-    VertexPose* VPk = new VertexPose(pFp);
-    VPk->setId(4);
-    VPk->setFixed(false);
-    optimizer.addVertex(VPk);
-    VertexVelocity* VVk = new VertexVelocity(pFp);
-    VVk->setId(5);
-    VVk->setFixed(false);
-    optimizer.addVertex(VVk);
-    VertexGyroBias* VGk = new VertexGyroBias(pFp);
-    VGk->setId(6);
-    VGk->setFixed(false);
-    optimizer.addVertex(VGk);
-    VertexAccBias* VAk = new VertexAccBias(pFp);
-    VAk->setId(7);
-    VAk->setFixed(false);
-    optimizer.addVertex(VAk);
-
-    EdgeInertial* ei = new EdgeInertial(pFrame->mpImuPreintegratedFrame);
-
-    ei->setVertex(0, VPk);
-    ei->setVertex(1, VVk);
-    ei->setVertex(2, VGk);
-    ei->setVertex(3, VAk);
-    ei->setVertex(4, VP);
-    ei->setVertex(5, VV);
-    optimizer.addEdge(ei);
-
-    EdgeGyroRW* egr = new EdgeGyroRW();
-    egr->setVertex(0,VGk);
-    egr->setVertex(1,VG);
+    VertexPose VPk(pFp);
+    VertexVelocity VVk(pFp);
+    VertexGyroBias VGk(pFp);
+    VertexAccBias VAk(pFp);
+    solver.SetPreviousVertices(&VPk,&VVk,&VGk,&VAk);
+
+    EdgeInertial ei(pFrame->mpImuPreintegratedFrame);
+
+    ei.setVertex(0, &VPk);
+    ei.setVertex(1, &VVk);
+    ei.setVertex(2, &VGk);
+    ei.setVertex(3, &VAk);
+    ei.setVertex(4, &VP);
+    ei.setVertex(5, &VV);
+
+    EdgeGyroRW egr;
+    egr.setVertex(0,&VGk);
+    egr.setVertex(1,&VG);
     cv::Mat cvInfoG = pFrame->mpImuPreintegratedFrame->C.rowRange(9,12).colRange(9,12).inv(cv::DECOMP_SVD);
     Eigen::Matrix3d InfoG;
     for(int r=0;r<3;r++)
         for(int c=0;c<3;c++)
             InfoG(r,c)=cvInfoG.at<float>(r,c);
-    egr->setInformation(InfoG);
-    optimizer.addEdge(egr);
+    egr.setInformation(InfoG);
 
-    EdgeAccRW* ear = new EdgeAccRW();
-    ear->setVertex(0,VAk);
-    ear->setVertex(1,VA);
+    EdgeAccRW ear;
+    ear.setVertex(0,&VAk);
+    ear.setVertex(1,&VA);
     cv::Mat cvInfoA = pFrame->mpImuPreintegratedFrame->C.rowRange(12,15).colRange(12,15).inv(cv::DECOMP_SVD);
     Eigen::Matrix3d InfoA;
     for(int r=0;r<3;r++)
         for(int c=0;c<3;c++)
             InfoA(r,c)=cvInfoA.at<float>(r,c);
-    ear->setInformation(InfoA);
-    optimizer.addEdge(ear);
+    ear.setInformation(InfoA);
+
+    solver.SetInertialEdges(&ei,&egr,&ear);
 
     if (!pFp->mpcpi)
         Verbose::PrintMess("pFp->mpcpi does not exist!!!\nPrevious Frame " + to_string(pFp->mnId), Verbose::VERBOSITY_NORMAL);
 
-    EdgePriorPoseImu* ep = new EdgePriorPoseImu(pFp->mpcpi);
+    EdgePriorPoseImu ep(pFp->mpcpi);
 
-    ep->setVertex(0,VPk);
-    ep->setVertex(1,VVk);
-    ep->setVertex(2,VGk);
-    ep->setVertex(3,VAk);
-    g2o::RobustKernelHuber* rkp = new g2o::RobustKernelHuber;
-    ep->setRobustKernel(rkp);
-    rkp->setDelta(5);
-    optimizer.addEdge(ep);
+    ep.setVertex(0,&VPk);
+    ep.setVertex(1,&VVk);
+    ep.setVertex(2,&VGk);
+    ep.setVertex(3,&VAk);
+    solver.SetPrior(&ep,5);
 
     // We perform 4 optimizations, after each optimization we classify observation as inlier/outlier
     // At the next optimization, outliers are not included, but at the end they can be classified as inliers again.
@@ -7353,8 +7181,10 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
     int nInliers=0;
     for(size_t it=0; it<4; it++)
     {
-        optimizer.initializeOptimization(0);
-        optimizer.optimize(its[it]);
+        solver.Optimize(its[it]);
+
+        // Outliers are evaluated at the optimized states, the inliers keep the errors of the last iteration
+        solver.ComputeErrors(true);
 
         nBad=0;
         nBadMono = 0;
@@ -7364,72 +7194,60 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
         nInliersStereo=0;
         float chi2close = 1.5*chi2Mono[it];
 
-        for(size_t i=0, iend=vpEdgesMono.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsMono.size(); i<iend; i++)
         {
-            EdgeMonoOnlyPose* e = vpEdgesMono[i];
+            const size_t t = vnTermsMono[i];
 
             const size_t idx = vnIndexEdgeMono[i];
             bool bClose = pFrame->mvpMapPoints[idx]->mTrackDepth<10.f;
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
+            const float chi2 = terms.Chi2(t);
 
-            const float chi2 = e->chi2();
-
-            if((chi2>chi2Mono[it]&&!bClose)||(bClose && chi2>chi2close)||!e->isDepthPositive())
+            if((chi2>chi2Mono[it]&&!bClose)||(bClose && chi2>chi2close)||!solver.IsDepthPositive(t))
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBadMono++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
                 nInliersMono++;
             }
 
-            if (it==2)
-                e->setRobustKernel(0);
-
         }
 
-        for(size_t i=0, iend=vpEdgesStereo.size(); i<iend; i++)
+        for(size_t i=0, iend=vnTermsStereo.size(); i<iend; i++)
         {
-            EdgeStereoOnlyPose* e = vpEdgesStereo[i];
+            const size_t t = vnTermsStereo[i];
 
             const size_t idx = vnIndexEdgeStereo[i];
 
-            if(pFrame->mvbOutlier[idx])
-            {
-                e->computeError();
-            }
-
-            const float chi2 = e->chi2();
+            const float chi2 = terms.Chi2(t);
 
             if(chi2>chi2Stereo[it])
             {
                 pFrame->mvbOutlier[idx]=true;
-                e->setLevel(1);
+                terms.SetLevel(t,1);
                 nBadStereo++;
             }
             else
             {
                 pFrame->mvbOutlier[idx]=false;
-                e->setLevel(0);
+                terms.SetLevel(t,0);
                 nInliersStereo++;
             }
-
-            if(it==2)
-                e->setRobustKernel(0);
         }
 
+        if(it==2)
+            terms.SetRobust(false);
+
         nInliers = nInliersMono + nInliersStereo;
         nBad = nBadMono + nBadStereo;
 
-        if(optimizer.edges().size()<10)
+        // Terms and inertial edges, as the edges of the g2o graph
+        if(terms.size()+4<10)
         {
             cout << "PIOLF: NOT ENOUGH EDGES" << endl;
             break;
@@ -7442,14 +7260,11 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
         nBad=0;
         const float chi2MonoOut = 18.f;
         const float chi2StereoOut = 24.f;
-        EdgeMonoOnlyPose* e1;
-        EdgeStereoOnlyPose* e2;
+        solver.ComputeErrors();
         for(size_t i=0, iend=vnIndexEdgeMono.size(); i<iend; i++)
         {
             const size_t idx = vnIndexEdgeMono[i];
-            e1 = vpEdgesMono[i];
-            e1->computeError();
-            if (e1->chi2()<chi2MonoOut)
+            if (terms.Chi2(vnTermsMono[i])<chi2MonoOut)
                 pFrame->mvbOutlier[idx]=false;
             else
                 nBad++;
@@ -7458,9 +7273,7 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
         for(size_t i=0, iend=vnIndexEdgeStereo.size(); i<iend; i++)
         {
             const size_t idx = vnIndexEdgeStereo[i];
-            e2 = vpEdgesStereo[i];
-            e2->computeError();
-            if (e2->chi2()<chi2StereoOut)
+            if (terms.Chi2(vnTermsStereo[i])<chi2StereoOut)
                 pFrame->mvbOutlier[idx]=false;
             else
                 nBad++;
@@ -7471,56 +7284,56 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
 
 
     // Recover optimized pose, velocity and biases
-    pFrame->SetImuPoseVelocity(Converter::toCvMat(VP->estimate().Rwb),Converter::toCvMat(VP->estimate().twb),Converter::toCvMat(VV->estimate()));
+    pFrame->SetImuPoseVelocity(Converter::toCvMat(VP.estimate().Rwb),Converter::toCvMat(VP.estimate().twb),Converter::toCvMat(VV.estimate()));
     Vector6d b;
-    b << VG->estimate(), VA->estimate();
+    b << VG.estimate(), VA.estimate();
     pFrame->mImuBias = IMU::Bias(b[3],b[4],b[5],b[0],b[1],b[2]);
 
     // Recover Hessian, marginalize previous frame states and generate new prior for frame
     Eigen::Matrix<double,30,30> H;
     H.setZero();
 
-    H.block<24,24>(0,0)+= ei->GetHessian();
+    H.block<24,24>(0,0)+= ei.GetHessian();
 
-    Eigen::Matrix<double,6,6> Hgr = egr->GetHessian();
+    Eigen::Matrix<double,6,6> Hgr = egr.GetHessian();
     H.block<3,3>(9,9) += Hgr.block<3,3>(0,0);
     H.block<3,3>(9,24) += Hgr.block<3,3>(0,3);
     H.block<3,3>(24,9) += Hgr.block<3,3>(3,0);
     H.block<3,3>(24,24) += Hgr.block<3,3>(3,3);
 
-    Eigen::Matrix<double,6,6> Har = ear->GetHessian();
+    Eigen::Matrix<double,6,6> Har = ear.GetHessian();
     H.block<3,3>(12,12) += Har.block<3,3>(0,0);
     H.block<3,3>(12,27) += Har.block<3,3>(0,3);
     H.block<3,3>(27,12) += Har.block<3,3>(3,0);
     H.block<3,3>(27,27) += Har.block<3,3>(3,3);
 
-    H.block<15,15>(0,0) += ep->GetHessian();
+    H.block<15,15>(0,0) += ep.GetHessian();
 
     int tot_in = 0, tot_out = 0;
-    for(size_t i=0, iend=vpEdgesMono.size(); i<iend; i++)
+    for(size_t i=0, iend=vnTermsMono.size(); i<iend; i++)
     {
-        EdgeMonoOnlyPose* e = vpEdgesMono[i];
+        const size_t t = vnTermsMono[i];
 
         const size_t idx = vnIndexEdgeMono[i];
 
         if(!pFrame->mvbOutlier[idx])
         {
-            H.block<6,6>(15,15) += e->GetHessian();
+            H.block<6,6>(15,15) += solver.Hessian(t);
             tot_in++;
         }
         else
             tot_out++;
     }
 
-    for(size_t i=0, iend=vpEdgesStereo.size(); i<iend; i++)
+    for(size_t i=0, iend=vnTermsStereo.size(); i<iend; i++)
     {
-        EdgeStereoOnlyPose* e = vpEdgesStereo[i];
+        const size_t t = vnTermsStereo[i];
 
         const size_t idx = vnIndexEdgeStereo[i];
 
         if(!pFrame->mvbOutlier[idx])
         {
-            H.block<6,6>(15,15) += e->GetHessian();
+            H.block<6,6>(15,15) += solver.Hessian(t);
             tot_in++;
         }
         else
@@ -7529,7 +7342,7 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
 
     H = Marginalize(H,0,14);
 
-    pFrame->mpcpi = new ConstraintPoseImu(VP->estimate().Rwb,VP->estimate().twb,VV->estimate(),VG->estimate(),VA->estimate(),H.block<15,15>(15,15));
+    pFrame->mpcpi = new ConstraintPoseImu(VP.estimate().Rwb,VP.estimate().twb,VV.estimate(),VG.estimate(),VA.estimate(),H.block<15,15>(15,15));
     delete pFp->mpcpi;
     pFp->mpcpi = NULL;
 
@@ -7551,7 +7364,7 @@ void Optimizer::OptimizeEssentialGraph4DoF(Map* pMap, KeyFrame* pLoopKF, KeyFram
     g2o::SparseOptimizer optimizer;
     optimizer.setVerbose(false);
     g2o::BlockSolverX::LinearSolverType * linearSolver =
-            new g2o::LinearSolverEigen<g2o::BlockSolverX::PoseMatrixType>();
+            CreateLinearSolver<g2o::BlockSolverX::PoseMatrixType>(OPT_ESSENTIAL_GRAPH);
     g2o::BlockSolverX * solver_ptr = new g2o::BlockSolverX(linearSolver);
 
     g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
@@ -0,0 +1,262 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PoseInertialSolver.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+
+// Thirdparty
+#include <Eigen/Cholesky>
+
+#include "G2oTypes.h"
+
+namespace ORB_SLAM3 {
+
+template<int D>
+PoseInertialSolver<D>::PoseInertialSolver()
+    : mTerms(PoseOnlyTerms::UPDATE_BODY)
+{
+    Clear();
+}
+
+template<int D>
+PoseInertialSolver<D>& PoseInertialSolver<D>::ThreadSolver()
+{
+    static thread_local PoseInertialSolver<D> solver;
+    return solver;
+}
+
+template<int D>
+void PoseInertialSolver<D>::Clear()
+{
+    mTerms.Clear();
+    mpVP = mpVPk = NULL;
+    mpVV = mpVVk = NULL;
+    mpVG = mpVGk = NULL;
+    mpVA = mpVAk = NULL;
+    mpEI = NULL;
+    mpEGR = NULL;
+    mpEAR = NULL;
+    mpEP = NULL;
+    mthHuberPrior = 0.;
+}
+
+template<int D>
+void PoseInertialSolver<D>::SetFrameVertices(VertexPose* VP, VertexVelocity* VV, VertexGyroBias* VG, VertexAccBias* VA)
+{
+    mpVP = VP;
+    mpVV = VV;
+    mpVG = VG;
+    mpVA = VA;
+
+    const ImuCamPose &pose = VP->estimate();
+    for(size_t c=0; c<pose.pCamera.size(); ++c)
+        mTerms.SetCamera(c, pose.pCamera[c], pose.Rcb[c], pose.tcb[c]);
+    mTerms.SetStereoBaseline(pose.bf);
+}
+
+template<int D>
+void PoseInertialSolver<D>::SetPreviousVertices(VertexPose* VPk, VertexVelocity* VVk, VertexGyroBias* VGk, VertexAccBias* VAk)
+{
+    mpVPk = VPk;
+    mpVVk = VVk;
+    mpVGk = VGk;
+    mpVAk = VAk;
+}
+
+template<int D>
+void PoseInertialSolver<D>::SetInertialEdges(EdgeInertial* ei, EdgeGyroRW* egr, EdgeAccRW* ear)
+{
+    mpEI = ei;
+    mpEGR = egr;
+    mpEAR = ear;
+    MapJacobians();
+}
+
+template<int D>
+void PoseInertialSolver<D>::SetPrior(EdgePriorPoseImu* ep, double thHuber)
+{
+    mpEP = ep;
+    mthHuberPrior = thHuber;
+    MapJacobians();
+}
+
+template<int D>
+void PoseInertialSolver<D>::MapJacobians()
+{
+    // The edges share the workspace as in the g2o solvers, their Jacobians are read right after each linearization
+    g2o::OptimizableGraph::Edge* vpEdges[4] = {mpEI, mpEGR, mpEAR, mpEP};
+    for(int i=0; i<4; ++i)
+        if(vpEdges[i])
+            mWorkspace.updateSize(vpEdges[i]);
+    mWorkspace.allocate();
+    for(int i=0; i<4; ++i)
+        if(vpEdges[i])
+            vpEdges[i]->linearizeOplus(mWorkspace);
+}
+
+template<int D>
+void PoseInertialSolver<D>::GetBodyPose(Eigen::Matrix3d &Rbw, Eigen::Vector3d &tbw) const
+{
+    const ImuCamPose &pose = mpVP->estimate();
+    Rbw = pose.Rwb.transpose();
+    tbw = -Rbw*pose.twb;
+}
+
+template<int D>
+void PoseInertialSolver<D>::ComputeErrors(bool bOnlyInactive)
+{
+    Eigen::Matrix3d Rbw;
+    Eigen::Vector3d tbw;
+    GetBodyPose(Rbw, tbw);
+    mTerms.ComputeErrors(Rbw, tbw, bOnlyInactive);
+}
+
+template<int D>
+bool PoseInertialSolver<D>::IsDepthPositive(size_t i) const
+{
+    Eigen::Matrix3d Rbw;
+    Eigen::Vector3d tbw;
+    GetBodyPose(Rbw, tbw);
+    return mTerms.IsDepthPositive(i, Rbw, tbw);
+}
+
+template<int D>
+PoseOnlyTerms::Matrix6d PoseInertialSolver<D>::Hessian(size_t i) const
+{
+    Eigen::Matrix3d Rbw;
+    Eigen::Vector3d tbw;
+    GetBodyPose(Rbw, tbw);
+    return mTerms.Hessian(i, Rbw, tbw);
+}
+
+template<int D>
+int PoseInertialSolver<D>::Optimize(int nIterations)
+{
+    const int F = mnFrame;
+    const bool bPrevious = (D==30);
+
+    int it=0;
+    for(; it<nIterations; ++it)
+    {
+        // Errors at the current estimate
+        Eigen::Matrix3d Rbw;
+        Eigen::Vector3d tbw;
+        GetBodyPose(Rbw, tbw);
+        mTerms.ComputeErrors(Rbw, tbw);
+        mpEI->computeError();
+        mpEGR->computeError();
+        mpEAR->computeError();
+        if(mpEP)
+            mpEP->computeError();
+
+        MatrixD H = MatrixD::Zero();
+        VectorD b = VectorD::Zero();
+
+        // Reprojection terms on the frame pose
+        PoseOnlyTerms::Matrix6d Hp = PoseOnlyTerms::Matrix6d::Zero();
+        PoseOnlyTerms::Vector6d bp = PoseOnlyTerms::Vector6d::Zero();
+        mTerms.BuildSystem(Rbw, tbw, Hp, bp);
+        H.template block<6,6>(F,F) += Hp;
+        b.template segment<6>(F) += bp;
+
+        // Preintegration, columns [VPk VVk VGk VAk VP VV]
+        {
+            const Eigen::Matrix<double,9,24> Jei = mpEI->GetJacobian();
+            Eigen::Matrix<double,9,D> J = Eigen::Matrix<double,9,D>::Zero();
+            if(bPrevious)
+                J.leftCols(15) = Jei.leftCols<15>();
+            J.template block<9,9>(0,F) = Jei.rightCols<9>();
+            const Eigen::Matrix<double,D,9> JtO = J.transpose()*mpEI->information();
+            H.noalias() += JtO*J;
+            b.noalias() -= JtO*mpEI->error();
+        }
+
+        // Bias random walks, the previous biases at 9 and 12
+        {
+            mpEGR->linearizeOplus();
+            const Eigen::Matrix3d Jgi = mpEGR->jacobianOplusXi();
+            const Eigen::Matrix3d Jgj = mpEGR->jacobianOplusXj();
+            mpEAR->linearizeOplus();
+            const Eigen::Matrix3d Jai = mpEAR->jacobianOplusXi();
+            const Eigen::Matrix3d Jaj = mpEAR->jacobianOplusXj();
+            const Eigen::Matrix3d Og = mpEGR->information();
+            const Eigen::Matrix3d Oa = mpEAR->information();
+            H.template block<3,3>(F+9,F+9) += Jgj.transpose()*Og*Jgj;
+            H.template block<3,3>(F+12,F+12) += Jaj.transpose()*Oa*Jaj;
+            b.template segment<3>(F+9) -= Jgj.transpose()*Og*mpEGR->error();
+            b.template segment<3>(F+12) -= Jaj.transpose()*Oa*mpEAR->error();
+            if(bPrevious)
+            {
+                H.template block<3,3>(9,9) += Jgi.transpose()*Og*Jgi;
+                H.template block<3,3>(9,F+9) += Jgi.transpose()*Og*Jgj;
+                H.template block<3,3>(F+9,9) += Jgj.transpose()*Og*Jgi;
+                H.template block<3,3>(12,12) += Jai.transpose()*Oa*Jai;
+                H.template block<3,3>(12,F+12) += Jai.transpose()*Oa*Jaj;
+                H.template block<3,3>(F+12,12) += Jaj.transpose()*Oa*Jai;
+                b.template segment<3>(9) -= Jgi.transpose()*Og*mpEGR->error();
+                b.template segment<3>(12) -= Jai.transpose()*Oa*mpEAR->error();
+            }
+        }
+
+        // Prior of the previous frame, weighted by the Huber kernel
+        if(bPrevious && mpEP)
+        {
+            const double e2 = mpEP->chi2();
+            const double w = e2<=mthHuberPrior*mthHuberPrior ? 1. : mthHuberPrior/std::sqrt(e2);
+            const Eigen::Matrix<double,15,15> J = mpEP->GetJacobian();
+            const Eigen::Matrix<double,15,15> JtO = w*J.transpose()*mpEP->information();
+            H.template block<15,15>(0,0) += JtO*J;
+            b.template segment<15>(0) -= JtO*mpEP->error();
+        }
+
+        Eigen::LDLT<MatrixD> ldlt(H);
+        if(!ldlt.isPositive())
+        {
+            ++it;
+            break;
+        }
+        const VectorD x = ldlt.solve(b);
+
+        mpVP->oplus(x.data()+F);
+        mpVV->oplus(x.data()+F+6);
+        mpVG->oplus(x.data()+F+9);
+        mpVA->oplus(x.data()+F+12);
+        if(bPrevious)
+        {
+            mpVPk->oplus(x.data());
+            mpVVk->oplus(x.data()+6);
+            mpVGk->oplus(x.data()+9);
+            mpVAk->oplus(x.data()+12);
+        }
+    }
+
+    return it;
+}
+
+template class PoseInertialSolver<15>;
+template class PoseInertialSolver<30>;
+
+} //end ns
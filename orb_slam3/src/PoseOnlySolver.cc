@@ -0,0 +1,516 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PoseOnlySolver.h"
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Thirdparty
+#include <Eigen/Cholesky>
+
+#include "GeometricCamera.h"
+
+namespace ORB_SLAM3 {
+
+namespace {
+
+// Huber kernel as g2o::RobustKernelHuber: rho(e2) and rho'(e2)
+inline void Huber(const double e2, const double delta, double &rho0, double &rho1)
+{
+    if(e2 <= delta*delta)
+    {
+        rho0 = e2;
+        rho1 = 1.;
+    }
+    else
+    {
+        const double sqrte = std::sqrt(e2);
+        rho0 = 2*sqrte*delta - delta*delta;
+        rho1 = delta/sqrte;
+    }
+}
+
+} //end anonymous ns
+
+PoseOnlyTerms::PoseOnlyTerms(eUpdate update)
+    : mdSign(update==UPDATE_LEFT ? -1. : 1.), mbf(0.), mbRobust(true), mnRight(0)
+{
+    for(int c=0; c<2; ++c)
+    {
+        mpCamera[c] = NULL;
+        mRcr[c].setIdentity();
+        mtcr[c].setZero();
+    }
+}
+
+void PoseOnlyTerms::Clear()
+{
+    mvX.clear(); mvY.clear(); mvZ.clear();
+    mvU.clear(); mvV.clear(); mvUr.clear();
+    mvStereo.clear();
+    mvInfo.clear();
+    mvDelta.clear();
+    mvCam.clear();
+    mvLevel.clear();
+    mvEu.clear(); mvEv.clear(); mvEr.clear();
+    mvChi2.clear();
+    mbRobust = true;
+    mnRight = 0;
+}
+
+void PoseOnlyTerms::SetCamera(int nCam, GeometricCamera* pCamera, const Eigen::Matrix3d &Rcr, const Eigen::Vector3d &tcr)
+{
+    mpCamera[nCam] = pCamera;
+    mRcr[nCam] = Rcr;
+    mtcr[nCam] = tcr;
+}
+
+size_t PoseOnlyTerms::AddMono(const Eigen::Vector3d &Xw, const Eigen::Vector2d &obs, double invSigma2, double thHuber, int nCam)
+{
+    mvX.push_back(Xw[0]); mvY.push_back(Xw[1]); mvZ.push_back(Xw[2]);
+    mvU.push_back(obs[0]); mvV.push_back(obs[1]); mvUr.push_back(0.);
+    mvStereo.push_back(0.);
+    mvInfo.push_back(invSigma2);
+    mvDelta.push_back(thHuber);
+    mvCam.push_back(nCam);
+    mvLevel.push_back(0);
+    mvEu.push_back(0.); mvEv.push_back(0.); mvEr.push_back(0.);
+    mvChi2.push_back(0.);
+    if(nCam!=0)
+        mnRight++;
+    return mvLevel.size()-1;
+}
+
+size_t PoseOnlyTerms::AddStereo(const Eigen::Vector3d &Xw, const Eigen::Vector3d &obs, double invSigma2, double thHuber)
+{
+    const size_t i = AddMono(Xw, obs.head<2>(), invSigma2, thHuber, 0);
+    mvUr[i] = obs[2];
+    mvStereo[i] = 1.;
+    return i;
+}
+
+bool PoseOnlyTerms::IsPinhole() const
+{
+    return mnRight==0 && mpCamera[0] && mpCamera[0]->GetType()==mpCamera[0]->CAM_PINHOLE;
+}
+
+void PoseOnlyTerms::ComputeErrors(const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, bool bOnlyInactive)
+{
+    const size_t N = size();
+    const double* X = mvX.data();
+    const double* Y = mvY.data();
+    const double* Z = mvZ.data();
+    const double* U = mvU.data();
+    const double* V = mvV.data();
+    const double* Ur = mvUr.data();
+    const double* S = mvStereo.data();
+    const double* I = mvInfo.data();
+    const int* L = mvLevel.data();
+    double* Eu = mvEu.data();
+    double* Ev = mvEv.data();
+    double* Er = mvEr.data();
+    double* Chi2 = mvChi2.data();
+
+    if(IsPinhole())
+    {
+        const Eigen::Matrix3d Rcw = mRcr[0]*Rrw;
+        const Eigen::Vector3d tcw = mRcr[0]*trw + mtcr[0];
+        const double r00=Rcw(0,0), r01=Rcw(0,1), r02=Rcw(0,2);
+        const double r10=Rcw(1,0), r11=Rcw(1,1), r12=Rcw(1,2);
+        const double r20=Rcw(2,0), r21=Rcw(2,1), r22=Rcw(2,2);
+        const double t0=tcw[0], t1=tcw[1], t2=tcw[2];
+        const double fx = mpCamera[0]->getParameter(0);
+        const double fy = mpCamera[0]->getParameter(1);
+        const double cx = mpCamera[0]->getParameter(2);
+        const double cy = mpCamera[0]->getParameter(3);
+        const double bf = mbf;
+
+        for(size_t i=0; i<N; ++i)
+        {
+            const double x = r00*X[i] + r01*Y[i] + r02*Z[i] + t0;
+            const double y = r10*X[i] + r11*Y[i] + r12*Z[i] + t1;
+            const double z = r20*X[i] + r21*Y[i] + r22*Z[i] + t2;
+            const double invz = 1./z;
+            const double u = fx*x*invz + cx;
+            const double v = fy*y*invz + cy;
+            const double eu = U[i] - u;
+            const double ev = V[i] - v;
+            const double er = S[i]*(Ur[i] - (u - bf*invz));
+            const bool bKeep = bOnlyInactive && L[i]==0;
+            Eu[i] = bKeep ? Eu[i] : eu;
+            Ev[i] = bKeep ? Ev[i] : ev;
+            Er[i] = bKeep ? Er[i] : er;
+            Chi2[i] = bKeep ? Chi2[i] : I[i]*(eu*eu + ev*ev + er*er);
+        }
+        return;
+    }
+
+    Eigen::Matrix3d Rcw[2];
+    Eigen::Vector3d tcw[2];
+    for(int c=0; c<2; ++c)
+    {
+        Rcw[c] = mRcr[c]*Rrw;
+        tcw[c] = mRcr[c]*trw + mtcr[c];
+    }
+    for(size_t i=0; i<N; ++i)
+    {
+        if(bOnlyInactive && L[i]==0)
+            continue;
+        const int c = mvCam[i];
+        const Eigen::Vector3d Xc = Rcw[c]*Eigen::Vector3d(X[i],Y[i],Z[i]) + tcw[c];
+        const Eigen::Vector2d uv = mpCamera[c]->project(Xc);
+        Eu[i] = U[i] - uv[0];
+        Ev[i] = V[i] - uv[1];
+        Er[i] = S[i]*(Ur[i] - (uv[0] - mbf/Xc[2]));
+        Chi2[i] = I[i]*(Eu[i]*Eu[i] + Ev[i]*Ev[i] + Er[i]*Er[i]);
+    }
+}
+
+bool PoseOnlyTerms::IsDepthPositive(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw) const
+{
+    const int c = mvCam[i];
+    const Eigen::Vector3d Xr = Rrw*Eigen::Vector3d(mvX[i],mvY[i],mvZ[i]) + trw;
+    return (mRcr[c].row(2)*Xr + mtcr[c][2]) > 0.0;
+}
+
+double PoseOnlyTerms::ActiveRobustChi2() const
+{
+    double chi2 = 0.;
+    for(size_t i=0, iend=size(); i<iend; ++i)
+    {
+        if(mvLevel[i]!=0)
+            continue;
+        if(mbRobust)
+        {
+            double rho0, rho1;
+            Huber(mvChi2[i], mvDelta[i], rho0, rho1);
+            chi2 += rho0;
+        }
+        else
+            chi2 += mvChi2[i];
+    }
+    return chi2;
+}
+
+void PoseOnlyTerms::Jacobian(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, Eigen::Matrix<double,3,6> &J) const
+{
+    const int c = mvCam[i];
+    const Eigen::Vector3d Xr = Rrw*Eigen::Vector3d(mvX[i],mvY[i],mvZ[i]) + trw;
+    const Eigen::Vector3d Xc = mRcr[c]*Xr + mtcr[c];
+
+    Eigen::Matrix3d P;
+    P.topRows<2>() = mpCamera[c]->projectJac(Xc);
+    P.row(2) = P.row(0);
+    P(2,2) += mbf/(Xc[2]*Xc[2]);
+    P.row(2) *= mvStereo[i];
+
+    const double x = Xr[0];
+    const double y = Xr[1];
+    const double z = Xr[2];
+    Eigen::Matrix<double,3,6> SE3deriv;
+    SE3deriv << 0.0, z,   -y, 1.0, 0.0, 0.0,
+            -z , 0.0, x, 0.0, 1.0, 0.0,
+            y ,  -x , 0.0, 0.0, 0.0, 1.0;
+
+    J = mdSign * P * mRcr[c] * SE3deriv;
+}
+
+int PoseOnlyTerms::BuildSystem(const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw, Matrix6d &H, Vector6d &b)
+{
+    const size_t N = size();
+    if(mvW.size() < N)
+        mvW.resize(N);
+
+    // Weights: information times the Huber weight, 0 for the terms left out
+    double* W = mvW.data();
+    int nActive = 0;
+    for(size_t i=0; i<N; ++i)
+    {
+        double w = 0.;
+        if(mvLevel[i]==0)
+        {
+            double rho0, rho1 = 1.;
+            if(mbRobust)
+                Huber(mvChi2[i], mvDelta[i], rho0, rho1);
+            w = mvInfo[i]*rho1;
+            nActive++;
+        }
+        W[i] = w;
+    }
+
+    if(!IsPinhole())
+    {
+        Eigen::Matrix<double,3,6> Ji;
+        for(size_t i=0; i<N; ++i)
+        {
+            if(W[i]==0.)
+                continue;
+            Jacobian(i, Rrw, trw, Ji);
+            const Eigen::Vector3d e(mvEu[i], mvEv[i], mvEr[i]);
+            H.noalias() += Ji.transpose()*(W[i]*Ji);
+            b.noalias() -= Ji.transpose()*(W[i]*e);
+        }
+        return nActive;
+    }
+
+    const Eigen::Matrix3d M = mdSign*mRcr[0];
+    const double m00=M(0,0), m01=M(0,1), m02=M(0,2);
+    const double m10=M(1,0), m11=M(1,1), m12=M(1,2);
+    const double m20=M(2,0), m21=M(2,1), m22=M(2,2);
+    const double r00=Rrw(0,0), r01=Rrw(0,1), r02=Rrw(0,2);
+    const double r10=Rrw(1,0), r11=Rrw(1,1), r12=Rrw(1,2);
+    const double r20=Rrw(2,0), r21=Rrw(2,1), r22=Rrw(2,2);
+    const double t0=trw[0], t1=trw[1], t2=trw[2];
+    const double c00=mRcr[0](0,0), c01=mRcr[0](0,1), c02=mRcr[0](0,2);
+    const double c10=mRcr[0](1,0), c11=mRcr[0](1,1), c12=mRcr[0](1,2);
+    const double c20=mRcr[0](2,0), c21=mRcr[0](2,1), c22=mRcr[0](2,2);
+    const double u0=mtcr[0][0], u1=mtcr[0][1], u2=mtcr[0][2];
+    const double fx = mpCamera[0]->getParameter(0);
+    const double fy = mpCamera[0]->getParameter(1);
+    const double bf = mbf;
+    const double* X = mvX.data();
+    const double* Y = mvY.data();
+    const double* Z = mvZ.data();
+    const double* S = mvStereo.data();
+    const double* Eu = mvEu.data();
+    const double* Ev = mvEv.data();
+    const double* Er = mvEr.data();
+
+    // Upper triangle of H and b accumulated in nLanes independent lanes of consecutive terms, so that the inner
+    // loops map to SIMD registers. The terms left out and the padding of the last block have W=0.
+    const int nLanes = 4;
+    double h[21][nLanes] = {{0.}};
+    double g[6][nLanes] = {{0.}};
+    for(size_t i0=0; i0<N; i0+=nLanes)
+    {
+        double J[3][6][nLanes];
+        double WJ[3][6][nLanes];
+        double e[3][nLanes];
+        for(int l=0; l<nLanes; ++l)
+        {
+            const size_t i = std::min(i0+l, N-1);
+            const double w = i0+l<N ? W[i] : 0.;
+
+            // Point in the reference and camera frames
+            const double xr = r00*X[i] + r01*Y[i] + r02*Z[i] + t0;
+            const double yr = r10*X[i] + r11*Y[i] + r12*Z[i] + t1;
+            const double zr = r20*X[i] + r21*Y[i] + r22*Z[i] + t2;
+            const double xc = c00*xr + c01*yr + c02*zr + u0;
+            const double yc = c10*xr + c11*yr + c12*zr + u1;
+            const double zc = c20*xr + c21*yr + c22*zr + u2;
+            const double invz = 1./zc;
+            const double invz2 = invz*invz;
+
+            // Projection Jacobian P (3x3) times M
+            const double p00 = fx*invz, p02 = -fx*xc*invz2;
+            const double p11 = fy*invz, p12 = -fy*yc*invz2;
+            const double p22 = S[i]*(p02 + bf*invz2);
+            const double p20 = S[i]*p00;
+            double A[3][3];
+            A[0][0] = p00*m00 + p02*m20; A[0][1] = p00*m01 + p02*m21; A[0][2] = p00*m02 + p02*m22;
+            A[1][0] = p11*m10 + p12*m20; A[1][1] = p11*m11 + p12*m21; A[1][2] = p11*m12 + p12*m22;
+            A[2][0] = p20*m00 + p22*m20; A[2][1] = p20*m01 + p22*m21; A[2][2] = p20*m02 + p22*m22;
+
+            // J = A*[-[Xr]x | I]
+            for(int r=0; r<3; ++r)
+            {
+                J[r][0][l] = -A[r][1]*zr + A[r][2]*yr;
+                J[r][1][l] =  A[r][0]*zr - A[r][2]*xr;
+                J[r][2][l] = -A[r][0]*yr + A[r][1]*xr;
+                J[r][3][l] =  A[r][0];
+                J[r][4][l] =  A[r][1];
+                J[r][5][l] =  A[r][2];
+                for(int k=0; k<6; ++k)
+                    WJ[r][k][l] = w*J[r][k][l];
+            }
+            e[0][l] = Eu[i];
+            e[1][l] = Ev[i];
+            e[2][l] = Er[i];
+        }
+
+        for(int r=0; r<3; ++r)
+        {
+            int n = 0;
+            for(int a=0; a<6; ++a)
+            {
+                for(int c=a; c<6; ++c, ++n)
+                    for(int l=0; l<nLanes; ++l)
+                        h[n][l] += WJ[r][a][l]*J[r][c][l];
+                for(int l=0; l<nLanes; ++l)
+                    g[a][l] += WJ[r][a][l]*e[r][l];
+            }
+        }
+    }
+
+    int n = 0;
+    for(int a=0; a<6; ++a)
+    {
+        for(int c=a; c<6; ++c, ++n)
+        {
+            const double hac = (h[n][0] + h[n][1]) + (h[n][2] + h[n][3]);
+            H(a,c) += hac;
+            if(c!=a)
+                H(c,a) += hac;
+        }
+        b[a] -= (g[a][0] + g[a][1]) + (g[a][2] + g[a][3]);
+    }
+
+    return nActive;
+}
+
+PoseOnlyTerms::Matrix6d PoseOnlyTerms::Hessian(size_t i, const Eigen::Matrix3d &Rrw, const Eigen::Vector3d &trw) const
+{
+    Eigen::Matrix<double,3,6> J;
+    Jacobian(i, Rrw, trw, J);
+    return mvInfo[i]*J.transpose()*J;
+}
+
+PoseOnlySolver::PoseOnlySolver()
+    : mTerms(PoseOnlyTerms::UPDATE_LEFT)
+{
+    SetEstimate(g2o::SE3Quat());
+}
+
+PoseOnlySolver& PoseOnlySolver::ThreadSolver()
+{
+    static thread_local PoseOnlySolver solver;
+    return solver;
+}
+
+void PoseOnlySolver::Clear()
+{
+    mTerms.Clear();
+}
+
+void PoseOnlySolver::SetEstimate(const g2o::SE3Quat &Tcw)
+{
+    mTcw = Tcw;
+    mRcw = mTcw.rotation().toRotationMatrix();
+    mtcw = mTcw.translation();
+}
+
+void PoseOnlySolver::ComputeErrors(bool bOnlyInactive)
+{
+    mTerms.ComputeErrors(mRcw, mtcw, bOnlyInactive);
+}
+
+bool PoseOnlySolver::IsDepthPositive(size_t i) const
+{
+    return mTerms.IsDepthPositive(i, mRcw, mtcw);
+}
+
+int PoseOnlySolver::Optimize(int nIterations)
+{
+    typedef PoseOnlyTerms::Matrix6d Matrix6d;
+    typedef PoseOnlyTerms::Vector6d Vector6d;
+
+    const double tau = 1e-5;
+    const double goodStepUpperScale = 2./3.;
+    const double goodStepLowerScale = 1./3.;
+    const int maxTrialsAfterFailure = 10;
+
+    double lambda = 0.;
+    double ni = 2.;
+    int nBad = 0;
+
+    int it=0;
+    for(; it<nIterations; ++it)
+    {
+        mTerms.ComputeErrors(mRcw, mtcw);
+        double currentChi = mTerms.ActiveRobustChi2();
+        const double iniChi = currentChi;
+
+        Matrix6d H = Matrix6d::Zero();
+        Vector6d b = Vector6d::Zero();
+        if(mTerms.BuildSystem(mRcw, mtcw, H, b)==0)
+            return -1;
+
+        if(it==0)
+        {
+            lambda = tau*H.diagonal().cwiseAbs().maxCoeff();
+            ni = 2.;
+            nBad = 0;
+        }
+
+        double rho = 0.;
+        int q = 0;
+        do
+        {
+            Matrix6d Hl = H;
+            Hl.diagonal().array() += lambda;
+            Eigen::LDLT<Matrix6d> ldlt(Hl);
+            const bool bSolved = ldlt.isPositive();
+            const Vector6d x = bSolved ? Vector6d(ldlt.solve(b)) : Vector6d(Vector6d::Zero());
+
+            const g2o::SE3Quat Tcw = g2o::SE3Quat::exp(x)*mTcw;
+            const Eigen::Matrix3d Rcw = Tcw.rotation().toRotationMatrix();
+            const Eigen::Vector3d tcw = Tcw.translation();
+            mTerms.ComputeErrors(Rcw, tcw);
+            double tempChi = mTerms.ActiveRobustChi2();
+            if(!bSolved)
+                tempChi = std::numeric_limits<double>::max();
+
+            rho = (currentChi - tempChi)/(x.dot(lambda*x + b) + 1e-3);
+            if(rho>0 && std::isfinite(tempChi))
+            {
+                const double alpha = std::min(1. - std::pow(2*rho-1,3), goodStepUpperScale);
+                lambda *= std::max(goodStepLowerScale, alpha);
+                ni = 2.;
+                currentChi = tempChi;
+                mTcw = Tcw;
+                mRcw = Rcw;
+                mtcw = tcw;
+            }
+            else
+            {
+                lambda *= ni;
+                ni *= 2.;
+            }
+            q++;
+        } while(rho<0 && q<maxTrialsAfterFailure);
+
+        if(q==maxTrialsAfterFailure || rho==0)
+        {
+            ++it;
+            break;
+        }
+
+        if((iniChi-currentChi)*1e3 < iniChi)
+            nBad++;
+        else
+            nBad = 0;
+
+        if(nBad>=3)
+        {
+            ++it;
+            break;
+        }
+    }
+
+    return it;
+}
+
+} //end ns
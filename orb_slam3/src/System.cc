@@ -35,6 +35,8 @@
 
 // COVINS
 #include <comm/communicator.hpp> // for NO_LOOP_FINDER
+#include "ImagePool.h"
+#include "Optimizer.h"
 
 namespace ORB_SLAM3
 {
@@ -110,6 +112,40 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
     mpTracker = new Tracking(this, mpVocabulary, mpFrameDrawer, mpMapDrawer,
                              mpAtlas, mpKeyFrameDatabase, strSettingsFile, mSensor, strSequence);
 
+    // Optional parallel local BA and recording of the local BA problems
+    cv::FileNode node = fsSettings["LocalMapping.baThreads"];
+    if(!node.empty() && node.isInt())
+    {
+        Optimizer::SetLocalBAThreads((int)node);
+        cout << "Local BA threads: " << (int)node << endl;
+    }
+    node = fsSettings["LocalMapping.baRecordDir"];
+    if(!node.empty() && node.isString())
+    {
+        Optimizer::SetLocalBARecordDir((string)node);
+        cout << "Recording local BA problems to " << (string)node << endl;
+    }
+    node = fsSettings["LocalMapping.incrementalBA"];
+    if(!node.empty() && node.isInt())
+    {
+        Optimizer::SetIncrementalLocalBA((int)node != 0);
+        cout << "Incremental local BA: " << ((int)node != 0) << endl;
+    }
+
+    // Optional sparse linear solver per kind of optimization
+    const pair<string,Optimizer::eOptimization> vLinearSolverKeys[] = {
+        make_pair("Optimizer.linearSolver.localBA",Optimizer::OPT_LOCAL_BA),
+        make_pair("Optimizer.linearSolver.localInertialBA",Optimizer::OPT_LOCAL_INERTIAL_BA),
+        make_pair("Optimizer.linearSolver.globalBA",Optimizer::OPT_GLOBAL_BA),
+        make_pair("Optimizer.linearSolver.fullInertialBA",Optimizer::OPT_FULL_INERTIAL_BA),
+        make_pair("Optimizer.linearSolver.essentialGraph",Optimizer::OPT_ESSENTIAL_GRAPH)};
+    for(const pair<string,Optimizer::eOptimization> &key : vLinearSolverKeys)
+    {
+        node = fsSettings[key.first];
+        if(!node.empty() && node.isString() && Optimizer::SetLinearSolver(key.second,(string)node))
+            cout << key.first << ": " << (string)node << endl;
+    }
+
     //Initialize the Local Mapping thread and launch
     mpLocalMapper = new LocalMapping(this, mpAtlas, mSensor==MONOCULAR || mSensor==IMU_MONOCULAR, mSensor==IMU_MONOCULAR || mSensor==IMU_STEREO, strSequence);
     mptLocalMapping = new thread(&ORB_SLAM3::LocalMapping::Run,mpLocalMapper);
@@ -194,6 +230,8 @@ cv::Mat System::TrackStereo(const cv::Mat &imLeft, const cv::Mat &imRight, const
         exit(-1);
     }   
 
+    FlushPipelineOnChange();
+
     // Check mode change
     {
         unique_lock<mutex> lock(mMutexMode);
@@ -257,6 +295,8 @@ cv::Mat System::TrackRGBD(const cv::Mat &im, const cv::Mat &depthmap, const doub
         exit(-1);
     }    
 
+    FlushPipelineOnChange();
+
     // Check mode change
     {
         unique_lock<mutex> lock(mMutexMode);
@@ -315,6 +355,8 @@ cv::Mat System::TrackMonocular(const cv::Mat &im, const double &timestamp, const
         exit(-1);
     }
 
+    FlushPipelineOnChange();
+
     // Check mode change
     {
         unique_lock<mutex> lock(mMutexMode);
@@ -409,8 +451,30 @@ void System::ResetActiveMap()
     mbResetActiveMap = true;
 }
 
+void System::FlushPipelineOnChange()
+{
+    if(!mpTracker->IsPipelined())
+        return;
+
+    // Frames grabbed before a mode change or reset are tracked first, with the old settings. Not under the locks,
+    // tracking may request a reset itself.
+    bool bChange;
+    {
+        unique_lock<mutex> lock(mMutexMode);
+        bChange = mbActivateLocalizationMode || mbDeactivateLocalizationMode;
+    }
+    {
+        unique_lock<mutex> lock(mMutexReset);
+        bChange = bChange || mbReset || mbResetActiveMap;
+    }
+    if(bChange)
+        mpTracker->FlushPipeline();
+}
+
 void System::Shutdown()
 {
+    mpTracker->FlushPipeline();
+
     mpLocalMapper->RequestFinish();
     #ifdef COVINS_MOD
 //    #ifndef NO_LOOP_FINDER
@@ -482,11 +546,19 @@ void System::Shutdown()
         mptViewer->join();
     }
     std::cout << "Done" << std::endl;
+
+    if(covins_params::orb::send_images) {
+        const ImagePool::Stats stats = ImagePool::GetInstance()->GetStats();
+        std::cout << "Image pool: " << stats.nCopies << " frame images, " << stats.nAllocations << " allocations ("
+                  << stats.nBytesAllocated/(1024*1024) << " MB), " << stats.nBytesPooled/(1024*1024) << " MB pooled" << std::endl;
+    }
     #endif
 
     if(mpViewer)
         pangolin::BindToContext("ORB-SLAM2: Map Viewer");
 
+    mpTracker->PrintLatencyStats();
+
 #ifdef REGISTER_TIMES
     mpTracker->PrintTimeStats();
 #endif
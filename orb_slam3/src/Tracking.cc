@@ -51,7 +51,8 @@ Tracking::Tracking(System *pSys, ORBVocabulary* pVoc, FrameDrawer *pFrameDrawer,
     mbOnlyTracking(false), mbMapUpdated(false), mbVO(false), mpORBVocabulary(pVoc), mpKeyFrameDB(pKFDB),
     mpInitializer(static_cast<Initializer*>(NULL)), mpSystem(pSys), mpViewer(NULL),
     mpFrameDrawer(pFrameDrawer), mpMapDrawer(pMapDrawer), mpAtlas(pAtlas), mnLastRelocFrameId(0), time_recently_lost(5.0), time_recently_lost_visual(2.0),
-    mnInitialFrameId(0), mbCreatedMap(false), mnFirstFrameId(0), mpCamera2(nullptr)
+    mnInitialFrameId(0), mbCreatedMap(false), mnFirstFrameId(0), mpCamera2(nullptr), mpStereoPool(nullptr),
+    mHistFrameBuild("Frame build"), mHistTrack("Track"), mHistLatency("Image to pose")
 {
     // Load camera parameters from settings file
     cv::FileStorage fSettings(strSettingPath, cv::FileStorage::READ);
@@ -104,6 +105,10 @@ Tracking::Tracking(System *pSys, ORBVocabulary* pVoc, FrameDrawer *pFrameDrawer,
 #ifdef REGISTER_TIMES
     vdRectStereo_ms.clear();
     vdORBExtract_ms.clear();
+    vdORBPyramid_ms.clear();
+    vdORBFast_ms.clear();
+    vdORBDistribute_ms.clear();
+    vdORBDescriptor_ms.clear();
     vdStereoMatch_ms.clear();
     vdIMUInteg_ms.clear();
     vdPosePred_ms.clear();
@@ -118,6 +123,49 @@ Tracking::Tracking(System *pSys, ORBVocabulary* pVoc, FrameDrawer *pFrameDrawer,
 
     vnKeyFramesLM.clear();
     vnMapPointsLM.clear();
+
+    // Optional pipelined tracking (not for RGB-D)
+    mnPipelineDepth = 0;
+    mbStopPipeline = false;
+    mptFrameBuilder = nullptr;
+    cv::FileNode node = fSettings["Tracking.pipelineDepth"];
+    if(!node.empty() && node.isInt() && sensor!=System::RGBD)
+    {
+        mnPipelineDepth = std::max(node.operator int(),0);
+    }
+    if(mnPipelineDepth > 0)
+    {
+        cout << endl << "Pipelined tracking, depth: " << mnPipelineDepth << endl;
+        mptFrameBuilder = new thread(&Tracking::RunFrameBuilder,this);
+    }
+
+    // Stereo: left and right image are extracted on a persistent worker and the calling thread
+    if(sensor==System::STEREO || sensor==System::IMU_STEREO)
+    {
+        mpStereoPool = new WorkerPool(2);
+        Frame::mpStereoPool = mpStereoPool;
+    }
+
+    // Optional CPU list for the extraction workers (stereo worker first, then the ORBextractor.nThreads workers of
+    // each extractor), assigned round-robin. The tracking thread itself is not pinned.
+    node = fSettings["Tracking.workerCpus"];
+    if(!node.empty() && node.isSeq())
+    {
+        vector<int> vCpus;
+        for(cv::FileNodeIterator it = node.begin(); it != node.end(); ++it)
+            vCpus.push_back((int)*it);
+
+        int nNext = 0;
+        if(mpStereoPool)
+            nNext = mpStereoPool->SetAffinity(vCpus,nNext);
+        nNext = mpORBextractorLeft->SetAffinity(vCpus,nNext);
+        if(sensor==System::STEREO || sensor==System::IMU_STEREO)
+            nNext = mpORBextractorRight->SetAffinity(vCpus,nNext);
+        if(sensor==System::MONOCULAR || sensor==System::IMU_MONOCULAR)
+            nNext = mpIniORBextractor->SetAffinity(vCpus,nNext);
+
+        cout << "Extraction workers pinned to " << vCpus.size() << " CPUs" << endl;
+    }
 }
 
 #ifdef REGISTER_TIMES
@@ -290,6 +338,27 @@ void Tracking::PrintTimeStats()
     std::cout << "ORB Extraction: " << average << "$\\pm$" << deviation << std::endl;
     f << "ORB Extraction: " << average << "$\\pm$" << deviation << std::endl;
 
+    // stages of the left extractor
+    average = calcAverage(vdORBPyramid_ms);
+    deviation = calcDeviation(vdORBPyramid_ms, average);
+    std::cout << "  - Pyramid: " << average << "$\\pm$" << deviation << std::endl;
+    f << "  - Pyramid: " << average << "$\\pm$" << deviation << std::endl;
+
+    average = calcAverage(vdORBFast_ms);
+    deviation = calcDeviation(vdORBFast_ms, average);
+    std::cout << "  - FAST: " << average << "$\\pm$" << deviation << std::endl;
+    f << "  - FAST: " << average << "$\\pm$" << deviation << std::endl;
+
+    average = calcAverage(vdORBDistribute_ms);
+    deviation = calcDeviation(vdORBDistribute_ms, average);
+    std::cout << "  - Distribution+Orientation: " << average << "$\\pm$" << deviation << std::endl;
+    f << "  - Distribution+Orientation: " << average << "$\\pm$" << deviation << std::endl;
+
+    average = calcAverage(vdORBDescriptor_ms);
+    deviation = calcDeviation(vdORBDescriptor_ms, average);
+    std::cout << "  - Blur+Descriptors: " << average << "$\\pm$" << deviation << std::endl;
+    f << "  - Blur+Descriptors: " << average << "$\\pm$" << deviation << std::endl;
+
     if(!vdStereoMatch_ms.empty())
     {
         average = calcAverage(vdStereoMatch_ms);
@@ -493,7 +562,29 @@ void Tracking::PrintTimeStats()
 
 Tracking::~Tracking()
 {
+    if(mptFrameBuilder)
+    {
+        {
+            unique_lock<mutex> lock(mMutexPipeline);
+            mbStopPipeline = true;
+        }
+        mcvPipelineInput.notify_all();
+        mptFrameBuilder->join();
+        delete mptFrameBuilder;
+
+        // Frames that were never tracked (no Shutdown() before). The worker finishes the frame it builds before it
+        // checks the stop flag, so after the join all frames are owned by mdPipeline.
+        for(PendingFrame* pPending : mdPipeline)
+            delete pPending;
+        mdPipeline.clear();
+        mdPipelineInput.clear();
+    }
 
+    if(mpStereoPool)
+    {
+        Frame::mpStereoPool = nullptr;
+        delete mpStereoPool;
+    }
 }
 
 bool Tracking::ParseCamParamFile(cv::FileStorage &fSettings)
@@ -1033,6 +1124,7 @@ bool Tracking::ParseORBParamFile(cv::FileStorage &fSettings)
 {
     bool b_miss_params = false;
     int nFeatures, nLevels, fIniThFAST, fMinThFAST;
+    int nThreads = 1;
     float fScaleFactor;
 
     cv::FileNode node = fSettings["ORBextractor.nFeatures"];
@@ -1090,18 +1182,25 @@ bool Tracking::ParseORBParamFile(cv::FileStorage &fSettings)
         b_miss_params = true;
     }
 
+    // optional, threads per extractor (1: sequential)
+    node = fSettings["ORBextractor.nThreads"];
+    if(!node.empty() && node.isInt())
+    {
+        nThreads = std::max(node.operator int(),1);
+    }
+
     if(b_miss_params)
     {
         return false;
     }
 
-    mpORBextractorLeft = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST);
+    mpORBextractorLeft = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST,nThreads);
 
     if(mSensor==System::STEREO || mSensor==System::IMU_STEREO)
-        mpORBextractorRight = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST);
+        mpORBextractorRight = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST,nThreads);
 
     if(mSensor==System::MONOCULAR || mSensor==System::IMU_MONOCULAR)
-        mpIniORBextractor = new ORBextractor(5*nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST);
+        mpIniORBextractor = new ORBextractor(5*nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST,nThreads);
 
     cout << endl << "ORB Extractor Parameters: " << endl;
     cout << "- Number of Features: " << nFeatures << endl;
@@ -1109,6 +1208,7 @@ bool Tracking::ParseORBParamFile(cv::FileStorage &fSettings)
     cout << "- Scale Factor: " << fScaleFactor << endl;
     cout << "- Initial Fast Threshold: " << fIniThFAST << endl;
     cout << "- Minimum Fast Threshold: " << fMinThFAST << endl;
+    cout << "- Threads per Extractor: " << nThreads << endl;
 
     return true;
 }
@@ -1240,57 +1340,49 @@ void Tracking::SetStepByStep(bool bSet)
 
 cv::Mat Tracking::GrabImageStereo(const cv::Mat &imRectLeft, const cv::Mat &imRectRight, const double &timestamp, string filename)
 {
-    mImGray = imRectLeft;
+    cv::Mat imGrayLeft = imRectLeft;
     cv::Mat imGrayRight = imRectRight;
-    mImRight = imRectRight;
 
-    if(mImGray.channels()==3)
+    if(imGrayLeft.channels()==3)
     {
         if(mbRGB)
         {
-            cvtColor(mImGray,mImGray,cv::COLOR_RGB2GRAY);
+            cvtColor(imGrayLeft,imGrayLeft,cv::COLOR_RGB2GRAY);
             cvtColor(imGrayRight,imGrayRight,cv::COLOR_RGB2GRAY);
         }
         else
         {
-            cvtColor(mImGray,mImGray,cv::COLOR_BGR2GRAY);
+            cvtColor(imGrayLeft,imGrayLeft,cv::COLOR_BGR2GRAY);
             cvtColor(imGrayRight,imGrayRight,cv::COLOR_BGR2GRAY);
         }
     }
-    else if(mImGray.channels()==4)
+    else if(imGrayLeft.channels()==4)
     {
         if(mbRGB)
         {
-            cvtColor(mImGray,mImGray,cv::COLOR_RGBA2GRAY);
+            cvtColor(imGrayLeft,imGrayLeft,cv::COLOR_RGBA2GRAY);
             cvtColor(imGrayRight,imGrayRight,cv::COLOR_RGBA2GRAY);
         }
         else
         {
-            cvtColor(mImGray,mImGray,cv::COLOR_BGRA2GRAY);
+            cvtColor(imGrayLeft,imGrayLeft,cv::COLOR_BGRA2GRAY);
             cvtColor(imGrayRight,imGrayRight,cv::COLOR_BGRA2GRAY);
         }
     }
+    else if(IsPipelined())
+    {
+        // the caller may reuse its buffers before the frame is built
+        imGrayLeft = imRectLeft.clone();
+        imGrayRight = imRectRight.clone();
+    }
 
-    if (mSensor == System::STEREO && !mpCamera2)
-        mCurrentFrame = Frame(mImGray,imGrayRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera);
-    else if(mSensor == System::STEREO && mpCamera2)
-        mCurrentFrame = Frame(mImGray,imGrayRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,mpCamera2,mTlr);
-    else if(mSensor == System::IMU_STEREO && !mpCamera2)
-        mCurrentFrame = Frame(mImGray,imGrayRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,&mLastFrame,*mpImuCalib);
-    else if(mSensor == System::IMU_STEREO && mpCamera2)
-        mCurrentFrame = Frame(mImGray,imGrayRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,mpCamera2,mTlr,&mLastFrame,*mpImuCalib);
-
-    mCurrentFrame.mNameFile = filename;
-    mCurrentFrame.mnDataset = mnNumDataset;
-
-#ifdef REGISTER_TIMES
-    vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
-    vdStereoMatch_ms.push_back(mCurrentFrame.mTimeStereoMatch);
-#endif
-
-    Track();
+    PendingFrame* pPending = new PendingFrame();
+    pPending->imLeft = imGrayLeft;
+    pPending->imRight = imGrayRight;
+    pPending->timestamp = timestamp;
+    pPending->filename = filename;
 
-    return mCurrentFrame.mTcw.clone();
+    return ProcessFrame(pPending);
 }
 
 
@@ -1324,6 +1416,13 @@ cv::Mat Tracking::GrabImageRGBD(const cv::Mat &imRGB,const cv::Mat &imD, const d
 
 #ifdef REGISTER_TIMES
     vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
+    {
+        const ORBextractor::StageTimes stages = mCurrentFrame.mpORBextractorLeft->GetStageTimes();
+        vdORBPyramid_ms.push_back(stages.pyramid);
+        vdORBFast_ms.push_back(stages.fast);
+        vdORBDistribute_ms.push_back(stages.distribute);
+        vdORBDescriptor_ms.push_back(stages.descriptors);
+    }
 #endif
 
     Track();
@@ -1334,56 +1433,236 @@ cv::Mat Tracking::GrabImageRGBD(const cv::Mat &imRGB,const cv::Mat &imD, const d
 
 cv::Mat Tracking::GrabImageMonocular(const cv::Mat &im, const double &timestamp, string filename)
 {
-    mImGray = im;
+    cv::Mat imGray = im;
 
-    if(mImGray.channels()==3)
+    if(imGray.channels()==3)
     {
         if(mbRGB)
-            cvtColor(mImGray,mImGray,cv::COLOR_RGB2GRAY);
+            cvtColor(imGray,imGray,cv::COLOR_RGB2GRAY);
         else
-            cvtColor(mImGray,mImGray,cv::COLOR_BGR2GRAY);
+            cvtColor(imGray,imGray,cv::COLOR_BGR2GRAY);
     }
-    else if(mImGray.channels()==4)
+    else if(imGray.channels()==4)
     {
         if(mbRGB)
-            cvtColor(mImGray,mImGray,cv::COLOR_RGBA2GRAY);
+            cvtColor(imGray,imGray,cv::COLOR_RGBA2GRAY);
         else
-            cvtColor(mImGray,mImGray,cv::COLOR_BGRA2GRAY);
+            cvtColor(imGray,imGray,cv::COLOR_BGRA2GRAY);
+    }
+    else if(IsPipelined())
+    {
+        // the caller may reuse its buffer before the frame is built
+        imGray = im.clone();
     }
 
+    PendingFrame* pPending = new PendingFrame();
+    pPending->imLeft = imGray;
+    pPending->timestamp = timestamp;
+    pPending->filename = filename;
+
+    return ProcessFrame(pPending);
+}
+
+bool Tracking::UseIniExtractor()
+{
+    if(mSensor == System::MONOCULAR)
+        return mState==NOT_INITIALIZED || mState==NO_IMAGES_YET ||(lastID - initID) < mMaxFrames;
+    else if(mSensor == System::IMU_MONOCULAR)
+        return mState==NOT_INITIALIZED || mState==NO_IMAGES_YET;
+    return false;
+}
+
+void Tracking::BuildFrame(PendingFrame &pending, Frame* pPrevF)
+{
+    const double &timestamp = pending.timestamp;
+    pending.bLinkPrevFrame = false;
+    const std::chrono::steady_clock::time_point time_StartBuild = std::chrono::steady_clock::now();
+
     if (mSensor == System::MONOCULAR)
     {
-        if(mState==NOT_INITIALIZED || mState==NO_IMAGES_YET ||(lastID - initID) < mMaxFrames)
-            mCurrentFrame = Frame(mImGray,timestamp,mpIniORBextractor,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth);
-        else
-            mCurrentFrame = Frame(mImGray,timestamp,mpORBextractorLeft,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth);
+        ORBextractor* pExtractor = pending.bIniExtractor ? mpIniORBextractor : mpORBextractorLeft;
+        pending.frame = Frame(pending.imLeft,timestamp,pExtractor,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth);
     }
     else if(mSensor == System::IMU_MONOCULAR)
     {
-        if(mState==NOT_INITIALIZED || mState==NO_IMAGES_YET)
-        {
-            mCurrentFrame = Frame(mImGray,timestamp,mpIniORBextractor,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth,&mLastFrame,*mpImuCalib);
-        }
-        else
-            mCurrentFrame = Frame(mImGray,timestamp,mpORBextractorLeft,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth,&mLastFrame,*mpImuCalib);
+        ORBextractor* pExtractor = pending.bIniExtractor ? mpIniORBextractor : mpORBextractorLeft;
+        pending.frame = Frame(pending.imLeft,timestamp,pExtractor,mpORBVocabulary,mpCamera,mDistCoef,mbf,mThDepth,pPrevF,*mpImuCalib);
+        pending.bLinkPrevFrame = !pPrevF;
+    }
+    else if (mSensor == System::STEREO && !mpCamera2)
+        pending.frame = Frame(pending.imLeft,pending.imRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera);
+    else if(mSensor == System::STEREO && mpCamera2)
+        pending.frame = Frame(pending.imLeft,pending.imRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,mpCamera2,mTlr);
+    else if(mSensor == System::IMU_STEREO && !mpCamera2)
+    {
+        pending.frame = Frame(pending.imLeft,pending.imRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,pPrevF,*mpImuCalib);
+        pending.bLinkPrevFrame = !pPrevF;
+    }
+    else if(mSensor == System::IMU_STEREO && mpCamera2)
+    {
+        pending.frame = Frame(pending.imLeft,pending.imRight,timestamp,mpORBextractorLeft,mpORBextractorRight,mpORBVocabulary,mK,mDistCoef,mbf,mThDepth,mpCamera,mpCamera2,mTlr,pPrevF,*mpImuCalib);
+        pending.bLinkPrevFrame = !pPrevF;
     }
 
-    if (mState==NO_IMAGES_YET)
-        t0=timestamp;
+    mHistFrameBuild.Add(std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(std::chrono::steady_clock::now() - time_StartBuild).count());
 
-    mCurrentFrame.mNameFile = filename;
+#ifdef REGISTER_TIMES
+    pending.stages = pending.frame.mpORBextractorLeft->GetStageTimes();
+#endif
+}
+
+cv::Mat Tracking::TrackFrame(PendingFrame &pending)
+{
+    const bool bMono = mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR;
+
+    mImGray = pending.imLeft;
+    if(!bMono)
+        mImRight = pending.imRight;
+
+    mCurrentFrame = pending.frame;
+    if(pending.bLinkPrevFrame)
+    {
+        // what the Frame constructor does with the previous frame, now that it has been tracked
+        mCurrentFrame.mpPrevFrame = &mLastFrame;
+        mCurrentFrame.mVw = mLastFrame.mVw.empty() ? cv::Mat() : mLastFrame.mVw.clone();
+    }
+
+    if (bMono && mState==NO_IMAGES_YET)
+        t0=pending.timestamp;
+
+    mCurrentFrame.mNameFile = pending.filename;
     mCurrentFrame.mnDataset = mnNumDataset;
 
 #ifdef REGISTER_TIMES
     vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
+    vdORBPyramid_ms.push_back(pending.stages.pyramid);
+    vdORBFast_ms.push_back(pending.stages.fast);
+    vdORBDistribute_ms.push_back(pending.stages.distribute);
+    vdORBDescriptor_ms.push_back(pending.stages.descriptors);
+    if(!bMono)
+        vdStereoMatch_ms.push_back(mCurrentFrame.mTimeStereoMatch);
 #endif
 
-    lastID = mCurrentFrame.mnId;
+    if(bMono)
+        lastID = mCurrentFrame.mnId;
+
+    const std::chrono::steady_clock::time_point time_StartTrack = std::chrono::steady_clock::now();
     Track();
+    const std::chrono::steady_clock::time_point time_EndTrack = std::chrono::steady_clock::now();
+    mHistTrack.Add(std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndTrack - time_StartTrack).count());
+    mHistLatency.Add(std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndTrack - pending.tGrab).count());
 
     return mCurrentFrame.mTcw.clone();
 }
 
+cv::Mat Tracking::ProcessFrame(PendingFrame* pPending)
+{
+    // extractor choice and IMU link as for the frame after the last tracked one
+    pPending->bIniExtractor = UseIniExtractor();
+    pPending->bReady = false;
+    pPending->tGrab = std::chrono::steady_clock::now();
+
+    if(!IsPipelined())
+    {
+        BuildFrame(*pPending,&mLastFrame);
+        cv::Mat Tcw = TrackFrame(*pPending);
+        delete pPending;
+        return Tcw;
+    }
+
+    // The IMU measurements up to this image are already queued (System::Track* grabs them first), and
+    // PreintegrateIMU only consumes them up to the stamp of the frame being tracked.
+    {
+        unique_lock<mutex> lock(mMutexPipeline);
+        mdPipeline.push_back(pPending);
+        mdPipelineInput.push_back(pPending);
+        if((int)mdPipeline.size() <= mnPipelineDepth)
+        {
+            mcvPipelineInput.notify_one();
+            return cv::Mat();
+        }
+    }
+    mcvPipelineInput.notify_one();
+
+    return TrackPipelineFront();
+}
+
+cv::Mat Tracking::TrackPipelineFront()
+{
+    PendingFrame* pPending;
+    {
+        unique_lock<mutex> lock(mMutexPipeline);
+        mcvPipelineReady.wait(lock,[this]{return mdPipeline.front()->bReady;});
+        pPending = mdPipeline.front();
+
+        if(pPending->bIniExtractor != UseIniExtractor())
+        {
+            // The state changed while the frame was queued (initialization done, map reset): extract again with the
+            // right extractor, as the sequential version would have. The worker has to be idle, it uses the same
+            // extractors. The frame keeps its id.
+            mcvPipelineReady.wait(lock,[this]{return mdPipeline.back()->bReady;});
+
+            const long unsigned int nNextId = Frame::nNextId;
+            Frame::nNextId = pPending->frame.mnId;
+            pPending->bIniExtractor = UseIniExtractor();
+            BuildFrame(*pPending,nullptr);
+            Frame::nNextId = nNextId;
+        }
+
+        mdPipeline.pop_front();
+    }
+
+    cv::Mat Tcw = TrackFrame(*pPending);
+    delete pPending;
+    return Tcw;
+}
+
+void Tracking::FlushPipeline()
+{
+    while(true)
+    {
+        {
+            unique_lock<mutex> lock(mMutexPipeline);
+            if(mdPipeline.empty())
+                return;
+        }
+        TrackPipelineFront();
+    }
+}
+
+void Tracking::PrintLatencyStats()
+{
+    cout << endl << "Tracking latency" << endl;
+    mHistFrameBuild.Print(cout);
+    mHistTrack.Print(cout);
+    mHistLatency.Print(cout);
+}
+
+void Tracking::RunFrameBuilder()
+{
+    while(true)
+    {
+        PendingFrame* pPending;
+        {
+            unique_lock<mutex> lock(mMutexPipeline);
+            mcvPipelineInput.wait(lock,[this]{return mbStopPipeline || !mdPipelineInput.empty();});
+            if(mbStopPipeline)
+                return;
+            pPending = mdPipelineInput.front();
+            mdPipelineInput.pop_front();
+        }
+
+        // mLastFrame is in use by the tracking - the link to it is set in TrackFrame
+        BuildFrame(*pPending,nullptr);
+
+        {
+            unique_lock<mutex> lock(mMutexPipeline);
+            pPending->bReady = true;
+        }
+        mcvPipelineReady.notify_all();
+    }
+}
+
 
 void Tracking::GrabImuData(const IMU::Point &imuMeasurement)
 {
@@ -3245,23 +3524,56 @@ void Tracking::SearchLocalPoints()
     int nToMatch=0;
 
     // Project points in frame and check its visibility
-    for(vector<MapPoint*>::iterator vit=mvpLocalMapPoints.begin(), vend=mvpLocalMapPoints.end(); vit!=vend; vit++)
+    if(mCurrentFrame.Nleft == -1)
     {
-        MapPoint* pMP = *vit;
+        // all points in one pass
+        vector<MapPoint*> &vpToProject = mFrustumBuffers.vpMPs;
+        vpToProject.clear();
+        for(vector<MapPoint*>::iterator vit=mvpLocalMapPoints.begin(), vend=mvpLocalMapPoints.end(); vit!=vend; vit++)
+        {
+            MapPoint* pMP = *vit;
+
+            if(pMP->mnLastFrameSeen == mCurrentFrame.mnId)
+                continue;
+            if(pMP->isBad())
+                continue;
+            vpToProject.push_back(pMP);
+        }
 
-        if(pMP->mnLastFrameSeen == mCurrentFrame.mnId)
-            continue;
-        if(pMP->isBad())
-            continue;
         // Project (this fills MapPoint variables for matching)
-        if(mCurrentFrame.isInFrustum(pMP,0.5))
+        mCurrentFrame.isInFrustum(mFrustumBuffers,0.5);
+
+        for(size_t i=0; i<vpToProject.size(); i++)
         {
-            pMP->IncreaseVisible();
-            nToMatch++;
+            MapPoint* pMP = vpToProject[i];
+            if(pMP->mbTrackInView)
+            {
+                pMP->IncreaseVisible();
+                nToMatch++;
+                mCurrentFrame.mmProjectPoints[pMP->mnId] = cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
+            }
         }
-        if(pMP->mbTrackInView)
+    }
+    else
+    {
+        for(vector<MapPoint*>::iterator vit=mvpLocalMapPoints.begin(), vend=mvpLocalMapPoints.end(); vit!=vend; vit++)
         {
-            mCurrentFrame.mmProjectPoints[pMP->mnId] = cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
+            MapPoint* pMP = *vit;
+
+            if(pMP->mnLastFrameSeen == mCurrentFrame.mnId)
+                continue;
+            if(pMP->isBad())
+                continue;
+            // Project (this fills MapPoint variables for matching)
+            if(mCurrentFrame.isInFrustum(pMP,0.5))
+            {
+                pMP->IncreaseVisible();
+                nToMatch++;
+            }
+            if(pMP->mbTrackInView)
+            {
+                mCurrentFrame.mmProjectPoints[pMP->mnId] = cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
+            }
         }
     }
 
@@ -3290,7 +3602,7 @@ void Tracking::SearchLocalPoints()
         if(mState==LOST || mState==RECENTLY_LOST) // Lost for less than 1 second
             th=15;
 
-        int matches = matcher.SearchByProjection(mCurrentFrame, mvpLocalMapPoints, th, mpLocalMapper->mbFarPoints, mpLocalMapper->mThFarPoints);
+        int matches = matcher.SearchByProjection(mCurrentFrame, mvpLocalMapPoints, mSearchBuffers, th, mpLocalMapper->mbFarPoints, mpLocalMapper->mThFarPoints);
     }
 }
 
@@ -0,0 +1,127 @@
+/**
+* This file is part of COVINS.
+*
+* Copyright (C) 2018-2021 Patrik Schmuck / Vision for Robotics Lab
+* (ETH Zurich) <collaborative (dot) slam (at) gmail (dot) com>
+* For more information see <https://github.com/VIS4ROB-lab/covins>
+*
+* COVINS is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the license, or
+* (at your option) any later version.
+*
+* COVINS is distributed to support research and development of
+* multi-agent system, but WITHOUT ANY WARRANTY; without even the
+* implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE. In no event will the authors be held liable for any damages
+* arising from the use of this software. See the GNU General Public
+* License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with COVINS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WorkerPool.h"
+
+// C++
+#include <iostream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ORB_SLAM3 {
+
+WorkerPool::WorkerPool(int nThreads)
+    : mpTask(nullptr), mnTasks(0), mnNext(0), mnDone(0), mbStop(false)
+{
+    for(int i=1; i<nThreads; ++i)
+        mvThreads.push_back(std::thread(&WorkerPool::Run,this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mbStop = true;
+    }
+    mCondWork.notify_all();
+    for(std::thread &t : mvThreads)
+        t.join();
+}
+
+void WorkerPool::ParallelFor(int n, const std::function<void(int)> &f)
+{
+    if(mvThreads.empty() || n <= 1)
+    {
+        for(int i=0; i<n; ++i)
+            f(i);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lockCall(mMutexCall);
+    std::unique_lock<std::mutex> lock(mMutex);
+    mpTask = &f;
+    mnTasks = n;
+    mnNext = 0;
+    mnDone = 0;
+    mCondWork.notify_all();
+
+    // the caller works as well instead of idling
+    while(mnNext < mnTasks)
+    {
+        const int i = mnNext++;
+        lock.unlock();
+        f(i);
+        lock.lock();
+        ++mnDone;
+    }
+    mCondDone.wait(lock,[this]{return mnDone == mnTasks;});
+
+    mpTask = nullptr;
+    mnTasks = 0;
+    mnNext = 0;
+}
+
+int WorkerPool::SetAffinity(const std::vector<int> &vCpus, int nFirst)
+{
+    if(vCpus.empty())
+        return nFirst;
+
+    for(std::thread &t : mvThreads)
+    {
+        const int cpu = vCpus[nFirst++ % vCpus.size()];
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu,&set);
+        if(pthread_setaffinity_np(t.native_handle(),sizeof(cpu_set_t),&set) != 0)
+            std::cerr << "WorkerPool: cannot pin worker to CPU " << cpu << std::endl;
+#else
+        (void)t;
+        (void)cpu;
+#endif
+    }
+    return nFirst;
+}
+
+void WorkerPool::Run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mCondWork.wait(lock,[this]{return mbStop || mnNext < mnTasks;});
+        if(mbStop)
+            return;
+
+        const int i = mnNext++;
+        const std::function<void(int)>* pTask = mpTask;
+        lock.unlock();
+        (*pTask)(i);
+        lock.lock();
+        if(++mnDone == mnTasks)
+            mCondDone.notify_all();
+    }
+}
+
+} //end ns
@@ -21,6 +21,11 @@
 * along with COVINS. If not, see <http://www.gnu.org/licenses/>.
 */
 
+// C++
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
 // COVINS
 #include "comm/communicator.hpp"
 #include <covins/covins_base/utils_base.hpp>
@@ -31,7 +36,9 @@
 namespace ORB_SLAM3 {
 
 Communicator::Communicator(std::string server_ip, std::string port, Atlas* map)
-    : CommunicatorBase()
+    : CommunicatorBase(),
+      queue_kfs_new_(covins_params::comm::kf_queue_size),
+      queue_kfs_update_(covins_params::comm::kf_queue_size)
 {
     covins_params::ShowParamsComm();
 
@@ -51,35 +58,125 @@ auto Communicator::ProcessAdditional()->void {
 
 }
 
+auto Communicator::PassKfToComm(KeyFrame* kf, eKfPriority prio)->void {
+    if(prio == KF_UPDATE) {
+        // the queued entry is converted when it is sent, so it already carries the newer state
+        if(kf->update_queued_.exchange(true)) return;
+        if(!queue_kfs_update_.TryPush(kf)) {
+            std::unique_lock<std::mutex> lock(mtx_update_overflow_);
+            set_kfs_update_overflow_.insert(std::make_pair(kf->mnId,kf));
+        }
+    } else {
+        // back-pressure: new KFs must not be lost. Once a KF went to the overflow, the later ones follow it to keep the order.
+        while(num_kfs_new_overflow_ > 0 || !queue_kfs_new_.TryPush(kf)) {
+            if(num_kfs_new_overflow_ > 0 || this->ShallFinish() || this->IsFinished()) {
+                // the comm thread is leaving (e.g. connection lost) and might never drain the queue
+                std::unique_lock<std::mutex> lock(mtx_new_overflow_);
+                list_kfs_new_overflow_.push_back(kf);
+                ++num_kfs_new_overflow_;
+                if(this->IsFinished() && !(num_kfs_dropped_++ % 100))
+                    std::cout << COUTWARN << "Comm " << client_id_ << ": comm finished - " << num_kfs_dropped_ << " KFs not sent" << std::endl;
+                break;
+            }
+            this->Wakeup();
+            std::unique_lock<std::mutex> lock(mtx_space_);
+            cv_space_.wait_for(lock,std::chrono::milliseconds(10));
+        }
+    }
+
+    this->Wakeup();
+}
+
+auto Communicator::Wakeup()->void {
+    std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in WaitForKfs()
+    if(waiting_) {
+        std::unique_lock<std::mutex> lock(mtx_wakeup_);
+        cv_wakeup_.notify_one();
+    }
+}
+
+auto Communicator::RecvMsg()->void {
+    CommunicatorBase::RecvMsg();
+    this->Wakeup(); // the recv thread sets finish when it exits
+}
+
+auto Communicator::WriteToBuffer()->void {
+    CommunicatorBase::WriteToBuffer();
+    data_in_ = true;
+    this->Wakeup();
+}
+
+auto Communicator::ProcessKf(KeyFrame* kfi)->void {
+    if(kfi->sent_once_ && !covins_params::comm::send_updates) return;
+    if(kfi->sent_once_ && kfi->mnId == 0) return;
+    covins::data_bundle map_chunk;
+    covins::MsgKeyframe msg_kf;
+    kfi->ConvertToMsg(msg_kf,kfi->mPrevKF,kfi->sent_once_,client_id_);
+    kfi->sent_once_ = true;
+    map_chunk.keyframes.push_back(msg_kf);
+    auto kfi_lms = kfi->GetMapPointMatches();
+    for(auto lmi : kfi_lms){
+        if(!lmi) continue;
+        if(lmi->sent_once_ && !covins_params::comm::send_updates) continue;
+        covins::MsgLandmark msg_lm;
+        lmi->ConvertToMsg(msg_lm,kfi,lmi->sent_once_,client_id_);
+        lmi->sent_once_ = true;
+        map_chunk.landmarks.push_back(msg_lm);
+    }
+    this->PassDataBundle(map_chunk);
+}
+
 auto Communicator::ProcessKfBuffer()->void {
-    std::unique_lock<std::mutex>(mtx_kf_queue_);
+    // new KFs first - updates only fill up the remaining budget of this iteration
+    const int max_kfs = covins_params::comm::max_sent_kfs_per_iteration > 0 ? covins_params::comm::max_sent_kfs_per_iteration : std::numeric_limits<int>::max();
     int cnt = 0;
-
-    while(!kf_out_buffer_.empty()) {
-        auto kfi = kf_out_buffer_.front();
-        kf_out_buffer_.pop_front();
-        if(kfi->sent_once_ && !covins_params::comm::send_updates) continue;
-        if(kfi->sent_once_ && kfi->mnId == 0) continue;
-        covins::data_bundle map_chunk;
-        covins::MsgKeyframe msg_kf;
-        kfi->ConvertToMsg(msg_kf,kfi->mPrevKF,kfi->sent_once_,client_id_);
-        kfi->sent_once_ = true;
-        map_chunk.keyframes.push_back(msg_kf);
-        if(!kfi->sent_once_) cnt++;
-        auto kfi_lms = kfi->GetMapPointMatches();
-        for(auto lmi : kfi_lms){
-            if(!lmi) continue;
-            if(lmi->sent_once_ && !covins_params::comm::send_updates) continue;
-            covins::MsgLandmark msg_lm;
-            lmi->ConvertToMsg(msg_lm,kfi,lmi->sent_once_,client_id_);
-            lmi->sent_once_ = true;
-            map_chunk.landmarks.push_back(msg_lm);
+    KeyFrame* kfi;
+    while(cnt < max_kfs && queue_kfs_new_.TryPop(kfi)) {
+        this->ProcessKf(kfi);
+        cnt++;
+    }
+    if(cnt) {
+        std::unique_lock<std::mutex> lock(mtx_space_);
+        cv_space_.notify_all();
+    }
+    if(cnt < max_kfs && queue_kfs_new_.Empty()) {
+        // overflow KFs are newer than all KFs in the queue
+        std::unique_lock<std::mutex> lock(mtx_new_overflow_);
+        while(cnt < max_kfs && !list_kfs_new_overflow_.empty()) {
+            kfi = list_kfs_new_overflow_.front();
+            list_kfs_new_overflow_.pop_front();
+            lock.unlock();
+            this->ProcessKf(kfi);
+            cnt++;
+            lock.lock();
+            --num_kfs_new_overflow_;
+        }
+    }
+    while(cnt < max_kfs && queue_kfs_update_.TryPop(kfi)) {
+        kfi->update_queued_ = false; // before the conversion - a later update is queued again
+        this->ProcessKf(kfi);
+        cnt++;
+    }
+    if(cnt < max_kfs) {
+        std::unique_lock<std::mutex> lock(mtx_update_overflow_);
+        while(cnt < max_kfs && !set_kfs_update_overflow_.empty()) {
+            kfi = set_kfs_update_overflow_.begin()->second;
+            set_kfs_update_overflow_.erase(set_kfs_update_overflow_.begin());
+            kfi->update_queued_ = false;
+            lock.unlock();
+            this->ProcessKf(kfi);
+            cnt++;
+            lock.lock();
         }
-        this->PassDataBundle(map_chunk);
-        if(cnt >= covins_params::comm::max_sent_kfs_per_iteration) break;
     }
 }
 
+auto Communicator::HasKfs()->bool {
+    if(!queue_kfs_new_.Empty() || !queue_kfs_update_.Empty() || num_kfs_new_overflow_ > 0) return true;
+    std::unique_lock<std::mutex> lock(mtx_update_overflow_);
+    return !set_kfs_update_overflow_.empty();
+}
+
 auto Communicator::ProcessKeyframeMessages()->void {
     std::unique_lock<std::mutex> lock(mtx_in_);
     while(!buffer_keyframes_in_.empty()) {
@@ -102,6 +199,17 @@ auto Communicator::ProcessNewLandmarks()->void {
 
 }
 
+auto Communicator::WaitForKfs(int timeout_ms)->void {
+    if(data_in_ || this->HasKfs()) return;
+
+    std::unique_lock<std::mutex> lock(mtx_wakeup_);
+    waiting_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // re-check after announcing the wait - a producer that pushed before seeing waiting_ is caught here
+    cv_wakeup_.wait_for(lock,std::chrono::milliseconds(timeout_ms),[this]{return data_in_ || this->HasKfs() || this->ShallFinish();});
+    waiting_ = false;
+}
+
 auto Communicator::Run()->void {
     std::thread thread_recv(&Communicator::RecvMsg, this);
     thread_recv.detach();
@@ -110,6 +218,7 @@ auto Communicator::Run()->void {
     {
         this->ProcessKfBuffer();
         this->ProcessBufferOut();
+        data_in_ = false; // before draining - data written meanwhile is caught by the next iteration
         this->ProcessBufferIn();
         if(this->TryLock()){
             this->ProcessKeyframeMessages();
@@ -121,21 +230,24 @@ auto Communicator::Run()->void {
         }
 
         if(this->ShallFinish()){
-            std::unique_lock<std::mutex>(mtx_kf_queue_);
-            if(!kf_out_buffer_.empty()) {
-                std::cout << "Comm:: waiting for kf_out_buffer_" << std::endl;
+            if(this->HasKfs()) {
+                std::cout << "Comm:: waiting for KF queue" << std::endl;
             } else {
                 std::cout << "Comm " << client_id_ << ": close" << std::endl;
                 break;
             }
         }
-        usleep(1000);
+        this->WaitForKfs(100);
     }
 
     std::cout << "Comm " << client_id_ << ": leave " << __PRETTY_FUNCTION__ << std::endl;
 
-    std::unique_lock<std::mutex> lock(mtx_finish_);
-    is_finished_ = true;
+    {
+        std::unique_lock<std::mutex> lock(mtx_finish_);
+        is_finished_ = true;
+    }
+    std::unique_lock<std::mutex> lock(mtx_space_);
+    cv_space_.notify_all();                                 // producers blocked on a full queue
 }
 
 } //end ns